@@ -0,0 +1,367 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+// Qt
+#include <QtTest>
+// KWin
+#include "../../src/client/clientmanagement.h"
+#include "../../src/client/compositor.h"
+#include "../../src/client/connection_thread.h"
+#include "../../src/client/event_queue.h"
+#include "../../src/client/registry.h"
+#include "../../src/client/shm_pool.h"
+#include "../../src/client/surface.h"
+#include "../../src/server/clientmanagement_interface.h"
+#include "../../src/server/compositor_interface.h"
+#include "../../src/server/display.h"
+#include "../../src/server/surface_interface.h"
+
+using namespace KWayland::Client;
+
+class TestClientManagement : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TestClientManagement(QObject *parent = nullptr);
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void testInitialSnapshot();
+    void testAddChangeRemove();
+    void testRemoveMany();
+    void testBatchAppliedOnDone();
+    void testUnchangedStates();
+    void testCaptureDamagedRows();
+
+private:
+    KWaylandServer::Display *m_display;
+    KWaylandServer::ClientManagementInterface *m_clientManagementInterface;
+    KWaylandServer::CompositorInterface *m_compositorInterface;
+    KWayland::Client::ConnectionThread *m_connection;
+    KWayland::Client::ClientManagement *m_clientManagement;
+    KWayland::Client::Compositor *m_compositor;
+    KWayland::Client::ShmPool *m_shm;
+    KWayland::Client::EventQueue *m_queue;
+    QThread *m_thread;
+    QList<KWaylandServer::ClientManagementInterface::WindowState *> m_states;
+};
+
+static const QString s_socketName = QStringLiteral("kwayland-test-wayland-client-management-0");
+
+static KWaylandServer::ClientManagementInterface::WindowState *createWindowState(int32_t windowId, const QRect &geometry)
+{
+    auto state = new KWaylandServer::ClientManagementInterface::WindowState;
+    memset(state, 0, sizeof(*state));
+    state->pid = 1000 + windowId;
+    state->windowId = windowId;
+    qstrncpy(state->resourceName, "test", sizeof(state->resourceName));
+    state->geometry.x = geometry.x();
+    state->geometry.y = geometry.y();
+    state->geometry.width = geometry.width();
+    state->geometry.height = geometry.height();
+    return state;
+}
+
+TestClientManagement::TestClientManagement(QObject *parent)
+    : QObject(parent)
+    , m_display(nullptr)
+    , m_clientManagementInterface(nullptr)
+    , m_compositorInterface(nullptr)
+    , m_connection(nullptr)
+    , m_clientManagement(nullptr)
+    , m_compositor(nullptr)
+    , m_shm(nullptr)
+    , m_queue(nullptr)
+    , m_thread(nullptr)
+{
+}
+
+void TestClientManagement::init()
+{
+    using namespace KWaylandServer;
+    delete m_display;
+    m_display = new Display(this);
+    m_display->addSocketName(s_socketName);
+    m_display->start();
+    QVERIFY(m_display->isRunning());
+    m_display->createShm();
+    m_compositorInterface = new CompositorInterface(m_display, m_display);
+
+    m_clientManagementInterface = new ClientManagementInterface(m_display, m_display);
+    m_states << createWindowState(1, QRect(0, 0, 100, 100));
+    m_clientManagementInterface->setWindowStates(m_states);
+
+    // setup connection
+    m_connection = new KWayland::Client::ConnectionThread;
+    QSignalSpy connectedSpy(m_connection, &ConnectionThread::connected);
+    m_connection->setSocketName(s_socketName);
+
+    m_thread = new QThread(this);
+    m_connection->moveToThread(m_thread);
+    m_thread->start();
+
+    m_connection->initConnection();
+    QVERIFY(connectedSpy.wait());
+
+    m_queue = new KWayland::Client::EventQueue(this);
+    m_queue->setup(m_connection);
+    QVERIFY(m_queue->isValid());
+
+    Registry registry;
+    QSignalSpy clientManagementSpy(&registry, &Registry::clientManagementAnnounced);
+    QVERIFY(clientManagementSpy.isValid());
+    QSignalSpy windowStatesSpy(&registry, &Registry::windowStatesAnnounced);
+    QVERIFY(windowStatesSpy.isValid());
+    QSignalSpy compositorSpy(&registry, &Registry::compositorAnnounced);
+    QSignalSpy shmSpy(&registry, &Registry::shmAnnounced);
+    registry.setEventQueue(m_queue);
+    registry.create(m_connection->display());
+    QVERIFY(registry.isValid());
+    registry.setup();
+
+    QVERIFY(clientManagementSpy.wait());
+    QCOMPARE(compositorSpy.count(), 1);
+    QCOMPARE(shmSpy.count(), 1);
+    m_compositor = registry.createCompositor(compositorSpy.first().first().value<quint32>(), compositorSpy.first().last().value<quint32>(), this);
+    QVERIFY(m_compositor->isValid());
+    m_shm = registry.createShmPool(shmSpy.first().first().value<quint32>(), shmSpy.first().last().value<quint32>(), this);
+    QVERIFY(m_shm->isValid());
+    m_clientManagement = registry.createClientManagement(clientManagementSpy.first().first().value<quint32>(),
+                                                         clientManagementSpy.first().last().value<quint32>(),
+                                                         this);
+    QVERIFY(m_clientManagement->isValid());
+    if (windowStatesSpy.isEmpty()) {
+        QVERIFY(windowStatesSpy.wait());
+    }
+    m_clientManagement->setupWindowStates(registry.bindWindowStates(windowStatesSpy.first().first().value<quint32>(),
+                                                                    windowStatesSpy.first().last().value<quint32>()));
+}
+
+void TestClientManagement::cleanup()
+{
+#define CLEANUP(variable)                                                                                                                                      \
+    if (variable) {                                                                                                                                            \
+        delete variable;                                                                                                                                       \
+        variable = nullptr;                                                                                                                                    \
+    }
+    CLEANUP(m_clientManagement)
+    CLEANUP(m_compositor)
+    CLEANUP(m_shm)
+    CLEANUP(m_queue)
+    if (m_connection) {
+        m_connection->deleteLater();
+        m_connection = nullptr;
+    }
+    if (m_thread) {
+        m_thread->quit();
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+    CLEANUP(m_display)
+#undef CLEANUP
+    // these are the children of the display
+    m_clientManagementInterface = nullptr;
+    m_compositorInterface = nullptr;
+    qDeleteAll(m_states);
+    m_states.clear();
+}
+
+void TestClientManagement::testInitialSnapshot()
+{
+    // clients using com_deepin_window_states get the known window states on bind without requesting them
+    QSignalSpy windowStatesChangedSpy(m_clientManagement, &ClientManagement::windowStatesChanged);
+    QVERIFY(windowStatesChangedSpy.isValid());
+    QVERIFY(windowStatesChangedSpy.wait());
+
+    const auto states = m_clientManagement->getWindowStates();
+    QCOMPARE(states.count(), 1);
+    QCOMPARE(states.first().windowId, 1);
+    QCOMPARE(states.first().geometry.width, 100);
+    QCOMPARE(qstrcmp(states.first().resourceName, "test"), 0);
+}
+
+void TestClientManagement::testAddChangeRemove()
+{
+    QSignalSpy windowStatesChangedSpy(m_clientManagement, &ClientManagement::windowStatesChanged);
+    QVERIFY(windowStatesChangedSpy.isValid());
+    QVERIFY(windowStatesChangedSpy.wait());
+
+    // add two windows
+    m_states << createWindowState(2, QRect(10, 10, 200, 200)) << createWindowState(3, QRect(20, 20, 300, 300));
+    m_clientManagementInterface->setWindowStates(m_states);
+    QVERIFY(windowStatesChangedSpy.wait());
+    QCOMPARE(windowStatesChangedSpy.count(), 2);
+    QCOMPARE(m_clientManagement->getWindowStates().count(), 3);
+    QCOMPARE(m_clientManagement->getWindowStates().at(2).windowId, 3);
+
+    // change one window
+    m_states[1]->geometry.x = 50;
+    m_states[1]->isActive = true;
+    m_clientManagementInterface->setWindowStates(m_states);
+    QVERIFY(windowStatesChangedSpy.wait());
+    QCOMPARE(windowStatesChangedSpy.count(), 3);
+    QCOMPARE(m_clientManagement->getWindowStates().count(), 3);
+    QCOMPARE(m_clientManagement->getWindowStates().at(1).windowId, 2);
+    QCOMPARE(m_clientManagement->getWindowStates().at(1).geometry.x, 50);
+    QVERIFY(m_clientManagement->getWindowStates().at(1).isActive);
+
+    // remove the first window
+    delete m_states.takeFirst();
+    m_clientManagementInterface->setWindowStates(m_states);
+    QVERIFY(windowStatesChangedSpy.wait());
+    QCOMPARE(windowStatesChangedSpy.count(), 4);
+    const auto states = m_clientManagement->getWindowStates();
+    QCOMPARE(states.count(), 2);
+    QCOMPARE(states.at(0).windowId, 2);
+    QCOMPARE(states.at(0).geometry.x, 50);
+    QCOMPARE(states.at(1).windowId, 3);
+}
+
+void TestClientManagement::testRemoveMany()
+{
+    // this test verifies that removing several windows in one event keeps the right ones
+    QSignalSpy windowStatesChangedSpy(m_clientManagement, &ClientManagement::windowStatesChanged);
+    QVERIFY(windowStatesChangedSpy.isValid());
+    QVERIFY(windowStatesChangedSpy.wait());
+
+    for (int32_t windowId = 2; windowId <= 5; ++windowId) {
+        m_states << createWindowState(windowId, QRect(windowId * 10, windowId * 10, 100, 100));
+    }
+    m_clientManagementInterface->setWindowStates(m_states);
+    QVERIFY(windowStatesChangedSpy.wait());
+    QCOMPARE(m_clientManagement->getWindowStates().count(), 5);
+
+    // remove the second and the fourth window, the second one comes first in the event
+    delete m_states.takeAt(3);
+    delete m_states.takeAt(1);
+    m_clientManagementInterface->setWindowStates(m_states);
+    QVERIFY(windowStatesChangedSpy.wait());
+    QCOMPARE(windowStatesChangedSpy.count(), 3);
+    auto states = m_clientManagement->getWindowStates();
+    QCOMPARE(states.count(), 3);
+    QCOMPARE(states.at(0).windowId, 1);
+    QCOMPARE(states.at(1).windowId, 3);
+    QCOMPARE(states.at(1).geometry.x, 30);
+    QCOMPARE(states.at(2).windowId, 5);
+    QCOMPARE(states.at(2).geometry.x, 50);
+
+    // the index still finds the remaining windows
+    m_states[2]->geometry.x = 500;
+    m_clientManagementInterface->setWindowStates(m_states);
+    QVERIFY(windowStatesChangedSpy.wait());
+    states = m_clientManagement->getWindowStates();
+    QCOMPARE(states.count(), 3);
+    QCOMPARE(states.at(2).windowId, 5);
+    QCOMPARE(states.at(2).geometry.x, 500);
+}
+
+void TestClientManagement::testBatchAppliedOnDone()
+{
+    // this test verifies that observers only see the window states of complete batches
+    QSignalSpy windowStatesChangedSpy(m_clientManagement, &ClientManagement::windowStatesChanged);
+    QVERIFY(windowStatesChangedSpy.isValid());
+    QVERIFY(windowStatesChangedSpy.wait());
+    m_states << createWindowState(2, QRect(10, 10, 200, 200));
+    m_clientManagementInterface->setWindowStates(m_states);
+    QVERIFY(windowStatesChangedSpy.wait());
+
+    QVector<QVector<int32_t>> observed;
+    connect(m_clientManagement, &ClientManagement::windowStatesChanged, this, [this, &observed] {
+        QVector<int32_t> windowIds;
+        for (const ClientManagement::WindowState &state : m_clientManagement->getWindowStates()) {
+            windowIds << state.windowId;
+        }
+        observed << windowIds;
+    });
+
+    // remove one window, change another and add two in one batch
+    delete m_states.takeFirst();
+    m_states[0]->isActive = true;
+    m_states << createWindowState(3, QRect(20, 20, 300, 300)) << createWindowState(4, QRect(30, 30, 400, 400));
+    m_clientManagementInterface->setWindowStates(m_states);
+    QVERIFY(windowStatesChangedSpy.wait());
+    QCOMPARE(windowStatesChangedSpy.count(), 3);
+    QCOMPARE(observed.count(), 1);
+    QCOMPARE(observed.first(), QVector<int32_t>({2, 3, 4}));
+    QVERIFY(m_clientManagement->getWindowStates().first().isActive);
+}
+
+void TestClientManagement::testUnchangedStates()
+{
+    QSignalSpy windowStatesChangedSpy(m_clientManagement, &ClientManagement::windowStatesChanged);
+    QVERIFY(windowStatesChangedSpy.isValid());
+    QVERIFY(windowStatesChangedSpy.wait());
+
+    // setting the same states again does not produce any event for incremental clients
+    m_clientManagementInterface->setWindowStates(m_states);
+    QVERIFY(!windowStatesChangedSpy.wait(100));
+    QCOMPARE(windowStatesChangedSpy.count(), 1);
+}
+
+void TestClientManagement::testCaptureDamagedRows()
+{
+    using namespace KWaylandServer;
+    QSignalSpy surfaceCreatedSpy(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QScopedPointer<Surface> surface(m_compositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    auto serverSurface = surfaceCreatedSpy.first().first().value<SurfaceInterface *>();
+    QVERIFY(serverSurface);
+
+    connect(m_clientManagementInterface, &ClientManagementInterface::captureWindowImageRequest, this, [this, serverSurface](int windowId, wl_resource *buffer) {
+        m_clientManagementInterface->sendWindowCaption(windowId, buffer, serverSurface);
+    });
+    QSignalSpy capturedSpy(m_clientManagementInterface, &ClientManagementInterface::windowCaptured);
+    QSignalSpy captionDoneSpy(m_clientManagement, &ClientManagement::captionWindowDone);
+    QSignalSpy damagedSpy(serverSurface, &SurfaceInterface::damaged);
+
+    QImage red(64, 64, QImage::Format_ARGB32_Premultiplied);
+    red.fill(Qt::red);
+    surface->attachBuffer(m_shm->createBuffer(red));
+    surface->damage(red.rect());
+    surface->commit(Surface::CommitFlag::None);
+    QVERIFY(damagedSpy.wait());
+
+    // the capture buffer has a larger stride than the window buffer
+    const int stride = 80 * 4;
+    auto capture = m_shm->getBuffer(QSize(64, 64), stride, Buffer::Format::RGB32).toStrongRef();
+    QVERIFY(capture);
+    auto pixel = [&capture, stride](int x, int y) {
+        return reinterpret_cast<const QRgb *>(capture->address() + y * stride)[x] & 0x00ffffff;
+    };
+
+    m_clientManagement->getWindowCaption(1, *capture);
+    QVERIFY(captionDoneSpy.wait());
+    QCOMPARE(captionDoneSpy.last().at(0).toInt(), 1);
+    QCOMPARE(captionDoneSpy.last().at(1).toBool(), true);
+    QCOMPARE(capturedSpy.count(), 1);
+    QCOMPARE(capturedSpy.last().at(1).toBool(), true);
+    QVERIFY(capturedSpy.last().at(2).value<qint64>() >= 0);
+    QCOMPARE(pixel(0, 0), QColor(Qt::red).rgb() & 0x00ffffff);
+    QCOMPARE(pixel(63, 63), QColor(Qt::red).rgb() & 0x00ffffff);
+
+    // clear the capture buffer, a second capture only copies the damaged rows
+    memset(capture->address(), 0, stride * 64);
+    QImage green(64, 64, QImage::Format_ARGB32_Premultiplied);
+    green.fill(Qt::green);
+    surface->attachBuffer(m_shm->createBuffer(green));
+    surface->damage(QRect(0, 10, 16, 4));
+    surface->commit(Surface::CommitFlag::None);
+    QVERIFY(damagedSpy.wait());
+
+    m_clientManagement->getWindowCaption(1, *capture);
+    QVERIFY(captionDoneSpy.wait());
+    QCOMPARE(captionDoneSpy.last().at(1).toBool(), true);
+    QCOMPARE(capturedSpy.count(), 2);
+    QCOMPARE(pixel(0, 9), 0u);
+    QCOMPARE(pixel(0, 10), QColor(Qt::green).rgb() & 0x00ffffff);
+    QCOMPARE(pixel(63, 13), QColor(Qt::green).rgb() & 0x00ffffff);
+    QCOMPARE(pixel(0, 14), 0u);
+    QCOMPARE(pixel(63, 63), 0u);
+}
+
+QTEST_GUILESS_MAIN(TestClientManagement)
+#include "test_client_management.moc"
@@ -0,0 +1,188 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+// Qt
+#include <QtTest>
+// KWin
+#include "../../src/client/connection_thread.h"
+#include "../../src/client/event_queue.h"
+#include "../../src/client/registry.h"
+#include "../../src/server/compositor_interface.h"
+#include "../../src/server/display.h"
+
+using namespace KWayland::Client;
+
+class TestEventQueue : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void testReadWhileConnectionBusy();
+    void testDispatchLatency();
+    void testRelease();
+
+private:
+    KWaylandServer::Display *m_display = nullptr;
+    ConnectionThread *m_connection = nullptr;
+    QThread *m_thread = nullptr;
+};
+
+static const QString s_socketName = QStringLiteral("kwayland-test-event-queue-0");
+
+void TestEventQueue::init()
+{
+    m_display = new KWaylandServer::Display(this);
+    m_display->addSocketName(s_socketName);
+    m_display->start();
+    QVERIFY(m_display->isRunning());
+    new KWaylandServer::CompositorInterface(m_display, m_display);
+
+    m_connection = new ConnectionThread;
+    QSignalSpy connectedSpy(m_connection, &ConnectionThread::connected);
+    m_connection->setSocketName(s_socketName);
+
+    m_thread = new QThread(this);
+    m_connection->moveToThread(m_thread);
+    m_thread->start();
+
+    m_connection->initConnection();
+    QVERIFY(connectedSpy.wait());
+}
+
+void TestEventQueue::cleanup()
+{
+    if (m_thread) {
+        m_thread->quit();
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+    delete m_connection;
+    m_connection = nullptr;
+
+    delete m_display;
+    m_display = nullptr;
+}
+
+void TestEventQueue::testReadWhileConnectionBusy()
+{
+    // the thread of the connection does not get to read until the announcements arrived
+    QSemaphore entered;
+    QSemaphore busy;
+    auto unblock = qScopeGuard([&busy] {
+        busy.release();
+    });
+    QMetaObject::invokeMethod(m_connection, [&entered, &busy] {
+        entered.release();
+        busy.acquire();
+    });
+    entered.acquire();
+
+    EventQueue queue;
+    queue.setup(m_connection);
+    QVERIFY(queue.isValid());
+
+    Registry registry;
+    registry.setEventQueue(&queue);
+    QSignalSpy announcedSpy(&registry, &Registry::interfacesAnnounced);
+    registry.create(m_connection);
+    registry.setup();
+    m_connection->flush();
+
+    QVERIFY(announcedSpy.wait());
+    QVERIFY(queue.dispatchCount() > 0);
+}
+
+void TestEventQueue::testDispatchLatency()
+{
+    QThread workerThread;
+    workerThread.start();
+
+    EventQueue *queue = nullptr;
+    Registry *registry = nullptr;
+    QObject worker;
+    worker.moveToThread(&workerThread);
+    QMetaObject::invokeMethod(
+        &worker,
+        [this, &queue, &registry] {
+            queue = new EventQueue;
+            queue->setup(m_connection);
+            registry = new Registry;
+            registry->setEventQueue(queue);
+        },
+        Qt::BlockingQueuedConnection);
+    QVERIFY(queue->isValid());
+
+    // the request goes out right before the worker blocks, so the thread of the
+    // connection reads the answer and the worker dispatches it late
+    QElapsedTimer timer;
+    timer.start();
+    QSemaphore blocked;
+    QMetaObject::invokeMethod(&worker, [this, registry, &blocked] {
+        registry->create(m_connection);
+        registry->setup();
+        m_connection->flush();
+        blocked.acquire();
+    });
+    QTest::qWait(100);
+    blocked.release();
+
+    // the answer was read by now, its dispatch is queued behind the blocked worker
+    qint64 maximumLatency = 0;
+    qint64 averageLatency = 0;
+    quint64 dispatchCount = 0;
+    quint64 dispatchCountAfterReset = 0;
+    QMetaObject::invokeMethod(
+        &worker,
+        [&] {
+            maximumLatency = queue->maximumDispatchLatency();
+            averageLatency = queue->averageDispatchLatency();
+            dispatchCount = queue->dispatchCount();
+            queue->resetDispatchStatistics();
+            dispatchCountAfterReset = queue->dispatchCount();
+            delete registry;
+            delete queue;
+        },
+        Qt::BlockingQueuedConnection);
+    const qint64 elapsed = timer.nsecsElapsed();
+    QVERIFY(dispatchCount > 0);
+    // the events were read after the request went out and dispatched before now
+    QVERIFY(maximumLatency > 0);
+    QVERIFY(maximumLatency <= elapsed);
+    QVERIFY(averageLatency <= maximumLatency);
+    QCOMPARE(dispatchCountAfterReset, quint64(0));
+
+    workerThread.quit();
+    workerThread.wait();
+}
+
+void TestEventQueue::testRelease()
+{
+    EventQueue queue;
+    queue.setup(m_connection);
+    Registry registry;
+    registry.setEventQueue(&queue);
+    QSignalSpy announcedSpy(&registry, &Registry::interfacesAnnounced);
+    registry.create(m_connection);
+    registry.setup();
+    QVERIFY(announcedSpy.wait());
+
+    registry.release();
+    queue.release();
+    QVERIFY(!queue.isValid());
+
+    // the connection keeps reading without the released queue
+    Registry other;
+    QSignalSpy otherSpy(&other, &Registry::interfacesAnnounced);
+    other.create(m_connection);
+    other.setup();
+    m_connection->flush();
+    QVERIFY(otherSpy.wait());
+}
+
+QTEST_GUILESS_MAIN(TestEventQueue)
+#include "test_event_queue.moc"
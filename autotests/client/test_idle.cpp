@@ -31,6 +31,8 @@ private Q_SLOTS:
     void testServerSimulateUserActivity();
     void testIdleInhibit();
     void testIdleInhibitBlocksTimeout();
+    void testStateEdges();
+    void benchmarkUserActivity();
 
 private:
     Display *m_display = nullptr;
@@ -267,5 +269,73 @@ void IdleTest::testIdleInhibitBlocksTimeout()
     m_display->dispatchEvents();
 }
 
+void IdleTest::testStateEdges()
+{
+    // this test verifies that timeouts with different intervals go idle at their own deadline,
+    // and that idle and resumed are only sent when the state changes
+    QScopedPointer<IdleTimeout> shortTimeout(m_idle->getTimeout(500, m_seat));
+    QScopedPointer<IdleTimeout> longTimeout(m_idle->getTimeout(1500, m_seat));
+    QSignalSpy shortIdleSpy(shortTimeout.data(), &IdleTimeout::idle);
+    QSignalSpy shortResumedSpy(shortTimeout.data(), &IdleTimeout::resumeFromIdle);
+    QSignalSpy longIdleSpy(longTimeout.data(), &IdleTimeout::idle);
+    QSignalSpy longResumedSpy(longTimeout.data(), &IdleTimeout::resumeFromIdle);
+    m_connection->flush();
+
+    QVERIFY(shortIdleSpy.wait());
+    QVERIFY(longIdleSpy.isEmpty());
+    QVERIFY(longIdleSpy.wait());
+    QCOMPARE(shortIdleSpy.count(), 1);
+
+    // the first activity resumes both, the following ones send nothing
+    m_idleInterface->simulateUserActivity();
+    m_idleInterface->simulateUserActivity();
+    m_idleInterface->simulateUserActivity();
+    QVERIFY(longResumedSpy.wait());
+    QCOMPARE(shortResumedSpy.count(), 1);
+    QVERIFY(!shortResumedSpy.wait(200));
+    QCOMPARE(longResumedSpy.count(), 1);
+
+    // activity before the deadline pushes it back without sending anything
+    QVERIFY(shortIdleSpy.wait());
+    QCOMPARE(shortIdleSpy.count(), 2);
+    QCOMPARE(longIdleSpy.count(), 1);
+    m_idleInterface->simulateUserActivity();
+    QVERIFY(shortResumedSpy.wait());
+    QVERIFY(!longIdleSpy.wait(1000));
+    QCOMPARE(longResumedSpy.count(), 1);
+    QVERIFY(longIdleSpy.wait());
+    QCOMPARE(longIdleSpy.count(), 2);
+
+    shortTimeout.reset();
+    longTimeout.reset();
+    m_connection->flush();
+    m_display->dispatchEvents();
+}
+
+void IdleTest::benchmarkUserActivity()
+{
+    // the compositor reports every input event as user activity, with 100 clients watching
+    const int watcherCount = 100;
+    QVector<IdleTimeout *> timeouts;
+    for (int i = 0; i < watcherCount; ++i) {
+        timeouts << m_idle->getTimeout(500 + i, m_seat);
+    }
+    // once the last one went idle, the server knows all of them
+    QSignalSpy idleSpy(timeouts.last(), &IdleTimeout::idle);
+    m_connection->flush();
+    QVERIFY(idleSpy.wait());
+
+    // one iteration is 1000 input events
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            m_idleInterface->simulateUserActivity();
+        }
+    }
+
+    qDeleteAll(timeouts);
+    m_connection->flush();
+    m_display->dispatchEvents();
+}
+
 QTEST_GUILESS_MAIN(IdleTest)
 #include "test_idle.moc"
@@ -6,6 +6,7 @@
 // Qt
 #include <QtTest>
 // KWin
+#include "../../src/server/clientconnection.h"
 #include "../../src/server/compositor_interface.h"
 #include "../../src/server/display.h"
 #include "../../src/server/plasmavirtualdesktop_interface.h"
@@ -40,6 +41,7 @@ private Q_SLOTS:
     void testAllDesktops();
     void testCreateRequested();
     void testRemoveRequested();
+    void testSwitchManyWindows();
 
 private:
     KWaylandServer::Display *m_display;
@@ -521,5 +523,61 @@ void TestVirtualDesktop::testRemoveRequested()
     QCOMPARE(desktopRemoveRequestedSpy.first().first().toString(), QStringLiteral("0-1"));
 }
 
+void TestVirtualDesktop::testSwitchManyWindows()
+{
+    // this test verifies that moving 200 windows to another desktop at once sends every window
+    // only the desktops it leaves and enters, followed by a single done
+    testCreate();
+    m_display->setClientMetricsEnabled(true);
+    QCOMPARE(m_display->connections().count(), 1);
+    KWaylandServer::ClientConnection *connection = m_display->connections().first();
+    auto sentEvents = [connection](const QString &interface) {
+        return connection->sentEventCounts().value(interface);
+    };
+
+    QScopedPointer<QObject> windowParent(new QObject);
+    QSignalSpy windowCreatedSpy(m_windowManagement, &PlasmaWindowManagement::windowCreated);
+    QVERIFY(windowCreatedSpy.isValid());
+    QHash<KWaylandServer::PlasmaWindowInterface *, QStringList> desktops;
+    for (int i = 0; i < 200; ++i) {
+        desktops.insert(m_windowManagementInterface->createWindow(windowParent.data(), QUuid::createUuid()), {QStringLiteral("0-1")});
+    }
+    QTRY_COMPARE(windowCreatedSpy.count(), 200);
+
+    QSignalSpy managementDoneSpy(m_plasmaVirtualDesktopManagement, &PlasmaVirtualDesktopManagement::done);
+    QVERIFY(managementDoneSpy.isValid());
+    m_windowManagementInterface->setPlasmaVirtualDesktops(desktops);
+    QVERIFY(managementDoneSpy.wait());
+
+    // a leave and an enter per window, one done per client
+    quint64 windowEvents = sentEvents(QStringLiteral("org_kde_plasma_window"));
+    const quint64 managementEvents = sentEvents(QStringLiteral("org_kde_plasma_virtual_desktop_management"));
+    for (auto it = desktops.begin(); it != desktops.end(); ++it) {
+        it.value() = QStringList({QStringLiteral("0-2")});
+    }
+    m_windowManagementInterface->setPlasmaVirtualDesktops(desktops);
+    QCOMPARE(sentEvents(QStringLiteral("org_kde_plasma_window")) - windowEvents, quint64(400));
+    QCOMPARE(sentEvents(QStringLiteral("org_kde_plasma_virtual_desktop_management")) - managementEvents, quint64(1));
+
+    QVERIFY(managementDoneSpy.wait());
+    QCOMPARE(managementDoneSpy.count(), 2);
+    const auto windows = m_windowManagement->windows();
+    for (PlasmaWindow *window : windows) {
+        if (window == m_window) {
+            continue;
+        }
+        QCOMPARE(window->plasmaVirtualDesktops(), QStringList({QStringLiteral("0-2")}));
+        QVERIFY(!window->isOnAllDesktops());
+    }
+
+    // one desktop at a time every window also passes through all desktops
+    windowEvents = sentEvents(QStringLiteral("org_kde_plasma_window"));
+    for (auto it = desktops.constBegin(); it != desktops.constEnd(); ++it) {
+        it.key()->removePlasmaVirtualDesktop(QStringLiteral("0-2"));
+        it.key()->addPlasmaVirtualDesktop(QStringLiteral("0-3"));
+    }
+    QCOMPARE(sentEvents(QStringLiteral("org_kde_plasma_window")) - windowEvents, quint64(600));
+}
+
 QTEST_GUILESS_MAIN(TestVirtualDesktop)
 #include "test_plasma_virtual_desktop.moc"
@@ -0,0 +1,213 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+// Qt
+#include <QtTest>
+// client
+#include "../../src/client/connection_thread.h"
+#include "../../src/client/event_queue.h"
+#include "../../src/client/plasmawindowmanagement.h"
+#include "../../src/client/plasmawindowmodel.h"
+#include "../../src/client/registry.h"
+// server
+#include "../../src/server/display.h"
+#include "../../src/server/plasmawindowmanagement_interface.h"
+
+using namespace KWayland::Client;
+using namespace KWaylandServer;
+
+class PlasmaWindowModelTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void testCoalescedDataChanged();
+    void testRowsAfterRemove();
+    void benchmarkUpdateStorm();
+
+private:
+    bool createWindows(int count);
+    PlasmaWindow *windowAt(int row) const;
+
+    Display *m_display = nullptr;
+    PlasmaWindowManagementInterface *m_pwInterface = nullptr;
+    PlasmaWindowManagement *m_pw = nullptr;
+    PlasmaWindowModel *m_model = nullptr;
+    ConnectionThread *m_connection = nullptr;
+    QThread *m_thread = nullptr;
+    EventQueue *m_queue = nullptr;
+};
+
+static const QString s_socketName = QStringLiteral("kwayland-test-plasma-window-model-0");
+
+void PlasmaWindowModelTest::init()
+{
+    delete m_display;
+    m_display = new Display(this);
+    m_display->addSocketName(s_socketName);
+    m_display->start();
+    QVERIFY(m_display->isRunning());
+    m_pwInterface = new PlasmaWindowManagementInterface(m_display, m_display);
+
+    // setup connection
+    m_connection = new KWayland::Client::ConnectionThread;
+    QSignalSpy connectedSpy(m_connection, &ConnectionThread::connected);
+    QVERIFY(connectedSpy.isValid());
+    m_connection->setSocketName(s_socketName);
+
+    m_thread = new QThread(this);
+    m_connection->moveToThread(m_thread);
+    m_thread->start();
+
+    m_connection->initConnection();
+    QVERIFY(connectedSpy.wait());
+
+    m_queue = new EventQueue(this);
+    m_queue->setup(m_connection);
+
+    Registry registry;
+    QSignalSpy interfacesAnnouncedSpy(&registry, &Registry::interfacesAnnounced);
+    QVERIFY(interfacesAnnouncedSpy.isValid());
+    registry.setEventQueue(m_queue);
+    registry.create(m_connection);
+    QVERIFY(registry.isValid());
+    registry.setup();
+    QVERIFY(interfacesAnnouncedSpy.wait());
+
+    m_pw = registry.createPlasmaWindowManagement(registry.interface(Registry::Interface::PlasmaWindowManagement).name,
+                                                 registry.interface(Registry::Interface::PlasmaWindowManagement).version,
+                                                 this);
+    QVERIFY(m_pw->isValid());
+    m_model = m_pw->createWindowModel();
+    QVERIFY(m_model);
+}
+
+#define CLEANUP(variable)                                                                                                                                      \
+    if (variable) {                                                                                                                                            \
+        delete variable;                                                                                                                                       \
+        variable = nullptr;                                                                                                                                    \
+    }
+
+void PlasmaWindowModelTest::cleanup()
+{
+    CLEANUP(m_pw)
+    CLEANUP(m_queue)
+    if (m_connection) {
+        m_connection->deleteLater();
+        m_connection = nullptr;
+    }
+    if (m_thread) {
+        m_thread->quit();
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+
+    CLEANUP(m_display)
+    // the model and the server windows are deleted with their parents
+    m_model = nullptr;
+    m_pwInterface = nullptr;
+}
+#undef CLEANUP
+
+bool PlasmaWindowModelTest::createWindows(int count)
+{
+    for (int i = 0; i < count; ++i) {
+        m_pwInterface->createWindow(m_pwInterface, QUuid::createUuid());
+    }
+    return QTest::qWaitFor([this, count] {
+        return m_model->rowCount() == count;
+    });
+}
+
+PlasmaWindow *PlasmaWindowModelTest::windowAt(int row) const
+{
+    return static_cast<PlasmaWindow *>(m_model->index(row).internalPointer());
+}
+
+void PlasmaWindowModelTest::testCoalescedDataChanged()
+{
+    // this test verifies that the changes of one event loop iteration are emitted once per range of rows
+    QVERIFY(createWindows(5));
+    QSignalSpy dataChangedSpy(m_model, &PlasmaWindowModel::dataChanged);
+    QVERIFY(dataChangedSpy.isValid());
+
+    Q_EMIT windowAt(1)->titleChanged();
+    Q_EMIT windowAt(1)->activeChanged();
+    Q_EMIT windowAt(1)->titleChanged();
+    Q_EMIT windowAt(2)->maximizedChanged();
+    Q_EMIT windowAt(4)->geometryChanged();
+    QCOMPARE(dataChangedSpy.count(), 0);
+
+    QVERIFY(dataChangedSpy.wait());
+    QCOMPARE(dataChangedSpy.count(), 2);
+    QCOMPARE(dataChangedSpy.at(0).at(0).toModelIndex(), m_model->index(1));
+    QCOMPARE(dataChangedSpy.at(0).at(1).toModelIndex(), m_model->index(2));
+    QCOMPARE(dataChangedSpy.at(0).at(2).value<QVector<int>>(),
+             QVector<int>({Qt::DisplayRole, PlasmaWindowModel::IsActive, PlasmaWindowModel::IsMaximized}));
+    QCOMPARE(dataChangedSpy.at(1).at(0).toModelIndex(), m_model->index(4));
+    QCOMPARE(dataChangedSpy.at(1).at(1).toModelIndex(), m_model->index(4));
+    QCOMPARE(dataChangedSpy.at(1).at(2).value<QVector<int>>(), QVector<int>({PlasmaWindowModel::Geometry}));
+
+    // nothing changed since
+    QVERIFY(!dataChangedSpy.wait(100));
+}
+
+void PlasmaWindowModelTest::testRowsAfterRemove()
+{
+    // this test verifies that changes are emitted for the right rows after a window went away
+    QVERIFY(createWindows(4));
+    PlasmaWindow *removed = windowAt(1);
+    PlasmaWindow *last = windowAt(3);
+    QSignalSpy rowsRemovedSpy(m_model, &PlasmaWindowModel::rowsRemoved);
+    QVERIFY(rowsRemovedSpy.isValid());
+    QSignalSpy dataChangedSpy(m_model, &PlasmaWindowModel::dataChanged);
+    QVERIFY(dataChangedSpy.isValid());
+
+    // the pending change of the removed window is dropped
+    Q_EMIT removed->titleChanged();
+    Q_EMIT removed->unmapped();
+    QCOMPARE(rowsRemovedSpy.count(), 1);
+    QCOMPARE(rowsRemovedSpy.first().at(1).toInt(), 1);
+    QCOMPARE(m_model->rowCount(), 3);
+    QCOMPARE(windowAt(2), last);
+
+    Q_EMIT removed->titleChanged();
+    Q_EMIT last->titleChanged();
+    QVERIFY(dataChangedSpy.wait());
+    QCOMPARE(dataChangedSpy.count(), 1);
+    QCOMPARE(dataChangedSpy.first().at(0).toModelIndex(), m_model->index(2));
+    QCOMPARE(dataChangedSpy.first().at(1).toModelIndex(), m_model->index(2));
+    QCOMPARE(m_model->data(m_model->index(2), PlasmaWindowModel::Uuid).toByteArray(), last->uuid());
+}
+
+void PlasmaWindowModelTest::benchmarkUpdateStorm()
+{
+    // one QBENCHMARK iteration changes the geometry and the title of 150 windows, as a workspace
+    // switch does, and lets the model emit its changes
+    QVERIFY(createWindows(150));
+    QVector<PlasmaWindow *> windows;
+    for (int row = 0; row < m_model->rowCount(); ++row) {
+        windows << windowAt(row);
+    }
+    QSignalSpy dataChangedSpy(m_model, &PlasmaWindowModel::dataChanged);
+    QVERIFY(dataChangedSpy.isValid());
+
+    QBENCHMARK {
+        for (PlasmaWindow *window : qAsConst(windows)) {
+            Q_EMIT window->geometryChanged();
+            Q_EMIT window->titleChanged();
+        }
+        QVERIFY(dataChangedSpy.wait());
+    }
+    // all rows form one range
+    QCOMPARE(dataChangedSpy.last().at(0).toModelIndex(), m_model->index(0));
+    QCOMPARE(dataChangedSpy.last().at(1).toModelIndex(), m_model->index(149));
+}
+
+QTEST_MAIN(PlasmaWindowModelTest)
+#include "test_plasma_window_model.moc"
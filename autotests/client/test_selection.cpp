@@ -10,6 +10,7 @@
 #include "../../src/client/connection_thread.h"
 #include "../../src/client/datadevice.h"
 #include "../../src/client/datadevicemanager.h"
+#include "../../src/client/dataoffer.h"
 #include "../../src/client/datasource.h"
 #include "../../src/client/event_queue.h"
 #include "../../src/client/keyboard.h"
@@ -21,6 +22,10 @@
 #include "../../src/server/datadevicemanager_interface.h"
 #include "../../src/server/display.h"
 #include "../../src/server/seat_interface.h"
+#include "../../src/server/selection_cache.h"
+
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace KWayland::Client;
 using namespace KWaylandServer;
@@ -32,6 +37,7 @@ private Q_SLOTS:
     void init();
     void cleanup();
     void testClearOnEnter();
+    void testSelectionCache();
 
 private:
     Display *m_display = nullptr;
@@ -248,5 +254,106 @@ void SelectionTest::testClearOnEnter()
     QVERIFY(selectionClearedClient1Spy.wait());
 }
 
+/**
+ * Reads @p fd until end of file without blocking the event loop, which serves the data.
+ */
+static QByteArray readAll(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    QByteArray data;
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < 5000) {
+        char buffer[1024];
+        const ssize_t bytes = read(fd, buffer, sizeof(buffer));
+        if (bytes == 0) {
+            break;
+        }
+        if (bytes > 0) {
+            data.append(buffer, bytes);
+        } else {
+            QTest::qWait(10);
+        }
+    }
+    close(fd);
+    return data;
+}
+
+void SelectionTest::testSelectionCache()
+{
+    // this test verifies that the selection outlives its source client when it is cached
+    SelectionCache cache;
+    cache.setMimeTypePolicy(QStringLiteral("application/x-kde-*"), SelectionCache::Policy::Skip);
+    m_seatInterface->setSelectionCache(&cache);
+    QCOMPARE(m_seatInterface->selectionCache(), &cache);
+    QCOMPARE(cache.mimeTypePolicy(QStringLiteral("text/plain")), SelectionCache::Policy::Cache);
+    QCOMPARE(cache.mimeTypePolicy(QStringLiteral("application/x-kde-onlyReplaceEmpty")), SelectionCache::Policy::Skip);
+
+    QSignalSpy keyboardEnteredClient1Spy(m_client1.keyboard, &Keyboard::entered);
+    QVERIFY(keyboardEnteredClient1Spy.isValid());
+    QSignalSpy surfaceCreatedSpy(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(surfaceCreatedSpy.isValid());
+    QScopedPointer<Surface> s1(m_client1.compositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    auto serverSurface1 = surfaceCreatedSpy.last().first().value<SurfaceInterface *>();
+    m_seatInterface->setFocusedKeyboardSurface(serverSurface1);
+    QVERIFY(keyboardEnteredClient1Spy.wait());
+
+    // the source client answers each request once
+    QScopedPointer<DataSource> dataSource(m_client1.ddm->createDataSource());
+    dataSource->offer(QStringLiteral("text/plain"));
+    dataSource->offer(QStringLiteral("application/x-kde-onlyReplaceEmpty"));
+    QStringList requestedMimeTypes;
+    connect(dataSource.data(), &DataSource::sendDataRequested, this, [&requestedMimeTypes](const QString &mimeType, qint32 fd) {
+        requestedMimeTypes << mimeType;
+        write(fd, "hello", 5);
+        close(fd);
+    });
+
+    QSignalSpy captureFinishedSpy(&cache, &SelectionCache::captureFinished);
+    QVERIFY(captureFinishedSpy.isValid());
+    m_client1.dataDevice->setSelection(keyboardEnteredClient1Spy.first().first().value<quint32>(), dataSource.data());
+    QVERIFY(captureFinishedSpy.wait());
+    QCOMPARE(captureFinishedSpy.first().first().toStringList(), QStringList({QStringLiteral("text/plain")}));
+    QCOMPARE(requestedMimeTypes, QStringList({QStringLiteral("text/plain")}));
+    QCOMPARE(cache.cachedSize(), qint64(5));
+    QVERIFY(m_seatInterface->selection());
+    QCOMPARE(cache.capturedSource(), m_seatInterface->selection());
+
+    // the source client goes away, the cached copy becomes the selection
+    QSignalSpy selectionChangedSpy(m_seatInterface, &SeatInterface::selectionChanged);
+    QVERIFY(selectionChangedSpy.isValid());
+    dataSource.reset();
+    QVERIFY(selectionChangedSpy.wait());
+    QCOMPARE(m_seatInterface->selection(), cache.cachedSource());
+    QCOMPARE(m_seatInterface->selection()->mimeTypes(), QStringList({QStringLiteral("text/plain")}));
+
+    // and another client can paste it
+    QSignalSpy selectionOfferedClient2Spy(m_client2.dataDevice, &DataDevice::selectionOffered);
+    QVERIFY(selectionOfferedClient2Spy.isValid());
+    QScopedPointer<Surface> s2(m_client2.compositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    auto serverSurface2 = surfaceCreatedSpy.last().first().value<SurfaceInterface *>();
+    m_seatInterface->setFocusedKeyboardSurface(serverSurface2);
+    QVERIFY(selectionOfferedClient2Spy.wait());
+    auto offer = selectionOfferedClient2Spy.first().first().value<DataOffer *>();
+    QVERIFY(offer);
+    QTRY_COMPARE(offer->offeredMimeTypes().count(), 1);
+    QCOMPARE(offer->offeredMimeTypes().first().name(), QStringLiteral("text/plain"));
+
+    int fds[2];
+    QCOMPARE(pipe2(fds, O_CLOEXEC), 0);
+    offer->receive(QStringLiteral("text/plain"), fds[1]);
+    close(fds[1]);
+    m_client2.connection->flush();
+    QCOMPARE(readAll(fds[0]), QByteArrayLiteral("hello"));
+
+    // clearing the selection drops the cache
+    m_seatInterface->setSelection(nullptr);
+    QVERIFY(!cache.cachedSource());
+    QCOMPARE(cache.cachedSize(), qint64(0));
+    m_seatInterface->setSelectionCache(nullptr);
+}
+
 QTEST_GUILESS_MAIN(SelectionTest)
 #include "test_selection.moc"
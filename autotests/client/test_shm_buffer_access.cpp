@@ -0,0 +1,348 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+// Qt
+#include <QImage>
+#include <QtConcurrent>
+#include <QtTest>
+// KWin
+#include "../../src/client/compositor.h"
+#include "../../src/client/connection_thread.h"
+#include "../../src/client/event_queue.h"
+#include "../../src/client/registry.h"
+#include "../../src/client/shm_pool.h"
+#include "../../src/client/surface.h"
+#include "../../src/server/compositor_interface.h"
+#include "../../src/server/display.h"
+#include "../../src/server/shmclientbuffer.h"
+#include "../../src/server/surface_interface.h"
+// Wayland
+#include <wayland-client-protocol.h>
+#include <wayland-server-core.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace KWayland::Client;
+using namespace KWaylandServer;
+
+class TestShmBufferAccess : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TestShmBufferAccess(QObject *parent = nullptr);
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void testConcurrentAccess();
+    void testWorkerThreadAccess();
+    void testTruncatedPool_data();
+    void testTruncatedPool();
+
+private:
+    ShmClientBuffer *attachBuffer(Surface *surface, SurfaceInterface *serverSurface, Buffer::Ptr buffer);
+
+    KWaylandServer::Display *m_display;
+    KWaylandServer::CompositorInterface *m_compositorInterface;
+    KWayland::Client::ConnectionThread *m_connection;
+    KWayland::Client::Compositor *m_compositor;
+    KWayland::Client::EventQueue *m_queue;
+    KWayland::Client::Registry *m_registry;
+    QThread *m_thread;
+    quint32 m_shmName = 0;
+    quint32 m_shmVersion = 0;
+};
+
+static const QString s_socketName = QStringLiteral("kwayland-test-shm-buffer-access-0");
+static const int s_bufferCount = 16;
+static const int s_iterations = 200;
+
+TestShmBufferAccess::TestShmBufferAccess(QObject *parent)
+    : QObject(parent)
+    , m_display(nullptr)
+    , m_compositorInterface(nullptr)
+    , m_connection(nullptr)
+    , m_compositor(nullptr)
+    , m_queue(nullptr)
+    , m_registry(nullptr)
+    , m_thread(nullptr)
+{
+}
+
+void TestShmBufferAccess::init()
+{
+    delete m_display;
+    m_display = new KWaylandServer::Display(this);
+    m_display->addSocketName(s_socketName);
+    m_display->start();
+    QVERIFY(m_display->isRunning());
+    m_display->createShm();
+    m_compositorInterface = new CompositorInterface(m_display, m_display);
+
+    // setup connection
+    m_connection = new KWayland::Client::ConnectionThread;
+    QSignalSpy connectedSpy(m_connection, &ConnectionThread::connected);
+    m_connection->setSocketName(s_socketName);
+
+    m_thread = new QThread(this);
+    m_connection->moveToThread(m_thread);
+    m_thread->start();
+
+    m_connection->initConnection();
+    QVERIFY(connectedSpy.wait());
+
+    m_queue = new KWayland::Client::EventQueue(this);
+    m_queue->setup(m_connection);
+    QVERIFY(m_queue->isValid());
+
+    m_registry = new Registry(this);
+    QSignalSpy compositorSpy(m_registry, &Registry::compositorAnnounced);
+    QSignalSpy shmSpy(m_registry, &Registry::shmAnnounced);
+    m_registry->setEventQueue(m_queue);
+    m_registry->create(m_connection->display());
+    QVERIFY(m_registry->isValid());
+    m_registry->setup();
+
+    QVERIFY(compositorSpy.wait());
+    if (shmSpy.isEmpty()) {
+        QVERIFY(shmSpy.wait());
+    }
+    m_compositor = m_registry->createCompositor(compositorSpy.first().first().value<quint32>(), compositorSpy.first().last().value<quint32>(), this);
+    m_shmName = shmSpy.first().first().value<quint32>();
+    m_shmVersion = shmSpy.first().last().value<quint32>();
+}
+
+void TestShmBufferAccess::cleanup()
+{
+#define CLEANUP(variable)                                                                                                                                      \
+    if (variable) {                                                                                                                                            \
+        delete variable;                                                                                                                                       \
+        variable = nullptr;                                                                                                                                    \
+    }
+    CLEANUP(m_compositor)
+    CLEANUP(m_registry)
+    CLEANUP(m_queue)
+    if (m_connection) {
+        m_connection->deleteLater();
+        m_connection = nullptr;
+    }
+    if (m_thread) {
+        m_thread->quit();
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+    CLEANUP(m_display)
+#undef CLEANUP
+    // these are the children of the display
+    m_compositorInterface = nullptr;
+}
+
+ShmClientBuffer *TestShmBufferAccess::attachBuffer(Surface *surface, SurfaceInterface *serverSurface, Buffer::Ptr buffer)
+{
+    QSignalSpy committedSpy(serverSurface, &SurfaceInterface::committed);
+    surface->attachBuffer(buffer);
+    surface->damage(QRect(QPoint(0, 0), buffer.toStrongRef()->size()));
+    surface->commit(Surface::CommitFlag::None);
+    if (!committedSpy.wait()) {
+        return nullptr;
+    }
+    return qobject_cast<ShmClientBuffer *>(serverSurface->buffer());
+}
+
+void TestShmBufferAccess::testConcurrentAccess()
+{
+    // every surface gets a buffer from its own pool, so the buffers can't share a pool mapping
+    QSignalSpy surfaceCreatedSpy(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVector<ShmPool *> pools;
+    QVector<Surface *> surfaces;
+    QVector<ShmClientBuffer *> buffers;
+    QVector<QColor> colors;
+    for (int i = 0; i < s_bufferCount; ++i) {
+        auto pool = new ShmPool(this);
+        pool->setup(m_registry->bindShm(m_shmName, m_shmVersion));
+        QVERIFY(pool->isValid());
+        pools << pool;
+
+        auto surface = m_compositor->createSurface(this);
+        QVERIFY(surfaceCreatedSpy.wait());
+        surfaces << surface;
+        auto serverSurface = surfaceCreatedSpy.last().first().value<SurfaceInterface *>();
+
+        const QColor color = QColor::fromHsv(i * 360 / s_bufferCount, 255, 255);
+        QImage image(64 + i, 64, QImage::Format_RGB32);
+        image.fill(color);
+        colors << color;
+
+        ShmClientBuffer *buffer = attachBuffer(surface, serverSurface, pool->createBuffer(image));
+        QVERIFY(buffer);
+        buffer->ref();
+        buffers << buffer;
+    }
+
+    auto verifyImage = [](const QImage &image, const QColor &color) {
+        if (image.isNull()) {
+            return false;
+        }
+        for (int y = 0; y < image.height(); ++y) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+            for (int x = 0; x < image.width(); ++x) {
+                if (line[x] != color.rgb()) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    for (int iteration = 0; iteration < s_iterations; ++iteration) {
+        // map all buffers at once on the display thread
+        QVector<QImage> images;
+        for (ShmClientBuffer *buffer : qAsConst(buffers)) {
+            images << buffer->data();
+        }
+
+        // read them on worker threads, the workers hold the last references
+        QVector<QFuture<bool>> futures;
+        for (int i = 0; i < images.count(); ++i) {
+            futures << QtConcurrent::run([verifyImage](QImage image, QColor color, ShmClientBuffer *buffer) {
+                // the buffer is mapped, so it can be shared from a worker thread as well
+                const QImage other = buffer->data();
+                return verifyImage(image, color) && verifyImage(other, color);
+            }, images.at(i), colors.at(i), buffers.at(i));
+        }
+        images.clear();
+
+        for (QFuture<bool> &future : futures) {
+            QVERIFY(future.result());
+        }
+    }
+
+    // the pool references released on the workers are dropped on the display thread
+    QCoreApplication::processEvents();
+
+    // pools can grow again after the accesses ended
+    QImage large(512, 512, QImage::Format_RGB32);
+    large.fill(Qt::white);
+    QSignalSpy surfaceCreatedSpy2(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QScopedPointer<Surface> surface(m_compositor->createSurface());
+    QVERIFY(surfaceCreatedSpy2.wait());
+    auto serverSurface = surfaceCreatedSpy2.first().first().value<SurfaceInterface *>();
+    ShmClientBuffer *largeBuffer = attachBuffer(surface.data(), serverSurface, pools.first()->createBuffer(large));
+    QVERIFY(largeBuffer);
+    QCOMPARE(largeBuffer->data(), large);
+
+    for (ShmClientBuffer *buffer : qAsConst(buffers)) {
+        buffer->unref();
+    }
+    qDeleteAll(surfaces);
+    qDeleteAll(pools);
+}
+
+void TestShmBufferAccess::testWorkerThreadAccess()
+{
+    QScopedPointer<ShmPool> pool(m_registry->createShmPool(m_shmName, m_shmVersion));
+    QVERIFY(pool->isValid());
+    QSignalSpy surfaceCreatedSpy(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QScopedPointer<Surface> surface(m_compositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    auto serverSurface = surfaceCreatedSpy.first().first().value<SurfaceInterface *>();
+
+    QImage image(32, 32, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    ShmClientBuffer *buffer = attachBuffer(surface.data(), serverSurface, pool->createBuffer(image));
+    QVERIFY(buffer);
+
+    // a buffer which is not mapped can't be mapped from a worker thread
+    QVERIFY(QtConcurrent::run([buffer]() {
+                return buffer->data();
+            }).result().isNull());
+
+    // while it's mapped on the display thread, workers can share the mapping
+    QImage data = buffer->data();
+    QCOMPARE(data, image);
+    QCOMPARE(QtConcurrent::run([buffer]() {
+                 return buffer->data().copy();
+             }).result(),
+             image);
+}
+
+void TestShmBufferAccess::testTruncatedPool_data()
+{
+    QTest::addColumn<bool>("libwaylandHandler");
+
+    QTest::newRow("guard only") << false;
+    // libwayland installs its SIGBUS handler in front of the guard on first use
+    QTest::newRow("after wl_shm_buffer_begin_access") << true;
+}
+
+void TestShmBufferAccess::testTruncatedPool()
+{
+    QFETCH(bool, libwaylandHandler);
+    QSignalSpy errorSpy(m_connection, &ConnectionThread::errorOccurred);
+    QSignalSpy surfaceCreatedSpy(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QScopedPointer<Surface> surface(m_compositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    auto serverSurface = surfaceCreatedSpy.first().first().value<SurfaceInterface *>();
+
+    // set up a pool by hand, so the test controls the backing file
+    const int width = 256;
+    const int height = 256;
+    const int stride = width * 4;
+    const int size = stride * height;
+    const int fd = memfd_create("test-shm-buffer-access", MFD_CLOEXEC);
+    QVERIFY(fd != -1);
+    QCOMPARE(ftruncate(fd, size), 0);
+
+    wl_shm *shm = m_registry->bindShm(m_shmName, m_shmVersion);
+    wl_shm_pool *pool = wl_shm_create_pool(shm, fd, size);
+    wl_buffer *clientBuffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_XRGB8888);
+
+    QSignalSpy committedSpy(serverSurface, &SurfaceInterface::committed);
+    surface->attachBuffer(clientBuffer);
+    surface->damage(QRect(0, 0, width, height));
+    surface->commit(Surface::CommitFlag::None);
+    QVERIFY(committedSpy.wait());
+    auto buffer = qobject_cast<ShmClientBuffer *>(serverSurface->buffer());
+    QVERIFY(buffer);
+
+    // another buffer is accessed at the same time
+    QScopedPointer<ShmPool> otherPool(m_registry->createShmPool(m_shmName, m_shmVersion));
+    QScopedPointer<Surface> otherSurface(m_compositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    QImage image(16, 16, QImage::Format_RGB32);
+    image.fill(Qt::green);
+    ShmClientBuffer *otherBuffer = attachBuffer(otherSurface.data(), surfaceCreatedSpy.last().first().value<SurfaceInterface *>(), otherPool->createBuffer(image));
+    QVERIFY(otherBuffer);
+    const QImage otherData = otherBuffer->data();
+    if (libwaylandHandler) {
+        wl_shm_buffer *shmBuffer = wl_shm_buffer_get(otherBuffer->resource());
+        QVERIFY(shmBuffer);
+        wl_shm_buffer_begin_access(shmBuffer);
+        wl_shm_buffer_end_access(shmBuffer);
+    }
+
+    // the client truncates the file, reading it must not crash the compositor
+    QCOMPARE(ftruncate(fd, 0), 0);
+    {
+        const QImage data = buffer->data();
+        QVERIFY(!data.isNull());
+        QCOMPARE(data.pixel(width - 1, height - 1), qRgb(0, 0, 0));
+    }
+    QCOMPARE(otherData, image);
+
+    // the offending client is disconnected once the access ends
+    QVERIFY(errorSpy.wait());
+
+    wl_buffer_destroy(clientBuffer);
+    wl_shm_pool_destroy(pool);
+    wl_shm_destroy(shm);
+    close(fd);
+}
+
+QTEST_GUILESS_MAIN(TestShmBufferAccess)
+#include "test_shm_buffer_access.moc"
@@ -32,6 +32,11 @@ private Q_SLOTS:
     void testCreateBufferFromImageWithAlpha();
     void testCreateBufferFromData();
     void testReuseBuffer();
+    void testGrowInPlace();
+    void testReclaimReleasedRanges();
+    void testCompact();
+
+    void benchmarkResizeChurn();
 
 private:
     KWaylandServer::Display *m_display;
@@ -204,5 +209,106 @@ void TestShmPool::testReuseBuffer()
     QVERIFY(buffer4 != buffer3);
 }
 
+void TestShmPool::testGrowInPlace()
+{
+    QVERIFY(m_shmPool->isValid());
+    QSignalSpy resizedSpy(m_shmPool, &KWayland::Client::ShmPool::poolResized);
+    QImage img(24, 24, QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::red);
+    auto buffer = m_shmPool->createBuffer(img).toStrongRef();
+    QVERIFY(buffer);
+    buffer->setUsed(true);
+    uchar *address = buffer->address();
+
+    // a large buffer makes the pool grow, the existing one stays where it is
+    auto large = m_shmPool->getBuffer(QSize(512, 512), 2048).toStrongRef();
+    QVERIFY(large);
+    QImage(large->address(), 512, 512, QImage::Format_ARGB32_Premultiplied).fill(Qt::white);
+    QCOMPARE(buffer->address(), address);
+    QCOMPARE(QImage(buffer->address(), 24, 24, QImage::Format_ARGB32_Premultiplied), img);
+    QVERIFY(resizedSpy.isEmpty());
+}
+
+void TestShmPool::testReclaimReleasedRanges()
+{
+    // the pool starts out with 4096 bytes, fill it completely
+    QVERIFY(m_shmPool->isValid());
+    QSignalSpy resizedSpy(m_shmPool, &KWayland::Client::ShmPool::poolResized);
+    auto first = m_shmPool->getBuffer(QSize(8, 32), 32).toStrongRef();
+    auto second = m_shmPool->getBuffer(QSize(8, 32), 32).toStrongRef();
+    auto third = m_shmPool->getBuffer(QSize(8, 64), 32).toStrongRef();
+    QVERIFY(first && second && third);
+    third->setUsed(true);
+    uchar *address = first->address();
+    QCOMPARE(second->address(), address + 1024);
+    first->setReleased(true);
+    second->setReleased(true);
+    first.clear();
+    second.clear();
+
+    // a buffer of another size takes the two coalesced ranges instead of growing the pool
+    auto buffer = m_shmPool->getBuffer(QSize(16, 32), 64).toStrongRef();
+    QVERIFY(buffer);
+    QCOMPARE(buffer->address(), address);
+    QVERIFY(resizedSpy.isEmpty());
+}
+
+void TestShmPool::testCompact()
+{
+    QVERIFY(m_shmPool->isValid());
+    QSignalSpy resizedSpy(m_shmPool, &KWayland::Client::ShmPool::poolResized);
+    auto weak = m_shmPool->getBuffer(QSize(256, 256), 1024);
+    auto buffer = weak.toStrongRef();
+    QVERIFY(buffer);
+
+    // the server still holds the buffer
+    QVERIFY(!m_shmPool->compact());
+    buffer->setReleased(true);
+    buffer->setUsed(true);
+    QVERIFY(!m_shmPool->compact());
+    buffer->setUsed(false);
+    buffer.clear();
+
+    QVERIFY(m_shmPool->compact());
+    QCOMPARE(resizedSpy.count(), 1);
+    QVERIFY(!weak.toStrongRef());
+    QVERIFY(m_shmPool->isValid());
+    auto small = m_shmPool->getBuffer(QSize(24, 24), 96).toStrongRef();
+    QVERIFY(small);
+    small->setReleased(true);
+    small.clear();
+
+    // idle compaction
+    m_shmPool->setIdleCompactionTimeout(50);
+    QCOMPARE(m_shmPool->idleCompactionTimeout(), 50);
+    auto idle = m_shmPool->getBuffer(QSize(256, 256), 1024);
+    idle.toStrongRef()->setReleased(true);
+    QVERIFY(resizedSpy.wait());
+    QVERIFY(!idle.toStrongRef());
+    m_shmPool->setIdleCompactionTimeout(0);
+    QCOMPARE(m_shmPool->idleCompactionTimeout(), 0);
+}
+
+void TestShmPool::benchmarkResizeChurn()
+{
+    // an interactive resize with three buffers in flight, the server releasing the oldest each frame
+    QVERIFY(m_shmPool->isValid());
+    QBENCHMARK {
+        QVector<QSharedPointer<KWayland::Client::Buffer>> inFlight;
+        for (int i = 0; i < 200; ++i) {
+            const QSize size(400 + i * 4, 300 + i * 3);
+            auto buffer = m_shmPool->getBuffer(size, size.width() * 4).toStrongRef();
+            QVERIFY(buffer);
+            inFlight << buffer;
+            if (inFlight.count() > 2) {
+                inFlight.takeFirst()->setReleased(true);
+            }
+        }
+        for (const auto &buffer : qAsConst(inFlight)) {
+            buffer->setReleased(true);
+        }
+    }
+}
+
 QTEST_GUILESS_MAIN(TestShmPool)
 #include "test_shm_pool.moc"
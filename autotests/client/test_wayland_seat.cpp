@@ -69,6 +69,7 @@ private Q_SLOTS:
     void testPointerHoldGesture_data();
     void testPointerHoldGesture();
     void testPointerAxis();
+    void testPointerMotionCoalescing();
     void testCursor();
     void testCursorDamage();
     void testKeyboard();
@@ -1317,6 +1318,112 @@ void TestWaylandSeat::testPointerAxis()
     QCOMPARE(axisStoppedSpy.count(), 1);
 }
 
+void TestWaylandSeat::testPointerMotionCoalescing()
+{
+    using namespace KWayland::Client;
+    using namespace KWaylandServer;
+
+    QSignalSpy hasPointerChangedSpy(m_seat, &Seat::hasPointerChanged);
+    QVERIFY(hasPointerChangedSpy.isValid());
+    m_seatInterface->setHasPointer(true);
+    QVERIFY(hasPointerChangedSpy.wait());
+    QScopedPointer<Pointer> pointer(m_seat->createPointer());
+    QVERIFY(pointer);
+    QScopedPointer<RelativePointer> relativePointer(m_relativePointerManager->createRelativePointer(pointer.data()));
+    QVERIFY(relativePointer->isValid());
+
+    QSignalSpy surfaceCreatedSpy(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(surfaceCreatedSpy.isValid());
+    QScopedPointer<Surface> surface(m_compositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    auto serverSurface = surfaceCreatedSpy.first().first().value<SurfaceInterface *>();
+    QVERIFY(serverSurface);
+
+    QImage image(QSize(100, 100), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::black);
+    surface->attachBuffer(m_shm->createBuffer(image));
+    surface->damage(image.rect());
+    surface->commit(Surface::CommitFlag::None);
+    QSignalSpy committedSpy(serverSurface, &KWaylandServer::SurfaceInterface::committed);
+    QVERIFY(committedSpy.wait());
+
+    m_seatInterface->setFocusedPointerSurface(serverSurface);
+    QSignalSpy frameSpy(pointer.data(), &Pointer::frame);
+    QVERIFY(frameSpy.isValid());
+    QVERIFY(frameSpy.wait());
+    QCOMPARE(frameSpy.count(), 1);
+
+    QSignalSpy motionSpy(pointer.data(), &Pointer::motion);
+    QVERIFY(motionSpy.isValid());
+    QSignalSpy buttonSpy(pointer.data(), &Pointer::buttonStateChanged);
+    QVERIFY(buttonSpy.isValid());
+    QSignalSpy relativeMotionSpy(relativePointer.data(), &RelativePointer::relativeMotion);
+    QVERIFY(relativeMotionSpy.isValid());
+
+    // all the motion between two frames is merged
+    QCOMPARE(m_seatInterface->pointerMotionCoalescing(), PointerMotionCoalescing::Disabled);
+    m_seatInterface->setPointerMotionCoalescing(PointerMotionCoalescing::Frame);
+    QCOMPARE(m_seatInterface->pointer()->motionCoalescing(), PointerMotionCoalescing::Frame);
+    for (int i = 1; i <= 5; ++i) {
+        m_seatInterface->setTimestamp(i);
+        m_seatInterface->notifyPointerMotion(QPointF(i, i * 2));
+    }
+    m_seatInterface->notifyPointerFrame();
+    QVERIFY(frameSpy.wait());
+    QCOMPARE(frameSpy.count(), 2);
+    QCOMPARE(motionSpy.count(), 1);
+    QCOMPARE(motionSpy.last().first().toPointF(), QPointF(5, 10));
+    QCOMPARE(motionSpy.last().last().value<quint32>(), quint32(5));
+    QCOMPARE(m_seatInterface->pointer()->receivedMotionCount(), quint64(5));
+    QCOMPARE(m_seatInterface->pointer()->sentMotionCount(), quint64(1));
+
+    // frames carrying nothing but motion are merged until the next vblank, relative motion is not
+    m_seatInterface->setPointerMotionCoalescing(PointerMotionCoalescing::Vblank);
+    for (int i = 6; i <= 10; ++i) {
+        m_seatInterface->setTimestamp(i);
+        m_seatInterface->notifyPointerMotion(QPointF(i, i * 2));
+        m_seatInterface->relativePointerMotion(QSizeF(1, 2), QSizeF(0.5, 1), i);
+        m_seatInterface->notifyPointerFrame();
+    }
+    QTRY_COMPARE(relativeMotionSpy.count(), 5);
+    QCOMPARE(relativeMotionSpy.last().at(2).value<quint64>(), quint64(10));
+    QCOMPARE(motionSpy.count(), 1);
+    QCOMPARE(frameSpy.count(), 2);
+    m_seatInterface->notifyPointerVblank();
+    QVERIFY(frameSpy.wait());
+    QCOMPARE(frameSpy.count(), 3);
+    QCOMPARE(motionSpy.count(), 2);
+    QCOMPARE(motionSpy.last().first().toPointF(), QPointF(10, 20));
+    QCOMPARE(motionSpy.last().last().value<quint32>(), quint32(10));
+
+    // a button flushes the merged motion and gets its frame right away
+    m_seatInterface->setTimestamp(11);
+    m_seatInterface->notifyPointerMotion(QPointF(20, 20));
+    m_seatInterface->notifyPointerButton(Qt::LeftButton, PointerButtonState::Pressed);
+    m_seatInterface->notifyPointerFrame();
+    QVERIFY(frameSpy.wait());
+    QCOMPARE(frameSpy.count(), 4);
+    QCOMPARE(motionSpy.count(), 3);
+    QCOMPARE(motionSpy.last().first().toPointF(), QPointF(20, 20));
+    QCOMPARE(buttonSpy.count(), 1);
+    m_seatInterface->notifyPointerButton(Qt::LeftButton, PointerButtonState::Released);
+    m_seatInterface->notifyPointerFrame();
+    QVERIFY(frameSpy.wait());
+    QCOMPARE(buttonSpy.count(), 2);
+
+    QCOMPARE(m_seatInterface->pointer()->receivedMotionCount(), quint64(11));
+    QCOMPARE(m_seatInterface->pointer()->sentMotionCount(), quint64(3));
+
+    // without coalescing every motion is sent again
+    m_seatInterface->setPointerMotionCoalescing(PointerMotionCoalescing::Disabled);
+    m_seatInterface->notifyPointerMotion(QPointF(21, 20));
+    m_seatInterface->notifyPointerMotion(QPointF(22, 20));
+    m_seatInterface->notifyPointerFrame();
+    QVERIFY(frameSpy.wait());
+    QCOMPARE(motionSpy.count(), 5);
+    QCOMPARE(m_seatInterface->pointer()->sentMotionCount(), quint64(5));
+}
+
 void TestWaylandSeat::testCursor()
 {
     using namespace KWayland::Client;
@@ -2109,10 +2216,33 @@ void TestWaylandSeat::testKeymap()
     fd = keymapChangedSpy.first().first().toInt();
     QVERIFY(fd != -1);
     QCOMPARE(keymapChangedSpy.first().last().value<quint32>(), 3u);
-    QVERIFY(file.open(fd, QIODevice::ReadWrite));
+    QVERIFY(file.open(fd, QIODevice::ReadOnly));
     address = reinterpret_cast<char *>(file.map(0, keymapChangedSpy.first().last().value<quint32>()));
     QVERIFY(address);
     QCOMPARE(qstrcmp(address, "bar"), 0);
+    file.close();
+
+    // setting a keymap with known content reuses the cached keymap file
+    const quint64 bytesWritten = KeyboardInterface::keymapBytesWritten();
+    keymapChangedSpy.clear();
+    m_seatInterface->keyboard()->setKeymap(QByteArrayLiteral("bar"));
+    QVERIFY(keymapChangedSpy.wait());
+    QCOMPARE(KeyboardInterface::keymapBytesWritten(), bytesWritten);
+
+    // a second keyboard gets the same keymap without writing it again
+    keymapChangedSpy.clear();
+    QScopedPointer<Keyboard> keyboard2(m_seat->createKeyboard());
+    QSignalSpy keymapChangedSpy2(keyboard2.data(), &Keyboard::keymapChanged);
+    QVERIFY(keymapChangedSpy2.isValid());
+    QVERIFY(keymapChangedSpy2.wait());
+    QCOMPARE(keymapChangedSpy2.first().last().value<quint32>(), 3u);
+    QCOMPARE(KeyboardInterface::keymapBytesWritten(), bytesWritten);
+    fd = keymapChangedSpy2.first().first().toInt();
+    QVERIFY(fd != -1);
+    QVERIFY(file.open(fd, QIODevice::ReadOnly));
+    address = reinterpret_cast<char *>(file.map(0, keymapChangedSpy2.first().last().value<quint32>()));
+    QVERIFY(address);
+    QCOMPARE(qstrcmp(address, "bar"), 0);
 }
 
 QTEST_GUILESS_MAIN(TestWaylandSeat)
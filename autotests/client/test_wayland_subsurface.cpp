@@ -22,6 +22,9 @@
 // Wayland
 #include <wayland-client.h>
 
+#include <memory>
+#include <vector>
+
 Q_DECLARE_METATYPE(KWayland::Client::SubSurface::Mode)
 
 class TestSubSurface : public QObject
@@ -45,9 +48,13 @@ private Q_SLOTS:
     void testRemoveSurface();
     void testMappingOfSurfaceTree();
     void testSurfaceAt();
+    void testSurfaceAtAfterChanges();
     void testDestroyAttachedBuffer();
     void testDestroyParentSurface();
 
+    void benchmarkInputSurfaceAt_data();
+    void benchmarkInputSurfaceAt();
+
 private:
     KWaylandServer::Display *m_display;
     KWaylandServer::CompositorInterface *m_compositorInterface;
@@ -987,6 +994,78 @@ void TestSubSurface::testSurfaceAt()
     QVERIFY(!parentServerSurface->surfaceAt(QPointF(101, 101)));
 }
 
+void TestSubSurface::testSurfaceAtAfterChanges()
+{
+    // this test verifies that moving, resizing or unmapping a sub-surface, or changing its input region
+    // is reflected by surfaceAt and inputSurfaceAt
+    using namespace KWayland::Client;
+    using namespace KWaylandServer;
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<Surface> parent(m_compositor->createSurface());
+    QImage image(QSize(100, 100), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::red);
+    parent->attachBuffer(m_shm->createBuffer(image));
+    parent->damage(QRect(0, 0, 100, 100));
+    parent->commit(Surface::CommitFlag::None);
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *parentServerSurface = serverSurfaceCreated.last().first().value<KWaylandServer::SurfaceInterface *>();
+
+    QScopedPointer<Surface> child(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *childServerSurface = serverSurfaceCreated.last().first().value<KWaylandServer::SurfaceInterface *>();
+    QScopedPointer<SubSurface> childSubSurface(m_subCompositor->createSubSurface(child.data(), parent.data()));
+    childSubSurface->setMode(SubSurface::Mode::Desynchronized);
+
+    QSignalSpy childCommittedSpy(childServerSurface, &SurfaceInterface::committed);
+    QVERIFY(childCommittedSpy.isValid());
+    QImage childImage(QSize(50, 50), QImage::Format_ARGB32_Premultiplied);
+    childImage.fill(Qt::green);
+    child->attachBuffer(m_shm->createBuffer(childImage));
+    child->damage(QRect(0, 0, 50, 50));
+    child->commit(Surface::CommitFlag::None);
+    QVERIFY(childCommittedSpy.wait());
+    QCOMPARE(parentServerSurface->surfaceAt(QPointF(25, 25)), childServerSurface);
+    QCOMPARE(parentServerSurface->inputSurfaceAt(QPointF(25, 25)), childServerSurface);
+    QCOMPARE(parentServerSurface->surfaceAt(QPointF(75, 75)), parentServerSurface);
+
+    // move the child to the bottom right quarter
+    QSignalSpy positionChangedSpy(childServerSurface->subSurface(), &SubSurfaceInterface::positionChanged);
+    QVERIFY(positionChangedSpy.isValid());
+    childSubSurface->setPosition(QPoint(50, 50));
+    parent->commit(Surface::CommitFlag::None);
+    QVERIFY(positionChangedSpy.wait());
+    QCOMPARE(parentServerSurface->surfaceAt(QPointF(25, 25)), parentServerSurface);
+    QCOMPARE(parentServerSurface->surfaceAt(QPointF(75, 75)), childServerSurface);
+    QCOMPARE(parentServerSurface->inputSurfaceAt(QPointF(75, 75)), childServerSurface);
+
+    // the child no longer accepts input
+    child->setInputRegion(m_compositor->createRegion(QRegion()).get());
+    child->commit(Surface::CommitFlag::None);
+    QVERIFY(childCommittedSpy.wait());
+    QCOMPARE(parentServerSurface->surfaceAt(QPointF(75, 75)), childServerSurface);
+    QCOMPARE(parentServerSurface->inputSurfaceAt(QPointF(75, 75)), parentServerSurface);
+
+    // grow the child beyond the parent
+    QImage largeImage(QSize(100, 100), QImage::Format_ARGB32_Premultiplied);
+    largeImage.fill(Qt::blue);
+    child->attachBuffer(m_shm->createBuffer(largeImage));
+    child->damage(QRect(0, 0, 100, 100));
+    child->commit(Surface::CommitFlag::None);
+    QVERIFY(childCommittedSpy.wait());
+    QCOMPARE(parentServerSurface->surfaceAt(QPointF(125, 125)), childServerSurface);
+    QVERIFY(!parentServerSurface->inputSurfaceAt(QPointF(125, 125)));
+
+    // and unmap it
+    QSignalSpy unmappedSpy(childServerSurface, &SurfaceInterface::unmapped);
+    QVERIFY(unmappedSpy.isValid());
+    child->attachBuffer(Buffer::Ptr());
+    child->commit(Surface::CommitFlag::None);
+    QVERIFY(unmappedSpy.wait());
+    QCOMPARE(parentServerSurface->surfaceAt(QPointF(75, 75)), parentServerSurface);
+    QVERIFY(!parentServerSurface->surfaceAt(QPointF(125, 125)));
+}
+
 void TestSubSurface::testDestroyAttachedBuffer()
 {
     // this test verifies that destroying of a buffer attached to a sub-surface works
@@ -1066,5 +1145,79 @@ void TestSubSurface::testDestroyParentSurface()
     QVERIFY(destroySpy.wait());
 }
 
+void TestSubSurface::benchmarkInputSurfaceAt_data()
+{
+    QTest::addColumn<int>("depth");
+
+    QTest::newRow("1") << 1;
+    QTest::newRow("8") << 8;
+    QTest::newRow("32") << 32;
+}
+
+void TestSubSurface::benchmarkInputSurfaceAt()
+{
+    // this benchmark measures how many pointer motion events per second can be resolved to a
+    // surface in a tree of nested sub-surfaces, each with a sibling whose input region has a hole
+    using namespace KWayland::Client;
+    using namespace KWaylandServer;
+    QFETCH(int, depth);
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+
+    std::vector<std::unique_ptr<Surface>> surfaces;
+    std::vector<std::unique_ptr<SubSurface>> subSurfaces;
+    std::vector<SurfaceInterface *> serverSurfaces;
+    auto createSurface = [&](const QSize &size, Surface *parent, const QPoint &position) {
+        surfaces.emplace_back(m_compositor->createSurface());
+        Surface *surface = surfaces.back().get();
+        if (parent) {
+            subSurfaces.emplace_back(m_subCompositor->createSubSurface(surface, parent));
+            subSurfaces.back()->setMode(SubSurface::Mode::Desynchronized);
+            subSurfaces.back()->setPosition(position);
+        }
+        QImage image(size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::red);
+        surface->attachBuffer(m_shm->createBuffer(image));
+        surface->damage(QRect(QPoint(0, 0), size));
+        return surface;
+    };
+
+    Surface *parent = createSurface(QSize(1024, 1024), nullptr, QPoint());
+    for (int i = 0; i < depth; ++i) {
+        const int size = 1024 - 16 * (i + 1);
+        Surface *sibling = createSurface(QSize(64, 64), parent, QPoint(size - 64, 0));
+        sibling->setInputRegion(m_compositor->createRegion(QRegion(0, 0, 64, 64) - QRegion(16, 16, 32, 32)).get());
+        parent = createSurface(QSize(size, size), parent, QPoint(8, 8));
+    }
+    // the positions of the sub-surfaces are applied when their parents are committed
+    for (auto &surface : surfaces) {
+        surface->commit(Surface::CommitFlag::None);
+    }
+    while (serverSurfaceCreated.count() < int(surfaces.size())) {
+        QVERIFY(serverSurfaceCreated.wait());
+    }
+    QSignalSpy committedSpy(serverSurfaceCreated.last().first().value<SurfaceInterface *>(), &SurfaceInterface::committed);
+    QVERIFY(committedSpy.isValid());
+    surfaces.back()->commit(Surface::CommitFlag::None);
+    QVERIFY(committedSpy.wait());
+    SurfaceInterface *root = serverSurfaceCreated.first().first().value<SurfaceInterface *>();
+    QVERIFY(root->isMapped());
+    QCOMPARE(root->inputSurfaceAt(QPointF(512, 512)), serverSurfaceCreated.last().first().value<SurfaceInterface *>());
+
+    // a diagonal pointer motion across the tree, one QBENCHMARK iteration resolves 1000 motion events
+    QVector<QPointF> motion;
+    motion.reserve(1000);
+    for (int i = 0; i < 1000; ++i) {
+        motion.append(QPointF(i * 1.023, (i * 7 % 1000) * 1.023));
+    }
+    int hits = 0;
+    QBENCHMARK {
+        for (const QPointF &position : qAsConst(motion)) {
+            hits += root->inputSurfaceAt(position) != nullptr;
+        }
+    }
+    QVERIFY(hits > 0);
+}
+
 QTEST_GUILESS_MAIN(TestSubSurface)
 #include "test_wayland_subsurface.moc"
@@ -11,7 +11,9 @@
 #include "../../src/server/clientbuffer.h"
 #include "../../src/server/compositor_interface.h"
 #include "../../src/server/display.h"
+#include "../../src/server/framecallbackscheduler.h"
 #include "../../src/server/idleinhibit_v1_interface.h"
+#include "../../src/server/output_interface.h"
 #include "../../src/server/shmclientbuffer.h"
 #include "../../src/server/surface_interface.h"
 #include "../../src/client/compositor.h"
@@ -40,6 +42,7 @@ private Q_SLOTS:
     void testStaticAccessor();
     void testDamage();
     void testFrameCallback();
+    void testFrameCallbackScheduler();
     void testAttachBuffer();
     void testMultipleSurfaces();
     void testOpaque();
@@ -360,6 +363,97 @@ void TestWaylandSurface::testFrameCallback()
     QVERIFY(!frameRenderedSpy.isEmpty());
 }
 
+void TestWaylandSurface::testFrameCallbackScheduler()
+{
+    using namespace KWaylandServer;
+    auto output = new OutputInterface(m_display, m_display);
+    auto scheduler = new FrameCallbackScheduler(output);
+    QCOMPARE(FrameCallbackScheduler::get(output), scheduler);
+    QCOMPARE(scheduler->throttledRefreshRate(), 1000);
+
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<KWayland::Client::Surface> visible(m_compositor->createSurface());
+    QScopedPointer<KWayland::Client::Surface> hidden(m_compositor->createSurface());
+    QScopedPointer<KWayland::Client::Surface> offscreen(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    QTRY_COMPARE(serverSurfaceCreated.count(), 3);
+    auto serverVisible = serverSurfaceCreated.at(0).first().value<SurfaceInterface *>();
+    auto serverHidden = serverSurfaceCreated.at(1).first().value<SurfaceInterface *>();
+    auto serverOffscreen = serverSurfaceCreated.at(2).first().value<SurfaceInterface *>();
+    serverVisible->setOutputs({output});
+    serverHidden->setOutputs({output});
+    scheduler->setThrottled(serverHidden, true);
+    QVERIFY(scheduler->isThrottled(serverHidden));
+    QVERIFY(!scheduler->isThrottled(serverVisible));
+
+    QImage img(QSize(10, 10), QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::black);
+    auto commitFrame = [this, &img](KWayland::Client::Surface *surface) {
+        surface->attachBuffer(m_shm->createBuffer(img));
+        surface->damage(QRect(0, 0, 10, 10));
+        surface->commit();
+    };
+    QSignalSpy visibleFrameSpy(visible.data(), &KWayland::Client::Surface::frameRendered);
+    QSignalSpy hiddenFrameSpy(hidden.data(), &KWayland::Client::Surface::frameRendered);
+    QSignalSpy offscreenFrameSpy(offscreen.data(), &KWayland::Client::Surface::frameRendered);
+    QSignalSpy offscreenDamageSpy(serverOffscreen, &SurfaceInterface::damaged);
+
+    // only the surfaces on the output are scheduled
+    commitFrame(visible.data());
+    commitFrame(hidden.data());
+    commitFrame(offscreen.data());
+    QVERIFY(offscreenDamageSpy.wait());
+    QCOMPARE(scheduler->scheduledSurfaces(), QVector<SurfaceInterface *>({serverVisible, serverHidden}));
+
+    // the first frame of a throttled surface is not held back
+    scheduler->vblank(16);
+    QVERIFY(scheduler->scheduledSurfaces().isEmpty());
+    QCOMPARE(scheduler->firedCount(), quint64(2));
+    QCOMPARE(scheduler->skippedCount(), quint64(0));
+    QVERIFY(visibleFrameSpy.wait());
+    QTRY_COMPARE(hiddenFrameSpy.count(), 1);
+    QVERIFY(offscreenFrameSpy.isEmpty());
+    QVERIFY(serverOffscreen->hasFrameCallbacks());
+
+    // the next one of the hidden surface waits for a second to pass
+    commitFrame(visible.data());
+    commitFrame(hidden.data());
+    QTRY_COMPARE(scheduler->scheduledSurfaces().count(), 2);
+    scheduler->vblank(32);
+    QCOMPARE(scheduler->firedCount(), quint64(3));
+    QCOMPARE(scheduler->skippedCount(), quint64(1));
+    QCOMPARE(scheduler->scheduledSurfaces(), QVector<SurfaceInterface *>({serverHidden}));
+    QVERIFY(visibleFrameSpy.wait());
+    QCOMPARE(hiddenFrameSpy.count(), 1);
+
+    scheduler->vblank(1016);
+    QCOMPARE(scheduler->firedCount(), quint64(4));
+    QVERIFY(scheduler->scheduledSurfaces().isEmpty());
+    QVERIFY(hiddenFrameSpy.wait());
+
+    // once visible again, it gets every frame
+    scheduler->setThrottled(serverHidden, false);
+    commitFrame(hidden.data());
+    QTRY_COMPARE(scheduler->scheduledSurfaces().count(), 1);
+    scheduler->vblank(1032);
+    QCOMPARE(scheduler->firedCount(), quint64(5));
+    QVERIFY(hiddenFrameSpy.wait());
+
+    // entering the output schedules the pending frame callbacks
+    serverOffscreen->setOutputs({output});
+    QCOMPARE(scheduler->scheduledSurfaces(), QVector<SurfaceInterface *>({serverOffscreen}));
+
+    // a destroyed surface is forgotten
+    offscreen.reset();
+    QTRY_VERIFY(scheduler->scheduledSurfaces().isEmpty());
+
+    scheduler->resetCounters();
+    QCOMPARE(scheduler->firedCount(), quint64(0));
+    QCOMPARE(scheduler->skippedCount(), quint64(0));
+    delete output;
+}
+
 void TestWaylandSurface::testAttachBuffer()
 {
     // create the surface
@@ -583,9 +677,11 @@ void TestWaylandSurface::testMultipleSurfaces()
     QImage buffer2Data = qobject_cast<ShmClientBuffer *>(buffer2)->data();
     QCOMPARE(buffer2Data, red);
 
-    // while buffer2 is accessed we cannot access buffer1
+    // while buffer2 is accessed buffer1 from another pool can be accessed as well
     buffer1Data = qobject_cast<ShmClientBuffer *>(buffer1)->data();
-    QVERIFY(buffer1Data.isNull());
+    QVERIFY(!buffer1Data.isNull());
+    QCOMPARE(buffer1Data, black);
+    QCOMPARE(buffer2Data, red);
 
     // a deep copy can be kept around
     QImage deepCopy = buffer2Data.copy();
@@ -594,7 +690,8 @@ void TestWaylandSurface::testMultipleSurfaces()
     QVERIFY(buffer2Data.isNull());
     QCOMPARE(deepCopy, red);
 
-    // now that buffer2Data is destroyed we can access buffer1 again
+    // buffer1 is not affected by buffer2Data going away
+    QCOMPARE(buffer1Data, black);
     buffer1Data = qobject_cast<ShmClientBuffer *>(buffer1)->data();
     QVERIFY(!buffer1Data.isNull());
     QCOMPARE(buffer1Data, black);
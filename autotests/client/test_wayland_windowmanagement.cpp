@@ -6,6 +6,7 @@
 // Qt
 #include <QtTest>
 // KWin
+#include "../../src/server/clientconnection.h"
 #include "../../src/server/compositor_interface.h"
 #include "../../src/server/display.h"
 #include "../../src/server/plasmawindowmanagement_interface.h"
@@ -53,12 +54,20 @@ private Q_SLOTS:
     void testParentWindow();
     void testGeometry();
     void testIcon();
+    void testIconCache();
+    void testWindowIcons();
     void testPid();
     void testApplicationMenu();
+    void testBatchedMove();
+    void testStackingOrderMoves();
+    void benchmarkRestackStorm_data();
+    void benchmarkRestackStorm();
 
     void cleanup();
 
 private:
+    void setupStackingOrder();
+
     KWaylandServer::Display *m_display;
     KWaylandServer::CompositorInterface *m_compositorInterface;
     KWaylandServer::PlasmaWindowManagementInterface *m_windowManagementInterface;
@@ -590,6 +599,80 @@ void TestWindowManagement::testIcon()
     QCOMPARE(m_window->icon().name(), QStringLiteral("wayland"));
 }
 
+void TestWindowManagement::testIconCache()
+{
+    using namespace KWayland::Client;
+    m_windowManagementInterface->setIconSizes({QSize(16, 16), QSize(32, 32)});
+    m_windowManagement->setIconSizes({QSize(16, 16)});
+
+    QScopedPointer<KWaylandServer::PlasmaWindowInterface> otherInterface(m_windowManagementInterface->createWindow(this, QUuid::createUuid()));
+    QSignalSpy windowSpy(m_windowManagement, &PlasmaWindowManagement::windowCreated);
+    QVERIFY(windowSpy.wait());
+    QScopedPointer<PlasmaWindow> other(windowSpy.first().first().value<PlasmaWindow *>());
+    QVERIFY(other);
+
+    QSignalSpy iconChangedSpy(m_window, &PlasmaWindow::iconChanged);
+    QSignalSpy otherIconChangedSpy(other.data(), &PlasmaWindow::iconChanged);
+    QImage image(64, 64, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::blue);
+    const QIcon icon(QPixmap::fromImage(image));
+    m_windowInterface->setIcon(icon);
+    otherInterface->setIcon(icon);
+    QVERIFY(iconChangedSpy.wait());
+    if (otherIconChangedSpy.isEmpty()) {
+        QVERIFY(otherIconChangedSpy.wait());
+    }
+
+    // both windows share the icon, which only has the requested size
+    QCOMPARE(m_window->icon().cacheKey(), other->icon().cacheKey());
+    QCOMPARE(m_window->icon().availableSizes(), QList<QSize>{QSize(16, 16)});
+
+    // setting the same icon again does not transfer it again
+    m_windowInterface->setIcon(icon);
+    QVERIFY(!iconChangedSpy.wait(100));
+    QCOMPARE(iconChangedSpy.count(), 1);
+}
+
+void TestWindowManagement::testWindowIcons()
+{
+    // this test verifies that windows sharing an icon get it with one transfer through com_deepin_window_icons
+    using namespace KWayland::Client;
+    const Registry::AnnouncedInterface announced = m_registry->interface(Registry::Interface::WindowIcons);
+    QVERIFY(announced.name != 0);
+    m_display->setClientMetricsEnabled(true);
+    KWaylandServer::ClientConnection *connection = m_surfaceInterface->client();
+    QVERIFY(connection);
+    auto sentEvents = [connection](const QString &interface) {
+        return connection->sentEventCounts().value(interface);
+    };
+    m_windowManagement->setIconSizes({QSize(16, 16)});
+    m_windowManagement->setupWindowIcons(m_registry->bindWindowIcons(announced.name, announced.version));
+
+    QScopedPointer<KWaylandServer::PlasmaWindowInterface> otherInterface(m_windowManagementInterface->createWindow(this, QUuid::createUuid()));
+    QSignalSpy windowSpy(m_windowManagement, &PlasmaWindowManagement::windowCreated);
+    QVERIFY(windowSpy.wait());
+    QScopedPointer<PlasmaWindow> other(windowSpy.first().first().value<PlasmaWindow *>());
+    QVERIFY(other);
+    const quint64 windowEvents = sentEvents(QStringLiteral("org_kde_plasma_window"));
+
+    // two icons with the same content
+    QSignalSpy iconChangedSpy(m_window, &PlasmaWindow::iconChanged);
+    QSignalSpy otherIconChangedSpy(other.data(), &PlasmaWindow::iconChanged);
+    QImage image(64, 64, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::green);
+    m_windowInterface->setIcon(QIcon(QPixmap::fromImage(image)));
+    otherInterface->setIcon(QIcon(QPixmap::fromImage(image)));
+    QTRY_COMPARE(iconChangedSpy.count(), 1);
+    QTRY_COMPARE(otherIconChangedSpy.count(), 1);
+
+    // one transfer for both windows, only in the size the client renders
+    QCOMPARE(m_window->icon().cacheKey(), other->icon().cacheKey());
+    QCOMPARE(m_window->icon().availableSizes(), QList<QSize>{QSize(16, 16)});
+    QCOMPARE(sentEvents(QStringLiteral("com_deepin_window_icons")), quint64(2));
+    // the windows no longer announce icon changes themselves
+    QCOMPARE(sentEvents(QStringLiteral("org_kde_plasma_window")), windowEvents);
+}
+
 void TestWindowManagement::testPid()
 {
     using namespace KWayland::Client;
@@ -622,5 +705,183 @@ void TestWindowManagement::testApplicationMenu()
     QCOMPARE(m_window->applicationMenuObjectPath(), objectPath);
 }
 
+void TestWindowManagement::testBatchedMove()
+{
+    // this test verifies that the changes of a scripted interactive move reach the clients
+    // as one event per property when batching is enabled
+    using namespace KWayland::Client;
+    m_display->setClientMetricsEnabled(true);
+    KWaylandServer::ClientConnection *connection = m_surfaceInterface->client();
+    QVERIFY(connection);
+    auto windowEvents = [connection] {
+        return connection->sentEventCounts().value(QStringLiteral("org_kde_plasma_window"));
+    };
+    const quint64 before = windowEvents();
+
+    QVERIFY(!m_windowManagementInterface->isBatchingEnabled());
+    m_windowManagementInterface->setBatchingEnabled(true);
+    QVERIFY(m_windowManagementInterface->isBatchingEnabled());
+    QSignalSpy geometryChangedSpy(m_window, &PlasmaWindow::geometryChanged);
+    QVERIFY(geometryChangedSpy.isValid());
+    QSignalSpy activeChangedSpy(m_window, &PlasmaWindow::activeChanged);
+    QVERIFY(activeChangedSpy.isValid());
+    QSignalSpy keepAboveChangedSpy(m_window, &PlasmaWindow::keepAboveChanged);
+    QVERIFY(keepAboveChangedSpy.isValid());
+
+    // the move starts, the window gets activated and follows the pointer
+    m_windowInterface->setActive(true);
+    m_windowInterface->setTitle(QStringLiteral("Moving"));
+    for (int i = 0; i < 100; ++i) {
+        m_windowInterface->setGeometry(QRect(i, i * 2, 300, 200));
+    }
+    m_windowInterface->setKeepAbove(true);
+    m_windowInterface->setKeepAbove(false);
+    // nothing is sent before the event loop gets to the window management
+    QCOMPARE(windowEvents(), before);
+
+    QVERIFY(geometryChangedSpy.wait());
+    QCOMPARE(m_window->geometry(), QRect(99, 198, 300, 200));
+    QCOMPARE(m_window->title(), QStringLiteral("Moving"));
+    QVERIFY(m_window->isActive());
+    QVERIFY(!m_window->isKeepAbove());
+    QCOMPARE(geometryChangedSpy.count(), 1);
+    QCOMPARE(activeChangedSpy.count(), 1);
+    QCOMPARE(keepAboveChangedSpy.count(), 0);
+    // title, state and geometry
+    QCOMPARE(windowEvents() - before, quint64(3));
+
+    // the end of the move is sent right away
+    m_windowInterface->setGeometry(QRect(100, 200, 300, 200));
+    m_windowInterface->commit();
+    QCOMPARE(windowEvents() - before, quint64(4));
+    QVERIFY(geometryChangedSpy.wait());
+    QCOMPARE(geometryChangedSpy.count(), 2);
+    QCOMPARE(m_window->geometry(), QRect(100, 200, 300, 200));
+
+    // a batch ending where it started sends nothing
+    m_windowInterface->setGeometry(QRect(0, 0, 10, 10));
+    m_windowInterface->setGeometry(QRect(100, 200, 300, 200));
+    m_windowManagementInterface->commit();
+    QCOMPARE(windowEvents() - before, quint64(4));
+
+    // disabling batching sends what is pending, afterwards every change goes out on its own
+    m_windowInterface->setTitle(QStringLiteral("Moved"));
+    m_windowManagementInterface->setBatchingEnabled(false);
+    QCOMPARE(windowEvents() - before, quint64(5));
+    for (int i = 0; i < 10; ++i) {
+        m_windowInterface->setGeometry(QRect(i, 0, 300, 200));
+    }
+    QCOMPARE(windowEvents() - before, quint64(15));
+    QTRY_COMPARE(m_window->geometry(), QRect(9, 0, 300, 200));
+}
+
+static QVector<QByteArray> toByteArrays(const QVector<QString> &uuids)
+{
+    QVector<QByteArray> result;
+    for (const QString &uuid : uuids) {
+        result << uuid.toUtf8();
+    }
+    return result;
+}
+
+void TestWindowManagement::setupStackingOrder()
+{
+    const KWayland::Client::Registry::AnnouncedInterface announced = m_registry->interface(KWayland::Client::Registry::Interface::StackingOrder);
+    QVERIFY(announced.name != 0);
+    m_display->setClientMetricsEnabled(true);
+    KWaylandServer::ClientConnection *connection = m_surfaceInterface->client();
+    QVERIFY(connection);
+    m_windowManagement->setupStackingOrder(m_registry->bindStackingOrder(announced.name, announced.version));
+    m_connection->flush();
+    // the full order is sent once bound
+    QTRY_COMPARE(connection->sentEventCounts().value(QStringLiteral("com_deepin_stacking_order")), quint64(1));
+}
+
+void TestWindowManagement::testStackingOrderMoves()
+{
+    // this test verifies that a client with com_deepin_stacking_order gets restacks as moves
+    using namespace KWayland::Client;
+    QVector<QString> uuids;
+    for (int i = 0; i < 5; ++i) {
+        uuids << QUuid::createUuid().toString();
+    }
+    QSignalSpy stackingOrderChangedSpy(m_windowManagement, &PlasmaWindowManagement::stackingOrderUuidsChanged);
+    QVERIFY(stackingOrderChangedSpy.isValid());
+    m_windowManagementInterface->setStackingOrderUuids(uuids);
+    QVERIFY(stackingOrderChangedSpy.wait());
+    QCOMPARE(m_windowManagement->stackingOrderUuids(), toByteArrays(uuids));
+
+    setupStackingOrder();
+    KWaylandServer::ClientConnection *connection = m_surfaceInterface->client();
+    auto sentEvents = [connection](const QString &interface) {
+        return connection->sentEventCounts().value(interface);
+    };
+    const quint64 managementEvents = sentEvents(QStringLiteral("org_kde_plasma_window_management"));
+
+    // the bottom most window gets raised
+    uuids.move(0, 4);
+    m_windowManagementInterface->setStackingOrderUuids(uuids);
+    QVERIFY(stackingOrderChangedSpy.wait());
+    QCOMPARE(m_windowManagement->stackingOrderUuids(), toByteArrays(uuids));
+
+    // the top most window gets lowered
+    uuids.move(4, 1);
+    m_windowManagementInterface->setStackingOrderUuids(uuids);
+    QVERIFY(stackingOrderChangedSpy.wait());
+    QCOMPARE(m_windowManagement->stackingOrderUuids(), toByteArrays(uuids));
+    QCOMPARE(stackingOrderChangedSpy.count(), 3);
+    QCOMPARE(sentEvents(QStringLiteral("com_deepin_stacking_order")), quint64(3));
+
+    // anything else than a single move is sent as full order
+    uuids.removeAt(2);
+    m_windowManagementInterface->setStackingOrderUuids(uuids);
+    QVERIFY(stackingOrderChangedSpy.wait());
+    QCOMPARE(m_windowManagement->stackingOrderUuids(), toByteArrays(uuids));
+    uuids.swapItemsAt(0, 3);
+    m_windowManagementInterface->setStackingOrderUuids(uuids);
+    QVERIFY(stackingOrderChangedSpy.wait());
+    QCOMPARE(m_windowManagement->stackingOrderUuids(), toByteArrays(uuids));
+    QCOMPARE(sentEvents(QStringLiteral("com_deepin_stacking_order")), quint64(5));
+
+    // the window management interface doesn't send the order anymore
+    QCOMPARE(sentEvents(QStringLiteral("org_kde_plasma_window_management")), managementEvents);
+}
+
+void TestWindowManagement::benchmarkRestackStorm_data()
+{
+    QTest::addColumn<bool>("moves");
+
+    QTest::newRow("full order") << false;
+    QTest::newRow("moves") << true;
+}
+
+void TestWindowManagement::benchmarkRestackStorm()
+{
+    // one QBENCHMARK iteration raises one of 150 windows and waits until the client has seen it
+    using namespace KWayland::Client;
+    QFETCH(bool, moves);
+    if (moves) {
+        setupStackingOrder();
+    }
+    QVector<QString> uuids;
+    for (int i = 0; i < 150; ++i) {
+        uuids << QUuid::createUuid().toString();
+    }
+    QSignalSpy stackingOrderChangedSpy(m_windowManagement, &PlasmaWindowManagement::stackingOrderUuidsChanged);
+    QVERIFY(stackingOrderChangedSpy.isValid());
+    m_windowManagementInterface->setStackingOrderUuids(uuids);
+    QVERIFY(stackingOrderChangedSpy.wait());
+
+    int restacks = 0;
+    QBENCHMARK {
+        // never the top most window, raising it would not change anything
+        uuids.move((restacks++ * 37) % (uuids.count() - 1), uuids.count() - 1);
+        m_windowManagementInterface->setStackingOrderUuids(uuids);
+        m_display->flush();
+        QVERIFY(stackingOrderChangedSpy.wait());
+    }
+    QCOMPARE(m_windowManagement->stackingOrderUuids(), toByteArrays(uuids));
+}
+
 QTEST_MAIN(TestWindowManagement)
 #include "test_wayland_windowmanagement.moc"
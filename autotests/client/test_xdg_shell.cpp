@@ -250,6 +250,14 @@ void XdgShellTest::testTitle()
     QCOMPARE(titleChangedSpy.count(), 1);
     QCOMPARE(titleChangedSpy.first().first().toString(), QStringLiteral("foo"));
     QCOMPARE(serverXdgToplevel->windowTitle(), QStringLiteral("foo"));
+
+    // setting the same title again is not a change
+    xdgSurface->setTitle(QStringLiteral("foo"));
+    xdgSurface->setTitle(QStringLiteral("Grüße — ✓"));
+    QVERIFY(titleChangedSpy.wait());
+    QCOMPARE(titleChangedSpy.count(), 2);
+    QCOMPARE(titleChangedSpy.last().first().toString(), QStringLiteral("Grüße — ✓"));
+    QCOMPARE(serverXdgToplevel->windowTitle(), QStringLiteral("Grüße — ✓"));
 }
 
 void XdgShellTest::testWindowClass()
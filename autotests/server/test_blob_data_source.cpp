@@ -0,0 +1,270 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+// Qt
+#include <QCryptographicHash>
+#include <QtTest>
+// KWin
+#include "../../src/server/blob_data_source.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <utility>
+
+using namespace KWaylandServer;
+
+/**
+ * Reads everything from a pipe on its own thread, like a client receiving a selection.
+ */
+class Receiver : public QThread
+{
+public:
+    explicit Receiver(qint64 readLimit = -1)
+        : m_readLimit(readLimit)
+    {
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC) == 0) {
+            m_readFd = fds[0];
+            m_writeFd = fds[1];
+        }
+    }
+    ~Receiver() override
+    {
+        wait();
+        if (m_readFd != -1) {
+            close(m_readFd);
+        }
+    }
+
+    /**
+     * The end handed to the source, which takes its ownership.
+     */
+    int takeWriteFd()
+    {
+        return std::exchange(m_writeFd, -1);
+    }
+
+    qint64 bytes() const
+    {
+        return m_bytes;
+    }
+    QByteArray checksum() const
+    {
+        return m_checksum;
+    }
+
+protected:
+    void run() override
+    {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        QByteArray buffer(256 * 1024, Qt::Uninitialized);
+        while (m_readLimit == -1 || m_bytes < m_readLimit) {
+            const ssize_t bytes = read(m_readFd, buffer.data(), buffer.size());
+            if (bytes <= 0) {
+                break;
+            }
+            hash.addData(buffer.constData(), bytes);
+            m_bytes += bytes;
+        }
+        if (m_readLimit != -1) {
+            // gives up early, the source has to notice
+            close(m_readFd);
+            m_readFd = -1;
+        }
+        m_checksum = hash.result();
+    }
+
+private:
+    qint64 m_readLimit;
+    int m_readFd = -1;
+    int m_writeFd = -1;
+    qint64 m_bytes = 0;
+    QByteArray m_checksum;
+};
+
+class TestBlobDataSource : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testSmallData();
+    void testMimeTypes();
+    void testUnknownMimeType();
+    void testConcurrentReceivers();
+    void testReceiverClosesEarly();
+    void testReplaceData();
+    void testThroughput_data();
+    void testThroughput();
+};
+
+static const QString s_text = QStringLiteral("text/plain");
+
+static QByteArray payload(int size)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    quint32 seed = 1;
+    for (int i = 0; i < size; ++i) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = char(seed >> 16);
+    }
+    return data;
+}
+
+void TestBlobDataSource::testSmallData()
+{
+    BlobDataSource source;
+    QVERIFY(source.setData(s_text, QByteArrayLiteral("hello")));
+
+    QSignalSpy finishedSpy(&source, &BlobDataSource::transferFinished);
+    Receiver receiver;
+    source.requestData(s_text, receiver.takeWriteFd());
+    receiver.start();
+    QVERIFY(receiver.wait(5000));
+
+    // small data fits into the pipe and finishes right away
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.first().at(0).toString(), s_text);
+    QCOMPARE(finishedSpy.first().at(1).value<qint64>(), qint64(5));
+    QCOMPARE(receiver.bytes(), qint64(5));
+    QCOMPARE(receiver.checksum(), QCryptographicHash::hash(QByteArrayLiteral("hello"), QCryptographicHash::Sha1));
+    QCOMPARE(source.activeTransferCount(), 0);
+}
+
+void TestBlobDataSource::testMimeTypes()
+{
+    BlobDataSource source;
+    QSignalSpy offeredSpy(&source, &AbstractDataSource::mimeTypeOffered);
+    QVERIFY(source.setData(s_text, QByteArrayLiteral("a")));
+    QVERIFY(source.setData(QStringLiteral("text/html"), QByteArrayLiteral("<b>a</b>")));
+    QVERIFY(source.setData(s_text, QByteArrayLiteral("b")));
+    QCOMPARE(offeredSpy.count(), 2);
+    QCOMPARE(source.mimeTypes(), QStringList({s_text, QStringLiteral("text/html")}));
+
+    source.removeMimeType(s_text);
+    QCOMPARE(source.mimeTypes(), QStringList({QStringLiteral("text/html")}));
+
+    QVERIFY(!source.setFile(s_text, QStringLiteral("/does/not/exist")));
+    QCOMPARE(source.mimeTypes(), QStringList({QStringLiteral("text/html")}));
+}
+
+void TestBlobDataSource::testUnknownMimeType()
+{
+    BlobDataSource source;
+    QVERIFY(source.setData(s_text, QByteArrayLiteral("hello")));
+
+    // the receiver reads end of file right away
+    Receiver receiver;
+    source.requestData(QStringLiteral("image/png"), receiver.takeWriteFd());
+    receiver.start();
+    QVERIFY(receiver.wait(5000));
+    QCOMPARE(receiver.bytes(), qint64(0));
+    QCOMPARE(source.activeTransferCount(), 0);
+}
+
+void TestBlobDataSource::testConcurrentReceivers()
+{
+    const QByteArray data = payload(4 << 20);
+    BlobDataSource source;
+    QVERIFY(source.setData(s_text, data));
+    QSignalSpy finishedSpy(&source, &BlobDataSource::transferFinished);
+
+    std::vector<std::unique_ptr<Receiver>> receivers;
+    for (int i = 0; i < 4; ++i) {
+        receivers.emplace_back(new Receiver);
+        source.requestData(s_text, receivers.back()->takeWriteFd());
+    }
+    // nobody read yet, all transfers wait without blocking the event loop
+    QCOMPARE(source.activeTransferCount(), 4);
+
+    for (const auto &receiver : receivers) {
+        receiver->start();
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 4, 10000);
+    QCOMPARE(source.activeTransferCount(), 0);
+
+    const QByteArray checksum = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    for (const auto &receiver : receivers) {
+        QVERIFY(receiver->wait(5000));
+        QCOMPARE(receiver->bytes(), qint64(data.size()));
+        QCOMPARE(receiver->checksum(), checksum);
+    }
+}
+
+void TestBlobDataSource::testReceiverClosesEarly()
+{
+    BlobDataSource source;
+    QVERIFY(source.setData(s_text, payload(4 << 20)));
+    QSignalSpy finishedSpy(&source, &BlobDataSource::transferFinished);
+    QSignalSpy failedSpy(&source, &BlobDataSource::transferFailed);
+
+    Receiver receiver(1 << 20);
+    source.requestData(s_text, receiver.takeWriteFd());
+    receiver.start();
+
+    // the source gets EPIPE instead of being killed by SIGPIPE
+    QVERIFY(failedSpy.wait(10000));
+    QCOMPARE(failedSpy.first().at(0).toString(), s_text);
+    QCOMPARE(finishedSpy.count(), 0);
+    QCOMPARE(source.activeTransferCount(), 0);
+}
+
+void TestBlobDataSource::testReplaceData()
+{
+    const QByteArray first = payload(1 << 20);
+    BlobDataSource source;
+    QVERIFY(source.setData(s_text, first));
+    QSignalSpy finishedSpy(&source, &BlobDataSource::transferFinished);
+
+    Receiver receiver;
+    source.requestData(s_text, receiver.takeWriteFd());
+    QCOMPARE(source.activeTransferCount(), 1);
+
+    // the started transfer keeps sending what was requested
+    QVERIFY(source.setData(s_text, QByteArrayLiteral("second")));
+    receiver.start();
+    QVERIFY(finishedSpy.wait(10000));
+    QVERIFY(receiver.wait(5000));
+    QCOMPARE(receiver.checksum(), QCryptographicHash::hash(first, QCryptographicHash::Sha1));
+}
+
+void TestBlobDataSource::testThroughput_data()
+{
+    QTest::addColumn<bool>("file");
+
+    QTest::newRow("memory") << false;
+    QTest::newRow("file") << true;
+}
+
+void TestBlobDataSource::testThroughput()
+{
+    QFETCH(bool, file);
+    const QByteArray data = payload(100 << 20);
+    const QByteArray checksum = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+
+    BlobDataSource source;
+    QTemporaryFile tmp;
+    if (file) {
+        QVERIFY(tmp.open());
+        QCOMPARE(tmp.write(data), qint64(data.size()));
+        QVERIFY(tmp.flush());
+        QVERIFY(source.setFile(s_text, tmp.fileName()));
+    } else {
+        QVERIFY(source.setData(s_text, data));
+    }
+    QSignalSpy finishedSpy(&source, &BlobDataSource::transferFinished);
+
+    Receiver receiver;
+    source.requestData(s_text, receiver.takeWriteFd());
+    receiver.start();
+    QVERIFY(finishedSpy.wait(60000));
+    QVERIFY(receiver.wait(5000));
+
+    QCOMPARE(finishedSpy.first().at(1).value<qint64>(), qint64(data.size()));
+    QCOMPARE(receiver.bytes(), qint64(data.size()));
+    QCOMPARE(receiver.checksum(), checksum);
+}
+
+QTEST_GUILESS_MAIN(TestBlobDataSource)
+#include "test_blob_data_source.moc"
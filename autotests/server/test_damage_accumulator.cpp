@@ -0,0 +1,208 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include <QMatrix4x4>
+#include <QtTest>
+
+#include "../../src/server/damageaccumulator_p.h"
+
+using namespace KWaylandServer;
+
+class TestDamageAccumulator : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testEmpty();
+    void testExactRegion();
+    void testCoveredRects();
+    void testMergeAdjacent();
+    void testBoundedRectCount();
+    void testBoundingRectThreshold();
+    void testClear();
+
+    void benchmarkRegion_data();
+    void benchmarkRegion();
+    void benchmarkAccumulator_data();
+    void benchmarkAccumulator();
+};
+
+/**
+ * The damage of a terminal redrawing @p count short runs of characters all over the screen.
+ */
+static QVector<QRect> terminalDamage(int count)
+{
+    QVector<QRect> rects;
+    rects.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const int row = (i * 7) % 60;
+        const int column = (i * 13) % 200;
+        rects << QRect(column * 8, row * 16, 8 * (1 + i % 3), 16);
+    }
+    return rects;
+}
+
+void TestDamageAccumulator::testEmpty()
+{
+    DamageAccumulator damage;
+    QVERIFY(damage.isEmpty());
+    damage.add(QRect());
+    damage.add(QRect(10, 10, 0, 5));
+    damage.add(QRect(10, 10, -5, 5));
+    QVERIFY(damage.isEmpty());
+    QCOMPARE(damage.rectCount(), 0);
+    QCOMPARE(damage.region(), QRegion());
+}
+
+void TestDamageAccumulator::testExactRegion()
+{
+    // a handful of unrelated rects are kept as they are
+    const QVector<QRect> rects{QRect(5, 8, 3, 6), QRect(10, 11, 6, 1), QRect(0, 0, 2, 2), QRect(1, 1, 4, 4)};
+    DamageAccumulator damage;
+    QRegion expected;
+    for (const QRect &rect : rects) {
+        damage.add(rect);
+        expected += rect;
+    }
+    QCOMPARE(damage.region(), expected);
+    QCOMPARE(damage.boundingRect(), expected.boundingRect());
+    QCOMPARE(damage.rectCount(), 4);
+}
+
+void TestDamageAccumulator::testCoveredRects()
+{
+    DamageAccumulator damage;
+    damage.add(QRect(10, 10, 10, 10));
+    damage.add(QRect(12, 12, 2, 2));
+    QCOMPARE(damage.rectCount(), 1);
+
+    damage.add(QRect(100, 100, 5, 5));
+    damage.add(QRect(101, 101, 1, 1));
+    damage.add(QRect(0, 0, 50, 50));
+    QCOMPARE(damage.rectCount(), 2);
+    QCOMPARE(damage.region(), QRegion(0, 0, 50, 50) + QRegion(100, 100, 5, 5));
+}
+
+void TestDamageAccumulator::testMergeAdjacent()
+{
+    // glyphs drawn next to each other in a line end up as a single rect
+    DamageAccumulator damage;
+    for (int i = 0; i < 80; ++i) {
+        damage.add(QRect(i * 8, 16, 8, 16));
+    }
+    QCOMPARE(damage.rectCount(), 1);
+    QCOMPARE(damage.region(), QRegion(0, 16, 640, 16));
+
+    // and so do full lines below each other
+    for (int i = 2; i < 10; ++i) {
+        damage.add(QRect(0, i * 16, 640, 16));
+    }
+    QCOMPARE(damage.rectCount(), 1);
+    QCOMPARE(damage.region(), QRegion(0, 16, 640, 144));
+}
+
+void TestDamageAccumulator::testBoundedRectCount()
+{
+    DamageAccumulator damage;
+    QRegion expected;
+    for (const QRect &rect : terminalDamage(200)) {
+        damage.add(rect);
+        expected += rect;
+        QVERIFY(damage.rectCount() <= DamageAccumulator::maxRects);
+    }
+    // merging may only grow the damage
+    QCOMPARE(damage.region().intersected(expected), expected);
+    QCOMPARE(damage.boundingRect(), expected.boundingRect());
+}
+
+void TestDamageAccumulator::testBoundingRectThreshold()
+{
+    DamageAccumulator damage;
+    for (int i = 0; i < 10; ++i) {
+        damage.add(QRect(i * 20, i * 20, 5, 5), 10);
+    }
+    QCOMPARE(damage.rectCount(), 10);
+
+    damage.add(QRect(500, 500, 5, 5), 10);
+    QCOMPARE(damage.rectCount(), 1);
+    QCOMPARE(damage.region(), QRegion(0, 0, 505, 505));
+
+    damage.add(QRect(600, 0, 10, 10), 10);
+    QCOMPARE(damage.region(), QRegion(0, 0, 610, 505));
+}
+
+void TestDamageAccumulator::testClear()
+{
+    DamageAccumulator damage;
+    for (int i = 0; i < 20; ++i) {
+        damage.add(QRect(i * 20, 0, 5, 5), 10);
+    }
+    QCOMPARE(damage.rectCount(), 1);
+    damage.clear();
+    QVERIFY(damage.isEmpty());
+    QCOMPARE(damage.rectCount(), 0);
+    damage.add(QRect(0, 0, 5, 5), 10);
+    damage.add(QRect(20, 0, 5, 5), 10);
+    QCOMPARE(damage.rectCount(), 2);
+}
+
+void TestDamageAccumulator::benchmarkRegion_data()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::newRow("10") << 10;
+    QTest::newRow("100") << 100;
+    QTest::newRow("1000") << 1000;
+}
+
+void TestDamageAccumulator::benchmarkRegion()
+{
+    // what SurfaceInterface did before: unite every rect and map the result rect by rect
+    QFETCH(int, count);
+    const QVector<QRect> rects = terminalDamage(count);
+    QMatrix4x4 matrix;
+    matrix.scale(0.5);
+
+    QBENCHMARK {
+        QRegion damage;
+        for (const QRect &rect : rects) {
+            damage |= rect;
+        }
+        QRegion mapped;
+        for (const QRect &rect : damage) {
+            mapped += matrix.mapRect(rect);
+        }
+        mapped &= QRect(0, 0, 1024, 768);
+    }
+}
+
+void TestDamageAccumulator::benchmarkAccumulator_data()
+{
+    benchmarkRegion_data();
+}
+
+void TestDamageAccumulator::benchmarkAccumulator()
+{
+    QFETCH(int, count);
+    const QVector<QRect> rects = terminalDamage(count);
+    QMatrix4x4 matrix;
+    matrix.scale(0.5);
+
+    QBENCHMARK {
+        DamageAccumulator damage;
+        for (const QRect &rect : rects) {
+            damage.add(rect);
+        }
+        QRegion mapped;
+        for (const QRect &rect : damage.region()) {
+            mapped += matrix.mapRect(rect);
+        }
+        mapped &= QRect(0, 0, 1024, 768);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestDamageAccumulator)
+#include "test_damage_accumulator.moc"
@@ -8,11 +8,13 @@
 // WaylandServer
 #include "../../src/server/clientconnection.h"
 #include "../../src/server/display.h"
+#include "../../src/server/filtered_display.h"
 #include "../../src/server/output_interface.h"
 #include "../../src/server/outputmanagement_v2_interface.h"
 // Wayland
 #include <wayland-server.h>
 // system
+#include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -27,9 +29,30 @@ private Q_SLOTS:
     void testStartStop();
     void testAddRemoveOutput();
     void testClientConnection();
+    void testClientBacklog();
     void testConnectNoSocket();
     void testOutputManagement();
     void testAutoSocketName();
+
+    void benchmarkClientStartup_data();
+    void benchmarkClientStartup();
+};
+
+class CountingFilteredDisplay : public FilteredDisplay
+{
+public:
+    using FilteredDisplay::FilteredDisplay;
+
+    bool allowInterface(ClientConnection *client, const QByteArray &interfaceName) override
+    {
+        Q_UNUSED(interfaceName)
+        if (client) {
+            ++filterCount;
+        }
+        return true;
+    }
+
+    int filterCount = 0;
 };
 
 void TestWaylandServerDisplay::testSocketName()
@@ -161,6 +184,100 @@ void TestWaylandServerDisplay::testClientConnection()
     QVERIFY(display.connections().isEmpty());
 }
 
+/**
+ * Reads everything the server has sent so far on the client end @p fd of a connection.
+ */
+static void drainClientSocket(Display *display, int fd)
+{
+    char buffer[4096];
+    // the display may have more events buffered than fit into the socket
+    for (int i = 0; i < 10; ++i) {
+        while (read(fd, buffer, sizeof(buffer)) > 0) { }
+        QMetaObject::invokeMethod(display, "flush");
+    }
+}
+
+void TestWaylandServerDisplay::testClientBacklog()
+{
+    // this test verifies the metrics of a client which does not read the events sent to it
+    Display display;
+    display.addSocketName(QStringLiteral("kwin-wayland-server-display-test-client-backlog"));
+    display.start();
+    QVERIFY(!display.clientMetricsEnabled());
+    display.setClientMetricsEnabled(true);
+    QVERIFY(display.clientMetricsEnabled());
+
+    int sv[2];
+    QVERIFY(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) >= 0);
+    QVERIFY(fcntl(sv[1], F_SETFL, O_NONBLOCK) == 0);
+    ClientConnection *connection = display.createClient(sv[0]);
+    QVERIFY(connection);
+    QSignalSpy disconnectedSpy(&display, &Display::clientDisconnected);
+    QVERIFY(disconnectedSpy.isValid());
+    QSignalSpy throttledSpy(connection, &ClientConnection::throttledChanged);
+    QVERIFY(throttledSpy.isValid());
+
+    wl_resource *callback = wl_resource_create(connection->client(), &wl_callback_interface, 1, 0);
+    QVERIFY(callback);
+    auto sendEvents = [&display, callback](int count) {
+        for (int i = 0; i < count; ++i) {
+            wl_callback_send_done(callback, i);
+        }
+        QMetaObject::invokeMethod(&display, "flush");
+    };
+
+    // the client has not read anything yet
+    sendEvents(100);
+    QVERIFY(connection->queuedBytes() > 0);
+    QCOMPARE(connection->sentEventCounts().value(QStringLiteral("wl_callback")), quint64(100));
+    QVERIFY(!connection->lastDrainTime().isValid());
+
+    drainClientSocket(&display, sv[1]);
+    QCOMPARE(connection->queuedBytes(), quint64(0));
+    QVERIFY(connection->lastDrainTime().isValid());
+    const QDateTime drainTime = connection->lastDrainTime();
+
+    // keep sending until the socket is full, less than 4 KiB at a time so the display buffers none of it
+    while (connection->blockedFlushCount() == 0) {
+        QVERIFY(connection->queuedBytes() < 1024 * 1024);
+        sendEvents(300);
+    }
+    QCOMPARE(disconnectedSpy.count(), 0);
+    QCOMPARE(connection->lastDrainTime(), drainTime);
+
+    // ask the policy what to do with it
+    QVector<ClientConnection *> exceeded;
+    Display::BacklogAction action = Display::BacklogAction::Throttle;
+    display.setClientBacklogThreshold(connection->queuedBytes() / 2);
+    display.setClientBacklogPolicy([&exceeded, &action](ClientConnection *client) {
+        exceeded.append(client);
+        return action;
+    });
+    sendEvents(1);
+    QCOMPARE(exceeded, QVector<ClientConnection *>{connection});
+    QVERIFY(connection->isThrottled());
+    QCOMPARE(throttledSpy.count(), 1);
+
+    // throttling ends once the client reads everything
+    drainClientSocket(&display, sv[1]);
+    QVERIFY(!connection->isThrottled());
+    QCOMPARE(throttledSpy.count(), 2);
+    QVERIFY(connection->lastDrainTime() >= drainTime);
+
+    // and a client stuck again is disconnected
+    action = Display::BacklogAction::Disconnect;
+    while (disconnectedSpy.isEmpty()) {
+        QVERIFY(exceeded.count() < 1000);
+        sendEvents(300);
+    }
+    QVERIFY(exceeded.count() > 1);
+    QCOMPARE(disconnectedSpy.first().first().value<ClientConnection *>(), connection);
+    QVERIFY(display.connections().isEmpty());
+
+    close(sv[0]);
+    close(sv[1]);
+}
+
 void TestWaylandServerDisplay::testConnectNoSocket()
 {
     Display display;
@@ -209,5 +326,58 @@ void TestWaylandServerDisplay::testAutoSocketName()
     QCOMPARE(socketNameChangedSpy1.count(), 1);
 }
 
+void TestWaylandServerDisplay::benchmarkClientStartup_data()
+{
+    QTest::addColumn<int>("clientCount");
+    QTest::addColumn<int>("globalCount");
+
+    QTest::newRow("10 clients, 50 globals") << 10 << 50;
+    QTest::newRow("100 clients, 50 globals") << 100 << 50;
+    QTest::newRow("500 clients, 50 globals") << 500 << 50;
+    QTest::newRow("500 clients, 150 globals") << 500 << 150;
+}
+
+void TestWaylandServerDisplay::benchmarkClientStartup()
+{
+    // this benchmark connects many clients which all create a registry, the global filter
+    // looks up the ClientConnection for every global announced to every client
+    QFETCH(int, clientCount);
+    QFETCH(int, globalCount);
+
+    CountingFilteredDisplay display(nullptr);
+    display.start();
+    const wl_global_bind_func_t bindOutput = [](wl_client *, void *, uint32_t, uint32_t) {};
+    for (int i = 0; i < globalCount; ++i) {
+        wl_global_create(display, &wl_output_interface, 1, nullptr, bindOutput);
+    }
+
+    // wl_display.get_registry with the new id 2, as the first request of a client
+    const uint32_t getRegistry[] = {1, (12 << 16) | WL_DISPLAY_GET_REGISTRY, 2};
+
+    QBENCHMARK {
+        display.filterCount = 0;
+        QVector<int> clientFds;
+        QVector<ClientConnection *> connections;
+        for (int i = 0; i < clientCount; ++i) {
+            int sv[2];
+            QVERIFY(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) >= 0);
+            connections << display.createClient(sv[0]);
+            clientFds << sv[1];
+            QCOMPARE(write(sv[1], getRegistry, sizeof(getRegistry)), ssize_t(sizeof(getRegistry)));
+            display.dispatchEvents();
+        }
+        QCOMPARE(display.filterCount, clientCount * globalCount);
+
+        for (ClientConnection *connection : qAsConst(connections)) {
+            connection->destroy();
+        }
+        for (int fd : qAsConst(clientFds)) {
+            close(fd);
+        }
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    }
+    QVERIFY(display.connections().isEmpty());
+}
+
 QTEST_GUILESS_MAIN(TestWaylandServerDisplay)
 #include "test_display.moc"
@@ -0,0 +1,229 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+// Qt
+#include <QThread>
+#include <QtTest>
+// WaylandServer
+#include "../../src/server/display.h"
+#include "../../src/server/inputeventring.h"
+#include "../../src/server/seat_interface.h"
+
+#include <linux/input.h>
+#include <poll.h>
+#include <time.h>
+
+using namespace KWaylandServer;
+
+class TestInputEventRing : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testCapacity();
+    void testFull();
+    void testWakeUp();
+    void testProducerThread();
+    void testSeat();
+    void testHistogram();
+};
+
+static const QString s_socketName = QStringLiteral("kwin-wayland-server-input-event-ring-test-0");
+
+static std::chrono::microseconds now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::microseconds(ts.tv_nsec / 1000);
+}
+
+static void pushBlocking(InputEventRing *ring, const InputEvent &event)
+{
+    while (!ring->push(event)) {
+        QThread::yieldCurrentThread();
+    }
+}
+
+static bool isReadable(int fd)
+{
+    pollfd pfd = {fd, POLLIN, 0};
+    return poll(&pfd, 1, 0) == 1;
+}
+
+void TestInputEventRing::testCapacity()
+{
+    QCOMPARE(InputEventRing(1).capacity(), 1);
+    QCOMPARE(InputEventRing(1000).capacity(), 1024);
+    QCOMPARE(InputEventRing(1024).capacity(), 1024);
+    QCOMPARE(InputEventRing().capacity(), 1024);
+}
+
+void TestInputEventRing::testFull()
+{
+    InputEventRing ring(4);
+    QVERIFY(ring.isEmpty());
+    for (quint32 i = 0; i < 4; ++i) {
+        QVERIFY(ring.push(InputEvent::keyboardKey(std::chrono::microseconds(i), i, KeyboardKeyState::Pressed)));
+    }
+    QVERIFY(!ring.push(InputEvent::keyboardKey(std::chrono::microseconds(4), 4, KeyboardKeyState::Pressed)));
+    QCOMPARE(ring.droppedCount(), quint64(1));
+
+    QVector<quint32> keys;
+    QCOMPARE(ring.drain([&keys](const InputEvent &event) {
+        QCOMPARE(event.type, InputEvent::Type::KeyboardKey);
+        keys << event.key.keyCode;
+    }), 4);
+    QCOMPARE(keys, QVector<quint32>({0, 1, 2, 3}));
+    QVERIFY(ring.isEmpty());
+
+    // the positions wrap around the buffer
+    QVERIFY(ring.push(InputEvent::touchDown(std::chrono::microseconds(5), 7, QPointF(1, 2))));
+    QVERIFY(ring.push(InputEvent::touchUp(std::chrono::microseconds(6), 7)));
+    QVector<InputEvent> events;
+    QCOMPARE(ring.drain([&events](const InputEvent &event) {
+        events << event;
+    }), 2);
+    QCOMPARE(events[0].type, InputEvent::Type::TouchDown);
+    QCOMPARE(events[0].touch.id, 7);
+    QCOMPARE(events[0].position(), QPointF(1, 2));
+    QCOMPARE(events[0].category(), InputEvent::Category::Touch);
+    QCOMPARE(events[1].type, InputEvent::Type::TouchUp);
+    QCOMPARE(events[1].time, std::chrono::microseconds(6));
+    QCOMPARE(ring.drain([](const InputEvent &) {}), 0);
+}
+
+void TestInputEventRing::testWakeUp()
+{
+    InputEventRing ring(8);
+    QVERIFY(ring.fileDescriptor() != -1);
+    QVERIFY(!isReadable(ring.fileDescriptor()));
+
+    QVERIFY(ring.push(InputEvent::pointerFrame(std::chrono::microseconds(1))));
+    QVERIFY(isReadable(ring.fileDescriptor()));
+    ring.acknowledgeWakeUp();
+    QVERIFY(!isReadable(ring.fileDescriptor()));
+
+    // the consumer has not caught up yet, so no more wake ups
+    QVERIFY(ring.push(InputEvent::pointerFrame(std::chrono::microseconds(2))));
+    QVERIFY(!isReadable(ring.fileDescriptor()));
+
+    QCOMPARE(ring.drain([](const InputEvent &) {}), 2);
+    QVERIFY(ring.push(InputEvent::pointerFrame(std::chrono::microseconds(3))));
+    QVERIFY(isReadable(ring.fileDescriptor()));
+}
+
+void TestInputEventRing::testProducerThread()
+{
+    // a synthetic input thread pushes faster than the ring can hold, retrying when it is full
+    const quint32 eventCount = 200000;
+    InputEventRing ring(64);
+    QScopedPointer<QThread> producer(QThread::create([&ring, eventCount] {
+        for (quint32 i = 0; i < eventCount; ++i) {
+            pushBlocking(&ring, InputEvent::keyboardKey(std::chrono::microseconds(i), i, KeyboardKeyState::Pressed));
+        }
+    }));
+    producer->start();
+
+    quint32 expected = 0;
+    bool inOrder = true;
+    while (expected < eventCount) {
+        if (!isReadable(ring.fileDescriptor()) && ring.isEmpty()) {
+            pollfd pfd = {ring.fileDescriptor(), POLLIN, 0};
+            QVERIFY(poll(&pfd, 1, 5000) == 1);
+        }
+        ring.acknowledgeWakeUp();
+        const int drained = ring.drain([&expected, &inOrder](const InputEvent &event) {
+            inOrder = inOrder && event.key.keyCode == expected && event.time == std::chrono::microseconds(expected);
+            ++expected;
+        });
+        QVERIFY(drained <= ring.capacity());
+    }
+    QVERIFY(producer->wait());
+    QVERIFY(inOrder);
+    QCOMPARE(expected, eventCount);
+    QVERIFY(ring.isEmpty());
+}
+
+void TestInputEventRing::testSeat()
+{
+    Display display;
+    display.addSocketName(s_socketName);
+    display.start();
+    SeatInterface *seat = new SeatInterface(&display);
+    seat->setHasPointer(true);
+    seat->setHasKeyboard(true);
+
+    InputEventRing ring(256);
+    seat->setInputEventRing(&ring);
+    QCOMPARE(seat->inputEventRing(), &ring);
+    QSignalSpy pointerPosChangedSpy(seat, &SeatInterface::pointerPosChanged);
+
+    const int motionCount = 1000;
+    QScopedPointer<QThread> producer(QThread::create([&ring, motionCount] {
+        for (int i = 1; i <= motionCount; ++i) {
+            pushBlocking(&ring, InputEvent::pointerMotion(now(), QPointF(i, i * 2)));
+        }
+        pushBlocking(&ring, InputEvent::keyboardKey(now(), KEY_A, KeyboardKeyState::Pressed));
+        pushBlocking(&ring, InputEvent::keyboardKey(now(), KEY_A, KeyboardKeyState::Released));
+    }));
+    producer->start();
+
+    // the seat is woken up by the ring, no explicit dispatching needed
+    QTRY_COMPARE(seat->keyboardInputLatency().totalCount(), quint64(2));
+    QVERIFY(producer->wait());
+    QCOMPARE(pointerPosChangedSpy.count(), motionCount);
+    QCOMPARE(seat->pointerPos(), QPointF(motionCount, motionCount * 2));
+    QCOMPARE(seat->pointerInputLatency().totalCount(), quint64(motionCount));
+    QCOMPARE(seat->touchInputLatency().totalCount(), quint64(0));
+    QVERIFY(seat->pointerInputLatency().percentile(0.5) > std::chrono::nanoseconds::zero());
+
+    // events queued before a dispatch are delivered before the requests of the clients
+    ring.push(InputEvent::pointerMotion(std::chrono::microseconds(42000), QPointF(3, 4)));
+    display.dispatchEvents();
+    QCOMPARE(seat->pointerPos(), QPointF(3, 4));
+    QCOMPARE(seat->timestamp(), 42u);
+    QCOMPARE(seat->dispatchInputEvents(), 0);
+
+    seat->resetInputLatency();
+    QCOMPARE(seat->pointerInputLatency().totalCount(), quint64(0));
+    QCOMPARE(seat->keyboardInputLatency().totalCount(), quint64(0));
+
+    seat->setInputEventRing(nullptr);
+    QVERIFY(!seat->inputEventRing());
+    ring.push(InputEvent::pointerMotion(now(), QPointF(5, 6)));
+    display.dispatchEvents();
+    QCOMPARE(seat->pointerPos(), QPointF(3, 4));
+}
+
+void TestInputEventRing::testHistogram()
+{
+    InputLatencyHistogram histogram;
+    QCOMPARE(histogram.totalCount(), quint64(0));
+    QCOMPARE(histogram.percentile(0.99), std::chrono::nanoseconds::zero());
+
+    histogram.record(std::chrono::nanoseconds(500));
+    histogram.record(std::chrono::microseconds(1));
+    histogram.record(std::chrono::microseconds(3));
+    histogram.record(std::chrono::microseconds(700));
+    histogram.record(std::chrono::seconds(60));
+    QCOMPARE(histogram.totalCount(), quint64(5));
+    QCOMPARE(histogram.count(0), quint64(1));
+    QCOMPARE(histogram.count(1), quint64(1));
+    QCOMPARE(histogram.count(2), quint64(1));
+    QCOMPARE(histogram.count(10), quint64(1));
+    QCOMPARE(histogram.count(InputLatencyHistogram::BucketCount - 1), quint64(1));
+    QCOMPARE(histogram.maximum(), std::chrono::nanoseconds(std::chrono::seconds(60)));
+
+    QCOMPARE(histogram.percentile(0.1), std::chrono::nanoseconds(std::chrono::microseconds(1)));
+    QCOMPARE(histogram.percentile(0.5), std::chrono::nanoseconds(std::chrono::microseconds(4)));
+    QCOMPARE(histogram.percentile(0.7), std::chrono::nanoseconds(std::chrono::microseconds(1024)));
+    QCOMPARE(histogram.percentile(1), std::chrono::nanoseconds(std::chrono::seconds(60)));
+
+    histogram.reset();
+    QCOMPARE(histogram.totalCount(), quint64(0));
+    QCOMPARE(histogram.count(10), quint64(0));
+}
+
+QTEST_GUILESS_MAIN(TestInputEventRing)
+#include "test_input_event_ring.moc"
@@ -0,0 +1,385 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include <QImage>
+#include <QThread>
+#include <QtTest>
+
+#include "../../src/server/compositor_interface.h"
+#include "../../src/server/display.h"
+#include "../../src/server/output_interface.h"
+#include "../../src/server/presentationtime_interface.h"
+#include "../../src/server/surface_interface.h"
+
+#include "../../src/client/compositor.h"
+#include "../../src/client/connection_thread.h"
+#include "../../src/client/event_queue.h"
+#include "../../src/client/output.h"
+#include "../../src/client/registry.h"
+#include "../../src/client/shm_pool.h"
+#include "../../src/client/surface.h"
+
+#include "qwayland-presentation-time.h"
+
+using namespace KWaylandServer;
+using namespace std::chrono_literals;
+
+class Presentation : public QtWayland::wp_presentation
+{
+public:
+    quint32 clockId = 0;
+
+protected:
+    void wp_presentation_clock_id(uint32_t clk_id) override
+    {
+        clockId = clk_id;
+    }
+};
+
+class PresentationFeedback : public QObject, public QtWayland::wp_presentation_feedback
+{
+    Q_OBJECT
+
+public:
+    explicit PresentationFeedback(struct ::wp_presentation_feedback *feedback)
+        : QtWayland::wp_presentation_feedback(feedback)
+    {
+    }
+    ~PresentationFeedback() override
+    {
+        // the server destroyed its side after the last event
+        wp_presentation_feedback_destroy(object());
+    }
+
+    std::chrono::nanoseconds timestamp() const
+    {
+        return std::chrono::seconds(seconds) + std::chrono::nanoseconds(nanoseconds);
+    }
+
+    QVector<wl_output *> syncOutputs;
+    quint64 seconds = 0;
+    quint32 nanoseconds = 0;
+    quint32 refresh = 0;
+    quint64 sequence = 0;
+    quint32 flags = 0;
+
+Q_SIGNALS:
+    void presented();
+    void discarded();
+
+protected:
+    void wp_presentation_feedback_sync_output(struct ::wl_output *output) override
+    {
+        syncOutputs.append(output);
+    }
+    void wp_presentation_feedback_presented(uint32_t tv_sec_hi,
+                                            uint32_t tv_sec_lo,
+                                            uint32_t tv_nsec,
+                                            uint32_t refresh,
+                                            uint32_t seq_hi,
+                                            uint32_t seq_lo,
+                                            uint32_t flags) override
+    {
+        this->seconds = quint64(tv_sec_hi) << 32 | tv_sec_lo;
+        this->nanoseconds = tv_nsec;
+        this->refresh = refresh;
+        this->sequence = quint64(seq_hi) << 32 | seq_lo;
+        this->flags = flags;
+        Q_EMIT presented();
+    }
+    void wp_presentation_feedback_discarded() override
+    {
+        Q_EMIT discarded();
+    }
+};
+
+/**
+ * Stands in for the clock of the display hardware, so the test knows each timestamp.
+ */
+class FakeClock
+{
+public:
+    std::chrono::nanoseconds now() const
+    {
+        return m_now;
+    }
+    /**
+     * Moves to the next vblank of an output refreshing at @p refreshRate mHz.
+     */
+    std::chrono::nanoseconds vblank(int refreshRate)
+    {
+        m_now += std::chrono::nanoseconds(1000000000000ll / refreshRate);
+        ++m_sequence;
+        return m_now;
+    }
+    quint64 sequence() const
+    {
+        return m_sequence;
+    }
+
+private:
+    // past 2^32 seconds, so the high half of the seconds is used as well
+    std::chrono::nanoseconds m_now = std::chrono::seconds(0x100000005ll) + 123ns;
+    quint64 m_sequence = 0x100000000ll;
+};
+
+class TestPresentationTimeInterface : public QObject
+{
+    Q_OBJECT
+
+public:
+    ~TestPresentationTimeInterface() override;
+
+private Q_SLOTS:
+    void initTestCase();
+    void testClockId();
+    void testPresented();
+    void testFrameSequence();
+    void testSupersededUpdate();
+    void testDiscarded();
+    void testSurfaceDestroyed();
+
+private:
+    SurfaceInterface *createSurface(QScopedPointer<KWayland::Client::Surface> &clientSurface);
+    PresentationFeedback *commitWithFeedback(KWayland::Client::Surface *clientSurface, SurfaceInterface *serverSurface);
+
+    KWayland::Client::ConnectionThread *m_connection;
+    KWayland::Client::EventQueue *m_queue;
+    KWayland::Client::Compositor *m_clientCompositor;
+    KWayland::Client::ShmPool *m_shm;
+    KWayland::Client::Output *m_clientOutput;
+
+    QThread *m_thread;
+    Display m_display;
+    CompositorInterface *m_serverCompositor;
+    OutputInterface *m_serverOutput;
+    Presentation *m_presentation = nullptr;
+    FakeClock m_clock;
+};
+
+static const QString s_socketName = QStringLiteral("kwin-wayland-server-presentation-time-test-0");
+
+void TestPresentationTimeInterface::initTestCase()
+{
+    m_display.addSocketName(s_socketName);
+    m_display.start();
+    QVERIFY(m_display.isRunning());
+
+    m_display.createShm();
+    auto presentation = new PresentationInterface(&m_display, this);
+    QCOMPARE(presentation->clockId(), CLOCK_MONOTONIC);
+    presentation->setClockId(CLOCK_MONOTONIC_RAW);
+
+    m_serverCompositor = new CompositorInterface(&m_display, this);
+    m_serverOutput = new OutputInterface(&m_display, this);
+    m_serverOutput->setMode(QSize(1920, 1080), 60000);
+
+    m_connection = new KWayland::Client::ConnectionThread;
+    QSignalSpy connectedSpy(m_connection, &KWayland::Client::ConnectionThread::connected);
+    m_connection->setSocketName(s_socketName);
+
+    m_thread = new QThread(this);
+    m_connection->moveToThread(m_thread);
+    m_thread->start();
+
+    m_connection->initConnection();
+    QVERIFY(connectedSpy.wait());
+
+    m_queue = new KWayland::Client::EventQueue(this);
+    m_queue->setup(m_connection);
+    QVERIFY(m_queue->isValid());
+
+    auto registry = new KWayland::Client::Registry(this);
+    connect(registry, &KWayland::Client::Registry::interfaceAnnounced, this, [this, registry](const QByteArray &interface, quint32 id, quint32 version) {
+        if (interface == QByteArrayLiteral("wp_presentation")) {
+            m_presentation = new Presentation();
+            m_presentation->init(*registry, id, version);
+        }
+    });
+    QSignalSpy allAnnouncedSpy(registry, &KWayland::Client::Registry::interfacesAnnounced);
+    QSignalSpy compositorSpy(registry, &KWayland::Client::Registry::compositorAnnounced);
+    QSignalSpy shmSpy(registry, &KWayland::Client::Registry::shmAnnounced);
+    QSignalSpy outputSpy(registry, &KWayland::Client::Registry::outputAnnounced);
+    registry->setEventQueue(m_queue);
+    registry->create(m_connection->display());
+    QVERIFY(registry->isValid());
+    registry->setup();
+    QVERIFY(allAnnouncedSpy.wait());
+    QVERIFY(m_presentation);
+
+    m_clientCompositor = registry->createCompositor(compositorSpy.first().first().value<quint32>(), compositorSpy.first().last().value<quint32>(), this);
+    QVERIFY(m_clientCompositor->isValid());
+    m_shm = registry->createShmPool(shmSpy.first().first().value<quint32>(), shmSpy.first().last().value<quint32>(), this);
+    QVERIFY(m_shm->isValid());
+    m_clientOutput = registry->createOutput(outputSpy.first().first().value<quint32>(), outputSpy.first().last().value<quint32>(), this);
+    QSignalSpy outputChangedSpy(m_clientOutput, &KWayland::Client::Output::changed);
+    QVERIFY(outputChangedSpy.wait());
+}
+
+TestPresentationTimeInterface::~TestPresentationTimeInterface()
+{
+    delete m_presentation;
+    m_presentation = nullptr;
+    delete m_clientOutput;
+    m_clientOutput = nullptr;
+    delete m_shm;
+    m_shm = nullptr;
+    delete m_queue;
+    m_queue = nullptr;
+    if (m_thread) {
+        m_thread->quit();
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+    m_connection->deleteLater();
+    m_connection = nullptr;
+}
+
+SurfaceInterface *TestPresentationTimeInterface::createSurface(QScopedPointer<KWayland::Client::Surface> &clientSurface)
+{
+    QSignalSpy serverSurfaceCreatedSpy(m_serverCompositor, &CompositorInterface::surfaceCreated);
+    clientSurface.reset(m_clientCompositor->createSurface(this));
+    if (!serverSurfaceCreatedSpy.wait()) {
+        return nullptr;
+    }
+    auto serverSurface = serverSurfaceCreatedSpy.first().first().value<SurfaceInterface *>();
+    serverSurface->setOutputs({m_serverOutput});
+    return serverSurface;
+}
+
+PresentationFeedback *TestPresentationTimeInterface::commitWithFeedback(KWayland::Client::Surface *clientSurface, SurfaceInterface *serverSurface)
+{
+    auto feedback = new PresentationFeedback(m_presentation->feedback(*clientSurface));
+    QImage image(QSize(16, 16), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::red);
+    clientSurface->attachBuffer(m_shm->createBuffer(image));
+    clientSurface->damage(image.rect());
+
+    QSignalSpy committedSpy(serverSurface, &SurfaceInterface::committed);
+    clientSurface->commit(KWayland::Client::Surface::CommitFlag::None);
+    if (!committedSpy.wait()) {
+        delete feedback;
+        return nullptr;
+    }
+    return feedback;
+}
+
+void TestPresentationTimeInterface::testClockId()
+{
+    QCOMPARE(m_presentation->clockId, quint32(CLOCK_MONOTONIC_RAW));
+}
+
+void TestPresentationTimeInterface::testPresented()
+{
+    QScopedPointer<KWayland::Client::Surface> clientSurface;
+    SurfaceInterface *serverSurface = createSurface(clientSurface);
+    QVERIFY(serverSurface);
+    QVERIFY(!serverSurface->hasPresentationFeedback());
+
+    QScopedPointer<PresentationFeedback> feedback(commitWithFeedback(clientSurface.data(), serverSurface));
+    QVERIFY(feedback);
+    QVERIFY(serverSurface->hasPresentationFeedback());
+
+    QSignalSpy presentedSpy(feedback.data(), &PresentationFeedback::presented);
+    const std::chrono::nanoseconds timestamp = m_clock.vblank(m_serverOutput->refreshRate());
+    serverSurface->sendPresented(m_serverOutput,
+                                 timestamp,
+                                 m_clock.sequence(),
+                                 PresentationInterface::Kind::Vsync | PresentationInterface::Kind::HardwareClock | PresentationInterface::Kind::ZeroCopy);
+    QVERIFY(!serverSurface->hasPresentationFeedback());
+    QVERIFY(presentedSpy.wait());
+
+    QCOMPARE(feedback->timestamp(), timestamp);
+    QVERIFY(feedback->seconds > 0xffffffffull);
+    QCOMPARE(feedback->sequence, m_clock.sequence());
+    QCOMPARE(feedback->refresh, quint32(16666666));
+    QCOMPARE(feedback->flags, quint32(WP_PRESENTATION_FEEDBACK_KIND_VSYNC | WP_PRESENTATION_FEEDBACK_KIND_HW_CLOCK | WP_PRESENTATION_FEEDBACK_KIND_ZERO_COPY));
+    QCOMPARE(feedback->syncOutputs, QVector<wl_output *>{*m_clientOutput});
+}
+
+void TestPresentationTimeInterface::testFrameSequence()
+{
+    // a client pacing itself sees each vblank of the fake clock exactly
+    QScopedPointer<KWayland::Client::Surface> clientSurface;
+    SurfaceInterface *serverSurface = createSurface(clientSurface);
+    QVERIFY(serverSurface);
+
+    std::chrono::nanoseconds previous = m_clock.now();
+    for (int i = 0; i < 3; ++i) {
+        QScopedPointer<PresentationFeedback> feedback(commitWithFeedback(clientSurface.data(), serverSurface));
+        QVERIFY(feedback);
+        QSignalSpy presentedSpy(feedback.data(), &PresentationFeedback::presented);
+        const std::chrono::nanoseconds timestamp = m_clock.vblank(m_serverOutput->refreshRate());
+        serverSurface->sendPresented(m_serverOutput, timestamp, m_clock.sequence(), PresentationInterface::Kind::Vsync);
+        QVERIFY(presentedSpy.wait());
+
+        QCOMPARE(feedback->timestamp(), timestamp);
+        QCOMPARE(feedback->timestamp() - previous, std::chrono::nanoseconds(feedback->refresh));
+        QCOMPARE(feedback->flags, quint32(WP_PRESENTATION_FEEDBACK_KIND_VSYNC));
+        previous = feedback->timestamp();
+    }
+}
+
+void TestPresentationTimeInterface::testSupersededUpdate()
+{
+    QScopedPointer<KWayland::Client::Surface> clientSurface;
+    SurfaceInterface *serverSurface = createSurface(clientSurface);
+    QVERIFY(serverSurface);
+
+    QScopedPointer<PresentationFeedback> first(commitWithFeedback(clientSurface.data(), serverSurface));
+    QVERIFY(first);
+    QSignalSpy firstDiscardedSpy(first.data(), &PresentationFeedback::discarded);
+
+    // the second commit replaces the content update before it was presented
+    QScopedPointer<PresentationFeedback> second(commitWithFeedback(clientSurface.data(), serverSurface));
+    QVERIFY(second);
+    QVERIFY(firstDiscardedSpy.wait());
+    QVERIFY(serverSurface->hasPresentationFeedback());
+
+    QSignalSpy secondPresentedSpy(second.data(), &PresentationFeedback::presented);
+    serverSurface->sendPresented(m_serverOutput, m_clock.vblank(m_serverOutput->refreshRate()), m_clock.sequence(), PresentationInterface::Kind::Vsync);
+    QVERIFY(secondPresentedSpy.wait());
+}
+
+void TestPresentationTimeInterface::testDiscarded()
+{
+    QScopedPointer<KWayland::Client::Surface> clientSurface;
+    SurfaceInterface *serverSurface = createSurface(clientSurface);
+    QVERIFY(serverSurface);
+
+    QScopedPointer<PresentationFeedback> feedback(commitWithFeedback(clientSurface.data(), serverSurface));
+    QVERIFY(feedback);
+    QSignalSpy discardedSpy(feedback.data(), &PresentationFeedback::discarded);
+    QSignalSpy presentedSpy(feedback.data(), &PresentationFeedback::presented);
+
+    serverSurface->sendDiscarded();
+    QVERIFY(!serverSurface->hasPresentationFeedback());
+    QVERIFY(discardedSpy.wait());
+
+    // nothing left to present
+    serverSurface->sendPresented(m_serverOutput, m_clock.vblank(m_serverOutput->refreshRate()), m_clock.sequence(), PresentationInterface::Kind::Vsync);
+    m_connection->flush();
+    QTest::qWait(100);
+    QVERIFY(presentedSpy.isEmpty());
+}
+
+void TestPresentationTimeInterface::testSurfaceDestroyed()
+{
+    QScopedPointer<KWayland::Client::Surface> clientSurface;
+    SurfaceInterface *serverSurface = createSurface(clientSurface);
+    QVERIFY(serverSurface);
+
+    QScopedPointer<PresentationFeedback> feedback(commitWithFeedback(clientSurface.data(), serverSurface));
+    QVERIFY(feedback);
+    QSignalSpy discardedSpy(feedback.data(), &PresentationFeedback::discarded);
+
+    clientSurface.reset();
+    QVERIFY(discardedSpy.wait());
+}
+
+QTEST_GUILESS_MAIN(TestPresentationTimeInterface)
+#include "test_presentationtime_interface.moc"
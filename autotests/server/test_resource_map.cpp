@@ -0,0 +1,231 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+// Qt
+#include <QMultiMap>
+#include <QtTest>
+// Wayland
+#include "qwayland-server-wayland.h"
+#include <wayland-server.h>
+// system
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace QtWaylandServer;
+
+class TestResourceMap : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void testResourcesForClient();
+    void testSnapshot();
+    void testBroadcastVersion();
+
+    void benchmarkSendLoop_data();
+    void benchmarkSendLoop();
+    void benchmarkBroadcast_data();
+    void benchmarkBroadcast();
+
+private:
+    void createClients(int count);
+    /**
+     * Flushes the clients and reads back what they were sent, returns the bytes received by each.
+     */
+    QVector<int> drainClients();
+
+    wl_display *m_display = nullptr;
+    QVector<wl_client *> m_clients;
+    QVector<int> m_clientFds;
+};
+
+void TestResourceMap::init()
+{
+    m_display = wl_display_create();
+    QVERIFY(m_display);
+}
+
+void TestResourceMap::cleanup()
+{
+    for (wl_client *client : qAsConst(m_clients)) {
+        wl_client_destroy(client);
+    }
+    m_clients.clear();
+    for (int fd : qAsConst(m_clientFds)) {
+        close(fd);
+    }
+    m_clientFds.clear();
+    wl_display_destroy(m_display);
+    m_display = nullptr;
+}
+
+void TestResourceMap::createClients(int count)
+{
+    for (int i = 0; i < count; ++i) {
+        int sv[2];
+        QVERIFY(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0, sv) >= 0);
+        wl_client *client = wl_client_create(m_display, sv[0]);
+        QVERIFY(client);
+        m_clients << client;
+        m_clientFds << sv[1];
+    }
+}
+
+QVector<int> TestResourceMap::drainClients()
+{
+    wl_display_flush_clients(m_display);
+
+    QVector<int> received;
+    received.reserve(m_clientFds.count());
+    char buffer[4096];
+    for (int fd : qAsConst(m_clientFds)) {
+        int bytes = 0;
+        ssize_t size;
+        while ((size = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            bytes += size;
+        }
+        received << bytes;
+    }
+    return received;
+}
+
+void TestResourceMap::testResourcesForClient()
+{
+    createClients(2);
+    wl_output output;
+
+    wl_output::Resource *first = output.add(m_clients[0], 1);
+    wl_output::Resource *other = output.add(m_clients[1], 1);
+    wl_output::Resource *second = output.add(m_clients[0], 1);
+
+    const auto &resources = output.resourceMap();
+    QCOMPARE(resources.count(), 3);
+    QCOMPARE(resources.count(m_clients[0]), 2);
+    QVERIFY(resources.contains(m_clients[1]));
+
+    // the most recently bound resource of a client comes first
+    QCOMPARE(resources.value(m_clients[0]), second);
+    QCOMPARE(resources.values(m_clients[0]), (QList<wl_output::Resource *>{second, first}));
+    QCOMPARE(resources.value(m_clients[1]), other);
+
+    const wl_output::ResourceRange range = resources.resources(m_clients[0]);
+    QCOMPARE(range.count(), 2);
+    QVERIFY(range.contains(first));
+    QVERIFY(!range.contains(other));
+
+    wl_resource_destroy(second->handle);
+    QCOMPARE(resources.count(), 2);
+    QCOMPARE(resources.value(m_clients[0]), first);
+
+    wl_resource_destroy(other->handle);
+    QVERIFY(!resources.contains(m_clients[1]));
+    QVERIFY(resources.resources(m_clients[1]).isEmpty());
+    QVERIFY(!resources.value(m_clients[1]));
+}
+
+void TestResourceMap::testSnapshot()
+{
+    createClients(3);
+    wl_output output;
+    for (wl_client *client : qAsConst(m_clients)) {
+        output.add(client, 1);
+    }
+
+    // a copy keeps the resources it was taken with while the original changes
+    const auto snapshot = output.resourceMap();
+    int visited = 0;
+    for (wl_output::Resource *resource : snapshot) {
+        ++visited;
+        wl_resource_destroy(resource->handle);
+    }
+    QCOMPARE(visited, 3);
+    QCOMPARE(snapshot.count(), 3);
+    QVERIFY(output.resourceMap().isEmpty());
+}
+
+void TestResourceMap::testBroadcastVersion()
+{
+    createClients(2);
+    wl_output output;
+    output.add(m_clients[0], 1);
+    output.add(m_clients[1], 2);
+    drainClients();
+
+    // wl_output.scale was added in version 2
+    output.broadcast_scale(2);
+    QVector<int> received = drainClients();
+    QCOMPARE(received[0], 0);
+    QVERIFY(received[1] > 0);
+
+    output.broadcast_geometry(0, 0, 300, 200, 0, QStringLiteral("make"), QStringLiteral("model"), 0);
+    received = drainClients();
+    QVERIFY(received[0] > 0);
+    QCOMPARE(received[0], received[1]);
+
+    // a range only reaches the resources of a single client
+    output.broadcast_geometry(output.resourceMap().resources(m_clients[1]), 0, 0, 300, 200, 0, QStringLiteral("make"), QStringLiteral("model"), 0);
+    received = drainClients();
+    QCOMPARE(received[0], 0);
+    QVERIFY(received[1] > 0);
+}
+
+void TestResourceMap::benchmarkSendLoop_data()
+{
+    QTest::addColumn<int>("clientCount");
+
+    QTest::newRow("1") << 1;
+    QTest::newRow("10") << 10;
+    QTest::newRow("100") << 100;
+    QTest::newRow("250") << 250;
+}
+
+void TestResourceMap::benchmarkSendLoop()
+{
+    // what the interfaces did before: copy the resource map and send to each resource in turn
+    QFETCH(int, clientCount);
+    createClients(clientCount);
+    wl_output output;
+    QMultiMap<wl_client *, wl_output::Resource *> resourceMap;
+    for (wl_client *client : qAsConst(m_clients)) {
+        resourceMap.insert(client, output.add(client, 1));
+    }
+    const QString make = QStringLiteral("make");
+    const QString model = QStringLiteral("model");
+
+    QBENCHMARK {
+        const auto resources = resourceMap;
+        for (wl_output::Resource *resource : resources) {
+            output.send_geometry(resource->handle, 0, 0, 300, 200, 0, make, model, 0);
+        }
+        drainClients();
+    }
+}
+
+void TestResourceMap::benchmarkBroadcast_data()
+{
+    benchmarkSendLoop_data();
+}
+
+void TestResourceMap::benchmarkBroadcast()
+{
+    QFETCH(int, clientCount);
+    createClients(clientCount);
+    wl_output output;
+    for (wl_client *client : qAsConst(m_clients)) {
+        output.add(client, 1);
+    }
+    const QString make = QStringLiteral("make");
+    const QString model = QStringLiteral("model");
+
+    QBENCHMARK {
+        output.broadcast_geometry(0, 0, 300, 200, 0, make, model, 0);
+        drainClients();
+    }
+}
+
+QTEST_GUILESS_MAIN(TestResourceMap)
+#include "test_resource_map.moc"
@@ -0,0 +1,276 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include <QtTest>
+
+#include "../../src/server/surfacetransform_p.h"
+
+using namespace KWaylandServer;
+
+class TestSurfaceTransform : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testIdentity();
+    void testMatchesMatrix_data();
+    void testMatchesMatrix();
+    void testRoundTrip_data();
+    void testRoundTrip();
+    void testInverseRoundsOutwards();
+    void testFractionalViewport();
+    void testRegion();
+
+    void benchmarkMatrix();
+    void benchmarkTransform();
+};
+
+/**
+ * The surface to buffer matrix as SurfaceInterface used to build it.
+ */
+static QMatrix4x4 referenceMatrix(OutputInterface::Transform transform, int scale, const QSize &bufferSize, const QRectF &sourceGeometry, const QSize &surfaceSize)
+{
+    QMatrix4x4 matrix;
+    matrix.scale(scale, scale);
+
+    switch (transform) {
+    case OutputInterface::Transform::Normal:
+    case OutputInterface::Transform::Flipped:
+        break;
+    case OutputInterface::Transform::Rotated90:
+    case OutputInterface::Transform::Flipped90:
+        matrix.translate(0, bufferSize.height() / scale);
+        matrix.rotate(-90, 0, 0, 1);
+        break;
+    case OutputInterface::Transform::Rotated180:
+    case OutputInterface::Transform::Flipped180:
+        matrix.translate(bufferSize.width() / scale, bufferSize.height() / scale);
+        matrix.rotate(-180, 0, 0, 1);
+        break;
+    case OutputInterface::Transform::Rotated270:
+    case OutputInterface::Transform::Flipped270:
+        matrix.translate(bufferSize.width() / scale, 0);
+        matrix.rotate(-270, 0, 0, 1);
+        break;
+    }
+
+    switch (transform) {
+    case OutputInterface::Transform::Flipped:
+    case OutputInterface::Transform::Flipped180:
+        matrix.translate(bufferSize.width() / scale, 0);
+        matrix.scale(-1, 1);
+        break;
+    case OutputInterface::Transform::Flipped90:
+    case OutputInterface::Transform::Flipped270:
+        matrix.translate(bufferSize.height() / scale, 0);
+        matrix.scale(-1, 1);
+        break;
+    default:
+        break;
+    }
+
+    if (sourceGeometry.isValid()) {
+        matrix.translate(sourceGeometry.x(), sourceGeometry.y());
+    }
+
+    QSizeF sourceSize = sourceGeometry.size();
+    if (!sourceGeometry.isValid()) {
+        sourceSize = bufferSize / scale;
+        if (transform == OutputInterface::Transform::Rotated90 || transform == OutputInterface::Transform::Rotated270
+            || transform == OutputInterface::Transform::Flipped90 || transform == OutputInterface::Transform::Flipped270) {
+            sourceSize.transpose();
+        }
+    }
+    if (sourceSize != surfaceSize) {
+        matrix.scale(sourceSize.width() / surfaceSize.width(), sourceSize.height() / surfaceSize.height());
+    }
+    return matrix;
+}
+
+static QSize surfaceSizeFor(OutputInterface::Transform transform, int scale, const QSize &bufferSize)
+{
+    QSize size = bufferSize / scale;
+    if (transform == OutputInterface::Transform::Rotated90 || transform == OutputInterface::Transform::Rotated270
+        || transform == OutputInterface::Transform::Flipped90 || transform == OutputInterface::Transform::Flipped270) {
+        size.transpose();
+    }
+    return size;
+}
+
+static void addTransformRows()
+{
+    QTest::addColumn<OutputInterface::Transform>("transform");
+    QTest::addColumn<int>("scale");
+    QTest::addColumn<QRectF>("sourceGeometry");
+    QTest::addColumn<QSize>("destinationSize");
+
+    const QVector<QPair<OutputInterface::Transform, const char *>> transforms{
+        {OutputInterface::Transform::Normal, "normal"},
+        {OutputInterface::Transform::Rotated90, "rotated90"},
+        {OutputInterface::Transform::Rotated180, "rotated180"},
+        {OutputInterface::Transform::Rotated270, "rotated270"},
+        {OutputInterface::Transform::Flipped, "flipped"},
+        {OutputInterface::Transform::Flipped90, "flipped90"},
+        {OutputInterface::Transform::Flipped180, "flipped180"},
+        {OutputInterface::Transform::Flipped270, "flipped270"},
+    };
+    for (const auto &transform : transforms) {
+        for (int scale : {1, 2, 3}) {
+            QTest::addRow("%s-%d", transform.second, scale) << transform.first << scale << QRectF() << QSize();
+            QTest::addRow("%s-%d-crop", transform.second, scale) << transform.first << scale << QRectF(10, 5, 30, 20) << QSize();
+            QTest::addRow("%s-%d-downscale", transform.second, scale) << transform.first << scale << QRectF(10, 5, 30, 20) << QSize(15, 10);
+        }
+    }
+}
+
+void TestSurfaceTransform::testIdentity()
+{
+    const SurfaceTransform transform;
+    QVERIFY(transform.isIntegral());
+    QCOMPARE(transform.toMatrix(), QMatrix4x4());
+    QCOMPARE(transform.map(QPointF(12.5, 7)), QPointF(12.5, 7));
+    QCOMPARE(transform.mapRect(QRect(1, 2, 3, 4)), QRect(1, 2, 3, 4));
+    QCOMPARE(transform.inverseMapRect(QRect(1, 2, 3, 4)), QRect(1, 2, 3, 4));
+}
+
+void TestSurfaceTransform::testMatchesMatrix_data()
+{
+    addTransformRows();
+}
+
+void TestSurfaceTransform::testMatchesMatrix()
+{
+    QFETCH(OutputInterface::Transform, transform);
+    QFETCH(int, scale);
+    QFETCH(QRectF, sourceGeometry);
+    QFETCH(QSize, destinationSize);
+
+    const QSize bufferSize(120 * scale, 90 * scale);
+    QSize surfaceSize = surfaceSizeFor(transform, scale, bufferSize);
+    if (destinationSize.isValid()) {
+        surfaceSize = destinationSize;
+    } else if (sourceGeometry.isValid()) {
+        surfaceSize = sourceGeometry.size().toSize();
+    }
+
+    const SurfaceTransform surfaceTransform(transform, scale, bufferSize, sourceGeometry, surfaceSize);
+    const QMatrix4x4 matrix = referenceMatrix(transform, scale, bufferSize, sourceGeometry, surfaceSize);
+    QVERIFY(surfaceTransform.isIntegral());
+    QCOMPARE(surfaceTransform.toMatrix(), matrix);
+
+    for (const QPointF &point : {QPointF(0, 0), QPointF(1.5, 2.25), QPointF(7, 3)}) {
+        QCOMPARE(surfaceTransform.map(point), matrix.map(point));
+        QCOMPARE(surfaceTransform.inverseMap(matrix.map(point)), point);
+    }
+    for (const QRect &rect : {QRect(0, 0, 1, 1), QRect(3, 4, 5, 6), QRect(0, 0, 15, 10)}) {
+        QCOMPARE(surfaceTransform.mapRect(rect), matrix.mapRect(rect));
+    }
+}
+
+void TestSurfaceTransform::testRoundTrip_data()
+{
+    addTransformRows();
+}
+
+void TestSurfaceTransform::testRoundTrip()
+{
+    QFETCH(OutputInterface::Transform, transform);
+    QFETCH(int, scale);
+    QFETCH(QRectF, sourceGeometry);
+    QFETCH(QSize, destinationSize);
+
+    const QSize bufferSize(120 * scale, 90 * scale);
+    QSize surfaceSize = surfaceSizeFor(transform, scale, bufferSize);
+    if (destinationSize.isValid()) {
+        surfaceSize = destinationSize;
+    } else if (sourceGeometry.isValid()) {
+        surfaceSize = sourceGeometry.size().toSize();
+    }
+
+    const SurfaceTransform surfaceTransform(transform, scale, bufferSize, sourceGeometry, surfaceSize);
+    for (const QRect &rect : {QRect(0, 0, 1, 1), QRect(3, 4, 5, 6), QRect(2, 1, 11, 7)}) {
+        QCOMPARE(surfaceTransform.inverseMapRect(surfaceTransform.mapRect(rect)), rect);
+    }
+}
+
+void TestSurfaceTransform::testInverseRoundsOutwards()
+{
+    const SurfaceTransform transform(OutputInterface::Transform::Normal, 2, QSize(200, 100), QRectF(), QSize(100, 50));
+    QCOMPARE(transform.inverseMapRect(QRect(30, 40, 22, 4)), QRect(15, 20, 11, 2));
+    QCOMPARE(transform.inverseMapRect(QRect(31, 41, 1, 1)), QRect(15, 20, 1, 1));
+    QCOMPARE(transform.inverseMapRect(QRect(31, 41, 2, 2)), QRect(15, 20, 2, 2));
+
+    const SurfaceTransform rotated(OutputInterface::Transform::Rotated90, 2, QSize(200, 100), QRectF(), QSize(50, 100));
+    const QRect damage = rotated.inverseMapRect(QRect(1, 1, 1, 1));
+    QVERIFY(rotated.mapRect(damage).contains(QRect(1, 1, 1, 1)));
+    QCOMPARE(damage.size(), QSize(1, 1));
+}
+
+void TestSurfaceTransform::testFractionalViewport()
+{
+    // scaling a 30x20 crop up to 500x250 has no integer mapping
+    const QRectF sourceGeometry(10, 10, 30, 20);
+    const QSize surfaceSize(500, 250);
+    const SurfaceTransform transform(OutputInterface::Transform::Normal, 2, QSize(200, 100), sourceGeometry, surfaceSize);
+    const QMatrix4x4 matrix = referenceMatrix(OutputInterface::Transform::Normal, 2, QSize(200, 100), sourceGeometry, surfaceSize);
+    QVERIFY(!transform.isIntegral());
+    QCOMPARE(transform.map(QPointF(0, 0)), QPointF(20, 20));
+    QCOMPARE(transform.mapRect(QRect(0, 0, 250, 125)), matrix.mapRect(QRect(0, 0, 250, 125)));
+    QCOMPARE(transform.inverseMapRect(QRect(20, 20, 30, 20)), matrix.inverted().mapRect(QRect(20, 20, 30, 20)));
+
+    // and neither has a crop at a fractional offset
+    const SurfaceTransform fractionalOffset(OutputInterface::Transform::Normal, 1, QSize(200, 100), QRectF(0.5, 0, 30, 20), QSize(30, 20));
+    QVERIFY(!fractionalOffset.isIntegral());
+    QCOMPARE(fractionalOffset.map(QPointF(1, 1)), QPointF(1.5, 1));
+}
+
+void TestSurfaceTransform::testRegion()
+{
+    QRegion region;
+    region += QRect(0, 0, 10, 10);
+    region += QRect(20, 0, 5, 5);
+    region += QRect(5, 20, 30, 4);
+
+    for (auto bufferTransform : {OutputInterface::Transform::Normal, OutputInterface::Transform::Rotated90, OutputInterface::Transform::Flipped180}) {
+        const QSize bufferSize(100, 80);
+        const SurfaceTransform transform(bufferTransform, 2, bufferSize, QRectF(), surfaceSizeFor(bufferTransform, 2, bufferSize));
+        const QMatrix4x4 matrix = transform.toMatrix();
+        QRegion expected;
+        for (const QRect &rect : region) {
+            expected += matrix.mapRect(rect);
+        }
+        QCOMPARE(transform.map(region), expected);
+        QCOMPARE(transform.inverseMap(transform.map(region)), region);
+    }
+}
+
+void TestSurfaceTransform::benchmarkMatrix()
+{
+    const QMatrix4x4 matrix = referenceMatrix(OutputInterface::Transform::Rotated90, 2, QSize(1920, 1080), QRectF(), QSize(540, 960));
+    const QMatrix4x4 inverse = matrix.inverted();
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            const QRect rect(i % 500, i % 900, 16, 16);
+            inverse.mapRect(matrix.mapRect(rect));
+            matrix.map(QPointF(i, i));
+        }
+    }
+}
+
+void TestSurfaceTransform::benchmarkTransform()
+{
+    const SurfaceTransform transform(OutputInterface::Transform::Rotated90, 2, QSize(1920, 1080), QRectF(), QSize(540, 960));
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            const QRect rect(i % 500, i % 900, 16, 16);
+            transform.inverseMapRect(transform.mapRect(rect));
+            transform.map(QPointF(i, i));
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(TestSurfaceTransform)
+#include "test_surface_transform.moc"
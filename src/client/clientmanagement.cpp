@@ -22,9 +22,14 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include "wayland_pointer_p.h"
 // Qt
 #include <QDebug>
+#include <QHash>
 #include <QVector>
+// std
+#include <algorithm>
+#include <functional>
 // wayland
 #include "wayland-client-management-client-protocol.h"
+#include "wayland-window-states-client-protocol.h"
 #include <wayland-client-protocol.h>
 
 namespace KWayland
@@ -40,25 +45,40 @@ class Q_DECL_HIDDEN ClientManagement::Private
 public:
     Private(ClientManagement *q);
     void setup(com_deepin_client_management *o);
+    void setupWindowStates(com_deepin_window_states *o);
     void get_window_states();
     void getWindowCaption(int windowId, wl_buffer *buffer);
     void requestSplitWindow(const char *uuid, int splitType);
 
     WaylandPointer<com_deepin_client_management, com_deepin_client_management_destroy> clientManagement;
+    WaylandPointer<com_deepin_window_states, com_deepin_window_states_destroy> windowStatesDeltas;
     EventQueue *queue = nullptr;
     uint m_windowsCount;
     WindowStates m_windowStates;
+    QHash<int32_t, int> m_windowIndex;
+    // changes received from com_deepin_window_states, applied on window_states_done
+    WindowStates m_pendingStates;
+    QVector<int32_t> m_pendingRemovals;
+    bool m_replacePending = false;
 
 private:
     static void windowStatesCallback(void *data, com_deepin_client_management *clientManagement, uint32_t count, wl_array *windowStates);
     static void windowCaptureCallback(void *data, com_deepin_client_management *clientManagement, int windowId, int succeed, wl_buffer *buffer);
     static void splitChangeCallback(void *data, com_deepin_client_management *clientManagement, const char *uuid, uint32_t splitable);
+    static void windowStatesChangedCallback(void *data, com_deepin_window_states *windowStates, uint32_t count, wl_array *states);
+    static void windowStatesRemovedCallback(void *data, com_deepin_window_states *windowStates, wl_array *windowIds);
+    static void windowStatesDoneCallback(void *data, com_deepin_window_states *windowStates);
     void addWindowStates(uint32_t count, wl_array *windowStates);
+    void changeWindowStates(wl_array *windowStates);
+    void removeWindowStates(wl_array *windowIds);
+    void applyWindowStates();
+    void rebuildWindowIndex();
     void sendWindowCaptionDone(int windowId, bool succeed, wl_buffer *buffer);
     void splitChange(const char* uuid, int splitable);
 
     ClientManagement *q;
     static struct com_deepin_client_management_listener s_clientManagementListener;
+    static struct com_deepin_window_states_listener s_windowStatesListener;
 };
 
 ClientManagement::Private::Private(ClientManagement *q)
@@ -92,6 +112,16 @@ void ClientManagement::Private::setup(com_deepin_client_management *o)
     com_deepin_client_management_add_listener(clientManagement, &s_clientManagementListener, this);
 }
 
+void ClientManagement::Private::setupWindowStates(com_deepin_window_states *o)
+{
+    Q_ASSERT(o);
+    Q_ASSERT(!windowStatesDeltas);
+    windowStatesDeltas.setup(o);
+    // the first batch replaces the known window states
+    m_replacePending = true;
+    com_deepin_window_states_add_listener(windowStatesDeltas, &s_windowStatesListener, this);
+}
+
 ClientManagement::ClientManagement(QObject *parent)
     : QObject(parent)
     , d(new Private(this))
@@ -100,6 +130,7 @@ ClientManagement::ClientManagement(QObject *parent)
 
 ClientManagement::~ClientManagement()
 {
+    d->windowStatesDeltas.release();
     d->clientManagement.release();
 }
 
@@ -109,20 +140,101 @@ com_deepin_client_management_listener ClientManagement::Private::s_clientManagem
     splitChangeCallback
 };
 
+com_deepin_window_states_listener ClientManagement::Private::s_windowStatesListener = {
+    windowStatesChangedCallback,
+    windowStatesRemovedCallback,
+    windowStatesDoneCallback
+};
+
 void ClientManagement::Private::addWindowStates(uint32_t count, wl_array *windowStates)
 {
     m_windowsCount = count;
 
-    if (0 < windowStates->size && (0 == (windowStates->size % sizeof(ClientManagement::WindowState)))) {
+    if (0 == (windowStates->size % sizeof(ClientManagement::WindowState)) && windowStates->size / sizeof(ClientManagement::WindowState) == count) {
         m_windowStates.clear();
         m_windowStates.resize(m_windowsCount);
         memcpy(m_windowStates.data(), windowStates->data, windowStates->size);
+        rebuildWindowIndex();
         Q_EMIT q->windowStatesChanged();
     } else {
         qWarning() << Q_FUNC_INFO << "receive wayland event error";
     }
 }
 
+void ClientManagement::Private::rebuildWindowIndex()
+{
+    m_windowIndex.clear();
+    m_windowIndex.reserve(m_windowStates.count());
+    for (int i = 0; i < m_windowStates.count(); ++i) {
+        m_windowIndex.insert(m_windowStates.at(i).windowId, i);
+    }
+}
+
+void ClientManagement::Private::changeWindowStates(wl_array *windowStates)
+{
+    if (0 != (windowStates->size % sizeof(ClientManagement::WindowState))) {
+        qWarning() << Q_FUNC_INFO << "receive wayland event error";
+        return;
+    }
+    const auto *states = static_cast<const ClientManagement::WindowState *>(windowStates->data);
+    const int count = windowStates->size / sizeof(ClientManagement::WindowState);
+    for (int i = 0; i < count; ++i) {
+        m_pendingStates.append(states[i]);
+    }
+}
+
+void ClientManagement::Private::removeWindowStates(wl_array *windowIds)
+{
+    const auto *ids = static_cast<const int32_t *>(windowIds->data);
+    const int count = windowIds->size / sizeof(int32_t);
+    for (int i = 0; i < count; ++i) {
+        m_pendingRemovals.append(ids[i]);
+    }
+}
+
+void ClientManagement::Private::applyWindowStates()
+{
+    if (m_replacePending) {
+        m_windowStates.clear();
+        m_windowIndex.clear();
+        m_replacePending = false;
+    }
+
+    QVector<int> rows;
+    rows.reserve(m_pendingRemovals.count());
+    for (int32_t windowId : qAsConst(m_pendingRemovals)) {
+        auto it = m_windowIndex.find(windowId);
+        if (it == m_windowIndex.end()) {
+            continue;
+        }
+        rows << *it;
+        m_windowIndex.erase(it);
+    }
+    if (!rows.isEmpty()) {
+        // removing from the back keeps the rows still to remove valid
+        std::sort(rows.begin(), rows.end(), std::greater<int>());
+        for (int row : qAsConst(rows)) {
+            m_windowStates.remove(row);
+        }
+        rebuildWindowIndex();
+    }
+
+    for (const ClientManagement::WindowState &state : qAsConst(m_pendingStates)) {
+        auto it = m_windowIndex.constFind(state.windowId);
+        if (it != m_windowIndex.constEnd()) {
+            m_windowStates[*it] = state;
+        } else {
+            m_windowIndex.insert(state.windowId, m_windowStates.count());
+            m_windowStates.append(state);
+        }
+    }
+
+    m_pendingStates.clear();
+    m_pendingRemovals.clear();
+    m_windowsCount = m_windowStates.count();
+    Q_EMIT q->windowStatesChanged();
+}
+
 void ClientManagement::Private::sendWindowCaptionDone(int windowId, bool succeed, wl_buffer *buffer)
 {
     Q_EMIT q->captionWindowDone(windowId, succeed);
@@ -159,11 +271,41 @@ void ClientManagement::Private::splitChangeCallback(void *data, com_deepin_clien
     o->splitChange(uuid, splitable);
 }
 
+void ClientManagement::Private::windowStatesChangedCallback(void *data, com_deepin_window_states *windowStates,
+                                                uint32_t count,
+                                                wl_array *states)
+{
+    Q_UNUSED(windowStates);
+    Q_UNUSED(count);
+    auto o = reinterpret_cast<ClientManagement::Private*>(data);
+    o->changeWindowStates(states);
+}
+
+void ClientManagement::Private::windowStatesRemovedCallback(void *data, com_deepin_window_states *windowStates,
+                                                wl_array *windowIds)
+{
+    Q_UNUSED(windowStates);
+    auto o = reinterpret_cast<ClientManagement::Private*>(data);
+    o->removeWindowStates(windowIds);
+}
+
+void ClientManagement::Private::windowStatesDoneCallback(void *data, com_deepin_window_states *windowStates)
+{
+    Q_UNUSED(windowStates);
+    auto o = reinterpret_cast<ClientManagement::Private*>(data);
+    o->applyWindowStates();
+}
+
 void ClientManagement::setup(com_deepin_client_management *clientManagement)
 {
     d->setup(clientManagement);
 }
 
+void ClientManagement::setupWindowStates(com_deepin_window_states *windowStates)
+{
+    d->setupWindowStates(windowStates);
+}
+
 EventQueue *ClientManagement::eventQueue() const
 {
     return d->queue;
@@ -194,6 +336,7 @@ ClientManagement::operator com_deepin_client_management*() const {
 
 void ClientManagement::destroy()
 {
+    d->windowStatesDeltas.destroy();
     d->clientManagement.destroy();
 
 }
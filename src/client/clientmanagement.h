@@ -30,6 +30,7 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include <DWayland/Client/kwaylandclient_export.h>
 
 struct com_deepin_client_management;
+struct com_deepin_window_states;
 class QPoint;
 class QRect;
 
@@ -113,6 +114,19 @@ public:
      * method.
      **/
     void setup(com_deepin_client_management *clientManagement);
+    /**
+     * Receives the window states through @p windowStates, which sends only the added,
+     * changed and removed window states instead of the state of all windows on every
+     * change. The changes of one batch are applied together before windowStatesChanged
+     * is emitted.
+     *
+     * @code
+     * c->setupWindowStates(registry->bindWindowStates(name, version));
+     * @endcode
+     *
+     * @see Registry::bindWindowStates
+     **/
+    void setupWindowStates(com_deepin_window_states *windowStates);
 
     /**
      * @returns @c true if managing a com_deepin_client_management.
@@ -152,6 +166,10 @@ public:
 Q_SIGNALS:
     /**
      * Emitted whenever window State changed.
+     *
+     * After setupWindowStates the server only sends the added, changed and removed
+     * window states, this signal is emitted once the whole batch has been applied to
+     * getWindowStates.
      **/
     void windowStatesChanged();
     /**
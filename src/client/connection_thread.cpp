@@ -4,6 +4,7 @@
     SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
 */
 #include "connection_thread.h"
+#include "event_queue.h"
 #include "logging.h"
 // Qt
 #include <QAbstractEventDispatcher>
@@ -13,10 +14,14 @@
 #include <QGuiApplication>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QReadWriteLock>
 #include <QSocketNotifier>
 #include <qpa/qplatformnativeinterface.h>
 // Wayland
 #include <wayland-client-protocol.h>
+// std
+#include <atomic>
+#include <chrono>
 
 namespace KWayland
 {
@@ -30,6 +35,10 @@ public:
     void doInitConnection();
     void setupSocketNotifier();
     void setupSocketFileWatcher();
+    qint64 readEvents(wl_display *readDisplay, wl_event_queue *queue);
+    void dispatchEvents();
+    void reportError();
+    void releaseDisplay();
 
     wl_display *display = nullptr;
     int fd = -1;
@@ -41,6 +50,12 @@ public:
     bool foreign = false;
     QMetaObject::Connection eventDispatcherConnection;
     int error = 0;
+    // guards display against being released while other threads read from it
+    QReadWriteLock displayLock;
+    QMutex queueMutex;
+    QVector<EventQueue *> queues;
+    // when the events pending on the default queue were read, 0 if none are pending
+    std::atomic<qint64> pendingRead{0};
     static QVector<ConnectionThread *> connections;
     static QRecursiveMutex mutex;
 
@@ -67,22 +82,30 @@ ConnectionThread::Private::Private(ConnectionThread *q)
 
 ConnectionThread::Private::~Private()
 {
-    {
-        QMutexLocker lock(&mutex);
-        connections.removeOne(q);
-    }
     if (display && !foreign) {
+        QWriteLocker locker(&displayLock);
         wl_display_flush(display);
         wl_display_disconnect(display);
+        display = nullptr;
     }
 }
 
+static qint64 monotonicTime()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 void ConnectionThread::Private::doInitConnection()
 {
+    wl_display *connected;
     if (fd != -1) {
-        display = wl_display_connect_to_fd(fd);
+        connected = wl_display_connect_to_fd(fd);
     } else {
-        display = wl_display_connect(socketName.toUtf8().constData());
+        connected = wl_display_connect(socketName.toUtf8().constData());
+    }
+    {
+        QWriteLocker locker(&displayLock);
+        display = connected;
     }
     if (!display) {
         qCWarning(KWAYLAND_CLIENT) << "Failed connecting to Wayland display";
@@ -109,21 +132,99 @@ void ConnectionThread::Private::setupSocketNotifier()
         if (!display) {
             return;
         }
-        if (wl_display_dispatch(display) == -1) {
-            error = wl_display_get_error(display);
-            if (error != 0) {
-                if (display) {
-                    free(display);
-                    display = nullptr;
-                }
-                Q_EMIT q->errorOccurred();
-                return;
-            }
+        // an error reading is picked up by dispatching
+        {
+            QReadLocker locker(&displayLock);
+            readEvents(display, nullptr);
         }
-        Q_EMIT q->eventsRead();
+        dispatchEvents();
     });
 }
 
+// the caller holds displayLock for reading
+qint64 ConnectionThread::Private::readEvents(wl_display *readDisplay, wl_event_queue *queue)
+{
+    if (!display || display != readDisplay) {
+        return -1;
+    }
+    const int prepared = queue ? wl_display_prepare_read_queue(display, queue) : wl_display_prepare_read(display);
+    if (prepared != 0) {
+        // the queue has to dispatch what was read before, the socket stays readable
+        return 0;
+    }
+    wl_display_flush(display);
+    if (wl_display_read_events(display) == -1) {
+        if (queue) {
+            // let the thread of the connection find and report the error
+            QMetaObject::invokeMethod(
+                q,
+                [this] {
+                    if (foreign) {
+                        reportError();
+                    } else {
+                        dispatchEvents();
+                    }
+                },
+                Qt::QueuedConnection);
+        }
+        return -1;
+    }
+
+    const qint64 readTime = monotonicTime();
+    {
+        QMutexLocker queueLocker(&queueMutex);
+        for (EventQueue *eventQueue : qAsConst(queues)) {
+            if (static_cast<wl_event_queue *>(*eventQueue) != queue) {
+                eventQueue->notifyEventsRead(readTime);
+            }
+        }
+    }
+    // the default queue of a foreign display is dispatched by the application
+    qint64 expected = 0;
+    if (queue && !foreign && pendingRead.compare_exchange_strong(expected, readTime)) {
+        QMetaObject::invokeMethod(q, [this] { dispatchEvents(); }, Qt::QueuedConnection);
+    }
+    return readTime;
+}
+
+void ConnectionThread::Private::dispatchEvents()
+{
+    pendingRead = 0;
+    if (!display) {
+        return;
+    }
+    if (wl_display_dispatch_pending(display) == -1) {
+        error = wl_display_get_error(display);
+        if (error != 0) {
+            releaseDisplay();
+            Q_EMIT q->errorOccurred();
+            return;
+        }
+    }
+    Q_EMIT q->eventsRead();
+}
+
+void ConnectionThread::Private::reportError()
+{
+    // the display of a foreign connection is owned by the application, it only gets looked at
+    if (!display || error != 0) {
+        return;
+    }
+    error = wl_display_get_error(display);
+    if (error != 0) {
+        Q_EMIT q->errorOccurred();
+    }
+}
+
+void ConnectionThread::Private::releaseDisplay()
+{
+    QWriteLocker locker(&displayLock);
+    if (display && !foreign) {
+        free(display);
+        display = nullptr;
+    }
+}
+
 void ConnectionThread::Private::setupSocketFileWatcher()
 {
     if (!runtimeDir.exists() || fd != -1) {
@@ -137,10 +238,7 @@ void ConnectionThread::Private::setupSocketFileWatcher()
         }
         qCWarning(KWAYLAND_CLIENT) << "Connection to server went away";
         serverDied = true;
-        if (display) {
-            free(display);
-            display = nullptr;
-        }
+        releaseDisplay();
         socketNotifier.reset();
 
         // need a new filesystem watcher
@@ -189,6 +287,12 @@ ConnectionThread::ConnectionThread(wl_display *display, QObject *parent)
 ConnectionThread::~ConnectionThread()
 {
     disconnect(d->eventDispatcherConnection);
+    {
+        QMutexLocker lock(&Private::mutex);
+        Private::connections.removeOne(this);
+    }
+    // event queues of other threads might still be reading, wait for them
+    QWriteLocker locker(&d->displayLock);
 }
 
 ConnectionThread *ConnectionThread::fromApplication(QObject *parent)
@@ -286,5 +390,40 @@ QVector<ConnectionThread *> ConnectionThread::connections()
     return Private::connections;
 }
 
+qint64 ConnectionThread::readEvents(ConnectionThread *connection, wl_display *display, wl_event_queue *queue)
+{
+    QMutexLocker lock(&Private::mutex);
+    if (!Private::connections.contains(connection)) {
+        return -1;
+    }
+    // keeps the destructor from completing until the events are read
+    QReadLocker locker(&connection->d->displayLock);
+    lock.unlock();
+    return connection->d->readEvents(display, queue);
+}
+
+void ConnectionThread::addEventQueue(EventQueue *queue)
+{
+    QMutexLocker locker(&d->queueMutex);
+    if (!d->queues.contains(queue)) {
+        d->queues << queue;
+    }
+}
+
+void ConnectionThread::removeEventQueue(ConnectionThread *connection, EventQueue *queue)
+{
+    QMutexLocker lock(&Private::mutex);
+    if (!Private::connections.contains(connection)) {
+        return;
+    }
+    QMutexLocker locker(&connection->d->queueMutex);
+    connection->d->queues.removeOne(queue);
+}
+
+bool ConnectionThread::readsEventsFor(const QObject *object) const
+{
+    return object->thread() == thread() && !d->socketNotifier.isNull();
+}
+
 }
 }
@@ -12,6 +12,7 @@
 #include <DWayland/Client/kwaylandclient_export.h>
 
 struct wl_display;
+struct wl_event_queue;
 
 namespace KWayland
 {
@@ -40,6 +41,8 @@ namespace KWayland
  **/
 namespace Client
 {
+class EventQueue;
+
 /**
  * @short Creates and manages the connection to a Wayland server.
  *
@@ -75,6 +78,10 @@ namespace Client
  * the Wayland socket, it will be dispatched and the signal @link ::eventsRead @endlink is emitted.
  * This allows further event queues in other threads to also dispatch their events.
  *
+ * An EventQueue set up for the ConnectionThread reads from the Wayland socket in its own thread
+ * as well, so its events are dispatched even while the thread of the ConnectionThread is busy.
+ * Whichever thread reads the events, all the other event queues get notified to dispatch theirs.
+ *
  * Furthermore this class flushes the Wayland connection whenever the QAbstractEventDispatcher
  * is about to block.
  *
@@ -120,10 +127,11 @@ public:
      * When the created ConnectionThread gets destroyed the managed wl_display won't be disconnected
      * as that's managed by Qt.
      *
-     * The returned ConnectionThread is not able to detect (protocol) error. The signal
-     * {@link errorOccurred} won't be emitted, {@link hasError} will return @c false, even if the
-     * actual connection held by QtWayland is on error. The behavior of QtWayland is to exit the
-     * application on error.
+     * The returned ConnectionThread only detects a (protocol) error when reading the events for
+     * an EventQueue fails. Otherwise the signal {@link errorOccurred} won't be emitted and
+     * {@link hasError} will return @c false, even if the actual connection held by QtWayland is
+     * on error. The behavior of QtWayland is to exit the application on error. The wl_display
+     * stays owned by QtWayland in either case.
      *
      * @since 5.4
      **/
@@ -220,6 +228,8 @@ Q_SIGNALS:
     void failed();
     /**
      * Emitted whenever new events are ready to be read.
+     *
+     * The events may have been read from the socket by an EventQueue in another thread.
      **/
     void eventsRead();
     /**
@@ -252,6 +262,32 @@ private Q_SLOTS:
     void doInitConnection();
 
 private:
+    friend class EventQueue;
+    /**
+     * Reads the events from the socket of @p display, which must be the display of
+     * @p connection, and notifies all event queues but @p queue about them.
+     * Passing a @c null @p queue reads for the default queue.
+     *
+     * This may be called from any thread, also while @p connection gets destroyed.
+     * The destructor waits for reads which already started.
+     *
+     * Returns the time the events were read, @c 0 if nothing could be read because
+     * @p queue still has events to dispatch, or @c -1 if the display or @p connection
+     * is gone or on error.
+     **/
+    static qint64 readEvents(ConnectionThread *connection, wl_display *display, wl_event_queue *queue);
+    void addEventQueue(EventQueue *queue);
+    /**
+     * Stops notifying @p queue, does nothing if @p connection is already destroyed.
+     **/
+    static void removeEventQueue(ConnectionThread *connection, EventQueue *queue);
+    /**
+     * Whether the socket notifier of this ConnectionThread reads the events for @p object,
+     * which is the case if it lives in the same thread. The display of a foreign
+     * ConnectionThread is read by the application.
+     **/
+    bool readsEventsFor(const QObject *object) const;
+
     class Private;
     QScopedPointer<Private> d;
 };
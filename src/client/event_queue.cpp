@@ -7,8 +7,13 @@
 #include "connection_thread.h"
 #include "wayland_pointer_p.h"
 
+#include <QSocketNotifier>
+
 #include <wayland-client.h>
 
+#include <atomic>
+#include <chrono>
+
 namespace KWayland
 {
 namespace Client
@@ -16,10 +21,67 @@ namespace Client
 class Q_DECL_HIDDEN EventQueue::Private
 {
 public:
+    void readEvents();
+    void dispatch(qint64 readTime);
+    void stopReading(EventQueue *q);
+
     wl_display *display = nullptr;
     WaylandPointer<wl_event_queue, wl_event_queue_destroy> queue;
+    // may be destroyed by another thread, only passed to the static functions of ConnectionThread
+    ConnectionThread *connection = nullptr;
+    QScopedPointer<QSocketNotifier> socketNotifier;
+    // when the events pending on the queue were read by another thread, 0 if none are pending
+    std::atomic<qint64> pendingRead{0};
+
+    qint64 lastLatency = 0;
+    qint64 maximumLatency = 0;
+    qint64 totalLatency = 0;
+    quint64 latencyCount = 0;
 };
 
+static qint64 monotonicTime()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void EventQueue::Private::readEvents()
+{
+    if (!connection) {
+        socketNotifier->setEnabled(false);
+        return;
+    }
+    // whatever another thread read in the meantime gets dispatched along
+    const qint64 pending = pendingRead.exchange(0);
+    const qint64 readTime = ConnectionThread::readEvents(connection, display, queue);
+    if (readTime == -1) {
+        // the ConnectionThread reports the error or is gone
+        socketNotifier->setEnabled(false);
+        return;
+    }
+    dispatch(pending ? pending : readTime);
+}
+
+void EventQueue::Private::dispatch(qint64 readTime)
+{
+    if (wl_display_dispatch_queue_pending(display, queue) > 0 && readTime > 0) {
+        lastLatency = monotonicTime() - readTime;
+        maximumLatency = qMax(maximumLatency, lastLatency);
+        totalLatency += lastLatency;
+        latencyCount++;
+    }
+    wl_display_flush(display);
+}
+
+void EventQueue::Private::stopReading(EventQueue *q)
+{
+    if (connection) {
+        ConnectionThread::removeEventQueue(connection, q);
+        connection = nullptr;
+    }
+    socketNotifier.reset();
+    pendingRead = 0;
+}
+
 EventQueue::EventQueue(QObject *parent)
     : QObject(parent)
     , d(new Private)
@@ -33,12 +95,14 @@ EventQueue::~EventQueue()
 
 void EventQueue::release()
 {
+    d->stopReading(this);
     d->queue.release();
     d->display = nullptr;
 }
 
 void EventQueue::destroy()
 {
+    d->stopReading(this);
     d->queue.destroy();
     d->display = nullptr;
 }
@@ -60,7 +124,17 @@ void EventQueue::setup(wl_display *display)
 void EventQueue::setup(ConnectionThread *connection)
 {
     setup(connection->display());
-    connect(connection, &ConnectionThread::eventsRead, this, &EventQueue::dispatch, Qt::QueuedConnection);
+    resetDispatchStatistics();
+    d->connection = connection;
+    connection->addEventQueue(this);
+    if (connection->readsEventsFor(this)) {
+        // the socket notifier of the connection reads and notifies this queue
+        return;
+    }
+    d->socketNotifier.reset(new QSocketNotifier(wl_display_get_fd(d->display), QSocketNotifier::Read));
+    connect(d->socketNotifier.data(), &QSocketNotifier::activated, this, [this] {
+        d->readEvents();
+    });
 }
 
 void EventQueue::dispatch()
@@ -68,8 +142,46 @@ void EventQueue::dispatch()
     if (!d->display || !d->queue) {
         return;
     }
-    wl_display_dispatch_queue_pending(d->display, d->queue);
-    wl_display_flush(d->display);
+    d->dispatch(d->pendingRead.exchange(0));
+}
+
+void EventQueue::notifyEventsRead(qint64 readTime)
+{
+    qint64 expected = 0;
+    if (d->pendingRead.compare_exchange_strong(expected, readTime)) {
+        QMetaObject::invokeMethod(this, &EventQueue::dispatch, Qt::QueuedConnection);
+    }
+}
+
+qint64 EventQueue::lastDispatchLatency() const
+{
+    return d->lastLatency;
+}
+
+qint64 EventQueue::maximumDispatchLatency() const
+{
+    return d->maximumLatency;
+}
+
+qint64 EventQueue::averageDispatchLatency() const
+{
+    if (d->latencyCount == 0) {
+        return 0;
+    }
+    return d->totalLatency / qint64(d->latencyCount);
+}
+
+quint64 EventQueue::dispatchCount() const
+{
+    return d->latencyCount;
+}
+
+void EventQueue::resetDispatchStatistics()
+{
+    d->lastLatency = 0;
+    d->maximumLatency = 0;
+    d->totalLatency = 0;
+    d->latencyCount = 0;
 }
 
 void EventQueue::addProxy(wl_proxy *proxy)
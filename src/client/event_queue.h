@@ -70,9 +70,14 @@ public:
     /**
      * Creates the event queue for the @p connection.
      *
-     * This method also connects the eventsRead signal of the ConnectionThread
-     * to the dispatch method. Events will be automatically dispatched without
-     * the need to call dispatch manually.
+     * Events will be automatically dispatched without the need to call dispatch
+     * manually. The EventQueue reads the events from the Wayland socket in the thread
+     * this method gets called from, so it does not have to wait for the thread of the
+     * @p connection or of any other EventQueue. An EventQueue living in the thread of the
+     * @p connection leaves the reading to the @p connection instead. Events read by another
+     * thread get dispatched through a queued invocation of dispatch.
+     *
+     * The @p connection has to outlive the EventQueue.
      * @see dispatch
      **/
     void setup(ConnectionThread *connection);
@@ -118,6 +123,37 @@ public:
     operator wl_event_queue *();
     operator wl_event_queue *() const;
 
+    /**
+     * The time in nanoseconds from reading the events from the Wayland socket until the
+     * last dispatch which had events to deliver started to dispatch them.
+     *
+     * The dispatch latency is only measured for an EventQueue set up for a ConnectionThread.
+     * Like all the dispatch statistics it must be accessed from the thread of the EventQueue.
+     * @see maximumDispatchLatency
+     * @see averageDispatchLatency
+     **/
+    qint64 lastDispatchLatency() const;
+    /**
+     * The highest dispatch latency in nanoseconds since the EventQueue got set up or
+     * resetDispatchStatistics was called.
+     * @see lastDispatchLatency
+     **/
+    qint64 maximumDispatchLatency() const;
+    /**
+     * The mean dispatch latency in nanoseconds since the EventQueue got set up or
+     * resetDispatchStatistics was called.
+     * @see lastDispatchLatency
+     **/
+    qint64 averageDispatchLatency() const;
+    /**
+     * The number of dispatches which delivered events and got their latency measured.
+     **/
+    quint64 dispatchCount() const;
+    /**
+     * Resets the dispatch latency statistics.
+     **/
+    void resetDispatchStatistics();
+
 public Q_SLOTS:
     /**
      * Dispatches all pending events on the EventQueue.
@@ -125,6 +161,12 @@ public Q_SLOTS:
     void dispatch();
 
 private:
+    friend class ConnectionThread;
+    /**
+     * Called by the ConnectionThread from whichever thread read events at @p readTime.
+     **/
+    void notifyEventsRead(qint64 readTime);
+
     class Private;
     QScopedPointer<Private> d;
 };
@@ -12,13 +12,22 @@
 #include "wayland_pointer_p.h"
 // Wayland
 #include <wayland-plasma-window-management-client-protocol.h>
+#include <wayland-stacking-order-client-protocol.h>
+#include <wayland-window-icons-client-protocol.h>
 
+#include <QCache>
+#include <QCryptographicHash>
 #include <QFutureWatcher>
+#include <QMutexLocker>
+#include <QSet>
+#include <QThreadPool>
 #include <QTimer>
 #include <QtConcurrentRun>
 #include <qplatformdefs.h>
 
 #include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
 
 namespace KWayland
 {
@@ -29,14 +38,24 @@ class Q_DECL_HIDDEN PlasmaWindowManagement::Private
 public:
     Private(PlasmaWindowManagement *q);
     WaylandPointer<org_kde_plasma_window_management, org_kde_plasma_window_management_destroy> wm;
+    WaylandPointer<com_deepin_stacking_order, com_deepin_stacking_order_destroy> stackingOrderDeltas;
+    WaylandPointer<com_deepin_window_icons, com_deepin_window_icons_destroy> windowIcons;
     EventQueue *queue = nullptr;
     bool showingDesktop = false;
     QList<PlasmaWindow *> windows;
     PlasmaWindow *activeWindow = nullptr;
     QVector<quint32> stackingOrder;
     QVector<QByteArray> stackingOrderUuids;
+    QList<QSize> iconSizes;
+    // the icon hash of each window uuid announced through windowIcons
+    QHash<QByteArray, QByteArray> iconHashes;
+    // the hashes of the icons being transferred
+    QSet<QByteArray> iconTransfers;
 
     void setup(org_kde_plasma_window_management *wm);
+    void setupStackingOrder(com_deepin_stacking_order *stackingOrder);
+    void setupWindowIcons(com_deepin_window_icons *icons);
+    void sendIconSizes();
 
 private:
     static void showDesktopCallback(void *data, org_kde_plasma_window_management *org_kde_plasma_window_management, uint32_t state);
@@ -44,12 +63,19 @@ private:
     static void windowWithUuidCallback(void *data, org_kde_plasma_window_management *org_kde_plasma_window_management, uint32_t id, const char *uuid);
     static void stackingOrderCallback(void *data, org_kde_plasma_window_management *org_kde_plasma_window_management, wl_array *ids);
     static void stackingOrderUuidsCallback(void *data, org_kde_plasma_window_management *org_kde_plasma_window_management, const char *uuids);
+    static void fullStackingOrderCallback(void *data, com_deepin_stacking_order *com_deepin_stacking_order, const char *uuids);
+    static void windowMovedCallback(void *data, com_deepin_stacking_order *com_deepin_stacking_order, uint32_t from, uint32_t to);
+    static void iconCallback(void *data, com_deepin_window_icons *com_deepin_window_icons, const char *uuid, const char *hash);
     void setShowDesktop(bool set);
     void windowCreated(org_kde_plasma_window *id, quint32 internalId, const char *uuid);
     void setStackingOrder(const QVector<quint32> &ids);
     void setStackingOrder(const QVector<QByteArray> &uuids);
+    void updateIcon(PlasmaWindow *window);
+    void transferIcon(const QByteArray &hash);
 
     static struct org_kde_plasma_window_management_listener s_listener;
+    static struct com_deepin_stacking_order_listener s_stackingOrderListener;
+    static struct com_deepin_window_icons_listener s_windowIconsListener;
     PlasmaWindowManagement *q;
 };
 
@@ -83,6 +109,9 @@ public:
     bool resizable = false;
     bool virtualDesktopChangeable = false;
     QIcon icon;
+    // the content hash of a transferred icon
+    QByteArray iconHash;
+    quint32 iconSerial = 0;
     PlasmaWindowManagement *wm = nullptr;
     bool unmapped = false;
     QPointer<PlasmaWindow> parentWindow;
@@ -158,6 +187,15 @@ org_kde_plasma_window_management_listener PlasmaWindowManagement::Private::s_lis
     windowWithUuidCallback,
 };
 
+com_deepin_stacking_order_listener PlasmaWindowManagement::Private::s_stackingOrderListener = {
+    fullStackingOrderCallback,
+    windowMovedCallback,
+};
+
+com_deepin_window_icons_listener PlasmaWindowManagement::Private::s_windowIconsListener = {
+    iconCallback,
+};
+
 void PlasmaWindowManagement::Private::setup(org_kde_plasma_window_management *windowManagement)
 {
     Q_ASSERT(!wm);
@@ -166,6 +204,47 @@ void PlasmaWindowManagement::Private::setup(org_kde_plasma_window_management *wi
     org_kde_plasma_window_management_add_listener(windowManagement, &s_listener, this);
 }
 
+void PlasmaWindowManagement::Private::setupStackingOrder(com_deepin_stacking_order *stackingOrder)
+{
+    Q_ASSERT(!stackingOrderDeltas);
+    Q_ASSERT(stackingOrder);
+    if (queue) {
+        queue->addProxy(stackingOrder);
+    }
+    stackingOrderDeltas.setup(stackingOrder);
+    com_deepin_stacking_order_add_listener(stackingOrder, &s_stackingOrderListener, this);
+}
+
+void PlasmaWindowManagement::Private::setupWindowIcons(com_deepin_window_icons *icons)
+{
+    Q_ASSERT(!windowIcons);
+    Q_ASSERT(icons);
+    if (queue) {
+        queue->addProxy(icons);
+    }
+    windowIcons.setup(icons);
+    com_deepin_window_icons_add_listener(icons, &s_windowIconsListener, this);
+    if (!iconSizes.isEmpty()) {
+        sendIconSizes();
+    }
+}
+
+void PlasmaWindowManagement::Private::sendIconSizes()
+{
+    if (!windowIcons) {
+        return;
+    }
+    wl_array sizes;
+    wl_array_init(&sizes);
+    for (const QSize &size : qAsConst(iconSizes)) {
+        int32_t *values = static_cast<int32_t *>(wl_array_add(&sizes, 2 * sizeof(int32_t)));
+        values[0] = size.width();
+        values[1] = size.height();
+    }
+    com_deepin_window_icons_set_icon_sizes(windowIcons, &sizes);
+    wl_array_release(&sizes);
+}
+
 void PlasmaWindowManagement::Private::showDesktopCallback(void *data, org_kde_plasma_window_management *org_kde_plasma_window_management, uint32_t state)
 {
     auto wm = reinterpret_cast<PlasmaWindowManagement::Private *>(data);
@@ -239,8 +318,11 @@ void PlasmaWindowManagement::Private::windowCreated(org_kde_plasma_window *id, q
     PlasmaWindow *window = new PlasmaWindow(q, id, internalId, uuid);
     window->d->wm = q;
     windows << window;
-    QObject::connect(window, &QObject::destroyed, q, [this, window] {
+    // the icon may have been announced before the window was created
+    updateIcon(window);
+    QObject::connect(window, &QObject::destroyed, q, [this, window, uuid = window->d->uuid] {
         windows.removeAll(window);
+        iconHashes.remove(uuid);
         if (activeWindow == window) {
             activeWindow = nullptr;
             Q_EMIT q->activeWindowChanged();
@@ -285,6 +367,25 @@ void PlasmaWindowManagement::Private::stackingOrderUuidsCallback(void *data, org
     wm->setStackingOrder(QByteArray(uuids).split(';').toVector());
 }
 
+void PlasmaWindowManagement::Private::fullStackingOrderCallback(void *data, com_deepin_stacking_order *stackingOrder, const char *uuids)
+{
+    auto wm = reinterpret_cast<PlasmaWindowManagement::Private *>(data);
+    Q_ASSERT(wm->stackingOrderDeltas == stackingOrder);
+    wm->setStackingOrder(QByteArray(uuids).split(';').toVector());
+}
+
+void PlasmaWindowManagement::Private::windowMovedCallback(void *data, com_deepin_stacking_order *stackingOrder, uint32_t from, uint32_t to)
+{
+    auto wm = reinterpret_cast<PlasmaWindowManagement::Private *>(data);
+    Q_ASSERT(wm->stackingOrderDeltas == stackingOrder);
+    const uint32_t count = wm->stackingOrderUuids.count();
+    if (from == to || from >= count || to >= count) {
+        return;
+    }
+    wm->stackingOrderUuids.move(from, to);
+    Q_EMIT wm->q->stackingOrderUuidsChanged();
+}
+
 void PlasmaWindowManagement::Private::setStackingOrder(const QVector<quint32> &ids)
 {
     if (stackingOrder == ids) {
@@ -320,6 +421,8 @@ void PlasmaWindowManagement::destroy()
         return;
     }
     Q_EMIT interfaceAboutToBeDestroyed();
+    d->stackingOrderDeltas.destroy();
+    d->windowIcons.destroy();
     d->wm.destroy();
 }
 
@@ -329,6 +432,8 @@ void PlasmaWindowManagement::release()
         return;
     }
     Q_EMIT interfaceAboutToBeReleased();
+    d->stackingOrderDeltas.release();
+    d->windowIcons.release();
     d->wm.release();
 }
 
@@ -337,6 +442,16 @@ void PlasmaWindowManagement::setup(org_kde_plasma_window_management *wm)
     d->setup(wm);
 }
 
+void PlasmaWindowManagement::setupStackingOrder(com_deepin_stacking_order *stackingOrder)
+{
+    d->setupStackingOrder(stackingOrder);
+}
+
+void PlasmaWindowManagement::setupWindowIcons(com_deepin_window_icons *windowIcons)
+{
+    d->setupWindowIcons(windowIcons);
+}
+
 void PlasmaWindowManagement::setEventQueue(EventQueue *queue)
 {
     d->queue = queue;
@@ -409,6 +524,20 @@ QVector<QByteArray> PlasmaWindowManagement::stackingOrderUuids() const
     return d->stackingOrderUuids;
 }
 
+void PlasmaWindowManagement::setIconSizes(const QList<QSize> &sizes)
+{
+    if (d->iconSizes == sizes) {
+        return;
+    }
+    d->iconSizes = sizes;
+    d->sendIconSizes();
+}
+
+QList<QSize> PlasmaWindowManagement::iconSizes() const
+{
+    return d->iconSizes;
+}
+
 org_kde_plasma_window_listener PlasmaWindow::Private::s_listener = {
     titleChangedCallback,
     appIdChangedCallback,
@@ -624,6 +753,8 @@ void PlasmaWindow::Private::themedIconNameChangedCallback(void *data, org_kde_pl
     auto p = cast(data);
     Q_UNUSED(window);
     const QString themedName = QString::fromUtf8(name);
+    p->iconHash.clear();
+    ++p->iconSerial;
     if (!themedName.isEmpty()) {
         QIcon icon = QIcon::fromTheme(themedName);
         p->icon = icon;
@@ -633,25 +764,60 @@ void PlasmaWindow::Private::themedIconNameChangedCallback(void *data, org_kde_pl
     Q_EMIT p->q->iconChanged();
 }
 
+namespace
+{
+struct TransferredIcon {
+    QByteArray hash;
+    QIcon icon;
+};
+
+/**
+ * The icons transferred for all windows by their content hash, so windows of the same
+ * application share one decoded icon.
+ */
+class PlasmaWindowIconCache
+{
+public:
+    PlasmaWindowIconCache()
+        // in KiB of transferred data
+        : icons(8 << 10)
+    {
+        threadPool.setMaxThreadCount(2);
+    }
+
+    QMutex mutex;
+    QCache<QByteArray, QIcon> icons;
+    QThreadPool threadPool;
+};
+}
+
+Q_GLOBAL_STATIC(PlasmaWindowIconCache, s_iconCache)
+
 static int readData(int fd, QByteArray &data)
 {
-    // implementation based on QtWayland file qwaylanddataoffer.cpp
+    // the fd stays non-blocking, a compositor not writing for a second must not hold a pool thread
+    pollfd pfd = {fd, POLLIN, 0};
     char buf[4096];
-    int retryCount = 0;
-    int n;
     while (true) {
-        n = QT_READ(fd, buf, sizeof buf);
-        if (n == -1 && (errno == EAGAIN) && ++retryCount < 1000) {
-            usleep(1000);
-        } else {
-            break;
+        const int n = QT_READ(fd, buf, sizeof buf);
+        if (n > 0) {
+            data.append(buf, n);
+            continue;
+        }
+        if (n == 0) {
+            return 0;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN) {
+            return -1;
+        }
+        const int ready = poll(&pfd, 1, 1000);
+        if (ready == 0 || (ready == -1 && errno != EINTR)) {
+            return -1;
         }
     }
-    if (n > 0) {
-        data.append(buf, n);
-        n = readData(fd, data);
-    }
-    return n;
 }
 
 void PlasmaWindow::Private::iconChangedCallback(void *data, org_kde_plasma_window *window)
@@ -665,30 +831,161 @@ void PlasmaWindow::Private::iconChangedCallback(void *data, org_kde_plasma_windo
     org_kde_plasma_window_get_icon(p->window, pipeFds[1]);
     close(pipeFds[1]);
     const int pipeFd = pipeFds[0];
-    auto readIcon = [pipeFd]() -> QIcon {
+    const QList<QSize> sizes = p->wm ? p->wm->iconSizes() : QList<QSize>();
+    auto readIcon = [pipeFd, sizes]() -> TransferredIcon {
         QByteArray content;
-        if (readData(pipeFd, content) != 0) {
-            close(pipeFd);
-            return QIcon();
-        }
+        const int result = readData(pipeFd, content);
         close(pipeFd);
+        if (result != 0 || content.isEmpty()) {
+            return TransferredIcon();
+        }
+        QByteArray key = QCryptographicHash::hash(content, QCryptographicHash::Sha1);
+        for (const QSize &size : sizes) {
+            key += ' ' + QByteArray::number(size.width()) + 'x' + QByteArray::number(size.height());
+        }
+        {
+            QMutexLocker locker(&s_iconCache->mutex);
+            if (const QIcon *icon = s_iconCache->icons.object(key)) {
+                return {key, *icon};
+            }
+        }
         QDataStream ds(content);
         QIcon icon;
         ds >> icon;
-        return icon;
+        if (!sizes.isEmpty() && !icon.isNull()) {
+            QIcon trimmed;
+            for (const QSize &size : sizes) {
+                trimmed.addPixmap(icon.pixmap(size));
+            }
+            icon = trimmed;
+        }
+        QMutexLocker locker(&s_iconCache->mutex);
+        if (const QIcon *cached = s_iconCache->icons.object(key)) {
+            return {key, *cached};
+        }
+        s_iconCache->icons.insert(key, new QIcon(icon), qMax(1, content.size() >> 10));
+        return {key, icon};
     };
-    QFutureWatcher<QIcon> *watcher = new QFutureWatcher<QIcon>(p->q);
-    QObject::connect(watcher, &QFutureWatcher<QIcon>::finished, p->q, [p, watcher] {
+    const quint32 serial = ++p->iconSerial;
+    QFutureWatcher<TransferredIcon> *watcher = new QFutureWatcher<TransferredIcon>(p->q);
+    QObject::connect(watcher, &QFutureWatcher<TransferredIcon>::finished, p->q, [p, watcher, serial] {
         watcher->deleteLater();
-        QIcon icon = watcher->result();
-        if (!icon.isNull()) {
-            p->icon = icon;
+        if (serial != p->iconSerial) {
+            // superseded by a newer icon
+            return;
+        }
+        const TransferredIcon result = watcher->result();
+        if (!result.icon.isNull()) {
+            if (result.hash == p->iconHash) {
+                return;
+            }
+            p->icon = result.icon;
+            p->iconHash = result.hash;
         } else {
             p->icon = QIcon::fromTheme(QStringLiteral("wayland"));
+            p->iconHash.clear();
         }
         Q_EMIT p->q->iconChanged();
     });
-    watcher->setFuture(QtConcurrent::run(readIcon));
+    watcher->setFuture(QtConcurrent::run(&s_iconCache->threadPool, readIcon));
+}
+
+void PlasmaWindowManagement::Private::iconCallback(void *data, com_deepin_window_icons *icons, const char *uuid, const char *hash)
+{
+    auto wm = reinterpret_cast<PlasmaWindowManagement::Private *>(data);
+    Q_ASSERT(wm->windowIcons == icons);
+    const QByteArray windowUuid(uuid);
+    wm->iconHashes.insert(windowUuid, QByteArray(hash));
+    auto it = std::find_if(wm->windows.constBegin(), wm->windows.constEnd(), [&windowUuid](PlasmaWindow *window) {
+        return window->d->uuid == windowUuid;
+    });
+    if (it != wm->windows.constEnd()) {
+        wm->updateIcon(*it);
+    }
+}
+
+void PlasmaWindowManagement::Private::updateIcon(PlasmaWindow *window)
+{
+    PlasmaWindow::Private *p = window->d.data();
+    const QByteArray hash = iconHashes.value(p->uuid);
+    if (hash == p->iconHash) {
+        return;
+    }
+    p->iconHash = hash;
+    // drops a transfer started through the window itself
+    ++p->iconSerial;
+    if (hash.isEmpty()) {
+        p->icon = QIcon::fromTheme(QStringLiteral("wayland"));
+        Q_EMIT window->iconChanged();
+        return;
+    }
+    QIcon cached;
+    {
+        QMutexLocker locker(&s_iconCache->mutex);
+        if (const QIcon *icon = s_iconCache->icons.object(hash)) {
+            cached = *icon;
+        }
+    }
+    if (cached.isNull()) {
+        transferIcon(hash);
+        return;
+    }
+    p->icon = cached;
+    Q_EMIT window->iconChanged();
+}
+
+void PlasmaWindowManagement::Private::transferIcon(const QByteArray &hash)
+{
+    // windows with the same icon wait for one transfer
+    if (iconTransfers.contains(hash)) {
+        return;
+    }
+    int pipeFds[2];
+    if (pipe2(pipeFds, O_CLOEXEC | O_NONBLOCK) != 0) {
+        return;
+    }
+    com_deepin_window_icons_get_icon(windowIcons, hash.constData(), pipeFds[1]);
+    close(pipeFds[1]);
+    iconTransfers.insert(hash);
+    const int pipeFd = pipeFds[0];
+    auto readIcon = [pipeFd, hash]() -> QIcon {
+        QByteArray content;
+        const int result = readData(pipeFd, content);
+        close(pipeFd);
+        if (result != 0 || content.isEmpty()) {
+            return QIcon();
+        }
+        QDataStream ds(content);
+        QIcon icon;
+        ds >> icon;
+        if (!icon.isNull()) {
+            QMutexLocker locker(&s_iconCache->mutex);
+            s_iconCache->icons.insert(hash, new QIcon(icon), qMax(1, content.size() >> 10));
+        }
+        return icon;
+    };
+    QFutureWatcher<QIcon> *watcher = new QFutureWatcher<QIcon>(q);
+    QObject::connect(watcher, &QFutureWatcher<QIcon>::finished, q, [this, watcher, hash] {
+        watcher->deleteLater();
+        iconTransfers.remove(hash);
+        QIcon icon = watcher->result();
+        if (icon.isNull()) {
+            icon = QIcon::fromTheme(QStringLiteral("wayland"));
+        }
+        QVector<QPointer<PlasmaWindow>> changed;
+        for (PlasmaWindow *window : qAsConst(windows)) {
+            if (window->d->iconHash == hash) {
+                window->d->icon = icon;
+                changed << window;
+            }
+        }
+        for (const QPointer<PlasmaWindow> &window : qAsConst(changed)) {
+            if (window) {
+                Q_EMIT window->iconChanged();
+            }
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(&s_iconCache->threadPool, readIcon));
 }
 
 void PlasmaWindow::Private::setActive(bool set)
@@ -16,6 +16,8 @@ struct org_kde_plasma_activation_feedback;
 struct org_kde_plasma_activation;
 struct org_kde_plasma_window_management;
 struct org_kde_plasma_window;
+struct com_deepin_stacking_order;
+struct com_deepin_window_icons;
 
 namespace KWayland
 {
@@ -102,6 +104,31 @@ public:
      * method.
      **/
     void setup(org_kde_plasma_window_management *shell);
+    /**
+     * Receives the stacking order through @p stackingOrder, which sends moves of single
+     * windows instead of the full stacking order on every change. Afterwards the compositor
+     * no longer sends the full uuid order through the window management interface.
+     *
+     * @code
+     * wm->setupStackingOrder(registry->bindStackingOrder(name, version));
+     * @endcode
+     *
+     * @see Registry::bindStackingOrder
+     **/
+    void setupStackingOrder(com_deepin_stacking_order *stackingOrder);
+    /**
+     * Receives the window icons through @p windowIcons, which announces them by the hash of
+     * their content. An icon shared by several windows is transferred only once, and only
+     * in the sizes set with setIconSizes. Afterwards the compositor no longer announces
+     * icon changes through the windows.
+     *
+     * @code
+     * wm->setupWindowIcons(registry->bindWindowIcons(name, version));
+     * @endcode
+     *
+     * @see Registry::bindWindowIcons
+     **/
+    void setupWindowIcons(com_deepin_window_icons *windowIcons);
 
     /**
      * Sets the @p queue to use for creating a Surface.
@@ -176,6 +203,19 @@ public:
      */
     QVector<QByteArray> stackingOrderUuids() const;
 
+    /**
+     * Keeps only the given @p sizes, e.g. the ones a task manager renders, of the icons
+     * transferred for the windows. This applies to icons transferred afterwards. An empty
+     * list, the default, keeps all sizes.
+     *
+     * With setupWindowIcons the compositor leaves out the other sizes before the transfer.
+     *
+     * Transferred icons are cached by their content, so windows with the same icon share it.
+     * @see PlasmaWindow::icon
+     */
+    void setIconSizes(const QList<QSize> &sizes);
+    QList<QSize> iconSizes() const;
+
 Q_SIGNALS:
     /**
      * This signal is emitted right before the interface is released.
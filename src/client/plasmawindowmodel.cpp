@@ -6,6 +6,7 @@
 #include "plasmawindowmodel.h"
 #include "plasmawindowmanagement.h"
 
+#include <QMap>
 #include <QMetaEnum>
 
 namespace KWayland
@@ -17,10 +18,18 @@ class Q_DECL_HIDDEN PlasmaWindowModel::Private
 public:
     Private(PlasmaWindowModel *q);
     QList<PlasmaWindow *> windows;
+    // the index of every window in windows
+    QHash<PlasmaWindow *, int> rows;
+    // the roles changed since the last dataChanged, per window
+    QHash<PlasmaWindow *, QVector<int>> dirtyRoles;
+    bool flushScheduled = false;
     PlasmaWindow *window = nullptr;
 
     void addWindow(PlasmaWindow *window);
+    void removeWindow(PlasmaWindow *window);
     void dataChanged(PlasmaWindow *window, int role);
+    void flushDataChanged();
+    void clear();
 
 private:
     PlasmaWindowModel *q;
@@ -33,22 +42,18 @@ PlasmaWindowModel::Private::Private(PlasmaWindowModel *q)
 
 void PlasmaWindowModel::Private::addWindow(PlasmaWindow *window)
 {
-    if (windows.indexOf(window) != -1) {
+    if (rows.contains(window)) {
         return;
     }
 
     const int count = windows.count();
     q->beginInsertRows(QModelIndex(), count, count);
     windows.append(window);
+    rows.insert(window, count);
     q->endInsertRows();
 
     auto removeWindow = [window, this] {
-        const int row = windows.indexOf(window);
-        if (row != -1) {
-            q->beginRemoveRows(QModelIndex(), row, row);
-            windows.removeAt(row);
-            q->endRemoveRows();
-        }
+        this->removeWindow(window);
     };
 
     QObject::connect(window, &PlasmaWindow::unmapped, q, removeWindow);
@@ -159,10 +164,74 @@ void PlasmaWindowModel::Private::addWindow(PlasmaWindow *window)
     });
 }
 
+void PlasmaWindowModel::Private::removeWindow(PlasmaWindow *window)
+{
+    const int row = rows.value(window, -1);
+    if (row == -1) {
+        return;
+    }
+    q->beginRemoveRows(QModelIndex(), row, row);
+    windows.removeAt(row);
+    rows.remove(window);
+    for (int i = row; i < windows.count(); ++i) {
+        rows[windows.at(i)] = i;
+    }
+    dirtyRoles.remove(window);
+    q->endRemoveRows();
+}
+
 void PlasmaWindowModel::Private::dataChanged(PlasmaWindow *window, int role)
 {
-    QModelIndex idx = q->index(windows.indexOf(window));
-    Q_EMIT q->dataChanged(idx, idx, QVector<int>() << role);
+    if (!rows.contains(window)) {
+        return;
+    }
+    QVector<int> &roles = dirtyRoles[window];
+    if (!roles.contains(role)) {
+        roles << role;
+    }
+    if (flushScheduled) {
+        return;
+    }
+    flushScheduled = true;
+    QMetaObject::invokeMethod(
+        q,
+        [this] {
+            flushDataChanged();
+        },
+        Qt::QueuedConnection);
+}
+
+void PlasmaWindowModel::Private::flushDataChanged()
+{
+    flushScheduled = false;
+    QMap<int, QVector<int>> changes;
+    for (auto it = dirtyRoles.constBegin(); it != dirtyRoles.constEnd(); ++it) {
+        changes.insert(rows.value(it.key()), it.value());
+    }
+    dirtyRoles.clear();
+
+    auto it = changes.constBegin();
+    while (it != changes.constEnd()) {
+        const int first = it.key();
+        int last = first;
+        QVector<int> roles = it.value();
+        for (++it; it != changes.constEnd() && it.key() == last + 1; ++it) {
+            ++last;
+            for (int role : it.value()) {
+                if (!roles.contains(role)) {
+                    roles << role;
+                }
+            }
+        }
+        Q_EMIT q->dataChanged(q->index(first), q->index(last), roles);
+    }
+}
+
+void PlasmaWindowModel::Private::clear()
+{
+    windows.clear();
+    rows.clear();
+    dirtyRoles.clear();
 }
 
 PlasmaWindowModel::PlasmaWindowModel(PlasmaWindowManagement *parent)
@@ -171,7 +240,7 @@ PlasmaWindowModel::PlasmaWindowModel(PlasmaWindowManagement *parent)
 {
     connect(parent, &PlasmaWindowManagement::interfaceAboutToBeReleased, this, [this] {
         beginResetModel();
-        d->windows.clear();
+        d->clear();
         endResetModel();
     });
 
@@ -29,6 +29,10 @@ class Surface;
  * The model resets when the PlasmaWindowManagement parent signals that its
  * interface is about to be destroyed.
  *
+ * Property changes of the windows are collected until the event loop runs again,
+ * then dataChanged is emitted once for every range of adjacent changed rows with
+ * all roles which changed in it.
+ *
  * To use this class you can create an instance yourself, or preferably use the
  * convenience method in PlasmaWindowManagement:
  * @code
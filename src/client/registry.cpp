@@ -97,6 +97,9 @@
 #include <wayland-strut-client-protocol.h>
 #include <wayland-dde-globalproperty-client-protocol.h>
 #include <wayland-wlr-data-control-unstable-v1-client-protocol.h>
+#include <wayland-stacking-order-client-protocol.h>
+#include <wayland-window-states-client-protocol.h>
+#include <wayland-window-icons-client-protocol.h>
 
 /*****
  * How to add another interface:
@@ -462,6 +465,27 @@ static const QMap<Registry::Interface, SuppertedInterfaceData> s_interfaces = {
         &Registry::dataControlDeviceManagerAnnounced,
         &Registry::dataControlDeviceManagerRemoved
     }},
+    {Registry::Interface::StackingOrder, {
+        1,
+        QByteArrayLiteral("com_deepin_stacking_order"),
+        &com_deepin_stacking_order_interface,
+        &Registry::stackingOrderAnnounced,
+        &Registry::stackingOrderRemoved
+    }},
+    {Registry::Interface::WindowStates, {
+        1,
+        QByteArrayLiteral("com_deepin_window_states"),
+        &com_deepin_window_states_interface,
+        &Registry::windowStatesAnnounced,
+        &Registry::windowStatesRemoved
+    }},
+    {Registry::Interface::WindowIcons, {
+        1,
+        QByteArrayLiteral("com_deepin_window_icons"),
+        &com_deepin_window_icons_interface,
+        &Registry::windowIconsAnnounced,
+        &Registry::windowIconsRemoved
+    }},
 };
 // clang-format on
 
@@ -782,6 +806,9 @@ BIND(DDEShell, dde_shell)
 BIND(Strut, com_deepin_kwin_strut)
 BIND(GlobalProperty, dde_globalproperty)
 BIND(DataControlDeviceManager, zwlr_data_control_manager_v1)
+BIND(StackingOrder, com_deepin_stacking_order)
+BIND(WindowStates, com_deepin_window_states)
+BIND(WindowIcons, com_deepin_window_icons)
 
 #undef BIND
 #undef BIND2
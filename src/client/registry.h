@@ -62,6 +62,9 @@ struct dde_shell;
 struct com_deepin_kwin_strut;
 struct dde_globalproperty;
 struct zwlr_data_control_manager_v1;
+struct com_deepin_stacking_order;
+struct com_deepin_window_states;
+struct com_deepin_window_icons;
 
 namespace KWayland
 {
@@ -203,6 +206,9 @@ public:
         Strut, ///< refers to com_deepin_kwin_strut interface
         GlobalProperty,
         DataControlDeviceManager, /// refers to zwlr_data_control_manager_v1
+        StackingOrder, ///< refers to com_deepin_stacking_order
+        WindowStates, ///< refers to com_deepin_window_states
+        WindowIcons, ///< refers to com_deepin_window_icons
     };
     explicit Registry(QObject *parent = nullptr);
     ~Registry() override;
@@ -776,6 +782,36 @@ public:
      * @since 5.54
      **/
     zwlr_data_control_manager_v1 *bindDataControlDeviceManager(uint32_t name, uint32_t version) const;
+
+    /**
+     * Binds the com_deepin_stacking_order with @p name and @p version.
+     * If the @p name does not exist,
+     * @c null will be returned.
+     *
+     * Pass it to PlasmaWindowManagement::setupStackingOrder to receive the
+     * stacking order as moves of single windows.
+     **/
+    com_deepin_stacking_order *bindStackingOrder(uint32_t name, uint32_t version) const;
+
+    /**
+     * Binds the com_deepin_window_states with @p name and @p version.
+     * If the @p name does not exist,
+     * @c null will be returned.
+     *
+     * Pass it to ClientManagement::setupWindowStates to receive only the
+     * changed window states.
+     **/
+    com_deepin_window_states *bindWindowStates(uint32_t name, uint32_t version) const;
+
+    /**
+     * Binds the com_deepin_window_icons with @p name and @p version.
+     * If the @p name does not exist,
+     * @c null will be returned.
+     *
+     * Pass it to PlasmaWindowManagement::setupWindowIcons to transfer each
+     * window icon only once.
+     **/
+    com_deepin_window_icons *bindWindowIcons(uint32_t name, uint32_t version) const;
     ///@}
 
     /**
@@ -1819,6 +1855,27 @@ Q_SIGNALS:
      * @since 5.54
      **/
     void dataControlDeviceManagerAnnounced(quint32 name, quint32 version);
+
+    /**
+     * Emitted whenever a com_deepin_stacking_order interface gets announced.
+     * @param name The name for the announced interface
+     * @param version The maximum supported version of the announced interface
+     **/
+    void stackingOrderAnnounced(quint32 name, quint32 version);
+
+    /**
+     * Emitted whenever a com_deepin_window_states interface gets announced.
+     * @param name The name for the announced interface
+     * @param version The maximum supported version of the announced interface
+     **/
+    void windowStatesAnnounced(quint32 name, quint32 version);
+
+    /**
+     * Emitted whenever a com_deepin_window_icons interface gets announced.
+     * @param name The name for the announced interface
+     * @param version The maximum supported version of the announced interface
+     **/
+    void windowIconsAnnounced(quint32 name, quint32 version);
     ///@}
 
     /**
@@ -2099,6 +2156,24 @@ Q_SIGNALS:
      * @since 5.54
      **/
     void dataControlDeviceManagerRemoved(quint32 name);
+
+    /**
+     * Emitted whenever a com_deepin_stacking_order gets removed.
+     * @param name The name of the removed interface
+     **/
+    void stackingOrderRemoved(quint32 name);
+
+    /**
+     * Emitted whenever a com_deepin_window_states gets removed.
+     * @param name The name of the removed interface
+     **/
+    void windowStatesRemoved(quint32 name);
+
+    /**
+     * Emitted whenever a com_deepin_window_icons gets removed.
+     * @param name The name of the removed interface
+     **/
+    void windowIconsRemoved(quint32 name);
     ///@}
     /**
      * Generic announced signal which gets emitted whenever an interface gets
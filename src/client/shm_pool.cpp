@@ -12,9 +12,18 @@
 #include <QDebug>
 #include <QImage>
 #include <QTemporaryFile>
+#include <QTimer>
 // system
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <unistd.h>
+// std
+#include <array>
+#include <limits>
+#include <map>
+#include <set>
 // wayland
 #include <wayland-client-protocol.h>
 
@@ -22,30 +31,168 @@ namespace KWayland
 {
 namespace Client
 {
+namespace
+{
+// the pool starts with a single page and at least doubles whenever it grows
+static const int32_t s_initialSize = 4096;
+// buffers start at cache line boundaries
+static const int32_t s_alignment = 64;
+// address space kept for growing the pool in place, a larger pool has to move
+static const size_t s_reservedSize = sizeof(void *) == 8 ? size_t(1) << 30 : size_t(64) << 20;
+
+static qint64 alignedSize(qint64 size, qint64 alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+static size_t pageSize()
+{
+    static const size_t size = sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+/**
+ * Hands out ranges of the pool. Free ranges are kept ordered by offset to coalesce
+ * released neighbours and in power of two size classes for a best fit lookup.
+ */
+class ShmAllocator
+{
+public:
+    void clear()
+    {
+        m_ranges.clear();
+        for (auto &sizeClass : m_sizeClasses) {
+            sizeClass.clear();
+        }
+    }
+
+    /**
+     * Returns the offset of a range of @p size bytes, or @c -1 if no free range is large enough.
+     */
+    int32_t allocate(int32_t size)
+    {
+        for (int i = sizeClass(size); i < int(m_sizeClasses.size()); ++i) {
+            auto it = m_sizeClasses[i].lower_bound({size, 0});
+            if (it == m_sizeClasses[i].end()) {
+                continue;
+            }
+            const int32_t rangeSize = it->first;
+            const int32_t offset = it->second;
+            remove(offset, rangeSize);
+            if (rangeSize > size) {
+                insert(offset + size, rangeSize - size);
+            }
+            return offset;
+        }
+        return -1;
+    }
+
+    void free(int32_t offset, int32_t size)
+    {
+        auto next = m_ranges.lower_bound(offset);
+        if (next != m_ranges.end() && next->first == offset + size) {
+            size += next->second;
+            remove(next->first, next->second);
+            next = m_ranges.lower_bound(offset);
+        }
+        if (next != m_ranges.begin()) {
+            auto previous = std::prev(next);
+            if (previous->first + previous->second == offset) {
+                offset = previous->first;
+                size += previous->second;
+                remove(previous->first, previous->second);
+            }
+        }
+        insert(offset, size);
+    }
+
+private:
+    static int sizeClass(int32_t size)
+    {
+        int sizeClass = 0;
+        while (size >>= 1) {
+            ++sizeClass;
+        }
+        return sizeClass;
+    }
+
+    void insert(int32_t offset, int32_t size)
+    {
+        m_ranges.emplace(offset, size);
+        m_sizeClasses[sizeClass(size)].emplace(size, offset);
+    }
+
+    void remove(int32_t offset, int32_t size)
+    {
+        m_ranges.erase(offset);
+        m_sizeClasses[sizeClass(size)].erase({size, offset});
+    }
+
+    // offset to size
+    std::map<int32_t, int32_t> m_ranges;
+    // size and offset
+    std::array<std::set<std::pair<int32_t, int32_t>>, 32> m_sizeClasses;
+};
+
+static int createTemporaryFile()
+{
+    QTemporaryFile tmp;
+    if (!tmp.open()) {
+        qCDebug(KWAYLAND_CLIENT) << "Could not open temporary file for Shm pool";
+        return -1;
+    }
+    if (unlink(tmp.fileName().toUtf8().constData()) != 0) {
+        qCDebug(KWAYLAND_CLIENT) << "Unlinking temporary file for Shm pool from file system failed";
+    }
+    tmp.setAutoRemove(false);
+    // QTemporaryFile closes its descriptor on destruction, keep our own
+    return fcntl(tmp.handle(), F_DUPFD_CLOEXEC, 0);
+}
+
+static int createPoolFile()
+{
+#if defined(MFD_CLOEXEC) && defined(MFD_ALLOW_SEALING) && defined(F_ADD_SEALS)
+    const int fd = memfd_create("kwayland-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd != -1) {
+        // the server may rely on the pool never shrinking under its mapping
+        if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK) == -1) {
+            qCDebug(KWAYLAND_CLIENT) << "Could not seal Shm pool file:" << strerror(errno);
+        }
+        return fd;
+    }
+#endif
+    return createTemporaryFile();
+}
+}
+
 class Q_DECL_HIDDEN ShmPool::Private
 {
 public:
     Private(ShmPool *q);
     bool createPool();
-    bool resizePool(int32_t newSize);
+    bool resizePool(int32_t minimumSize);
+    void destroyPool();
     QList<QSharedPointer<Buffer>>::iterator getBuffer(const QSize &size, int32_t stride, Buffer::Format format);
+    static int32_t byteCount(const Buffer *buffer);
     WaylandPointer<wl_shm, wl_shm_destroy> shm;
     WaylandPointer<wl_shm_pool, wl_shm_pool_destroy> pool;
     void *poolData = nullptr;
-    int32_t size = 1024;
-    QScopedPointer<QTemporaryFile> tmpFile;
+    int32_t size = 0;
+    // the address space at poolData, of which the first size bytes are mapped
+    size_t reservedSize = 0;
+    int fd = -1;
     bool valid = false;
-    int offset = 0;
+    ShmAllocator allocator;
     QList<QSharedPointer<Buffer>> buffers;
     EventQueue *queue = nullptr;
+    QTimer *compactionTimer = nullptr;
 
 private:
     ShmPool *q;
 };
 
 ShmPool::Private::Private(ShmPool *q)
-    : tmpFile(new QTemporaryFile())
-    , q(q)
+    : q(q)
 {
 }
 
@@ -63,15 +210,10 @@ ShmPool::~ShmPool()
 void ShmPool::release()
 {
     d->buffers.clear();
-    if (d->poolData) {
-        munmap(d->poolData, d->size);
-        d->poolData = nullptr;
-    }
+    d->destroyPool();
     d->pool.release();
     d->shm.release();
-    d->tmpFile->close();
     d->valid = false;
-    d->offset = 0;
 }
 
 void ShmPool::destroy()
@@ -80,15 +222,10 @@ void ShmPool::destroy()
         b->d->destroy();
     }
     d->buffers.clear();
-    if (d->poolData) {
-        munmap(d->poolData, d->size);
-        d->poolData = nullptr;
-    }
+    d->destroyPool();
     d->pool.destroy();
     d->shm.destroy();
-    d->tmpFile->close();
     d->valid = false;
-    d->offset = 0;
 }
 
 void ShmPool::setup(wl_shm *shm)
@@ -111,45 +248,97 @@ EventQueue *ShmPool::eventQueue()
 
 bool ShmPool::Private::createPool()
 {
-    if (!tmpFile->open()) {
-        qCDebug(KWAYLAND_CLIENT) << "Could not open temporary file for Shm pool";
+    fd = createPoolFile();
+    if (fd == -1) {
         return false;
     }
-    if (unlink(tmpFile->fileName().toUtf8().constData()) != 0) {
-        qCDebug(KWAYLAND_CLIENT) << "Unlinking temporary file for Shm pool from file system failed";
-    }
-    if (ftruncate(tmpFile->handle(), size) < 0) {
+    size = s_initialSize;
+    if (ftruncate(fd, size) < 0) {
         qCDebug(KWAYLAND_CLIENT) << "Could not set size for Shm pool file";
         return false;
     }
-    poolData = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, tmpFile->handle(), 0);
-    pool.setup(wl_shm_create_pool(shm, tmpFile->handle(), size));
-
-    if (poolData == MAP_FAILED || !pool) {
+    // reserve the address space to grow into, so Buffers don't move when the pool grows
+    reservedSize = s_reservedSize;
+    poolData = mmap(nullptr, reservedSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (poolData == MAP_FAILED
+        || mmap(poolData, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        qCDebug(KWAYLAND_CLIENT) << "Mapping Shm pool failed";
+        poolData = poolData == MAP_FAILED ? nullptr : poolData;
+        return false;
+    }
+    pool.setup(wl_shm_create_pool(shm, fd, size));
+    if (!pool) {
         qCDebug(KWAYLAND_CLIENT) << "Creating Shm pool failed";
         return false;
     }
+    allocator.free(0, size);
     return true;
 }
 
-bool ShmPool::Private::resizePool(int32_t newSize)
+void ShmPool::Private::destroyPool()
+{
+    if (poolData) {
+        munmap(poolData, reservedSize);
+        poolData = nullptr;
+    }
+    if (fd != -1) {
+        close(fd);
+        fd = -1;
+    }
+    allocator.clear();
+    size = 0;
+    reservedSize = 0;
+}
+
+bool ShmPool::Private::resizePool(int32_t minimumSize)
 {
-    if (ftruncate(tmpFile->handle(), newSize) < 0) {
+    const qint64 newSize = qMin(qMax(qint64(size) * 2, alignedSize(minimumSize, s_initialSize)), qint64(std::numeric_limits<int32_t>::max()));
+    if (newSize < minimumSize) {
+        return false;
+    }
+    if (ftruncate(fd, newSize) < 0) {
         qCDebug(KWAYLAND_CLIENT) << "Could not set new size for Shm pool file";
         return false;
     }
     wl_shm_pool_resize(pool, newSize);
-    munmap(poolData, size);
-    poolData = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, tmpFile->handle(), 0);
-    size = newSize;
-    if (poolData == MAP_FAILED) {
+
+    if (size_t(newSize) <= reservedSize) {
+        // map the new part right behind the old one, starting at the page the old part ends in
+        const size_t start = size / pageSize() * pageSize();
+        void *mapped = mmap(static_cast<char *>(poolData) + start, newSize - start, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, start);
+        if (mapped == MAP_FAILED) {
+            qCDebug(KWAYLAND_CLIENT) << "Growing Shm pool failed";
+            return false;
+        }
+        allocator.free(size, newSize - size);
+        size = newSize;
+        return true;
+    }
+
+    // out of reserved address space, all Buffers move
+    const size_t newReservedSize = qMax(reservedSize * 2, size_t(newSize));
+    void *newData = mmap(nullptr, newReservedSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (newData == MAP_FAILED || mmap(newData, newSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
         qCDebug(KWAYLAND_CLIENT) << "Resizing Shm pool failed";
+        if (newData != MAP_FAILED) {
+            munmap(newData, newReservedSize);
+        }
         return false;
     }
+    munmap(poolData, reservedSize);
+    poolData = newData;
+    reservedSize = newReservedSize;
+    allocator.free(size, newSize - size);
+    size = newSize;
     Q_EMIT q->poolResized();
     return true;
 }
 
+int32_t ShmPool::Private::byteCount(const Buffer *buffer)
+{
+    return alignedSize(qint64(buffer->size().height()) * buffer->stride(), s_alignment);
+}
+
 namespace
 {
 static Buffer::Format toBufferFormat(const QImage &image)
@@ -226,6 +415,9 @@ Buffer::Ptr ShmPool::getBuffer(const QSize &size, int32_t stride, Buffer::Format
 
 QList<QSharedPointer<Buffer>>::iterator ShmPool::Private::getBuffer(const QSize &s, int32_t stride, Buffer::Format format)
 {
+    if (compactionTimer) {
+        compactionTimer->start();
+    }
     for (auto it = buffers.begin(); it != buffers.end(); ++it) {
         auto buffer = *it;
         if (!buffer->isReleased() || buffer->isUsed()) {
@@ -237,26 +429,91 @@ QList<QSharedPointer<Buffer>>::iterator ShmPool::Private::getBuffer(const QSize
         buffer->setReleased(false);
         return it;
     }
-    const int32_t byteCount = s.height() * stride;
-    if (offset + byteCount > size) {
-        if (!resizePool(size + byteCount)) {
+    const qint64 requestedSize = alignedSize(qint64(s.height()) * stride, s_alignment);
+    if (stride <= 0 || requestedSize > std::numeric_limits<int32_t>::max()) {
+        return buffers.end();
+    }
+    const int32_t byteCount = requestedSize;
+    int32_t offset = allocator.allocate(byteCount);
+    // reclaim the memory of the oldest Buffers nobody needs any more before growing the pool
+    for (auto it = buffers.begin(); offset == -1 && it != buffers.end();) {
+        const Buffer *buffer = it->data();
+        if (!buffer->isReleased() || buffer->isUsed()) {
+            ++it;
+            continue;
+        }
+        allocator.free(buffer->d->offset, Private::byteCount(buffer));
+        it = buffers.erase(it);
+        offset = allocator.allocate(byteCount);
+    }
+    if (offset == -1) {
+        if (qint64(size) + byteCount > std::numeric_limits<int32_t>::max() || !resizePool(size + byteCount)) {
             return buffers.end();
         }
+        offset = allocator.allocate(byteCount);
+        Q_ASSERT(offset != -1);
     }
     // we don't have a buffer which we could reuse - need to create a new one
     wl_buffer *native = wl_shm_pool_create_buffer(pool, offset, s.width(), s.height(), stride, toWaylandFormat(format));
     if (!native) {
+        allocator.free(offset, byteCount);
         return buffers.end();
     }
     if (queue) {
         queue->addProxy(native);
     }
     Buffer *buffer = new Buffer(q, native, s, stride, offset, format);
-    offset += byteCount;
     auto it = buffers.insert(buffers.end(), QSharedPointer<Buffer>(buffer));
     return it;
 }
 
+bool ShmPool::compact()
+{
+    if (!d->valid) {
+        return false;
+    }
+    for (const auto &buffer : qAsConst(d->buffers)) {
+        if (!buffer->isReleased() || buffer->isUsed()) {
+            return false;
+        }
+    }
+    if (d->buffers.isEmpty() && d->size == s_initialSize) {
+        return true;
+    }
+    d->buffers.clear();
+    d->destroyPool();
+    d->pool.release();
+    d->valid = d->createPool();
+    Q_EMIT poolResized();
+    return d->valid;
+}
+
+void ShmPool::setIdleCompactionTimeout(int msecs)
+{
+    if (msecs <= 0) {
+        delete d->compactionTimer;
+        d->compactionTimer = nullptr;
+        return;
+    }
+    if (!d->compactionTimer) {
+        d->compactionTimer = new QTimer(this);
+        d->compactionTimer->setSingleShot(true);
+        connect(d->compactionTimer, &QTimer::timeout, this, [this] {
+            // Buffers still held by the server keep the pool busy, try again later
+            if (!compact()) {
+                d->compactionTimer->start();
+            }
+        });
+    }
+    d->compactionTimer->setInterval(msecs);
+    d->compactionTimer->start();
+}
+
+int ShmPool::idleCompactionTimeout() const
+{
+    return d->compactionTimer ? d->compactionTimer->interval() : 0;
+}
+
 bool ShmPool::isValid() const
 {
     return d->valid;
@@ -40,7 +40,8 @@ class EventQueue;
  * s->setup(registry->bindShm(name, version));
  * @endcode
  *
- * The ShmPool holds a memory-mapped file from which it provides Buffers.
+ * The ShmPool holds a memory-mapped file from which it provides Buffers. Where supported
+ * the file is a memfd sealed against shrinking.
  * All Buffers are held by the ShmPool and can be reused. Whenever a Buffer
  * is requested the ShmPool tries to reuse an existing Buffer. A Buffer can
  * be reused if the following conditions hold
@@ -50,6 +51,10 @@ class EventQueue;
  * @li the stride matches
  * @li the format matches
  *
+ * Otherwise the Buffer gets a new range of the pool. The ranges of Buffers which are
+ * released and not used are reclaimed, oldest first, whenever the pool has no free range
+ * large enough, so resizing a window does not let the pool grow without bounds.
+ *
  * The ownership of a Buffer stays with ShmPool. The ShmPool might destroy the
  * Buffer at any given time. Because of that ShmPool only provides QWeakPointer
  * for Buffers. Users should always check whether the pointer is still valid and
@@ -106,9 +111,13 @@ class EventQueue;
  * @endcode
  *
  * This is also important for the case that the shared memory pool needs to be resized.
- * The ShmPool will automatically resize if it cannot provide a new Buffer. During the resize
- * all existing Buffers are unmapped and any shared objects must be recreated. The ShmPool emits
- * the signal poolResized() after the pool got resized.
+ * The ShmPool will automatically grow if it cannot provide a new Buffer. It grows at least
+ * by doubling its size and normally in place, so the existing Buffers keep their address.
+ * Only if the pool outgrows the address space it reserved, all existing Buffers are moved and
+ * any shared objects must be recreated. The ShmPool emits the signal poolResized() in that case.
+ *
+ * The pool does not shrink while it grows. Once the Buffers are no longer needed it can be
+ * compacted, either explicitly with compact() or after being idle with setIdleCompactionTimeout().
  *
  * @see Buffer
  **/
@@ -211,9 +220,28 @@ public:
      **/
     Buffer::Ptr getBuffer(const QSize &size, int32_t stride, Buffer::Format format = Buffer::Format::ARGB32);
     wl_shm *shm();
+
+    /**
+     * Shrinks the shared memory pool back to its initial size. This destroys all Buffers,
+     * so it only succeeds if every Buffer got released by the server and is not used.
+     * The signal poolResized() is emitted once the pool got compacted.
+     *
+     * @returns @c true if the pool got compacted or already had its initial size
+     * @see setIdleCompactionTimeout
+     **/
+    bool compact();
+    /**
+     * Compacts the pool once no Buffer got requested for @p msecs milliseconds. While
+     * Buffers are still in use the compaction is tried again after another @p msecs.
+     * A timeout of @c 0, the default, disables the idle compaction.
+     * @see compact
+     **/
+    void setIdleCompactionTimeout(int msecs);
+    int idleCompactionTimeout() const;
 Q_SIGNALS:
     /**
-     * This signal is emitted whenever the shared memory pool gets resized.
+     * This signal is emitted whenever the shared memory pool got moved to another address,
+     * either because it outgrew its reserved address space or because it got compacted.
      * Any used Buffer must be remapped.
      **/
     void poolResized();
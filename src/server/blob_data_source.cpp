@@ -0,0 +1,357 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#include "blob_data_source.h"
+#include "logging.h"
+
+#include <QFile>
+#include <QHash>
+#include <QSharedPointer>
+#include <QSocketNotifier>
+#include <QTemporaryFile>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+namespace KWaylandServer
+{
+// how much one transfer writes before letting the event loop serve others
+static const qint64 s_maxBytesPerWakeUp = 4 << 20;
+
+namespace
+{
+struct Blob {
+    ~Blob()
+    {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    int fd = -1;
+    qint64 size = 0;
+};
+}
+
+/**
+ * Runs @p io with SIGPIPE blocked, so a receiver closing its end of the pipe results in EPIPE
+ * instead of terminating the compositor.
+ */
+template<typename Io>
+static auto ignoringSigpipe(Io io)
+{
+    sigset_t pipeMask;
+    sigemptyset(&pipeMask);
+    sigaddset(&pipeMask, SIGPIPE);
+    sigset_t pending;
+    sigpending(&pending);
+    const bool wasPending = sigismember(&pending, SIGPIPE);
+
+    sigset_t oldMask;
+    pthread_sigmask(SIG_BLOCK, &pipeMask, &oldMask);
+    const auto result = io();
+    const int error = errno;
+    if (!wasPending) {
+        // consume the SIGPIPE raised by io, if any
+        const timespec noWait = {0, 0};
+        while (sigtimedwait(&pipeMask, nullptr, &noWait) == -1 && errno == EINTR) { }
+    }
+    pthread_sigmask(SIG_SETMASK, &oldMask, nullptr);
+    errno = error;
+    return result;
+}
+
+static bool writeAll(int fd, const char *data, qint64 size)
+{
+    while (size > 0) {
+        const ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+static int createBlobFile()
+{
+#if defined(MFD_CLOEXEC) && defined(MFD_ALLOW_SEALING)
+    const int fd = memfd_create("dwayland-data-source", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd != -1) {
+        return fd;
+    }
+#endif
+    QTemporaryFile tmp;
+    if (!tmp.open()) {
+        qCWarning(KWAYLAND_SERVER) << "Failed to create data source file:" << tmp.errorString();
+        return -1;
+    }
+    unlink(tmp.fileName().toUtf8().constData());
+    tmp.setAutoRemove(false);
+    // QTemporaryFile closes its descriptor on destruction, keep our own
+    return fcntl(tmp.handle(), F_DUPFD_CLOEXEC, 0);
+}
+
+namespace
+{
+class BlobTransfer
+{
+public:
+    enum class Result {
+        Pending,
+        Finished,
+        Failed,
+    };
+
+    BlobTransfer(const QString &mimeType, const QSharedPointer<Blob> &blob, int fd)
+        : mimeType(mimeType)
+        , blob(blob)
+        , fd(fd)
+    {
+    }
+    ~BlobTransfer()
+    {
+        if (notifier) {
+            // the transfer may end from within the notifier's own activated signal
+            notifier->setEnabled(false);
+            notifier.take()->deleteLater();
+        }
+        close(fd);
+    }
+
+    Result write();
+
+    QString mimeType;
+    QSharedPointer<Blob> blob;
+    int fd;
+    off_t offset = 0;
+    // sendfile is not supported by every kind of receiving fd
+    bool useSendfile = true;
+    QScopedPointer<QSocketNotifier> notifier;
+
+private:
+    Result writeChunks();
+};
+
+BlobTransfer::Result BlobTransfer::write()
+{
+    return ignoringSigpipe([this] {
+        return writeChunks();
+    });
+}
+
+BlobTransfer::Result BlobTransfer::writeChunks()
+{
+    const off_t limit = qMin<qint64>(blob->size, offset + s_maxBytesPerWakeUp);
+    while (offset < blob->size) {
+        if (offset >= limit) {
+            // the receiver is still writable, the notifier fires again right away
+            return Result::Pending;
+        }
+        ssize_t written;
+        if (useSendfile) {
+            written = sendfile(fd, blob->fd, &offset, limit - offset);
+            if (written == -1 && (errno == EINVAL || errno == ENOSYS)) {
+                useSendfile = false;
+                continue;
+            }
+        } else {
+            char buffer[64 * 1024];
+            const ssize_t bytes = pread(blob->fd, buffer, qMin<qint64>(sizeof(buffer), limit - offset), offset);
+            if (bytes <= 0) {
+                return Result::Failed;
+            }
+            written = ::write(fd, buffer, bytes);
+            if (written > 0) {
+                offset += written;
+            }
+        }
+        if (written > 0) {
+            continue;
+        }
+        if (written == 0) {
+            // the file got truncated
+            return Result::Failed;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN) {
+            return Result::Pending;
+        }
+        return Result::Failed;
+    }
+    return Result::Finished;
+}
+}
+
+class BlobDataSourcePrivate
+{
+public:
+    BlobDataSourcePrivate(BlobDataSource *q);
+
+    void insert(const QString &mimeType, const QSharedPointer<Blob> &blob);
+    void write(BlobTransfer *transfer);
+    void remove(BlobTransfer *transfer);
+
+    QStringList mimeTypes;
+    QHash<QString, QSharedPointer<Blob>> blobs;
+    std::vector<std::unique_ptr<BlobTransfer>> transfers;
+
+private:
+    BlobDataSource *q;
+};
+
+BlobDataSourcePrivate::BlobDataSourcePrivate(BlobDataSource *q)
+    : q(q)
+{
+}
+
+void BlobDataSourcePrivate::insert(const QString &mimeType, const QSharedPointer<Blob> &blob)
+{
+    const bool offered = blobs.contains(mimeType);
+    blobs.insert(mimeType, blob);
+    if (!offered) {
+        mimeTypes.append(mimeType);
+        Q_EMIT q->mimeTypeOffered(mimeType);
+    }
+}
+
+void BlobDataSourcePrivate::write(BlobTransfer *transfer)
+{
+    switch (transfer->write()) {
+    case BlobTransfer::Result::Pending:
+        if (!transfer->notifier) {
+            transfer->notifier.reset(new QSocketNotifier(transfer->fd, QSocketNotifier::Write));
+            QObject::connect(transfer->notifier.data(), &QSocketNotifier::activated, q, [this, transfer] {
+                write(transfer);
+            });
+        }
+        return;
+    case BlobTransfer::Result::Finished: {
+        const QString mimeType = transfer->mimeType;
+        const qint64 size = transfer->blob->size;
+        remove(transfer);
+        Q_EMIT q->transferFinished(mimeType, size);
+        return;
+    }
+    case BlobTransfer::Result::Failed: {
+        qCDebug(KWAYLAND_SERVER) << "Transferring" << transfer->mimeType << "failed:" << strerror(errno);
+        const QString mimeType = transfer->mimeType;
+        remove(transfer);
+        Q_EMIT q->transferFailed(mimeType);
+        return;
+    }
+    }
+}
+
+void BlobDataSourcePrivate::remove(BlobTransfer *transfer)
+{
+    for (auto it = transfers.begin(); it != transfers.end(); ++it) {
+        if (it->get() == transfer) {
+            transfers.erase(it);
+            return;
+        }
+    }
+}
+
+BlobDataSource::BlobDataSource(QObject *parent)
+    : AbstractDataSource(parent)
+    , d(new BlobDataSourcePrivate(this))
+{
+}
+
+BlobDataSource::~BlobDataSource()
+{
+    Q_EMIT aboutToBeDestroyed();
+}
+
+bool BlobDataSource::setData(const QString &mimeType, const QByteArray &data)
+{
+    auto blob = QSharedPointer<Blob>::create();
+    blob->fd = createBlobFile();
+    if (blob->fd == -1) {
+        return false;
+    }
+    if (!writeAll(blob->fd, data.constData(), data.size())) {
+        qCWarning(KWAYLAND_SERVER) << "Failed to store data for" << mimeType << ":" << strerror(errno);
+        return false;
+    }
+#if defined(F_ADD_SEALS)
+    // receivers only ever read, make sure nobody else can change it behind their back either
+    fcntl(blob->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#endif
+    blob->size = data.size();
+    d->insert(mimeType, blob);
+    return true;
+}
+
+bool BlobDataSource::setFile(const QString &mimeType, const QString &fileName)
+{
+    auto blob = QSharedPointer<Blob>::create();
+    blob->fd = open(QFile::encodeName(fileName).constData(), O_RDONLY | O_CLOEXEC);
+    if (blob->fd == -1) {
+        qCWarning(KWAYLAND_SERVER) << "Failed to open" << fileName << ":" << strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if (fstat(blob->fd, &info) == -1 || !S_ISREG(info.st_mode)) {
+        qCWarning(KWAYLAND_SERVER) << fileName << "is not a regular file";
+        return false;
+    }
+    blob->size = info.st_size;
+    d->insert(mimeType, blob);
+    return true;
+}
+
+void BlobDataSource::removeMimeType(const QString &mimeType)
+{
+    if (d->blobs.remove(mimeType)) {
+        d->mimeTypes.removeOne(mimeType);
+    }
+}
+
+void BlobDataSource::requestData(const QString &mimeType, qint32 fd)
+{
+    const QSharedPointer<Blob> blob = d->blobs.value(mimeType);
+    if (!blob) {
+        close(fd);
+        return;
+    }
+    // transfers are driven by the event loop, never wait for a receiver
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    d->transfers.emplace_back(new BlobTransfer(mimeType, blob, fd));
+    d->write(d->transfers.back().get());
+}
+
+void BlobDataSource::cancel()
+{
+    Q_EMIT cancelled();
+}
+
+QStringList BlobDataSource::mimeTypes() const
+{
+    return d->mimeTypes;
+}
+
+int BlobDataSource::activeTransferCount() const
+{
+    return d->transfers.size();
+}
+
+}
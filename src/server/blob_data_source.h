@@ -0,0 +1,84 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#pragma once
+
+#include "abstract_data_source.h"
+
+#include <DWayland/Server/kwaylandserver_export.h>
+
+namespace KWaylandServer
+{
+class BlobDataSourcePrivate;
+
+/**
+ * @brief The BlobDataSource class serves the data of a selection owned by the compositor itself.
+ *
+ * The data of each mime type is either a QByteArray or a file. A QByteArray is copied once into
+ * a memfd, so it can be read by any number of receivers. The data is moved into the pipe of a
+ * receiver with sendfile, so the kernel copies it without passing through a userspace buffer.
+ * Transfers don't block: a receiver which does not read keeps its transfer waiting on the event
+ * loop without holding back any other.
+ *
+ * @code
+ * auto source = new BlobDataSource(seat);
+ * source->setData(QStringLiteral("image/png"), pngData);
+ * seat->setSelection(source);
+ * @endcode
+ */
+class KWAYLANDSERVER_EXPORT BlobDataSource : public AbstractDataSource
+{
+    Q_OBJECT
+public:
+    explicit BlobDataSource(QObject *parent = nullptr);
+    ~BlobDataSource() override;
+
+    /**
+     * Offers @p data for @p mimeType, replacing what was offered for it before. Transfers
+     * which already started keep sending the previous data.
+     *
+     * @returns @c false if the data could not be stored
+     */
+    bool setData(const QString &mimeType, const QByteArray &data);
+    /**
+     * Offers the content of the file @p fileName for @p mimeType. The file is opened right
+     * away and must not be truncated while the BlobDataSource offers it.
+     *
+     * @returns @c false if the file could not be opened
+     */
+    bool setFile(const QString &mimeType, const QString &fileName);
+    /**
+     * Stops offering data for @p mimeType.
+     */
+    void removeMimeType(const QString &mimeType);
+
+    void requestData(const QString &mimeType, qint32 fd) override;
+    void cancel() override;
+    QStringList mimeTypes() const override;
+
+    /**
+     * @returns the number of transfers waiting for their receiver to read
+     */
+    int activeTransferCount() const;
+
+Q_SIGNALS:
+    /**
+     * The data of @p mimeType was fully written to a receiver, which got @p bytes.
+     */
+    void transferFinished(const QString &mimeType, qint64 bytes);
+    /**
+     * The transfer of @p mimeType was aborted, e.g. because the receiver closed its end.
+     */
+    void transferFailed(const QString &mimeType);
+    /**
+     * The source is no longer the selection.
+     */
+    void cancelled();
+
+private:
+    QScopedPointer<BlobDataSourcePrivate> d;
+};
+
+}
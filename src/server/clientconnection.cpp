@@ -4,44 +4,27 @@
     SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
 */
 #include "clientconnection.h"
+#include "clientconnection_p.h"
 #include "display.h"
 #include "utils/executable_path.h"
 // Qt
+#include <QDateTime>
 #include <QFileInfo>
 #include <QVector>
 // Wayland
 #include <wayland-server.h>
+// system
+#include <linux/sockios.h>
+#include <poll.h>
+#include <sys/ioctl.h>
 
 namespace KWaylandServer
 {
-class ClientConnectionPrivate
-{
-public:
-    ClientConnectionPrivate(wl_client *c, Display *display, ClientConnection *q);
-    ~ClientConnectionPrivate();
-
-    wl_client *client;
-    Display *display;
-    pid_t pid = 0;
-    uid_t user = 0;
-    gid_t group = 0;
-    QString executablePath;
-
-private:
-    static void destroyListenerCallback(wl_listener *listener, void *data);
-    ClientConnection *q;
-    wl_listener listener;
-    static QVector<ClientConnectionPrivate *> s_allClients;
-};
-
-QVector<ClientConnectionPrivate *> ClientConnectionPrivate::s_allClients;
-
 ClientConnectionPrivate::ClientConnectionPrivate(wl_client *c, Display *display, ClientConnection *q)
     : client(c)
     , display(display)
     , q(q)
 {
-    s_allClients << this;
     listener.notify = destroyListenerCallback;
     wl_client_add_destroy_listener(c, &listener);
     wl_client_get_credentials(client, &pid, &user, &group);
@@ -53,18 +36,53 @@ ClientConnectionPrivate::~ClientConnectionPrivate()
     if (client) {
         wl_list_remove(&listener.link);
     }
-    s_allClients.removeAt(s_allClients.indexOf(this));
+}
+
+ClientConnection *ClientConnectionPrivate::fromClient(wl_client *client)
+{
+    wl_listener *listener = wl_client_get_destroy_listener(client, destroyListenerCallback);
+    if (!listener) {
+        return nullptr;
+    }
+    ClientConnectionPrivate *p = wl_container_of(listener, p, listener);
+    return p->q;
+}
+
+void ClientConnectionPrivate::updateFlushMetrics(qint64 now)
+{
+    const int fd = wl_client_get_fd(client);
+
+    // the bytes written to the socket which the client has not read yet
+    int queued = 0;
+    if (ioctl(fd, SIOCOUTQ, &queued) == 0) {
+        queuedBytes = queued;
+    }
+
+    // a socket which is not writable right after a flush makes the next one fail with EAGAIN
+    pollfd pfd{fd, POLLOUT, 0};
+    if (poll(&pfd, 1, 0) == 0) {
+        ++blockedFlushCount;
+    }
+
+    if (queuedBytes == 0) {
+        lastDrainTime = now;
+        setThrottled(false);
+    }
+}
+
+void ClientConnectionPrivate::setThrottled(bool set)
+{
+    if (throttled == set) {
+        return;
+    }
+    throttled = set;
+    Q_EMIT q->throttledChanged(set);
 }
 
 void ClientConnectionPrivate::destroyListenerCallback(wl_listener *listener, void *data)
 {
-    Q_UNUSED(listener)
-    wl_client *client = reinterpret_cast<wl_client *>(data);
-    auto it = std::find_if(s_allClients.constBegin(), s_allClients.constEnd(), [client](ClientConnectionPrivate *c) {
-        return c->client == client;
-    });
-    Q_ASSERT(it != s_allClients.constEnd());
-    auto p = (*it);
+    Q_UNUSED(data)
+    ClientConnectionPrivate *p = wl_container_of(listener, p, listener);
     auto q = p->q;
     Q_EMIT q->aboutToBeDestroyed();
     p->client = nullptr;
@@ -145,4 +163,36 @@ QString ClientConnection::executablePath() const
     return d->executablePath;
 }
 
+quint64 ClientConnection::queuedBytes() const
+{
+    return d->queuedBytes;
+}
+
+quint64 ClientConnection::blockedFlushCount() const
+{
+    return d->blockedFlushCount;
+}
+
+QHash<QString, quint64> ClientConnection::sentEventCounts() const
+{
+    QHash<QString, quint64> counts;
+    for (auto it = d->sentEvents.constBegin(); it != d->sentEvents.constEnd(); ++it) {
+        counts[QString::fromLatin1(it.key())] += it.value();
+    }
+    return counts;
+}
+
+QDateTime ClientConnection::lastDrainTime() const
+{
+    if (!d->lastDrainTime) {
+        return QDateTime();
+    }
+    return QDateTime::fromMSecsSinceEpoch(d->lastDrainTime);
+}
+
+bool ClientConnection::isThrottled() const
+{
+    return d->throttled;
+}
+
 }
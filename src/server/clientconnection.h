@@ -7,10 +7,12 @@
 
 #include <sys/types.h>
 
+#include <QHash>
 #include <QObject>
 
 #include <DWayland/Server/kwaylandserver_export.h>
 
+class QDateTime;
 struct wl_client;
 struct wl_resource;
 
@@ -92,6 +94,46 @@ public:
      */
     QString executablePath() const;
 
+    /**
+     * The number of bytes which have been written to the socket of this client, but not read
+     * by the client yet, as of the last flush of the Display. The kernel accounts the queued
+     * data including some bookkeeping overhead, so this is an approximation.
+     *
+     * The client metrics are only collected if they are enabled on the Display.
+     *
+     * @see Display::setClientMetricsEnabled
+     */
+    quint64 queuedBytes() const;
+    /**
+     * The number of flushes after which the socket of this client was full, so writing more
+     * events to it failed or would have failed with @c EAGAIN.
+     *
+     * @see Display::setClientMetricsEnabled
+     */
+    quint64 blockedFlushCount() const;
+    /**
+     * The number of events sent to this client for each interface name, counted while the
+     * client metrics are enabled on the Display.
+     *
+     * @see Display::setClientMetricsEnabled
+     */
+    QHash<QString, quint64> sentEventCounts() const;
+    /**
+     * The last time the client was found to have read all events sent to it. Returns an
+     * invalid QDateTime if it has not been sampled yet.
+     *
+     * @see Display::setClientMetricsEnabled
+     */
+    QDateTime lastDrainTime() const;
+    /**
+     * Whether the backlog policy of the Display decided to throttle this client. The compositor
+     * should refrain from sending non-essential events, e.g. frame callbacks or pointer motion,
+     * to a throttled client. A client stops being throttled once it has read all events.
+     *
+     * @see Display::setClientBacklogPolicy
+     */
+    bool isThrottled() const;
+
     /**
      * Cast operator the native wl_client this ClientConnection represents.
      */
@@ -118,9 +160,14 @@ Q_SIGNALS:
      * Signal emitted when the ClientConnection got disconnected from the server.
      */
     void disconnected(KWaylandServer::ClientConnection *);
+    /**
+     * This signal is emitted when the client starts or stops being throttled.
+     */
+    void throttledChanged(bool throttled);
 
 private:
     friend class Display;
+    friend class ClientConnectionPrivate;
     explicit ClientConnection(wl_client *c, Display *parent);
     QScopedPointer<ClientConnectionPrivate> d;
 };
@@ -0,0 +1,60 @@
+/*
+    SPDX-FileCopyrightText: 2014 Martin Gräßlin <mgraesslin@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#pragma once
+
+#include "clientconnection.h"
+
+#include <QHash>
+#include <QString>
+
+#include <wayland-server-core.h>
+
+namespace KWaylandServer
+{
+class ClientConnectionPrivate
+{
+public:
+    static ClientConnectionPrivate *get(ClientConnection *connection)
+    {
+        return connection->d.data();
+    }
+
+    /**
+     * Returns the ClientConnection of @p client, or @c null if none has been created yet.
+     */
+    static ClientConnection *fromClient(wl_client *client);
+
+    ClientConnectionPrivate(wl_client *c, Display *display, ClientConnection *q);
+    ~ClientConnectionPrivate();
+
+    /**
+     * Samples the socket of the client after the display flushed it.
+     */
+    void updateFlushMetrics(qint64 now);
+    void setThrottled(bool throttled);
+
+    wl_client *client;
+    Display *display;
+    pid_t pid = 0;
+    uid_t user = 0;
+    gid_t group = 0;
+    QString executablePath;
+
+    quint64 queuedBytes = 0;
+    quint64 blockedFlushCount = 0;
+    qint64 lastDrainTime = 0;
+    bool throttled = false;
+    // keyed by the name of the interface, which is unique for each wl_interface
+    QHash<const char *, quint64> sentEvents;
+
+private:
+    static void destroyListenerCallback(wl_listener *listener, void *data);
+    ClientConnection *q;
+    // doubles as the link from the wl_client back to this ClientConnection
+    wl_listener listener;
+};
+
+} // namespace KWaylandServer
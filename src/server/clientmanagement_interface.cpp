@@ -22,10 +22,14 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include "logging.h"
 #include "surface_interface.h"
 #include "utils.h"
-#include "shmclientbuffer.h"
+#include "windowcapture_p.h"
 
 #include <qwayland-server-wayland.h>
 #include "qwayland-server-com-deepin-client-management.h"
+#include "qwayland-server-com-deepin-window-states.h"
+
+#include <QElapsedTimer>
+#include <QHash>
 
 #define MAX_WINDOWS 100
 
@@ -33,6 +37,49 @@ namespace KWaylandServer
 {
 
 static const quint32 s_version = 1;
+static const quint32 s_windowStatesVersion = 1;
+
+static bool windowStatesEqual(const ClientManagementInterface::WindowState &a, const ClientManagementInterface::WindowState &b)
+{
+    // compare field by field, the padding of the structures is not initialized
+    return a.pid == b.pid
+        && a.windowId == b.windowId
+        && a.geometry.x == b.geometry.x
+        && a.geometry.y == b.geometry.y
+        && a.geometry.width == b.geometry.width
+        && a.geometry.height == b.geometry.height
+        && a.isMinimized == b.isMinimized
+        && a.isFullScreen == b.isFullScreen
+        && a.isActive == b.isActive
+        && a.splitable == b.splitable
+        && qstrncmp(a.resourceName, b.resourceName, sizeof(a.resourceName)) == 0
+        && qstrncmp(a.uuid, b.uuid, sizeof(a.uuid)) == 0;
+}
+
+class ClientManagementInterfacePrivate;
+
+/**
+ * Sends the added, changed and removed window states to the clients which bound
+ * com_deepin_window_states, instead of the state of all windows on every change.
+ */
+class WindowStatesInterfacePrivate : public QtWaylandServer::com_deepin_window_states
+{
+public:
+    WindowStatesInterfacePrivate(ClientManagementInterfacePrivate *clientManagement, Display *display);
+
+    bool isBound(wl_client *client) const;
+    void sendWindowStatesChanged();
+
+    ClientManagementInterfacePrivate *clientManagement;
+
+protected:
+    void com_deepin_window_states_bind_resource(Resource *resource) override;
+    void com_deepin_window_states_destroy_resource(Resource *resource) override;
+    void com_deepin_window_states_destroy(Resource *resource) override;
+
+private:
+    void sendWindowStateChanged(Resource *resource, const ClientManagementInterface::WindowState &state);
+};
 
 class ClientManagementInterfacePrivate: public QtWaylandServer::com_deepin_client_management
 {
@@ -45,12 +92,22 @@ public:
     void getWindowStates();
     void captureWindowImage(int windowId, wl_resource *buffer);
     void sendWindowStates(wl_resource *resource);
+    void setWindowStates(const QList<ClientManagementInterface::WindowState *> &windowStates);
     void sendWindowCaption(int windowId, bool succeed, wl_resource *buffer);
     void sendSplitChange(const QString& uuid, int splitable);
     void splitWindow(QString uuid, int splitType);
 
-    ClientManagementInterface::WindowState m_windowStates[MAX_WINDOWS];
-    uint32_t m_windowCount;
+    // window states in the order passed by the compositor, indexed by window id
+    QVector<ClientManagementInterface::WindowState> m_windowStates;
+    QHash<int32_t, int> m_windowIndex;
+
+    // changes since the last update, sent through com_deepin_window_states
+    QVector<int32_t> m_changedWindows;
+    QVector<int32_t> m_removedWindows;
+    bool m_snapshotRequested = false;
+
+    QScopedPointer<WindowStatesInterfacePrivate> windowStatesDeltas;
+    WindowCapture m_capture;
 
 protected:
     void com_deepin_client_management_get_window_states(Resource *resource) override;
@@ -66,12 +123,82 @@ private:
 ClientManagementInterfacePrivate::ClientManagementInterfacePrivate(ClientManagementInterface *q, Display *d)
     : QtWaylandServer::com_deepin_client_management(*d, s_version)
     , q(q)
+    , windowStatesDeltas(new WindowStatesInterfacePrivate(this, d))
+{
+}
+
+WindowStatesInterfacePrivate::WindowStatesInterfacePrivate(ClientManagementInterfacePrivate *clientManagement, Display *display)
+    : QtWaylandServer::com_deepin_window_states(*display, s_windowStatesVersion)
+    , clientManagement(clientManagement)
+{
+}
+
+bool WindowStatesInterfacePrivate::isBound(wl_client *client) const
+{
+    return resourceMap().contains(client);
+}
+
+void WindowStatesInterfacePrivate::sendWindowStateChanged(Resource *resource, const ClientManagementInterface::WindowState &state)
+{
+    // one state per event, a batch of full records could exceed the wayland message size
+    const QByteArray changed = QByteArray::fromRawData(reinterpret_cast<const char *>(&state), sizeof(state));
+    send_window_states_changed(resource->handle, 1, changed);
+}
+
+void WindowStatesInterfacePrivate::sendWindowStatesChanged()
+{
+    const auto clientResources = resourceMap();
+    if (clientResources.isEmpty()) {
+        return;
+    }
+    const QVector<int32_t> &removedWindows = clientManagement->m_removedWindows;
+    const QByteArray removed = QByteArray::fromRawData(reinterpret_cast<const char *>(removedWindows.constData()),
+                                                       sizeof(int32_t) * removedWindows.count());
+    for (Resource *resource : clientResources) {
+        if (!removedWindows.isEmpty()) {
+            send_window_states_removed(resource->handle, removed);
+        }
+        for (int32_t windowId : qAsConst(clientManagement->m_changedWindows)) {
+            sendWindowStateChanged(resource, clientManagement->m_windowStates.at(clientManagement->m_windowIndex.value(windowId)));
+        }
+        send_window_states_done(resource->handle);
+    }
+}
+
+void WindowStatesInterfacePrivate::com_deepin_window_states_bind_resource(Resource *resource)
 {
+    // the first batch replaces the window states known to the client
+    for (const ClientManagementInterface::WindowState &state : qAsConst(clientManagement->m_windowStates)) {
+        sendWindowStateChanged(resource, state);
+    }
+    send_window_states_done(resource->handle);
+}
+
+void WindowStatesInterfacePrivate::com_deepin_window_states_destroy_resource(Resource *resource)
+{
+    if (isBound(resource->client())) {
+        return;
+    }
+    // the client missed the full window states in the meantime
+    const auto clientManagementResources = clientManagement->resourceMap().values(resource->client());
+    for (auto clientManagementResource : clientManagementResources) {
+        clientManagement->sendWindowStates(clientManagementResource->handle);
+    }
+}
+
+void WindowStatesInterfacePrivate::com_deepin_window_states_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
 }
 
 void ClientManagementInterfacePrivate::com_deepin_client_management_get_window_states(Resource *resource)
 {
-    Q_UNUSED(resource);
+    if (windowStatesDeltas->isBound(resource->client())) {
+        // incremental clients get the known state right away, updates follow as deltas
+        sendWindowStates(resource->handle);
+    } else {
+        m_snapshotRequested = true;
+    }
 
     getWindowStates();
 }
@@ -109,23 +236,68 @@ void ClientManagementInterfacePrivate::splitWindow(QString uuid, int splitType)
 void ClientManagementInterfacePrivate::sendWindowStates(wl_resource *resource)
 {
     struct wl_array data;
-    auto fillArray = [this](const ClientManagementInterface::WindowState *origin, wl_array *dest) {
-        wl_array_init(dest);
-        const size_t memLength = sizeof(struct ClientManagementInterface::WindowState) * m_windowCount;
-        void *s = wl_array_add(dest, memLength);
-        memcpy(s, origin, memLength);
-    };
-    fillArray(m_windowStates, &data);
-    com_deepin_client_management_send_window_states(resource, m_windowCount, &data);
+    wl_array_init(&data);
+    const size_t memLength = sizeof(struct ClientManagementInterface::WindowState) * m_windowStates.count();
+    if (memLength) {
+        void *s = wl_array_add(&data, memLength);
+        memcpy(s, m_windowStates.constData(), memLength);
+    }
+    com_deepin_client_management_send_window_states(resource, m_windowStates.count(), &data);
     wl_array_release(&data);
 }
 
 void ClientManagementInterfacePrivate::updateWindowStates()
 {
-    const auto clientResources = resourceMap();
-    for (Resource *resource : clientResources) {
-        sendWindowStates(resource->handle);
+    const bool changed = !m_changedWindows.isEmpty() || !m_removedWindows.isEmpty();
+
+    if (changed) {
+        windowStatesDeltas->sendWindowStatesChanged();
+    }
+    if (changed || m_snapshotRequested) {
+        const auto clientResources = resourceMap();
+        for (Resource *resource : clientResources) {
+            if (!windowStatesDeltas->isBound(resource->client())) {
+                sendWindowStates(resource->handle);
+            }
+        }
     }
+
+    m_changedWindows.clear();
+    m_removedWindows.clear();
+    m_snapshotRequested = false;
+}
+
+void ClientManagementInterfacePrivate::setWindowStates(const QList<ClientManagementInterface::WindowState *> &windowStates)
+{
+    QVector<ClientManagementInterface::WindowState> states;
+    QHash<int32_t, int> index;
+    states.reserve(qMin(windowStates.count(), MAX_WINDOWS));
+    index.reserve(states.capacity());
+
+    for (const ClientManagementInterface::WindowState *state : windowStates) {
+        if (states.count() == MAX_WINDOWS) {
+            break;
+        }
+        const auto it = m_windowIndex.constFind(state->windowId);
+        if (it == m_windowIndex.constEnd() || !windowStatesEqual(m_windowStates.at(*it), *state)) {
+            if (!m_changedWindows.contains(state->windowId)) {
+                m_changedWindows.append(state->windowId);
+            }
+        }
+        index.insert(state->windowId, states.count());
+        states.append(*state);
+    }
+
+    // removed windows are announced in the order of the previous states
+    for (const ClientManagementInterface::WindowState &state : qAsConst(m_windowStates)) {
+        if (!index.contains(state.windowId)) {
+            m_removedWindows.append(state.windowId);
+            m_changedWindows.removeOne(state.windowId);
+        }
+    }
+
+    m_windowStates = states;
+    m_windowIndex = index;
 }
 
 void ClientManagementInterfacePrivate::sendWindowCaption(int windowId, bool succeed, wl_resource *buffer)
@@ -168,56 +340,30 @@ ClientManagementInterface *ClientManagementInterface::get(wl_resource* native)
 
 void ClientManagementInterface::setWindowStates(QList<WindowState*> &windowStates)
 {
-    int i = 0;
-    for (auto it = windowStates.begin();
-        it != windowStates.end() && i < MAX_WINDOWS;
-        ++it) {
-        memcpy(&d->m_windowStates[i++], *it, sizeof(WindowState));
-        d->m_windowCount = i;
-    }
+    d->setWindowStates(windowStates);
     Q_EMIT windowStatesChanged();
 }
 
+void ClientManagementInterface::setReadbackFunction(const ReadbackFunction &function)
+{
+    d->m_capture.setReadbackFunction(function);
+}
+
 void ClientManagementInterface::sendWindowCaptionImage(int windowId, wl_resource *buffer, QImage image)
 {
-    bool succeed = false;
-    wl_shm_buffer *shm_buffer = wl_shm_buffer_get(buffer);
-    if (shm_buffer && !image.isNull()) {
-        wl_shm_buffer_begin_access(shm_buffer);
-        void *data = wl_shm_buffer_get_data(shm_buffer);
-        if (data) {
-            succeed = true;
-            memcpy(data, image.bits(), image.sizeInBytes());
-        }
-        wl_shm_buffer_end_access(shm_buffer);
-    }
+    QElapsedTimer timer;
+    timer.start();
+    const bool succeed = d->m_capture.capture(image, buffer);
+    Q_EMIT windowCaptured(windowId, succeed, timer.nsecsElapsed());
     d->sendWindowCaption(windowId, succeed, buffer);
 }
 
 void ClientManagementInterface::sendWindowCaption(int windowId, wl_resource *buffer, SurfaceInterface* surface)
 {
-    if (!surface || !surface->buffer()) {
-        d->sendWindowCaption(windowId, false, buffer);
-        return;
-    }
-
-    auto shmClient = qobject_cast<ShmClientBuffer *>(surface->buffer());
-
-    if(!shmClient) {
-        return;
-    }
-
-    bool succeed = false;
-    wl_shm_buffer *shm_buffer = wl_shm_buffer_get(buffer);
-    if (shm_buffer) {
-        QImage image = shmClient->data();
-        void *data = wl_shm_buffer_get_data(shm_buffer);
-        if (!image.isNull())
-        {
-            memcpy(data, image.bits(), image.sizeInBytes());
-            succeed = true;
-        }
-    }
+    QElapsedTimer timer;
+    timer.start();
+    const bool succeed = d->m_capture.capture(surface, buffer);
+    Q_EMIT windowCaptured(windowId, succeed, timer.nsecsElapsed());
     d->sendWindowCaption(windowId, succeed, buffer);
 }
 
@@ -26,6 +26,8 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include <QVector>
 #include <QImage>
 
+#include <functional>
+
 #include "surface_interface.h"
 #include <DWayland/Server/kwaylandserver_export.h>
 
@@ -34,6 +36,7 @@ struct wl_resource;
 namespace KWaylandServer
 {
 
+class ClientBuffer;
 class Display;
 class ClientManagementInterfacePrivate;
 
@@ -69,9 +72,37 @@ public:
     };
 
     static ClientManagementInterface *get(wl_resource *native);
+    /**
+     * Sets the state of all windows.
+     *
+     * The states are tracked by window id. Clients which bound com_deepin_window_states
+     * only get the added, changed and removed states through it, other clients keep
+     * receiving the state of all windows on every change.
+     */
     void setWindowStates(QList<WindowState*> &windowStates);
 
+    /**
+     * Reads the content of a @p buffer the compositor can't map, e.g. a linux dmabuf, into
+     * @p target. The @p target image wraps the memory of the capture buffer, its size and
+     * format are the ones of the capture buffer. Returns @c true on success.
+     */
+    using ReadbackFunction = std::function<bool(ClientBuffer *buffer, QImage &target)>;
+
+    /**
+     * Sets the function used to capture windows whose surface is not backed by a shm buffer.
+     * Without a readback function capturing such windows fails.
+     */
+    void setReadbackFunction(const ReadbackFunction &function);
+
+    /**
+     * Copies @p image into the shm @p buffer, converting it to the format of the buffer.
+     */
     void sendWindowCaptionImage(int windowId, wl_resource *buffer, QImage image);
+    /**
+     * Copies the current buffer of @p surface into the shm @p buffer, converting it to the
+     * format of the buffer. When a client captures the same window into the same buffer
+     * again, only the parts damaged in between are copied.
+     */
     void sendWindowCaption(int windowId, wl_resource *buffer, SurfaceInterface* surface);
     void sendSplitChange(const QString& uuid, int splitable);
 
@@ -80,6 +111,11 @@ Q_SIGNALS:
     void windowStatesChanged();
 
     void captureWindowImageRequest(int windowId, wl_resource *buffer);
+    /**
+     * Emitted after each capture of the window @p windowId with the time, in nanoseconds,
+     * it took to fill the capture buffer.
+     */
+    void windowCaptured(int windowId, bool succeeded, qint64 durationNsecs);
     void splitWindowRequest(QString uuid, int splitType);
 
 private:
@@ -5,6 +5,7 @@
     SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
 */
 #include "compositor_interface.h"
+#include "damageaccumulator_p.h"
 #include "display.h"
 #include "region_interface_p.h"
 #include "surface_interface.h"
@@ -22,6 +23,7 @@ public:
 
     CompositorInterface *q;
     Display *display;
+    int damageRectThreshold = DamageAccumulator::defaultBoundingRectThreshold;
 
 protected:
     void compositor_create_surface(Resource *resource, uint32_t id) override;
@@ -70,4 +72,14 @@ Display *CompositorInterface::display() const
     return d->display;
 }
 
+void CompositorInterface::setDamageRectThreshold(int threshold)
+{
+    d->damageRectThreshold = threshold;
+}
+
+int CompositorInterface::damageRectThreshold() const
+{
+    return d->damageRectThreshold;
+}
+
 } // namespace KWaylandServer
@@ -35,6 +35,14 @@ public:
      */
     Display *display() const;
 
+    /**
+     * Sets the number of damage rectangles a surface can post between two commits before
+     * its damage is reduced to their bounding rectangle. Clients such as terminals and web
+     * browsers may post hundreds of small rectangles per frame; the default is 256.
+     */
+    void setDamageRectThreshold(int threshold);
+    int damageRectThreshold() const;
+
 Q_SIGNALS:
     /**
      * This signal is emitted when a new SurfaceInterface @a surface has been created.
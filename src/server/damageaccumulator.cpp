@@ -0,0 +1,107 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#include "damageaccumulator_p.h"
+
+#include <limits>
+
+namespace KWaylandServer
+{
+
+static qint64 area(const QRect &rect)
+{
+    return qint64(rect.width()) * rect.height();
+}
+
+/**
+ * Returns @c true if the union of @p a and @p b is a rectangle, i.e. they are stacked in
+ * the same columns or lined up in the same rows and touch or overlap.
+ */
+static bool formRect(const QRect &a, const QRect &b)
+{
+    if (a.top() == b.top() && a.bottom() == b.bottom()) {
+        return a.left() <= b.right() + 1 && b.left() <= a.right() + 1;
+    }
+    if (a.left() == b.left() && a.right() == b.right()) {
+        return a.top() <= b.bottom() + 1 && b.top() <= a.bottom() + 1;
+    }
+    return false;
+}
+
+void DamageAccumulator::add(const QRect &rect, int boundingRectThreshold)
+{
+    if (rect.isEmpty()) {
+        return;
+    }
+    m_bounds |= rect;
+    if (m_collapsed) {
+        return;
+    }
+    if (++m_added > boundingRectThreshold) {
+        m_collapsed = true;
+        m_rects.clear();
+        return;
+    }
+    insert(rect);
+}
+
+void DamageAccumulator::insert(QRect rect)
+{
+    int i = 0;
+    while (i < m_rects.count()) {
+        const QRect &existing = m_rects.at(i);
+        if (existing.contains(rect)) {
+            return;
+        }
+        if (rect.contains(existing) || formRect(rect, existing)) {
+            // the grown rect can swallow rects checked before, start over
+            rect |= existing;
+            m_rects.remove(i);
+            i = 0;
+            continue;
+        }
+        ++i;
+    }
+
+    if (m_rects.count() == maxRects) {
+        int closest = 0;
+        qint64 closestGrowth = std::numeric_limits<qint64>::max();
+        for (int j = 0; j < m_rects.count(); ++j) {
+            const qint64 growth = area(m_rects.at(j) | rect) - area(m_rects.at(j));
+            if (growth < closestGrowth) {
+                closest = j;
+                closestGrowth = growth;
+            }
+        }
+        rect |= m_rects.at(closest);
+        m_rects.remove(closest);
+        insert(rect);
+        return;
+    }
+
+    m_rects.append(rect);
+}
+
+void DamageAccumulator::clear()
+{
+    m_rects.clear();
+    m_bounds = QRect();
+    m_added = 0;
+    m_collapsed = false;
+}
+
+QRegion DamageAccumulator::region() const
+{
+    if (m_collapsed) {
+        return QRegion(m_bounds);
+    }
+    QRegion region;
+    for (const QRect &rect : m_rects) {
+        region += rect;
+    }
+    return region;
+}
+
+} // namespace KWaylandServer
@@ -0,0 +1,64 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#pragma once
+
+#include <DWayland/Server/kwaylandserver_export.h>
+
+#include <QRect>
+#include <QRegion>
+#include <QVarLengthArray>
+
+namespace KWaylandServer
+{
+/**
+ * Collects the damage rectangles posted to a surface between two commits.
+ *
+ * Adding a rectangle never builds a QRegion. Rectangles covered by another rectangle are
+ * dropped and rectangles which together form a rectangle are merged, so the damage stays
+ * exact for typical clients. At most maxRects rectangles are kept; beyond that a new
+ * rectangle is merged with the rectangle whose bounds grow the least. Once more than the
+ * bounding rect threshold of rectangles were added, the damage is the bounding rectangle.
+ */
+class KWAYLANDSERVER_EXPORT DamageAccumulator
+{
+public:
+    static constexpr int maxRects = 16;
+    static constexpr int defaultBoundingRectThreshold = 256;
+
+    /**
+     * Adds @p rect to the damage. If more than @p boundingRectThreshold rectangles were
+     * added since the last clear(), the damage collapses to its bounding rectangle.
+     */
+    void add(const QRect &rect, int boundingRectThreshold = defaultBoundingRectThreshold);
+    void clear();
+
+    bool isEmpty() const
+    {
+        return m_bounds.isEmpty();
+    }
+    QRect boundingRect() const
+    {
+        return m_bounds;
+    }
+    /**
+     * The number of rectangles the damage consists of, at most maxRects.
+     */
+    int rectCount() const
+    {
+        return m_collapsed ? 1 : m_rects.count();
+    }
+    QRegion region() const;
+
+private:
+    void insert(QRect rect);
+
+    QVarLengthArray<QRect, maxRects> m_rects;
+    QRect m_bounds;
+    int m_added = 0;
+    bool m_collapsed = false;
+};
+
+} // namespace KWaylandServer
@@ -21,6 +21,7 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include "ddeseat_interface.h"
 #include "ddekeyboard_interface.h"
 #include "display.h"
+#include "keymapcache_p.h"
 #include "logging.h"
 
 #include "qwayland-server-dde-seat.h"
@@ -65,9 +66,22 @@ DDESeatInterface *DDEKeyboardInterface::ddeSeat() const
 
 void DDEKeyboardInterface::setKeymap(int fd, quint32 size)
 {
+    d->keymapFile.reset();
     d->sendKeymap(fd, size);
 }
 
+void DDEKeyboardInterface::setKeymap(const QByteArray &content)
+{
+    if (content.isNull()) {
+        return;
+    }
+    d->keymapFile = KeymapCache::self()->keymap(content);
+    if (!d->keymapFile) {
+        return;
+    }
+    d->sendKeymap(d->keymapFile->fd(), d->keymapFile->size());
+}
+
 void DDEKeyboardInterfacePrivate::sendKeymap(int fd, quint32 size)
 {
     send_keymap(keymap_format_xkb_v1, fd, size);
@@ -49,6 +49,13 @@ public:
     DDESeatInterface *ddeSeat() const;
 
     void setKeymap(int fd, quint32 size);
+    /**
+     * Sends the keymap @p content to the dde keyboard like the file descriptor overload.
+     *
+     * The keymap file is taken from the shared keymap cache, so it is the same sealed
+     * file the wl_keyboards of the seat use.
+     */
+    void setKeymap(const QByteArray &content);
     void updateModifiers(quint32 depressed, quint32 latched, quint32 locked, quint32 group, quint32 serial);
     void keyPressed(quint32 key, quint32 serial);
     void keyReleased(quint32 key, quint32 serial);
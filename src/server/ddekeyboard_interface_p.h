@@ -26,11 +26,14 @@ License along with this library.  If not, see <http://www.gnu.org/licenses/>.
 #include <QMap>
 #include <QPointer>
 #include <QPointF>
+#include <QSharedPointer>
 
 #include "qwayland-server-dde-seat.h"
 
 namespace KWaylandServer
 {
+class KeymapFile;
+
 class DDEKeyboardInterfacePrivate : public QtWaylandServer::dde_keyboard
 {
 public:
@@ -45,6 +48,7 @@ public:
 
     DDEKeyboardInterface *q;
     DDESeatInterface *ddeSeat;
+    QSharedPointer<KeymapFile> keymapFile;
 protected:
     void dde_keyboard_release(Resource *resource) override;
 };
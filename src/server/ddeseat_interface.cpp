@@ -192,6 +192,18 @@ void DDESeatInterface::setKeymap(int fd, quint32 size)
     d->ddekeyboard->setKeymap(fd, size);
 }
 
+void DDESeatInterface::setKeymap(const QByteArray &content)
+{
+    if (!d->ddekeyboard) {
+        return;
+    }
+    d->keys.keymap.xkbcommonCompatible = true;
+    d->keys.keymap.fd = -1;
+    d->keys.keymap.size = content.size();
+
+    d->ddekeyboard->setKeymap(content);
+}
+
 void DDESeatInterface::keyPressed(quint32 key)
 {
     if (!d->ddekeyboard) {
@@ -66,6 +66,12 @@ public:
     quint32 touchtimestamp() const;
 
     void setKeymap(int fd, quint32 size);
+    /**
+     * Sets the keymap @p content through the shared keymap cache.
+     *
+     * @see KeyboardInterface::setKeymap
+     */
+    void setKeymap(const QByteArray &content);
     void keyPressed(quint32 key);
     void keyReleased(quint32 key);
     void updateKeyboardModifiers(quint32 depressed, quint32 latched, quint32 locked, quint32 group);
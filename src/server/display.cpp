@@ -6,14 +6,17 @@
 */
 #include "display.h"
 #include "clientbufferintegration.h"
+#include "clientconnection_p.h"
 #include "display_p.h"
 #include "drmclientbuffer.h"
 #include "logging.h"
 #include "output_interface.h"
+#include "seat_interface.h"
 #include "shmclientbuffer.h"
 
 #include <QAbstractEventDispatcher>
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QDebug>
 #include <QRect>
 
@@ -45,6 +48,9 @@ Display::Display(QObject *parent)
 
 Display::~Display()
 {
+    if (d->protocolLogger) {
+        wl_protocol_logger_destroy(d->protocolLogger);
+    }
     wl_display_destroy_clients(d->display);
     wl_display_destroy(d->display);
 }
@@ -111,6 +117,10 @@ bool Display::start()
 
 void Display::dispatchEvents()
 {
+    // deliver what the input threads queued up before the requests of the clients
+    for (SeatInterface *seat : qAsConst(d->seats)) {
+        seat->dispatchInputEvents();
+    }
     if (wl_event_loop_dispatch(d->loop, 0) != 0) {
         qCWarning(KWAYLAND_SERVER) << "Error on dispatching Wayland event loop";
     }
@@ -119,6 +129,87 @@ void Display::dispatchEvents()
 void Display::flush()
 {
     wl_display_flush_clients(d->display);
+    if (d->protocolLogger || d->clientBacklogPolicy) {
+        d->updateClientMetrics();
+    }
+}
+
+void DisplayPrivate::updateClientMetrics()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QVector<ClientConnection *> stuckClients;
+    for (ClientConnection *connection : qAsConst(clients)) {
+        ClientConnectionPrivate *connectionPrivate = ClientConnectionPrivate::get(connection);
+        if (!connectionPrivate->client) {
+            continue;
+        }
+        connectionPrivate->updateFlushMetrics(now);
+        if (!clientBacklogPolicy || connectionPrivate->queuedBytes <= clientBacklogThreshold) {
+            continue;
+        }
+        switch (clientBacklogPolicy(connection)) {
+        case Display::BacklogAction::Ignore:
+            break;
+        case Display::BacklogAction::Throttle:
+            connectionPrivate->setThrottled(true);
+            break;
+        case Display::BacklogAction::Disconnect:
+            stuckClients.append(connection);
+            break;
+        }
+    }
+    // destroying a client removes it from the list of clients
+    for (ClientConnection *connection : qAsConst(stuckClients)) {
+        qCWarning(KWAYLAND_SERVER) << "Disconnecting" << connection->executablePath() << "with" << connection->queuedBytes() << "queued bytes";
+        connection->destroy();
+    }
+}
+
+void DisplayPrivate::logProtocol(void *userData, wl_protocol_logger_type type, const wl_protocol_logger_message *message)
+{
+    if (type != WL_PROTOCOL_LOGGER_EVENT) {
+        return;
+    }
+    Q_UNUSED(userData)
+    // never create a connection here, the client may be in the middle of being destroyed
+    ClientConnection *connection = ClientConnectionPrivate::fromClient(wl_resource_get_client(message->resource));
+    if (!connection) {
+        return;
+    }
+    ++ClientConnectionPrivate::get(connection)->sentEvents[wl_resource_get_class(message->resource)];
+}
+
+void Display::setClientMetricsEnabled(bool enabled)
+{
+    if (clientMetricsEnabled() == enabled) {
+        return;
+    }
+    if (enabled) {
+        d->protocolLogger = wl_display_add_protocol_logger(d->display, DisplayPrivate::logProtocol, d.data());
+    } else {
+        wl_protocol_logger_destroy(d->protocolLogger);
+        d->protocolLogger = nullptr;
+    }
+}
+
+bool Display::clientMetricsEnabled() const
+{
+    return d->protocolLogger;
+}
+
+void Display::setClientBacklogThreshold(quint64 bytes)
+{
+    d->clientBacklogThreshold = bytes;
+}
+
+quint64 Display::clientBacklogThreshold() const
+{
+    return d->clientBacklogThreshold;
+}
+
+void Display::setClientBacklogPolicy(const BacklogPolicy &policy)
+{
+    d->clientBacklogPolicy = policy;
 }
 
 void Display::createShm()
@@ -182,20 +273,16 @@ QVector<SeatInterface *> Display::seats() const
 ClientConnection *Display::getConnection(wl_client *client)
 {
     Q_ASSERT(client);
-    auto it = std::find_if(d->clients.constBegin(), d->clients.constEnd(), [client](ClientConnection *c) {
-        return c->client() == client;
-    });
-    if (it != d->clients.constEnd()) {
-        return *it;
+    if (ClientConnection *connection = ClientConnectionPrivate::fromClient(client)) {
+        return connection;
     }
     // no ConnectionData yet, create it
     auto c = new ClientConnection(client, this);
     d->clients << c;
     connect(c, &ClientConnection::disconnected, this, [this](ClientConnection *c) {
-        const int index = d->clients.indexOf(c);
-        Q_ASSERT(index != -1);
-        d->clients.remove(index);
-        Q_ASSERT(d->clients.indexOf(c) == -1);
+        const bool removed = d->clients.removeOne(c);
+        Q_ASSERT(removed);
+        Q_UNUSED(removed)
         Q_EMIT clientDisconnected(c);
     });
     Q_EMIT clientConnected(c);
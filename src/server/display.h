@@ -13,6 +13,8 @@
 
 #include "clientconnection.h"
 
+#include <functional>
+
 struct wl_client;
 struct wl_display;
 
@@ -125,6 +127,59 @@ public:
     ClientConnection *getConnection(wl_client *client);
     QVector<ClientConnection *> connections() const;
 
+    /**
+     * What to do with a client whose backlog of unread events exceeds the threshold.
+     */
+    enum class BacklogAction {
+        /**
+         * Keep sending events to the client.
+         */
+        Ignore,
+        /**
+         * Mark the client as throttled until it has read all events.
+         * @see ClientConnection::isThrottled
+         */
+        Throttle,
+        /**
+         * Disconnect the client.
+         */
+        Disconnect,
+    };
+    using BacklogPolicy = std::function<BacklogAction(ClientConnection *client)>;
+
+    /**
+     * Enables collecting the metrics of each ClientConnection, such as the number of queued
+     * bytes and of events sent per interface. The metrics are sampled whenever the display
+     * flushes the clients. They are disabled by default.
+     *
+     * @see ClientConnection::queuedBytes
+     * @see ClientConnection::blockedFlushCount
+     * @see ClientConnection::sentEventCounts
+     * @see ClientConnection::lastDrainTime
+     */
+    void setClientMetricsEnabled(bool enabled);
+    bool clientMetricsEnabled() const;
+    /**
+     * Sets the number of queued bytes above which the backlog policy is asked what to do
+     * with a client. The default is 128 KiB.
+     *
+     * @see setClientBacklogPolicy
+     */
+    void setClientBacklogThreshold(quint64 bytes);
+    quint64 clientBacklogThreshold() const;
+    /**
+     * Sets the @p policy deciding what happens to a client which does not read the events sent
+     * to it. The policy is called after each flush for every client with more queued bytes than
+     * the backlog threshold, it can take ClientConnection::lastDrainTime into account to tell a
+     * slow client from a stuck one. Setting a policy samples the queued bytes even if the client
+     * metrics are disabled.
+     *
+     * Pass an empty policy to unset it.
+     *
+     * @see setClientBacklogThreshold
+     */
+    void setClientBacklogPolicy(const BacklogPolicy &policy);
+
     /**
      * Set the EGL @p display for this Wayland display.
      * The EGLDisplay can only be set once and must be alive as long as the Wayland display
@@ -9,6 +9,8 @@
 
 #include <wayland-server-core.h>
 
+#include "display.h"
+
 #include <QHash>
 #include <QList>
 #include <QSocketNotifier>
@@ -41,6 +43,9 @@ public:
     void registerClientBuffer(ClientBuffer *clientBuffer);
     void unregisterClientBuffer(ClientBuffer *clientBuffer);
 
+    void updateClientMetrics();
+    static void logProtocol(void *userData, wl_protocol_logger_type type, const wl_protocol_logger_message *message);
+
     Display *q;
     QSocketNotifier *socketNotifier = nullptr;
     wl_display *display = nullptr;
@@ -55,6 +60,9 @@ public:
     QHash<::wl_resource *, ClientBuffer *> resourceToBuffer;
     QHash<ClientBuffer *, ClientBufferDestroyListener *> bufferToListener;
     QList<ClientBufferIntegration *> bufferIntegrations;
+    wl_protocol_logger *protocolLogger = nullptr;
+    quint64 clientBacklogThreshold = 128 * 1024;
+    Display::BacklogPolicy clientBacklogPolicy;
 };
 
 } // namespace KWaylandServer
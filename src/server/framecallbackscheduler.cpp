@@ -0,0 +1,213 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#include "framecallbackscheduler.h"
+#include "output_interface.h"
+#include "subcompositor_interface.h"
+#include "surface_interface.h"
+#include "surface_interface_p.h"
+
+#include <QHash>
+
+#include <utility>
+
+namespace KWaylandServer
+{
+typedef QHash<OutputInterface *, FrameCallbackScheduler *> SchedulerHash;
+Q_GLOBAL_STATIC(SchedulerHash, s_schedulers)
+
+class FrameCallbackSchedulerPrivate
+{
+public:
+    FrameCallbackSchedulerPrivate(FrameCallbackScheduler *q, OutputInterface *output);
+
+    struct Entry {
+        QMetaObject::Connection destroyConnection;
+        quint32 lastFrame = 0;
+        bool hasFired = false;
+        bool scheduled = false;
+        bool throttled = false;
+    };
+
+    Entry &entry(SurfaceInterface *surface);
+    void release(SurfaceInterface *surface);
+    bool isThrottled(SurfaceInterface *surface) const;
+    bool holdBack(SurfaceInterface *surface, quint32 msec);
+
+    OutputInterface *output;
+    QHash<SurfaceInterface *, Entry> entries;
+    QVector<SurfaceInterface *> scheduled;
+    int throttledRefreshRate = 1000;
+    quint64 firedCount = 0;
+    quint64 skippedCount = 0;
+
+private:
+    FrameCallbackScheduler *q;
+};
+
+FrameCallbackSchedulerPrivate::FrameCallbackSchedulerPrivate(FrameCallbackScheduler *q, OutputInterface *output)
+    : output(output)
+    , q(q)
+{
+}
+
+FrameCallbackSchedulerPrivate::Entry &FrameCallbackSchedulerPrivate::entry(SurfaceInterface *surface)
+{
+    auto it = entries.find(surface);
+    if (it == entries.end()) {
+        it = entries.insert(surface, Entry());
+        it->destroyConnection = QObject::connect(surface, &SurfaceInterface::aboutToBeDestroyed, q, [this, surface] {
+            entries.remove(surface);
+            scheduled.removeOne(surface);
+        });
+    }
+    return *it;
+}
+
+void FrameCallbackSchedulerPrivate::release(SurfaceInterface *surface)
+{
+    auto it = entries.find(surface);
+    if (it == entries.end() || it->scheduled || it->throttled) {
+        return;
+    }
+    QObject::disconnect(it->destroyConnection);
+    entries.erase(it);
+}
+
+bool FrameCallbackSchedulerPrivate::isThrottled(SurfaceInterface *surface) const
+{
+    auto it = entries.constFind(surface);
+    if (it != entries.constEnd() && it->throttled) {
+        return true;
+    }
+    SubSurfaceInterface *subSurface = surface->subSurface();
+    SurfaceInterface *mainSurface = subSurface ? subSurface->mainSurface() : nullptr;
+    if (!mainSurface || mainSurface == surface) {
+        return false;
+    }
+    it = entries.constFind(mainSurface);
+    return it != entries.constEnd() && it->throttled;
+}
+
+bool FrameCallbackSchedulerPrivate::holdBack(SurfaceInterface *surface, quint32 msec)
+{
+    if (!isThrottled(surface)) {
+        return false;
+    }
+    const Entry &e = entries[surface];
+    if (!e.hasFired) {
+        return false;
+    }
+    const quint32 interval = 1000 * 1000 / qMax(1, throttledRefreshRate);
+    return msec - e.lastFrame < interval;
+}
+
+FrameCallbackScheduler::FrameCallbackScheduler(OutputInterface *output)
+    : QObject(output)
+    , d(new FrameCallbackSchedulerPrivate(this, output))
+{
+    Q_ASSERT(!s_schedulers->contains(output));
+    s_schedulers->insert(output, this);
+}
+
+FrameCallbackScheduler::~FrameCallbackScheduler()
+{
+    s_schedulers->remove(d->output);
+}
+
+OutputInterface *FrameCallbackScheduler::output() const
+{
+    return d->output;
+}
+
+void FrameCallbackScheduler::vblank(quint32 msec)
+{
+    const QVector<SurfaceInterface *> surfaces = std::exchange(d->scheduled, {});
+    for (SurfaceInterface *surface : surfaces) {
+        auto &e = d->entry(surface);
+        e.scheduled = false;
+        // the callbacks went out with another output, or the surface left this one
+        if (!surface->hasFrameCallbacks() || !surface->outputs().contains(d->output)) {
+            d->release(surface);
+            continue;
+        }
+        if (d->holdBack(surface, msec)) {
+            ++d->skippedCount;
+            e.scheduled = true;
+            d->scheduled.append(surface);
+            continue;
+        }
+        SurfaceInterfacePrivate::get(surface)->sendFrameCallbacks(msec);
+        ++d->firedCount;
+        e.lastFrame = msec;
+        e.hasFired = true;
+        d->release(surface);
+    }
+}
+
+void FrameCallbackScheduler::schedule(SurfaceInterface *surface)
+{
+    auto &e = d->entry(surface);
+    if (!e.scheduled) {
+        e.scheduled = true;
+        d->scheduled.append(surface);
+    }
+}
+
+QVector<SurfaceInterface *> FrameCallbackScheduler::scheduledSurfaces() const
+{
+    return d->scheduled;
+}
+
+void FrameCallbackScheduler::setThrottled(SurfaceInterface *surface, bool throttled)
+{
+    if (throttled) {
+        d->entry(surface).throttled = true;
+        return;
+    }
+    auto it = d->entries.find(surface);
+    if (it != d->entries.end()) {
+        it->throttled = false;
+        d->release(surface);
+    }
+}
+
+bool FrameCallbackScheduler::isThrottled(SurfaceInterface *surface) const
+{
+    return d->isThrottled(surface);
+}
+
+void FrameCallbackScheduler::setThrottledRefreshRate(int refreshRate)
+{
+    d->throttledRefreshRate = refreshRate;
+}
+
+int FrameCallbackScheduler::throttledRefreshRate() const
+{
+    return d->throttledRefreshRate;
+}
+
+quint64 FrameCallbackScheduler::firedCount() const
+{
+    return d->firedCount;
+}
+
+quint64 FrameCallbackScheduler::skippedCount() const
+{
+    return d->skippedCount;
+}
+
+void FrameCallbackScheduler::resetCounters()
+{
+    d->firedCount = 0;
+    d->skippedCount = 0;
+}
+
+FrameCallbackScheduler *FrameCallbackScheduler::get(OutputInterface *output)
+{
+    return s_schedulers->value(output);
+}
+
+}
@@ -0,0 +1,102 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#pragma once
+
+#include <QObject>
+#include <QVector>
+
+#include <DWayland/Server/kwaylandserver_export.h>
+
+namespace KWaylandServer
+{
+class FrameCallbackSchedulerPrivate;
+class OutputInterface;
+class SurfaceInterface;
+
+/**
+ * @brief The FrameCallbackScheduler class sends the frame callbacks of the surfaces on one output.
+ *
+ * Once a FrameCallbackScheduler is attached to an OutputInterface, each SurfaceInterface on that
+ * output which commits frame callbacks is queued, as given by SurfaceInterface::outputs(). The
+ * compositor calls vblank() once per refresh of the output, which sends the frame callbacks of
+ * all queued surfaces in one pass. There is no need to call SurfaceInterface::frameRendered()
+ * for each visible surface anymore.
+ *
+ * Surfaces nobody sees, e.g. occluded or minimized windows, can be throttled with setThrottled().
+ * A throttled surface and its subsurfaces get their frame callbacks at throttledRefreshRate(), so
+ * the client keeps running without rendering frames at the full refresh rate of the output.
+ *
+ * @code
+ * auto scheduler = new FrameCallbackScheduler(output);
+ * connect(renderLoop, &RenderLoop::framePresented, scheduler, [scheduler](std::chrono::milliseconds timestamp) {
+ *     scheduler->vblank(timestamp.count());
+ * });
+ * @endcode
+ */
+class KWAYLANDSERVER_EXPORT FrameCallbackScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * Attaches a new FrameCallbackScheduler to @p output, which becomes its parent.
+     */
+    explicit FrameCallbackScheduler(OutputInterface *output);
+    ~FrameCallbackScheduler() override;
+
+    OutputInterface *output() const;
+
+    /**
+     * Sends the frame callbacks of all surfaces queued on the output, with the timestamp @p msec.
+     */
+    void vblank(quint32 msec);
+
+    /**
+     * Queues @p surface for the next vblank(). This is done automatically when a surface on the
+     * output commits frame callbacks or enters the output with frame callbacks pending.
+     */
+    void schedule(SurfaceInterface *surface);
+    /**
+     * @returns the surfaces waiting for the next vblank()
+     */
+    QVector<SurfaceInterface *> scheduledSurfaces() const;
+
+    /**
+     * Throttles @p surface and its subsurfaces to throttledRefreshRate(), e.g. because the window
+     * is occluded or minimized.
+     */
+    void setThrottled(SurfaceInterface *surface, bool throttled);
+    /**
+     * @returns whether @p surface, or the main surface it belongs to, is throttled
+     */
+    bool isThrottled(SurfaceInterface *surface) const;
+
+    /**
+     * Sets the rate in mHz at which throttled surfaces get their frame callbacks. The default
+     * is 1000, one frame per second.
+     */
+    void setThrottledRefreshRate(int refreshRate);
+    int throttledRefreshRate() const;
+
+    /**
+     * @returns how many times a surface got its frame callbacks
+     */
+    quint64 firedCount() const;
+    /**
+     * @returns how many times the frame callbacks of a throttled surface were held back
+     */
+    quint64 skippedCount() const;
+    void resetCounters();
+
+    /**
+     * @returns the FrameCallbackScheduler attached to @p output, or @c null
+     */
+    static FrameCallbackScheduler *get(OutputInterface *output);
+
+private:
+    QScopedPointer<FrameCallbackSchedulerPrivate> d;
+};
+
+}
@@ -19,8 +19,8 @@ public:
     GlobalPropertyInterface *q;
 
 private:
-    void dde_globalproperty_set_property(Resource *resource, const QString &module, const QString &function, struct ::wl_resource *surface, int32_t type, const QString &data) override;
-    void dde_globalproperty_get_property(Resource *resource, const QString &data) override;
+    void dde_globalproperty_set_property(Resource *resource, QtWaylandServer::Utf8View module, QtWaylandServer::Utf8View function, struct ::wl_resource *surface, int32_t type, QtWaylandServer::Utf8View data) override;
+    void dde_globalproperty_get_property(Resource *resource, QtWaylandServer::Utf8View data) override;
 };
 
 GlobalPropertyInterfacePrivate::GlobalPropertyInterfacePrivate(GlobalPropertyInterface *_q, Display *display)
@@ -30,7 +30,7 @@ GlobalPropertyInterfacePrivate::GlobalPropertyInterfacePrivate(GlobalPropertyInt
 
 }
 
-void GlobalPropertyInterfacePrivate::dde_globalproperty_set_property(Resource *resource, const QString &module, const QString &function, struct ::wl_resource *surface, int32_t type, const QString &data)
+void GlobalPropertyInterfacePrivate::dde_globalproperty_set_property(Resource *resource, QtWaylandServer::Utf8View module, QtWaylandServer::Utf8View function, struct ::wl_resource *surface, int32_t type, QtWaylandServer::Utf8View data)
 {
     SurfaceInterface *si = SurfaceInterface::get(surface);
     if (!si) {
@@ -39,7 +39,8 @@ void GlobalPropertyInterfacePrivate::dde_globalproperty_set_property(Resource *r
     }
 
     QJsonParseError error;
-    const auto doc = QJsonDocument::fromJson(data.toUtf8(), &error);
+    // the JSON is parsed straight from the UTF-8 sent by the client
+    const auto doc = QJsonDocument::fromJson(data.toRawByteArray(), &error);
     if (error.error != QJsonParseError::NoError) {
         qDebug() << "Failed to parse data" << error.errorString();
         return;
@@ -53,7 +54,7 @@ void GlobalPropertyInterfacePrivate::dde_globalproperty_set_property(Resource *r
     emit q->windowDecoratePropertyChanged(si, ret);
 }
 
-void GlobalPropertyInterfacePrivate::dde_globalproperty_get_property(Resource *resource, const QString &data)
+void GlobalPropertyInterfacePrivate::dde_globalproperty_get_property(Resource *resource, QtWaylandServer::Utf8View data)
 {
 
 }
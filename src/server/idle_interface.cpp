@@ -7,6 +7,8 @@
 #include "idle_interface_p.h"
 #include "seat_interface.h"
 
+#include <limits>
+
 namespace KWaylandServer
 {
 static const quint32 s_version = 1;
@@ -15,6 +17,114 @@ IdleInterfacePrivate::IdleInterfacePrivate(IdleInterface *_q, Display *display)
     : QtWaylandServer::org_kde_kwin_idle(*display, s_version)
     , q(_q)
 {
+    clock.start();
+    timer.setSingleShot(true);
+    QObject::connect(&timer, &QTimer::timeout, q, [this] {
+        checkTimeouts();
+    });
+}
+
+IdleInterfacePrivate::~IdleInterfacePrivate()
+{
+    for (IdleTimeoutInterface *idleTimeout : qAsConst(idleTimeouts)) {
+        idleTimeout->manager = nullptr;
+    }
+}
+
+qint64 IdleInterfacePrivate::now() const
+{
+    return clock.elapsed();
+}
+
+void IdleInterfacePrivate::userActivity()
+{
+    if (inhibitCount > 0) {
+        // ignored while inhibited
+        return;
+    }
+    // this runs for every input event, so in the common case nothing but the timestamp changes;
+    // the armed timer finds out about the activity when it fires
+    lastActivity = now();
+    if (idleCount == 0) {
+        return;
+    }
+    for (IdleTimeoutInterface *idleTimeout : qAsConst(idleTimeouts)) {
+        if (idleTimeout->idle) {
+            idleTimeout->sendResumed();
+        }
+    }
+    reschedule();
+}
+
+void IdleInterfacePrivate::checkTimeouts()
+{
+    armedDeadline = 0;
+    if (inhibitCount > 0) {
+        return;
+    }
+    const qint64 currentTime = now();
+    for (IdleTimeoutInterface *idleTimeout : qAsConst(idleTimeouts)) {
+        if (idleTimeout->interval && !idleTimeout->idle && idleTimeout->deadline() <= currentTime) {
+            idleTimeout->sendIdle();
+        }
+    }
+    reschedule();
+}
+
+void IdleInterfacePrivate::reschedule()
+{
+    if (inhibitCount > 0) {
+        return;
+    }
+    qint64 nearest = std::numeric_limits<qint64>::max();
+    for (IdleTimeoutInterface *idleTimeout : qAsConst(idleTimeouts)) {
+        if (idleTimeout->interval && !idleTimeout->idle) {
+            nearest = qMin(nearest, idleTimeout->deadline());
+        }
+    }
+    if (nearest == std::numeric_limits<qint64>::max()) {
+        timer.stop();
+        armedDeadline = 0;
+        return;
+    }
+    if (timer.isActive() && armedDeadline <= nearest) {
+        // fires early enough, it re-arms itself then
+        return;
+    }
+    armedDeadline = nearest;
+    timer.start(qMax<qint64>(0, nearest - now()));
+}
+
+void IdleInterfacePrivate::setInhibited(bool inhibited)
+{
+    if (inhibited) {
+        for (IdleTimeoutInterface *idleTimeout : qAsConst(idleTimeouts)) {
+            if (idleTimeout->idle) {
+                idleTimeout->sendResumed();
+            }
+        }
+        timer.stop();
+        armedDeadline = 0;
+    } else {
+        // the timeouts start over
+        lastActivity = now();
+        reschedule();
+    }
+}
+
+void IdleInterfacePrivate::addTimeout(IdleTimeoutInterface *timeout)
+{
+    idleTimeouts << timeout;
+    reschedule();
+}
+
+void IdleInterfacePrivate::removeTimeout(IdleTimeoutInterface *timeout)
+{
+    idleTimeouts.removeOne(timeout);
+    if (timeout->idle) {
+        --idleCount;
+    }
+    // a timer armed for this timeout just fires without effect
 }
 
 void IdleInterfacePrivate::org_kde_kwin_idle_get_idle_timeout(Resource *resource, uint32_t id, wl_resource *seat, uint32_t timeout)
@@ -28,12 +138,7 @@ void IdleInterfacePrivate::org_kde_kwin_idle_get_idle_timeout(Resource *resource
         return;
     }
 
-    IdleTimeoutInterface *idleTimeout = new IdleTimeoutInterface(s, q, idleTimoutResource);
-    idleTimeouts << idleTimeout;
-
-    QObject::connect(idleTimeout, &IdleTimeoutInterface::destroyed, q, [this, idleTimeout]() {
-        idleTimeouts.removeOne(idleTimeout);
-    });
+    IdleTimeoutInterface *idleTimeout = new IdleTimeoutInterface(s, this, idleTimoutResource);
     idleTimeout->setup(timeout);
 }
 
@@ -49,6 +154,7 @@ void IdleInterface::inhibit()
 {
     d->inhibitCount++;
     if (d->inhibitCount == 1) {
+        d->setInhibited(true);
         Q_EMIT inhibitedChanged();
     }
 }
@@ -57,6 +163,7 @@ void IdleInterface::uninhibit()
 {
     d->inhibitCount--;
     if (d->inhibitCount == 0) {
+        d->setInhibited(false);
         Q_EMIT inhibitedChanged();
     }
 }
@@ -68,34 +175,23 @@ bool IdleInterface::isInhibited() const
 
 void IdleInterface::simulateUserActivity()
 {
-    for (auto i : qAsConst(d->idleTimeouts)) {
-        i->simulateUserActivity();
-    }
+    d->userActivity();
 }
 
-IdleTimeoutInterface::IdleTimeoutInterface(SeatInterface *seat, IdleInterface *manager, wl_resource *resource)
+IdleTimeoutInterface::IdleTimeoutInterface(SeatInterface *seat, IdleInterfacePrivate *manager, wl_resource *resource)
     : QObject()
     , QtWaylandServer::org_kde_kwin_idle_timeout(resource)
-    , seat(seat)
     , manager(manager)
+    , seat(seat)
 {
-    connect(manager, &IdleInterface::inhibitedChanged, this, [this, manager] {
-        if (!timer) {
-            // not yet configured
-            return;
-        }
-        if (manager->isInhibited()) {
-            if (!timer->isActive()) {
-                send_resumed();
-            }
-            timer->stop();
-        } else {
-            timer->start();
-        }
-    });
 }
 
-IdleTimeoutInterface::~IdleTimeoutInterface() = default;
+IdleTimeoutInterface::~IdleTimeoutInterface()
+{
+    if (manager) {
+        manager->removeTimeout(this);
+    }
+}
 
 void IdleTimeoutInterface::org_kde_kwin_idle_timeout_release(Resource *resource)
 {
@@ -113,38 +209,51 @@ void IdleTimeoutInterface::org_kde_kwin_idle_timeout_simulate_user_activity(Reso
     Q_UNUSED(resource)
     simulateUserActivity();
 }
+
 void IdleTimeoutInterface::simulateUserActivity()
 {
-    if (!timer) {
+    if (!manager || !interval) {
         // not yet configured
         return;
     }
-    if (manager->isInhibited()) {
+    if (manager->inhibitCount > 0) {
         // ignored while inhibited
         return;
     }
-    if (!timer->isActive()) {
-        send_resumed();
+    lastActivity = manager->now();
+    if (idle) {
+        sendResumed();
     }
-    timer->start();
+    manager->reschedule();
+}
+
+qint64 IdleTimeoutInterface::deadline() const
+{
+    return qMax(lastActivity, manager->lastActivity) + interval;
+}
+
+void IdleTimeoutInterface::sendIdle()
+{
+    idle = true;
+    ++manager->idleCount;
+    send_idle();
+}
+
+void IdleTimeoutInterface::sendResumed()
+{
+    idle = false;
+    --manager->idleCount;
+    send_resumed();
 }
 
 void IdleTimeoutInterface::setup(quint32 timeout)
 {
-    if (timer) {
+    if (interval) {
         return;
     }
-    timer = new QTimer(this);
-    timer->setSingleShot(true);
     // less than 500 msec is not idle by definition
-    timer->setInterval(qMax(timeout, 500u));
-    QObject::connect(timer, &QTimer::timeout, this, [this] {
-        send_idle();
-    });
-    if (manager->isInhibited()) {
-        // don't start if inhibited
-        return;
-    }
-    timer->start();
+    interval = qMax(timeout, 500u);
+    lastActivity = manager->now();
+    manager->addTimeout(this);
 }
 }
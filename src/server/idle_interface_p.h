@@ -9,6 +9,7 @@
 
 #include <qwayland-server-idle.h>
 
+#include <QElapsedTimer>
 #include <QTimer>
 
 namespace KWaylandServer
@@ -16,17 +17,46 @@ namespace KWaylandServer
 class Display;
 class SeatInterface;
 class IdleTimeoutInterface;
-class IdleTimeoutInterface;
 
 class IdleInterfacePrivate : public QtWaylandServer::org_kde_kwin_idle
 {
 public:
     IdleInterfacePrivate(IdleInterface *_q, Display *display);
+    ~IdleInterfacePrivate() override;
+
+    /**
+     * Milliseconds on the monotonic clock the idle timeouts are measured with.
+     */
+    qint64 now() const;
+    /**
+     * Records user activity and resumes all idle timeouts.
+     */
+    void userActivity();
+    /**
+     * Sends idle to the timeouts whose deadline passed and arms the timer for the next one.
+     */
+    void checkTimeouts();
+    /**
+     * Arms the timer for the nearest deadline, unless it already fires earlier.
+     */
+    void reschedule();
+    void setInhibited(bool inhibited);
+    void addTimeout(IdleTimeoutInterface *timeout);
+    void removeTimeout(IdleTimeoutInterface *timeout);
 
     int inhibitCount = 0;
     QVector<IdleTimeoutInterface *> idleTimeouts;
     IdleInterface *q;
 
+    QElapsedTimer clock;
+    QTimer timer;
+    // when the user was last active, a timeout counts from here or its own last activity
+    qint64 lastActivity = 0;
+    // when the timer fires, if active
+    qint64 armedDeadline = 0;
+    // how many timeouts sent idle and wait for activity
+    int idleCount = 0;
+
 protected:
     void org_kde_kwin_idle_get_idle_timeout(Resource *resource, uint32_t id, wl_resource *seat, uint32_t timeout) override;
 };
@@ -35,15 +65,22 @@ class IdleTimeoutInterface : public QObject, QtWaylandServer::org_kde_kwin_idle_
 {
     Q_OBJECT
 public:
-    explicit IdleTimeoutInterface(SeatInterface *seat, IdleInterface *parent, wl_resource *resource);
+    explicit IdleTimeoutInterface(SeatInterface *seat, IdleInterfacePrivate *manager, wl_resource *resource);
     ~IdleTimeoutInterface() override;
     void setup(quint32 timeout);
     void simulateUserActivity();
+    qint64 deadline() const;
+    void sendIdle();
+    void sendResumed();
+
+    IdleInterfacePrivate *manager;
+    // 0 until set up
+    qint64 interval = 0;
+    qint64 lastActivity = 0;
+    bool idle = false;
 
 private:
     SeatInterface *seat;
-    IdleInterface *manager;
-    QTimer *timer = nullptr;
 
 protected:
     void org_kde_kwin_idle_timeout_destroy_resource(Resource *resource) override;
@@ -0,0 +1,274 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#include "inputeventring.h"
+#include "logging.h"
+
+#include <QtAlgorithms>
+#include <QtMath>
+
+#include <cerrno>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace KWaylandServer
+{
+static InputEvent makeEvent(InputEvent::Type type, std::chrono::microseconds time)
+{
+    InputEvent event;
+    event.type = type;
+    event.time = time;
+    return event;
+}
+
+InputEvent InputEvent::pointerMotion(std::chrono::microseconds time, const QPointF &pos)
+{
+    InputEvent event = makeEvent(Type::PointerMotion, time);
+    event.motion.x = pos.x();
+    event.motion.y = pos.y();
+    return event;
+}
+
+InputEvent InputEvent::pointerButton(std::chrono::microseconds time, quint32 button, PointerButtonState state)
+{
+    InputEvent event = makeEvent(Type::PointerButton, time);
+    event.button.button = button;
+    event.button.state = state;
+    return event;
+}
+
+InputEvent InputEvent::pointerAxis(std::chrono::microseconds time, Qt::Orientation orientation, qreal delta, qint32 discreteDelta, PointerAxisSource source)
+{
+    InputEvent event = makeEvent(Type::PointerAxis, time);
+    event.axis.orientation = orientation;
+    event.axis.delta = delta;
+    event.axis.discreteDelta = discreteDelta;
+    event.axis.source = source;
+    return event;
+}
+
+InputEvent InputEvent::pointerFrame(std::chrono::microseconds time)
+{
+    return makeEvent(Type::PointerFrame, time);
+}
+
+InputEvent InputEvent::keyboardKey(std::chrono::microseconds time, quint32 keyCode, KeyboardKeyState state)
+{
+    InputEvent event = makeEvent(Type::KeyboardKey, time);
+    event.key.keyCode = keyCode;
+    event.key.state = state;
+    return event;
+}
+
+InputEvent InputEvent::keyboardModifiers(std::chrono::microseconds time, quint32 depressed, quint32 latched, quint32 locked, quint32 group)
+{
+    InputEvent event = makeEvent(Type::KeyboardModifiers, time);
+    event.modifiers.depressed = depressed;
+    event.modifiers.latched = latched;
+    event.modifiers.locked = locked;
+    event.modifiers.group = group;
+    return event;
+}
+
+InputEvent InputEvent::touchDown(std::chrono::microseconds time, qint32 id, const QPointF &pos)
+{
+    InputEvent event = makeEvent(Type::TouchDown, time);
+    event.touch.id = id;
+    event.touch.x = pos.x();
+    event.touch.y = pos.y();
+    return event;
+}
+
+InputEvent InputEvent::touchUp(std::chrono::microseconds time, qint32 id)
+{
+    InputEvent event = makeEvent(Type::TouchUp, time);
+    event.touch.id = id;
+    event.touch.x = 0;
+    event.touch.y = 0;
+    return event;
+}
+
+InputEvent InputEvent::touchMotion(std::chrono::microseconds time, qint32 id, const QPointF &pos)
+{
+    InputEvent event = makeEvent(Type::TouchMotion, time);
+    event.touch.id = id;
+    event.touch.x = pos.x();
+    event.touch.y = pos.y();
+    return event;
+}
+
+InputEvent InputEvent::touchFrame(std::chrono::microseconds time)
+{
+    return makeEvent(Type::TouchFrame, time);
+}
+
+InputEvent InputEvent::touchCancel(std::chrono::microseconds time)
+{
+    return makeEvent(Type::TouchCancel, time);
+}
+
+InputEvent::Category InputEvent::category() const
+{
+    switch (type) {
+    case Type::PointerMotion:
+    case Type::PointerButton:
+    case Type::PointerAxis:
+    case Type::PointerFrame:
+        return Category::Pointer;
+    case Type::KeyboardKey:
+    case Type::KeyboardModifiers:
+        return Category::Keyboard;
+    case Type::TouchDown:
+    case Type::TouchUp:
+    case Type::TouchMotion:
+    case Type::TouchFrame:
+    case Type::TouchCancel:
+        return Category::Touch;
+    }
+    Q_UNREACHABLE();
+}
+
+QPointF InputEvent::position() const
+{
+    switch (type) {
+    case Type::PointerMotion:
+        return QPointF(motion.x, motion.y);
+    case Type::TouchDown:
+    case Type::TouchMotion:
+        return QPointF(touch.x, touch.y);
+    default:
+        return QPointF();
+    }
+}
+
+void InputLatencyHistogram::record(std::chrono::nanoseconds latency)
+{
+    const qint64 micros = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    int bucket = 0;
+    if (micros > 0) {
+        // 2^(n-1) <= micros < 2^n
+        bucket = qMin(64 - qCountLeadingZeroBits(quint64(micros)), BucketCount - 1);
+    }
+    ++m_buckets[bucket];
+    ++m_totalCount;
+    m_maximum = qMax(m_maximum, latency);
+}
+
+void InputLatencyHistogram::reset()
+{
+    m_buckets.fill(0);
+    m_totalCount = 0;
+    m_maximum = std::chrono::nanoseconds::zero();
+}
+
+quint64 InputLatencyHistogram::count(int bucket) const
+{
+    if (bucket < 0 || bucket >= BucketCount) {
+        return 0;
+    }
+    return m_buckets[bucket];
+}
+
+quint64 InputLatencyHistogram::totalCount() const
+{
+    return m_totalCount;
+}
+
+std::chrono::nanoseconds InputLatencyHistogram::maximum() const
+{
+    return m_maximum;
+}
+
+std::chrono::nanoseconds InputLatencyHistogram::percentile(qreal percentile) const
+{
+    if (m_totalCount == 0) {
+        return std::chrono::nanoseconds::zero();
+    }
+    const quint64 rank = qMax<quint64>(1, qCeil(qBound<qreal>(0, percentile, 1) * m_totalCount));
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < BucketCount - 1; ++bucket) {
+        seen += m_buckets[bucket];
+        if (seen >= rank) {
+            return upperBound(bucket);
+        }
+    }
+    return m_maximum;
+}
+
+std::chrono::nanoseconds InputLatencyHistogram::upperBound(int bucket)
+{
+    return std::chrono::microseconds(quint64(1) << qBound(0, bucket, BucketCount - 1));
+}
+
+InputEventRing::InputEventRing(int capacity)
+    : m_eventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+{
+    quint64 size = 1;
+    while (size < quint64(qMax(capacity, 1))) {
+        size <<= 1;
+    }
+    m_events.reset(new InputEvent[size]);
+    m_mask = size - 1;
+    if (m_eventFd == -1) {
+        qCWarning(KWAYLAND_SERVER, "Failed to create the eventfd of an input event ring: %s", strerror(errno));
+    }
+}
+
+InputEventRing::~InputEventRing()
+{
+    if (m_eventFd != -1) {
+        close(m_eventFd);
+    }
+}
+
+int InputEventRing::capacity() const
+{
+    return int(m_mask + 1);
+}
+
+bool InputEventRing::push(const InputEvent &event)
+{
+    const quint64 head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) > m_mask) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    m_events[head & m_mask] = event;
+    m_head.store(head + 1, std::memory_order_seq_cst);
+    // the consumer had caught up, it might be waiting for us
+    if (m_tail.load(std::memory_order_seq_cst) == head) {
+        wakeUp();
+    }
+    return true;
+}
+
+bool InputEventRing::isEmpty() const
+{
+    return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_relaxed);
+}
+
+quint64 InputEventRing::droppedCount() const
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+int InputEventRing::fileDescriptor() const
+{
+    return m_eventFd;
+}
+
+void InputEventRing::acknowledgeWakeUp()
+{
+    eventfd_t value;
+    eventfd_read(m_eventFd, &value);
+}
+
+void InputEventRing::wakeUp()
+{
+    eventfd_write(m_eventFd, 1);
+}
+
+}
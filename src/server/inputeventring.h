@@ -0,0 +1,253 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#pragma once
+
+#include <DWayland/Server/kwaylandserver_export.h>
+
+#include "seat_interface.h"
+
+#include <QPointF>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace KWaylandServer
+{
+/**
+ * An input event translated by the input thread, ready to be delivered by the SeatInterface.
+ *
+ * The event is a plain value which can be copied between threads without allocations. Use the
+ * static factory functions to create one.
+ */
+struct KWAYLANDSERVER_EXPORT InputEvent {
+    enum class Type : quint8 {
+        PointerMotion,
+        PointerButton,
+        PointerAxis,
+        PointerFrame,
+        KeyboardKey,
+        KeyboardModifiers,
+        TouchDown,
+        TouchUp,
+        TouchMotion,
+        TouchFrame,
+        TouchCancel,
+    };
+    /**
+     * The kind of device an event comes from, latencies are tracked per category.
+     */
+    enum class Category {
+        Pointer,
+        Keyboard,
+        Touch,
+    };
+
+    static InputEvent pointerMotion(std::chrono::microseconds time, const QPointF &pos);
+    static InputEvent pointerButton(std::chrono::microseconds time, quint32 button, PointerButtonState state);
+    static InputEvent pointerAxis(std::chrono::microseconds time, Qt::Orientation orientation, qreal delta, qint32 discreteDelta, PointerAxisSource source);
+    static InputEvent pointerFrame(std::chrono::microseconds time);
+    static InputEvent keyboardKey(std::chrono::microseconds time, quint32 keyCode, KeyboardKeyState state);
+    static InputEvent keyboardModifiers(std::chrono::microseconds time, quint32 depressed, quint32 latched, quint32 locked, quint32 group);
+    static InputEvent touchDown(std::chrono::microseconds time, qint32 id, const QPointF &pos);
+    static InputEvent touchUp(std::chrono::microseconds time, qint32 id);
+    static InputEvent touchMotion(std::chrono::microseconds time, qint32 id, const QPointF &pos);
+    static InputEvent touchFrame(std::chrono::microseconds time);
+    static InputEvent touchCancel(std::chrono::microseconds time);
+
+    Category category() const;
+    QPointF position() const;
+
+    Type type;
+    /**
+     * When the event happened on @c CLOCK_MONOTONIC, as reported by the device. Clients get it
+     * in milliseconds, and the delivery latency is measured from it.
+     */
+    std::chrono::microseconds time;
+    union {
+        struct {
+            qreal x;
+            qreal y;
+        } motion;
+        struct {
+            quint32 button;
+            PointerButtonState state;
+        } button;
+        struct {
+            Qt::Orientation orientation;
+            qreal delta;
+            qint32 discreteDelta;
+            PointerAxisSource source;
+        } axis;
+        struct {
+            quint32 keyCode;
+            KeyboardKeyState state;
+        } key;
+        struct {
+            quint32 depressed;
+            quint32 latched;
+            quint32 locked;
+            quint32 group;
+        } modifiers;
+        struct {
+            qint32 id;
+            qreal x;
+            qreal y;
+        } touch;
+    };
+};
+
+/**
+ * A histogram of input delivery latencies with power of two buckets.
+ *
+ * Bucket 0 counts latencies below 1 µs, bucket @c n latencies from 2^(n-1) µs up to, but not
+ * including, 2^n µs. The last bucket also takes everything longer.
+ */
+class KWAYLANDSERVER_EXPORT InputLatencyHistogram
+{
+public:
+    static constexpr int BucketCount = 24;
+
+    void record(std::chrono::nanoseconds latency);
+    void reset();
+
+    /**
+     * @returns how many latencies fell into @p bucket
+     */
+    quint64 count(int bucket) const;
+    /**
+     * @returns how many latencies were recorded
+     */
+    quint64 totalCount() const;
+    std::chrono::nanoseconds maximum() const;
+    /**
+     * @returns the upper bound of the bucket holding the @p percentile of all latencies, for
+     * instance 0.99 for the 99th percentile
+     */
+    std::chrono::nanoseconds percentile(qreal percentile) const;
+
+    /**
+     * @returns the exclusive upper bound of latencies in @p bucket
+     */
+    static std::chrono::nanoseconds upperBound(int bucket);
+
+private:
+    std::array<quint64, BucketCount> m_buckets = {};
+    quint64 m_totalCount = 0;
+    std::chrono::nanoseconds m_maximum = std::chrono::nanoseconds::zero();
+};
+
+/**
+ * @brief The InputEventRing class passes input events from an input thread to a SeatInterface.
+ *
+ * The ring is a fixed size, lock-free queue for exactly one producer thread and one consumer
+ * thread. The input thread translates the events of the devices, e.g. from libinput, and push()es
+ * them without locking or allocating. The SeatInterface the ring is installed on with
+ * SeatInterface::setInputEventRing() drains it in one batch at the start of each
+ * Display::dispatchEvents() and whenever the ring wakes it up.
+ *
+ * A push() to an empty ring makes fileDescriptor() readable so an idle event loop wakes up. The
+ * producer and the consumer keep their positions on separate cache lines, neither writes the
+ * cache line of the other.
+ *
+ * If the ring is full, push() drops the event and returns @c false.
+ *
+ * @code
+ * // input thread
+ * ring->push(InputEvent::pointerMotion(std::chrono::microseconds(libinput_event_pointer_get_time_usec(event)), pos));
+ * @endcode
+ */
+class KWAYLANDSERVER_EXPORT InputEventRing
+{
+public:
+    /**
+     * Creates a ring for at least @p capacity events, rounded up to a power of two.
+     */
+    explicit InputEventRing(int capacity = 1024);
+    ~InputEventRing();
+
+    int capacity() const;
+
+    /**
+     * Appends @p event. Must only be called from the producer thread.
+     *
+     * @returns @c false if the ring was full and the event was dropped
+     */
+    bool push(const InputEvent &event);
+
+    /**
+     * Passes the queued events in order to @p consumer, at most capacity() of them. Must only be
+     * called from the consumer thread.
+     *
+     * @returns the number of events passed to @p consumer
+     */
+    template<typename Consumer>
+    int drain(Consumer consumer);
+
+    /**
+     * @returns whether there are no queued events, only reliable on the consumer thread
+     */
+    bool isEmpty() const;
+
+    /**
+     * @returns how many events push() dropped because the ring was full
+     */
+    quint64 droppedCount() const;
+
+    /**
+     * The eventfd which becomes readable when events are pushed to an empty ring.
+     */
+    int fileDescriptor() const;
+    /**
+     * Clears the readable state of fileDescriptor(). Call it before drain() when woken up.
+     */
+    void acknowledgeWakeUp();
+
+private:
+    void wakeUp();
+
+    static constexpr std::size_t CacheLineSize = 64;
+
+    // written by the producer
+    alignas(CacheLineSize) std::atomic<quint64> m_head{0};
+    std::atomic<quint64> m_dropped{0};
+    // written by the consumer
+    alignas(CacheLineSize) std::atomic<quint64> m_tail{0};
+    // read-only after construction
+    alignas(CacheLineSize) std::unique_ptr<InputEvent[]> m_events;
+    quint64 m_mask;
+    int m_eventFd;
+
+    Q_DISABLE_COPY(InputEventRing)
+};
+
+template<typename Consumer>
+int InputEventRing::drain(Consumer consumer)
+{
+    const quint64 limit = m_mask + 1;
+    quint64 tail = m_tail.load(std::memory_order_relaxed);
+    quint64 head = m_head.load(std::memory_order_seq_cst);
+    quint64 count = 0;
+    while (tail != head && count < limit) {
+        do {
+            consumer(m_events[tail & m_mask]);
+            ++tail;
+            ++count;
+        } while (tail != head && count < limit);
+        // the producer compares against the tail after publishing an event, so either it
+        // sees the ring drained and wakes us up, or we see its event here
+        m_tail.store(tail, std::memory_order_seq_cst);
+        head = m_head.load(std::memory_order_seq_cst);
+    }
+    if (tail != head) {
+        // the producer won't wake us up for a ring which never ran empty
+        wakeUp();
+    }
+    return int(count);
+}
+
+}
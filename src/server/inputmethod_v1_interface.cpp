@@ -8,6 +8,7 @@
 #include "display.h"
 #include "keyboard_interface.h"
 #include "keyboard_interface_p.h"
+#include "keymapcache_p.h"
 #include "logging.h"
 #include "output_interface.h"
 #include "seat_interface.h"
@@ -15,9 +16,6 @@
 #include "surfacerole_p.h"
 
 #include <QHash>
-#include <QTemporaryFile>
-
-#include <unistd.h>
 
 #include "qwayland-server-input-method-unstable-v1.h"
 #include "qwayland-server-text-input-unstable-v1.h"
@@ -33,6 +31,8 @@ public:
     InputKeyboardV1InterfacePrivate()
     {
     }
+
+    QSharedPointer<KeymapFile> keymapFile;
 };
 
 InputMethodGrabV1::InputMethodGrabV1(QObject *parent)
@@ -47,47 +47,22 @@ InputMethodGrabV1::~InputMethodGrabV1()
 
 void InputMethodGrabV1::sendKeymap(const QByteArray &keymap)
 {
-    QScopedPointer<QTemporaryFile> tmp(new QTemporaryFile());
-    if (!tmp->open()) {
-        qCWarning(KWAYLAND_SERVER) << "Failed to create keymap file:" << tmp->errorString();
-        return;
-    }
-
-    unlink(tmp->fileName().toUtf8().constData());
-    if (!tmp->resize(keymap.size())) {
-        qCWarning(KWAYLAND_SERVER) << "Failed to resize keymap file:" << tmp->errorString();
-        return;
-    }
-
-    uchar *address = tmp->map(0, keymap.size());
-    if (!address) {
-        qCWarning(KWAYLAND_SERVER) << "Failed to map keymap file:" << tmp->errorString();
+    d->keymapFile = KeymapCache::self()->keymap(keymap);
+    if (!d->keymapFile) {
         return;
     }
 
-    qstrncpy(reinterpret_cast<char *>(address), keymap.constData(), keymap.size() + 1);
-    tmp->unmap(address);
-
-    const auto resources = d->resourceMap();
-    for (auto r : resources) {
-        d->send_keymap(r->handle, QtWaylandServer::wl_keyboard::keymap_format::keymap_format_xkb_v1, tmp->handle(), tmp->size());
-    }
+    d->broadcast_keymap(QtWaylandServer::wl_keyboard::keymap_format::keymap_format_xkb_v1, d->keymapFile->fd(), d->keymapFile->size());
 }
 
 void InputMethodGrabV1::sendKey(quint32 serial, quint32 timestamp, quint32 key, KeyboardKeyState state)
 {
-    const auto resources = d->resourceMap();
-    for (auto r : resources) {
-        d->send_key(r->handle, serial, timestamp, key, quint32(state));
-    }
+    d->broadcast_key(serial, timestamp, key, quint32(state));
 }
 
 void InputMethodGrabV1::sendModifiers(quint32 serial, quint32 depressed, quint32 latched, quint32 locked, quint32 group)
 {
-    const auto resources = d->resourceMap();
-    for (auto r : resources) {
-        d->send_modifiers(r->handle, serial, depressed, latched, locked, group);
-    }
+    d->broadcast_modifiers(serial, depressed, latched, locked, group);
 }
 
 class InputMethodContextV1InterfacePrivate : public QtWaylandServer::zwp_input_method_context_v1
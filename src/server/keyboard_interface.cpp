@@ -5,16 +5,14 @@
 */
 #include "display.h"
 #include "keyboard_interface_p.h"
+#include "keymapcache_p.h"
 #include "logging.h"
 #include "seat_interface.h"
 #include "seat_interface_p.h"
 #include "surface_interface.h"
 // Qt
-#include <QTemporaryFile>
 #include <QVector>
 
-#include <unistd.h>
-
 namespace KWaylandServer
 {
 KeyboardInterfacePrivate::KeyboardInterfacePrivate(SeatInterface *s)
@@ -48,17 +46,14 @@ void KeyboardInterfacePrivate::keyboard_bind_resource(Resource *resource)
     }
 }
 
-QList<KeyboardInterfacePrivate::Resource *> KeyboardInterfacePrivate::keyboardsForClient(ClientConnection *client) const
+KeyboardInterfacePrivate::ResourceRange KeyboardInterfacePrivate::keyboardsForClient(ClientConnection *client) const
 {
-    return resourceMap().values(client->client());
+    return resourceMap().resources(client->client());
 }
 
 void KeyboardInterfacePrivate::sendLeave(SurfaceInterface *surface, quint32 serial)
 {
-    const QList<Resource *> keyboards = keyboardsForClient(surface->client());
-    for (Resource *keyboardResource : keyboards) {
-        send_leave(keyboardResource->handle, serial, surface->resource());
-    }
+    broadcast_leave(keyboardsForClient(surface->client()), serial, surface->resource());
 }
 
 void KeyboardInterfacePrivate::sendEnter(SurfaceInterface *surface, quint32 serial)
@@ -66,36 +61,15 @@ void KeyboardInterfacePrivate::sendEnter(SurfaceInterface *surface, quint32 seri
     const auto states = pressedKeys();
     QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char *>(states.constData()), sizeof(quint32) * states.size());
 
-    const QList<Resource *> keyboards = keyboardsForClient(surface->client());
-    for (Resource *keyboardResource : keyboards) {
-        send_enter(keyboardResource->handle, serial, surface->resource(), data);
-    }
+    broadcast_enter(keyboardsForClient(surface->client()), serial, surface->resource(), data);
 }
 
 void KeyboardInterfacePrivate::sendKeymap(Resource *resource)
 {
-    QScopedPointer<QTemporaryFile> tmp(new QTemporaryFile());
-    if (!tmp->open()) {
-        qCWarning(KWAYLAND_SERVER) << "Failed to create keymap file:" << tmp->errorString();
-        return;
-    }
-
-    unlink(tmp->fileName().toUtf8().constData());
-    if (!tmp->resize(keymap.size())) {
-        qCWarning(KWAYLAND_SERVER) << "Failed to resize keymap file:" << tmp->errorString();
+    if (!keymapFile) {
         return;
     }
-
-    uchar *address = tmp->map(0, keymap.size());
-    if (!address) {
-        qCWarning(KWAYLAND_SERVER) << "Failed to map keymap file:" << tmp->errorString();
-        return;
-    }
-
-    qstrncpy(reinterpret_cast<char *>(address), keymap.constData(), keymap.size() + 1);
-    tmp->unmap(address);
-
-    send_keymap(resource->handle, keymap_format::keymap_format_xkb_v1, tmp->handle(), tmp->size());
+    send_keymap(resource->handle, keymap_format::keymap_format_xkb_v1, keymapFile->fd(), keymapFile->size());
 }
 
 void KeyboardInterface::setKeymap(const QByteArray &content)
@@ -105,6 +79,10 @@ void KeyboardInterface::setKeymap(const QByteArray &content)
     }
 
     d->keymap = content;
+    d->keymapFile = KeymapCache::self()->keymap(content);
+    if (!d->keymapFile) {
+        return;
+    }
 
     const auto keyboardResources = d->resourceMap();
     for (KeyboardInterfacePrivate::Resource *resource : keyboardResources) {
@@ -112,12 +90,14 @@ void KeyboardInterface::setKeymap(const QByteArray &content)
     }
 }
 
+quint64 KeyboardInterface::keymapBytesWritten()
+{
+    return KeymapCache::self()->bytesWritten();
+}
+
 void KeyboardInterfacePrivate::sendModifiers(quint32 depressed, quint32 latched, quint32 locked, quint32 group, quint32 serial)
 {
-    const QList<Resource *> keyboards = keyboardsForClient(focusedSurface->client());
-    for (Resource *keyboardResource : keyboards) {
-        send_modifiers(keyboardResource->handle, serial, depressed, latched, locked, group);
-    }
+    broadcast_modifiers(keyboardsForClient(focusedSurface->client()), serial, depressed, latched, locked, group);
 }
 
 bool KeyboardInterfacePrivate::updateKey(quint32 key, KeyboardKeyState state)
@@ -191,11 +171,8 @@ void KeyboardInterface::sendKey(quint32 key, KeyboardKeyState state)
         return;
     }
 
-    const QList<KeyboardInterfacePrivate::Resource *> keyboards = d->keyboardsForClient(d->focusedSurface->client());
     const quint32 serial = d->seat->display()->nextSerial();
-    for (KeyboardInterfacePrivate::Resource *keyboardResource : keyboards) {
-        d->send_key(keyboardResource->handle, serial, d->seat->timestamp(), key, quint32(state));
-    }
+    d->broadcast_key(d->keyboardsForClient(d->focusedSurface->client()), serial, d->seat->timestamp(), key, quint32(state));
 }
 
 void KeyboardInterface::sendModifiers(quint32 depressed, quint32 latched, quint32 locked, quint32 group)
@@ -226,12 +203,7 @@ void KeyboardInterface::setRepeatInfo(qint32 charactersPerSecond, qint32 delay)
 {
     d->keyRepeat.charactersPerSecond = qMax(charactersPerSecond, 0);
     d->keyRepeat.delay = qMax(delay, 0);
-    const QList<KeyboardInterfacePrivate::Resource *> keyboards = d->resourceMap().values();
-    for (KeyboardInterfacePrivate::Resource *keyboardResource : keyboards) {
-        if (keyboardResource->version() >= WL_KEYBOARD_REPEAT_INFO_SINCE_VERSION) {
-            d->send_repeat_info(keyboardResource->handle, d->keyRepeat.charactersPerSecond, d->keyRepeat.delay);
-        }
-    }
+    d->broadcast_repeat_info(d->keyRepeat.charactersPerSecond, d->keyRepeat.delay);
 }
 
 SurfaceInterface *KeyboardInterface::focusedSurface() const
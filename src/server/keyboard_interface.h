@@ -39,7 +39,20 @@ public:
      * @returns The delay on key press before starting repeating keys
      */
     qint32 keyRepeatDelay() const;
+    /**
+     * Sets the keymap forwarded to all bound keyboards.
+     *
+     * Keymaps are shared through a process wide cache: every keyboard resource, on
+     * every seat, gets the same sealed read-only file for the same @p content.
+     */
     void setKeymap(const QByteArray &content);
+    /**
+     * @returns The total number of keymap bytes written into shared keymap files.
+     *
+     * This only grows when a keymap with new content is set, rebinding keyboards or
+     * setting an already cached keymap again does not write anything.
+     */
+    static quint64 keymapBytesWritten();
 
     /**
      * Sets the key repeat information to be forwarded to all bound keyboards.
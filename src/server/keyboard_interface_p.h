@@ -11,10 +11,12 @@
 
 #include <QHash>
 #include <QPointer>
+#include <QSharedPointer>
 
 namespace KWaylandServer
 {
 class ClientConnection;
+class KeymapFile;
 
 class KeyboardInterfacePrivate : public QtWaylandServer::wl_keyboard
 {
@@ -25,7 +27,7 @@ public:
     void sendModifiers();
     void sendModifiers(quint32 depressed, quint32 latched, quint32 locked, quint32 group, quint32 serial);
 
-    QList<Resource *> keyboardsForClient(ClientConnection *client) const;
+    ResourceRange keyboardsForClient(ClientConnection *client) const;
     void sendLeave(SurfaceInterface *surface, quint32 serial);
     void sendEnter(SurfaceInterface *surface, quint32 serial);
 
@@ -38,6 +40,7 @@ public:
     SurfaceInterface *focusedSurface = nullptr;
     QMetaObject::Connection destroyConnection;
     QByteArray keymap;
+    QSharedPointer<KeymapFile> keymapFile;
 
     struct {
         qint32 charactersPerSecond = 0;
@@ -0,0 +1,149 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#include "keymapcache_p.h"
+#include "logging.h"
+
+#include <QMutexLocker>
+#include <QTemporaryFile>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace KWaylandServer
+{
+Q_GLOBAL_STATIC(KeymapCache, s_keymapCache)
+
+static bool writeAll(int fd, const QByteArray &content)
+{
+    const char *data = content.constData();
+    qint64 remaining = content.size();
+    while (remaining > 0) {
+        const ssize_t written = ::write(fd, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        remaining -= written;
+    }
+    return true;
+}
+
+static int createSealedFile(const QByteArray &content)
+{
+#if defined(MFD_CLOEXEC) && defined(MFD_ALLOW_SEALING) && defined(F_ADD_SEALS)
+    const int fd = memfd_create("dwayland-keymap", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) {
+        return -1;
+    }
+    if (!writeAll(fd, content)) {
+        qCWarning(KWAYLAND_SERVER) << "Failed to write keymap file:" << strerror(errno);
+        close(fd);
+        return -1;
+    }
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+        qCWarning(KWAYLAND_SERVER) << "Failed to seal keymap file:" << strerror(errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    Q_UNUSED(content)
+    return -1;
+#endif
+}
+
+static int createTemporaryFile(const QByteArray &content)
+{
+    QTemporaryFile tmp;
+    if (!tmp.open()) {
+        qCWarning(KWAYLAND_SERVER) << "Failed to create keymap file:" << tmp.errorString();
+        return -1;
+    }
+    unlink(tmp.fileName().toUtf8().constData());
+    tmp.setAutoRemove(false);
+
+    if (!writeAll(tmp.handle(), content)) {
+        qCWarning(KWAYLAND_SERVER) << "Failed to write keymap file:" << strerror(errno);
+        return -1;
+    }
+    // QTemporaryFile closes its descriptor on destruction, keep our own
+    return fcntl(tmp.handle(), F_DUPFD_CLOEXEC, 0);
+}
+
+KeymapFile::KeymapFile(int fd, quint32 size, bool sealed)
+    : m_fd(fd)
+    , m_size(size)
+    , m_sealed(sealed)
+{
+}
+
+KeymapFile::~KeymapFile()
+{
+    close(m_fd);
+}
+
+KeymapCache *KeymapCache::self()
+{
+    return s_keymapCache;
+}
+
+QSharedPointer<KeymapFile> KeymapCache::keymap(const QByteArray &content)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_files.find(content);
+    if (it != m_files.end()) {
+        if (QSharedPointer<KeymapFile> file = it.value().toStrongRef()) {
+            return file;
+        }
+        m_files.erase(it);
+    }
+
+    // drop the entries of keymaps no keyboard references any longer
+    for (auto it = m_files.begin(); it != m_files.end();) {
+        if (it.value().isNull()) {
+            it = m_files.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    QSharedPointer<KeymapFile> file = createKeymap(content);
+    if (file) {
+        m_files.insert(content, file);
+    }
+    return file;
+}
+
+QSharedPointer<KeymapFile> KeymapCache::createKeymap(const QByteArray &content)
+{
+    bool sealed = true;
+    int fd = createSealedFile(content);
+    if (fd == -1) {
+        sealed = false;
+        fd = createTemporaryFile(content);
+    }
+    if (fd == -1) {
+        return QSharedPointer<KeymapFile>();
+    }
+
+    m_bytesWritten += content.size();
+    return QSharedPointer<KeymapFile>(new KeymapFile(fd, content.size(), sealed));
+}
+
+quint64 KeymapCache::bytesWritten() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytesWritten;
+}
+
+}
@@ -0,0 +1,82 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+
+namespace KWaylandServer
+{
+/**
+ * A read-only shared memory file holding the content of one keymap.
+ *
+ * The file is created once and then handed out to every keyboard resource,
+ * libwayland duplicates the file descriptor when marshalling the keymap event.
+ * Where supported the file is a memfd sealed against writes, shrinking and growing,
+ * so no client can modify the keymap seen by other clients.
+ */
+class KeymapFile
+{
+public:
+    ~KeymapFile();
+
+    int fd() const
+    {
+        return m_fd;
+    }
+    quint32 size() const
+    {
+        return m_size;
+    }
+    bool isSealed() const
+    {
+        return m_sealed;
+    }
+
+private:
+    KeymapFile(int fd, quint32 size, bool sealed);
+    friend class KeymapCache;
+
+    int m_fd;
+    quint32 m_size;
+    bool m_sealed;
+
+    Q_DISABLE_COPY(KeymapFile)
+};
+
+/**
+ * Process wide cache of keymap files keyed by keymap content.
+ *
+ * A keymap file lives as long as a keyboard still references it, switching
+ * back and forth between layouts reuses the file as long as it is alive.
+ */
+class KeymapCache
+{
+public:
+    static KeymapCache *self();
+
+    /**
+     * Returns the keymap file for @p content, creating it if needed.
+     * Returns a null pointer if the file could not be created.
+     */
+    QSharedPointer<KeymapFile> keymap(const QByteArray &content);
+
+    /**
+     * The total number of keymap bytes written into keymap files so far.
+     */
+    quint64 bytesWritten() const;
+
+private:
+    QSharedPointer<KeymapFile> createKeymap(const QByteArray &content);
+
+    mutable QMutex m_mutex;
+    QHash<QByteArray, QWeakPointer<KeymapFile>> m_files;
+    quint64 m_bytesWritten = 0;
+};
+
+}
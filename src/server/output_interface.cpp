@@ -371,7 +371,7 @@ bool OutputInterface::isDpmsSupported() const
 
 QVector<wl_resource *> OutputInterface::clientResources(ClientConnection *client) const
 {
-    const auto outputResources = d->resourceMap().values(client->client());
+    const auto outputResources = d->resourceMap().resources(client->client());
     QVector<wl_resource *> ret;
     ret.reserve(outputResources.count());
 
@@ -392,10 +392,7 @@ bool OutputInterface::isEnabled() const
 
 void OutputInterface::done()
 {
-    const auto outputResources = d->resourceMap();
-    for (OutputInterfacePrivate::Resource *resource : outputResources) {
-        d->sendDone(resource);
-    }
+    d->broadcast_done();
 }
 
 void OutputInterface::done(wl_client *client)
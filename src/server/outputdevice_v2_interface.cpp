@@ -719,10 +719,7 @@ OutputDeviceModeV2Interface::~OutputDeviceModeV2Interface() = default;
 
 OutputDeviceModeV2InterfacePrivate::~OutputDeviceModeV2InterfacePrivate()
 {
-    const auto map = resourceMap();
-    for (Resource *resource : map) {
-        send_removed(resource->handle);
-    }
+    broadcast_removed();
 }
 
 OutputDeviceModeV2InterfacePrivate::Resource *OutputDeviceModeV2InterfacePrivate::createResource(OutputDeviceV2InterfacePrivate::Resource *output)
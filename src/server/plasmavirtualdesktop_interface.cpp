@@ -7,6 +7,7 @@
 #include "display.h"
 
 #include <QDebug>
+#include <QHash>
 #include <QTimer>
 
 #include <qwayland-server-org-kde-plasma-virtual-desktop.h>
@@ -40,13 +41,12 @@ public:
     PlasmaVirtualDesktopManagementInterfacePrivate(PlasmaVirtualDesktopManagementInterface *_q, Display *display);
 
     QList<PlasmaVirtualDesktopInterface *> desktops;
+    // the desktops by id, windows look them up on every enter
+    QHash<QString, PlasmaVirtualDesktopInterface *> desktopsById;
     quint32 rows = 0;
     quint32 columns = 0;
     PlasmaVirtualDesktopManagementInterface *q;
 
-    inline QList<PlasmaVirtualDesktopInterface *>::const_iterator constFindDesktop(const QString &id);
-    inline QList<PlasmaVirtualDesktopInterface *>::iterator findDesktop(const QString &id);
-
 protected:
     void org_kde_plasma_virtual_desktop_management_get_virtual_desktop(Resource *resource, uint32_t id, const QString &desktop_id) override;
     void org_kde_plasma_virtual_desktop_management_request_create_virtual_desktop(Resource *resource, const QString &name, uint32_t position) override;
@@ -54,30 +54,16 @@ protected:
     void org_kde_plasma_virtual_desktop_management_bind_resource(Resource *resource) override;
 };
 
-inline QList<PlasmaVirtualDesktopInterface *>::const_iterator PlasmaVirtualDesktopManagementInterfacePrivate::constFindDesktop(const QString &id)
-{
-    return std::find_if(desktops.constBegin(), desktops.constEnd(), [id](const PlasmaVirtualDesktopInterface *desk) {
-        return desk->id() == id;
-    });
-}
-
-inline QList<PlasmaVirtualDesktopInterface *>::iterator PlasmaVirtualDesktopManagementInterfacePrivate::findDesktop(const QString &id)
-{
-    return std::find_if(desktops.begin(), desktops.end(), [id](const PlasmaVirtualDesktopInterface *desk) {
-        return desk->id() == id;
-    });
-}
-
 void PlasmaVirtualDesktopManagementInterfacePrivate::org_kde_plasma_virtual_desktop_management_get_virtual_desktop(Resource *resource,
                                                                                                                    uint32_t id,
                                                                                                                    const QString &desktop_id)
 {
-    auto i = constFindDesktop(desktop_id);
-    if (i == desktops.constEnd()) {
+    PlasmaVirtualDesktopInterface *desktop = desktopsById.value(desktop_id);
+    if (!desktop) {
         return;
     }
 
-    (*i)->d->add(resource->client(), id, resource->version());
+    desktop->d->add(resource->client(), id, resource->version());
 }
 
 void PlasmaVirtualDesktopManagementInterfacePrivate::org_kde_plasma_virtual_desktop_management_request_create_virtual_desktop(Resource *resource,
@@ -134,29 +120,18 @@ void PlasmaVirtualDesktopManagementInterface::setRows(quint32 rows)
 
     d->rows = rows;
 
-    const auto clientResources = d->resourceMap();
-    for (auto resource : clientResources) {
-        if (resource->version() < ORG_KDE_PLASMA_VIRTUAL_DESKTOP_MANAGEMENT_ROWS_SINCE_VERSION) {
-            continue;
-        }
-        d->send_rows(resource->handle, rows);
-    }
+    d->broadcast_rows(rows);
 }
 
 PlasmaVirtualDesktopInterface *PlasmaVirtualDesktopManagementInterface::desktop(const QString &id)
 {
-    auto i = d->constFindDesktop(id);
-    if (i != d->desktops.constEnd()) {
-        return *i;
-    }
-    return nullptr;
+    return d->desktopsById.value(id);
 }
 
 PlasmaVirtualDesktopInterface *PlasmaVirtualDesktopManagementInterface::createDesktop(const QString &id, quint32 position)
 {
-    auto i = d->constFindDesktop(id);
-    if (i != d->desktops.constEnd()) {
-        return *i;
+    if (PlasmaVirtualDesktopInterface *existing = d->desktopsById.value(id)) {
+        return existing;
     }
 
     const quint32 actualPosition = qMin(position, (quint32)d->desktops.count());
@@ -164,10 +139,7 @@ PlasmaVirtualDesktopInterface *PlasmaVirtualDesktopManagementInterface::createDe
     auto desktop = new PlasmaVirtualDesktopInterface(this);
     desktop->d->id = id;
 
-    const auto desktopClientResources = desktop->d->resourceMap();
-    for (auto resource : desktopClientResources) {
-        desktop->d->send_desktop_id(resource->handle, id);
-    }
+    desktop->d->broadcast_desktop_id(id);
 
     // activate the first desktop TODO: to be done here?
     if (d->desktops.isEmpty()) {
@@ -175,34 +147,26 @@ PlasmaVirtualDesktopInterface *PlasmaVirtualDesktopManagementInterface::createDe
     }
 
     d->desktops.insert(actualPosition, desktop);
+    d->desktopsById.insert(id, desktop);
 
-    const auto clientResources = d->resourceMap();
-    for (auto resource : clientResources) {
-        d->send_desktop_created(resource->handle, id, actualPosition);
-    }
+    d->broadcast_desktop_created(id, actualPosition);
 
     return desktop;
 }
 
 void PlasmaVirtualDesktopManagementInterface::removeDesktop(const QString &id)
 {
-    auto deskIt = d->findDesktop(id);
-    if (deskIt == d->desktops.end()) {
+    PlasmaVirtualDesktopInterface *desktop = d->desktopsById.take(id);
+    if (!desktop) {
         return;
     }
 
-    const auto desktopClientResources = (*deskIt)->d->resourceMap();
-    for (auto resource : desktopClientResources) {
-        (*deskIt)->d->send_removed(resource->handle);
-    }
+    desktop->d->broadcast_removed();
 
-    const auto clientResources = d->resourceMap();
-    for (auto resource : clientResources) {
-        d->send_desktop_removed(resource->handle, id);
-    }
+    d->broadcast_desktop_removed(id);
 
-    (*deskIt)->deleteLater();
-    d->desktops.erase(deskIt);
+    desktop->deleteLater();
+    d->desktops.removeOne(desktop);
 }
 
 QList<PlasmaVirtualDesktopInterface *> PlasmaVirtualDesktopManagementInterface::desktops() const
@@ -212,10 +176,7 @@ QList<PlasmaVirtualDesktopInterface *> PlasmaVirtualDesktopManagementInterface::
 
 void PlasmaVirtualDesktopManagementInterface::sendDone()
 {
-    const auto clientResources = d->resourceMap();
-    for (auto resource : clientResources) {
-        d->send_done(resource->handle);
-    }
+    d->broadcast_done();
 }
 
 //// PlasmaVirtualDesktopInterface
@@ -279,10 +240,7 @@ void PlasmaVirtualDesktopInterface::setName(const QString &name)
 
     d->name = name;
 
-    const auto clientResources = d->resourceMap();
-    for (auto resource : clientResources) {
-        d->send_name(resource->handle, name);
-    }
+    d->broadcast_name(name);
 }
 
 QString PlasmaVirtualDesktopInterface::name() const
@@ -317,10 +275,7 @@ bool PlasmaVirtualDesktopInterface::isActive() const
 
 void PlasmaVirtualDesktopInterface::sendDone()
 {
-    const auto clientResources = d->resourceMap();
-    for (auto resource : clientResources) {
-        d->send_done(resource->handle);
-    }
+    d->broadcast_done();
 }
 
 }
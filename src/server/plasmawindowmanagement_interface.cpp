@@ -9,22 +9,204 @@
 #include "plasmavirtualdesktop_interface.h"
 #include "surface_interface.h"
 
+#include <QCache>
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QFile>
+#include <QFutureWatcher>
 #include <QHash>
 #include <QIcon>
 #include <QList>
+#include <QMutexLocker>
 #include <QRect>
+#include <QSet>
+#include <QThreadPool>
 #include <QUuid>
 #include <QVector>
 #include <QtConcurrentRun>
 
+#include <qwayland-server-com-deepin-stacking-order.h>
+#include <qwayland-server-com-deepin-window-icons.h>
 #include <qwayland-server-plasma-window-management.h>
 
+#include <algorithm>
+#include <utility>
+
 namespace KWaylandServer
 {
 static const quint32 s_version = 14;
+static const quint32 s_stackingOrderVersion = 1;
+static const quint32 s_windowIconsVersion = 1;
 static const quint32 s_activationVersion = 1;
 
+/**
+ * The serialized icons of all windows. An icon is serialized once no matter how many clients
+ * fetch it, and icons with the same content share their data.
+ */
+class PlasmaWindowIconCache
+{
+public:
+    PlasmaWindowIconCache();
+
+    QThreadPool *threadPool()
+    {
+        return &m_threadPool;
+    }
+    /**
+     * Returns @p icon serialized with only the given @p sizes, or all of them if @p sizes is empty,
+     * and its content hash in @p hash. Safe to call from any thread.
+     */
+    QByteArray serialize(const QIcon &icon, const QList<QSize> &sizes, QByteArray *hash = nullptr);
+    /**
+     * Returns the content hash of @p icon with @p sizes if it was serialized before.
+     */
+    QByteArray hash(const QIcon &icon, const QList<QSize> &sizes);
+    /**
+     * Returns the data with the content @p hash, or a null QByteArray if it is not cached.
+     */
+    QByteArray contents(const QByteArray &hash);
+
+private:
+    QMutex m_mutex;
+    // the content hash of each serialized icon and list of sizes
+    QHash<QByteArray, QByteArray> m_hashes;
+    // the data of each content hash
+    QCache<QByteArray, QByteArray> m_contents;
+    QThreadPool m_threadPool;
+};
+
+Q_GLOBAL_STATIC(PlasmaWindowIconCache, s_iconCache)
+
+PlasmaWindowIconCache::PlasmaWindowIconCache()
+    // in bytes
+    : m_contents(16 << 20)
+{
+    // transfers are I/O bound, don't let a task manager fetching all icons at once occupy the global pool
+    m_threadPool.setMaxThreadCount(2);
+}
+
+static QByteArray iconKey(const QIcon &icon, const QList<QSize> &sizes)
+{
+    QByteArray key = QByteArray::number(icon.cacheKey());
+    for (const QSize &size : sizes) {
+        key += ' ' + QByteArray::number(size.width()) + 'x' + QByteArray::number(size.height());
+    }
+    return key;
+}
+
+QByteArray PlasmaWindowIconCache::serialize(const QIcon &icon, const QList<QSize> &sizes, QByteArray *hash)
+{
+    const QByteArray key = iconKey(icon, sizes);
+    {
+        QMutexLocker locker(&m_mutex);
+        const QByteArray known = m_hashes.value(key);
+        if (const QByteArray *data = m_contents.object(known)) {
+            if (hash) {
+                *hash = known;
+            }
+            return *data;
+        }
+    }
+
+    QIcon trimmed;
+    if (sizes.isEmpty()) {
+        trimmed = icon;
+    } else {
+        for (const QSize &size : sizes) {
+            trimmed.addPixmap(icon.pixmap(size));
+        }
+    }
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << trimmed;
+    const QByteArray contentHash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    if (hash) {
+        *hash = contentHash;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (m_hashes.size() > 4 * m_contents.count() + 256) {
+        // drop the keys of icons which went away with their contents
+        for (auto it = m_hashes.begin(); it != m_hashes.end();) {
+            it = m_contents.contains(it.value()) ? std::next(it) : m_hashes.erase(it);
+        }
+    }
+    m_hashes.insert(key, contentHash);
+    if (const QByteArray *existing = m_contents.object(contentHash)) {
+        return *existing;
+    }
+    m_contents.insert(contentHash, new QByteArray(data), data.size());
+    return data;
+}
+
+QByteArray PlasmaWindowIconCache::hash(const QIcon &icon, const QList<QSize> &sizes)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hashes.value(iconKey(icon, sizes));
+}
+
+QByteArray PlasmaWindowIconCache::contents(const QByteArray &hash)
+{
+    QMutexLocker locker(&m_mutex);
+    if (const QByteArray *data = m_contents.object(hash)) {
+        return *data;
+    }
+    return QByteArray();
+}
+
+class PlasmaWindowManagementInterfacePrivate;
+
+/**
+ * Sends the stacking order as moves of single windows to the clients which bound
+ * com_deepin_stacking_order, instead of the full order on every restack.
+ */
+class PlasmaStackingOrderInterfacePrivate : public QtWaylandServer::com_deepin_stacking_order
+{
+public:
+    PlasmaStackingOrderInterfacePrivate(PlasmaWindowManagementInterfacePrivate *wm, Display *display);
+
+    bool isBound(wl_client *client) const;
+    void sendStackingOrderChanged(const QVector<QString> &previous);
+
+    PlasmaWindowManagementInterfacePrivate *wm;
+
+protected:
+    void com_deepin_stacking_order_bind_resource(Resource *resource) override;
+    void com_deepin_stacking_order_destroy_resource(Resource *resource) override;
+    void com_deepin_stacking_order_destroy(Resource *resource) override;
+};
+
+/**
+ * Announces the window icons by their content hash to the clients which bound
+ * com_deepin_window_icons, so each client transfers an icon shared by several
+ * windows only once.
+ */
+class PlasmaWindowIconsInterfacePrivate : public QtWaylandServer::com_deepin_window_icons
+{
+public:
+    PlasmaWindowIconsInterfacePrivate(PlasmaWindowManagementInterfacePrivate *wm, Display *display);
+
+    bool isBound(wl_client *client) const;
+    /**
+     * Sends the icon hash of @p window to all bound clients, or only to @p resource.
+     */
+    void sendIconChanged(PlasmaWindowInterface *window, Resource *resource = nullptr);
+
+    PlasmaWindowManagementInterfacePrivate *wm;
+    // the sizes requested by each client, the ones of the PlasmaWindowManagementInterface otherwise
+    QHash<Resource *, QList<QSize>> iconSizes;
+
+protected:
+    void com_deepin_window_icons_bind_resource(Resource *resource) override;
+    void com_deepin_window_icons_destroy_resource(Resource *resource) override;
+    void com_deepin_window_icons_destroy(Resource *resource) override;
+    void com_deepin_window_icons_set_icon_sizes(Resource *resource, wl_array *sizes) override;
+    void com_deepin_window_icons_get_icon(Resource *resource, const QString &hash, int32_t fd) override;
+
+private:
+    QList<QSize> sizesFor(Resource *resource) const;
+};
+
 class PlasmaWindowManagementInterfacePrivate : public QtWaylandServer::org_kde_plasma_window_management
 {
 public:
@@ -32,9 +214,11 @@ public:
     void sendShowingDesktopState();
     void sendShowingDesktopState(wl_resource *resource);
     void sendStackingOrderChanged();
-    void sendStackingOrderChanged(wl_resource *resource);
+    void sendStackingOrderChanged(wl_resource *resource, const QByteArray &ids);
     void sendStackingOrderUuidsChanged();
     void sendStackingOrderUuidsChanged(wl_resource *resource);
+    void setStackingOrderUuids(const QVector<QString> &uuids);
+    void scheduleCommit(PlasmaWindowInterface *window);
 
     PlasmaWindowManagementInterface::ShowingDesktopState state = PlasmaWindowManagementInterface::ShowingDesktopState::Disabled;
     QList<PlasmaWindowInterface *> windows;
@@ -42,6 +226,15 @@ public:
     quint32 windowIdCounter = 0;
     QVector<quint32> stackingOrder;
     QVector<QString> stackingOrderUuids;
+    // the ';' separated uuids, encoded once per change for all clients
+    QString encodedStackingOrderUuids;
+    QScopedPointer<PlasmaStackingOrderInterfacePrivate> stackingOrderDeltas;
+    QScopedPointer<PlasmaWindowIconsInterfacePrivate> windowIcons;
+    QList<QSize> iconSizes;
+    // windows with property changes waiting for the next commit
+    QVector<PlasmaWindowInterface *> pendingWindows;
+    bool batchingEnabled = false;
+    bool commitScheduled = false;
     PlasmaWindowManagementInterface *q;
 
 protected:
@@ -68,8 +261,27 @@ public:
     void setGeometry(const QRect &geometry);
     void setApplicationMenuPaths(const QString &service, const QString &object);
     void setWindowId(quint32 winid);
+    void enterPlasmaVirtualDesktop(PlasmaVirtualDesktopInterface *desktop);
+    void leavePlasmaVirtualDesktop(const QString &id);
     wl_resource *resourceForParent(PlasmaWindowInterface *parent, Resource *child) const;
 
+    enum Property {
+        TitleProperty = 1 << 0,
+        AppIdProperty = 1 << 1,
+        PidProperty = 1 << 2,
+        ThemedIconNameProperty = 1 << 3,
+        IconProperty = 1 << 4,
+        StateProperty = 1 << 5,
+        ParentWindowProperty = 1 << 6,
+        GeometryProperty = 1 << 7,
+        ApplicationMenuProperty = 1 << 8,
+    };
+    /**
+     * Sends @p property right away, or with the next commit if batching is enabled.
+     */
+    void propertyChanged(Property property);
+    void sendPendingChanges();
+
     quint32 windowId = 0;
     QHash<SurfaceInterface *, QRect> minimizedGeometries;
     PlasmaWindowManagementInterface *wm;
@@ -78,6 +290,8 @@ public:
     PlasmaWindowInterface *parentWindow = nullptr;
     QMetaObject::Connection parentWindowDestroyConnection;
     QStringList plasmaVirtualDesktops;
+    // removes the window from a desktop when the desktop goes away
+    QHash<QString, QMetaObject::Connection> plasmaVirtualDesktopConnections;
     QStringList plasmaActivities;
     QRect geometry;
     PlasmaWindowInterface *q;
@@ -90,6 +304,10 @@ public:
     QIcon m_icon;
     quint32 m_state = 0;
     QString uuid;
+    quint32 pendingProperties = 0;
+    // what the bound clients were told last
+    quint32 sentState = 0;
+    QRect sentGeometry;
 
 protected:
     void org_kde_plasma_window_bind_resource(Resource *resource) override;
@@ -110,8 +328,242 @@ protected:
     void org_kde_plasma_window_send_to_output(Resource *resource, struct wl_resource *output) override;
 };
 
+/**
+ * Finds the window whose move from @p source to @p destination turns @p from into @p to.
+ *
+ * @returns @c false if the orders differ in any other way
+ */
+static bool findMove(const QVector<QString> &from, const QVector<QString> &to, int *source, int *destination)
+{
+    if (from.size() != to.size()) {
+        return false;
+    }
+    int first = 0;
+    while (first < from.size() && from[first] == to[first]) {
+        ++first;
+    }
+    if (first == from.size()) {
+        return false;
+    }
+    int last = from.size() - 1;
+    while (from[last] == to[last]) {
+        --last;
+    }
+    // raised, the windows above it moved down by one
+    if (to[last] == from[first] && std::equal(from.constBegin() + first + 1, from.constBegin() + last + 1, to.constBegin() + first)) {
+        *source = first;
+        *destination = last;
+        return true;
+    }
+    // lowered, the windows below it moved up by one
+    if (to[first] == from[last] && std::equal(from.constBegin() + first, from.constBegin() + last, to.constBegin() + first + 1)) {
+        *source = last;
+        *destination = first;
+        return true;
+    }
+    return false;
+}
+
+PlasmaStackingOrderInterfacePrivate::PlasmaStackingOrderInterfacePrivate(PlasmaWindowManagementInterfacePrivate *wm, Display *display)
+    : QtWaylandServer::com_deepin_stacking_order(*display, s_stackingOrderVersion)
+    , wm(wm)
+{
+}
+
+bool PlasmaStackingOrderInterfacePrivate::isBound(wl_client *client) const
+{
+    return resourceMap().contains(client);
+}
+
+void PlasmaStackingOrderInterfacePrivate::sendStackingOrderChanged(const QVector<QString> &previous)
+{
+    const auto clientResources = resourceMap();
+    if (clientResources.isEmpty()) {
+        return;
+    }
+    int source;
+    int destination;
+    if (findMove(previous, wm->stackingOrderUuids, &source, &destination)) {
+        for (auto resource : clientResources) {
+            send_window_moved(resource->handle, source, destination);
+        }
+    } else {
+        for (auto resource : clientResources) {
+            send_stacking_order(resource->handle, wm->encodedStackingOrderUuids);
+        }
+    }
+}
+
+void PlasmaStackingOrderInterfacePrivate::com_deepin_stacking_order_bind_resource(Resource *resource)
+{
+    send_stacking_order(resource->handle, wm->encodedStackingOrderUuids);
+}
+
+void PlasmaStackingOrderInterfacePrivate::com_deepin_stacking_order_destroy_resource(Resource *resource)
+{
+    if (isBound(resource->client())) {
+        return;
+    }
+    // the client missed the full orders in the meantime
+    const auto wmResources = wm->resourceMap().values(resource->client());
+    for (auto wmResource : wmResources) {
+        wm->sendStackingOrderUuidsChanged(wmResource->handle);
+    }
+}
+
+void PlasmaStackingOrderInterfacePrivate::com_deepin_stacking_order_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+PlasmaWindowIconsInterfacePrivate::PlasmaWindowIconsInterfacePrivate(PlasmaWindowManagementInterfacePrivate *wm, Display *display)
+    : QtWaylandServer::com_deepin_window_icons(*display, s_windowIconsVersion)
+    , wm(wm)
+{
+}
+
+bool PlasmaWindowIconsInterfacePrivate::isBound(wl_client *client) const
+{
+    return resourceMap().contains(client);
+}
+
+QList<QSize> PlasmaWindowIconsInterfacePrivate::sizesFor(Resource *resource) const
+{
+    return iconSizes.value(resource, wm->iconSizes);
+}
+
+void PlasmaWindowIconsInterfacePrivate::sendIconChanged(PlasmaWindowInterface *window, Resource *resource)
+{
+    const QList<Resource *> resources = resource ? QList<Resource *>{resource} : resourceMap().values();
+    if (resources.isEmpty()) {
+        return;
+    }
+    const QIcon icon = window->d->m_icon;
+    if (icon.isNull()) {
+        for (Resource *target : resources) {
+            send_icon(target->handle, window->d->uuid, QString());
+        }
+        return;
+    }
+
+    // the hash depends on the sizes, serialize once per distinct list of sizes
+    QVector<QPair<QList<QSize>, QList<Resource *>>> groups;
+    for (Resource *target : resources) {
+        const QList<QSize> sizes = sizesFor(target);
+        auto it = std::find_if(groups.begin(), groups.end(), [&sizes](const QPair<QList<QSize>, QList<Resource *>> &group) {
+            return group.first == sizes;
+        });
+        if (it != groups.end()) {
+            it->second << target;
+        } else {
+            groups.append({sizes, {target}});
+        }
+    }
+    for (const auto &group : qAsConst(groups)) {
+        const QList<QSize> sizes = group.first;
+        const QList<Resource *> targets = group.second;
+        auto watcher = new QFutureWatcher<QByteArray>(window);
+        QObject::connect(watcher, &QFutureWatcher<QByteArray>::finished, window, [this, window, watcher, cacheKey = icon.cacheKey(), sizes, targets] {
+            watcher->deleteLater();
+            if (window->d->m_icon.cacheKey() != cacheKey) {
+                // superseded by a newer icon
+                return;
+            }
+            const QString hash = QString::fromLatin1(watcher->result().toHex());
+            const auto clientResources = resourceMap();
+            for (Resource *target : clientResources) {
+                // the client may have gone or asked for other sizes in the meantime
+                if (targets.contains(target) && sizesFor(target) == sizes) {
+                    send_icon(target->handle, window->d->uuid, hash);
+                }
+            }
+        });
+        watcher->setFuture(QtConcurrent::run(s_iconCache->threadPool(), [icon, sizes] {
+            QByteArray hash;
+            s_iconCache->serialize(icon, sizes, &hash);
+            return hash;
+        }));
+    }
+}
+
+void PlasmaWindowIconsInterfacePrivate::com_deepin_window_icons_bind_resource(Resource *resource)
+{
+    for (PlasmaWindowInterface *window : qAsConst(wm->windows)) {
+        if (!window->d->m_icon.isNull()) {
+            sendIconChanged(window, resource);
+        }
+    }
+}
+
+void PlasmaWindowIconsInterfacePrivate::com_deepin_window_icons_destroy_resource(Resource *resource)
+{
+    iconSizes.remove(resource);
+    if (isBound(resource->client())) {
+        return;
+    }
+    // the client missed the icon changes in the meantime
+    for (PlasmaWindowInterface *window : qAsConst(wm->windows)) {
+        if (window->d->m_icon.isNull()) {
+            continue;
+        }
+        const auto windowResources = window->d->resourceMap().values(resource->client());
+        for (auto windowResource : windowResources) {
+            if (windowResource->version() >= ORG_KDE_PLASMA_WINDOW_ICON_CHANGED_SINCE_VERSION) {
+                window->d->send_icon_changed(windowResource->handle);
+            }
+        }
+    }
+}
+
+void PlasmaWindowIconsInterfacePrivate::com_deepin_window_icons_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void PlasmaWindowIconsInterfacePrivate::com_deepin_window_icons_set_icon_sizes(Resource *resource, wl_array *sizes)
+{
+    QList<QSize> requested;
+    const int32_t *values = static_cast<const int32_t *>(sizes->data);
+    const size_t count = sizes->size / sizeof(int32_t);
+    for (size_t i = 0; i + 1 < count; i += 2) {
+        requested << QSize(values[i], values[i + 1]);
+    }
+    iconSizes.insert(resource, requested);
+    for (PlasmaWindowInterface *window : qAsConst(wm->windows)) {
+        if (!window->d->m_icon.isNull()) {
+            sendIconChanged(window, resource);
+        }
+    }
+}
+
+void PlasmaWindowIconsInterfacePrivate::com_deepin_window_icons_get_icon(Resource *resource, const QString &hash, int32_t fd)
+{
+    const QByteArray contentHash = QByteArray::fromHex(hash.toLatin1());
+    const QList<QSize> sizes = sizesFor(resource);
+    // the data may have been dropped from the cache, then it gets serialized again
+    QIcon icon;
+    for (PlasmaWindowInterface *window : qAsConst(wm->windows)) {
+        if (!window->d->m_icon.isNull() && s_iconCache->hash(window->d->m_icon, sizes) == contentHash) {
+            icon = window->d->m_icon;
+            break;
+        }
+    }
+    QtConcurrent::run(s_iconCache->threadPool(), [fd, contentHash, icon, sizes] {
+        QByteArray data = s_iconCache->contents(contentHash);
+        if (data.isNull() && !icon.isNull()) {
+            data = s_iconCache->serialize(icon, sizes);
+        }
+        QFile file;
+        file.open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle);
+        file.write(data);
+        file.close();
+    });
+}
+
 PlasmaWindowManagementInterfacePrivate::PlasmaWindowManagementInterfacePrivate(PlasmaWindowManagementInterface *_q, Display *display)
     : QtWaylandServer::org_kde_plasma_window_management(*display, s_version)
+    , stackingOrderDeltas(new PlasmaStackingOrderInterfacePrivate(this, display))
+    , windowIcons(new PlasmaWindowIconsInterfacePrivate(this, display))
     , q(_q)
 {
 }
@@ -141,27 +593,37 @@ void PlasmaWindowManagementInterfacePrivate::sendShowingDesktopState(wl_resource
     send_show_desktop_changed(r, s);
 }
 
+static QByteArray encodeStackingOrder(const QVector<quint32> &stackingOrder)
+{
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(stackingOrder.constData()), sizeof(uint32_t) * stackingOrder.size());
+}
+
 void PlasmaWindowManagementInterfacePrivate::sendStackingOrderChanged()
 {
+    const QByteArray ids = encodeStackingOrder(stackingOrder);
     const auto clientResources = resourceMap();
     for (auto resource : clientResources) {
-        sendStackingOrderChanged(resource->handle);
+        sendStackingOrderChanged(resource->handle, ids);
     }
 }
 
-void PlasmaWindowManagementInterfacePrivate::sendStackingOrderChanged(wl_resource *r)
+void PlasmaWindowManagementInterfacePrivate::sendStackingOrderChanged(wl_resource *r, const QByteArray &ids)
 {
     if (wl_resource_get_version(r) < ORG_KDE_PLASMA_WINDOW_MANAGEMENT_STACKING_ORDER_CHANGED_SINCE_VERSION) {
         return;
     }
 
-    send_stacking_order_changed(r, QByteArray::fromRawData(reinterpret_cast<const char *>(stackingOrder.constData()), sizeof(uint32_t) * stackingOrder.size()));
+    send_stacking_order_changed(r, ids);
 }
 
 void PlasmaWindowManagementInterfacePrivate::sendStackingOrderUuidsChanged()
 {
     const auto clientResources = resourceMap();
     for (auto resource : clientResources) {
+        // such clients get the changes as moves
+        if (stackingOrderDeltas->isBound(resource->client())) {
+            continue;
+        }
         sendStackingOrderUuidsChanged(resource->handle);
     }
 }
@@ -172,16 +634,32 @@ void PlasmaWindowManagementInterfacePrivate::sendStackingOrderUuidsChanged(wl_re
         return;
     }
 
-    QString uuids;
-    for (const auto &uuid : qAsConst(stackingOrderUuids)) {
-        uuids += uuid;
-        uuids += QLatin1Char(';');
-    }
-    // Remove the trailing ';', on the receiving side this is interpreted as an empty uuid.
-    if (stackingOrderUuids.size() > 0) {
-        uuids.remove(uuids.length() - 1, 1);
+    send_stacking_order_uuid_changed(r, encodedStackingOrderUuids);
+}
+
+void PlasmaWindowManagementInterfacePrivate::setStackingOrderUuids(const QVector<QString> &uuids)
+{
+    const QVector<QString> previous = std::exchange(stackingOrderUuids, uuids);
+    // No trailing ';', on the receiving side it would be interpreted as an empty uuid.
+    encodedStackingOrderUuids = QStringList(stackingOrderUuids.toList()).join(QLatin1Char(';'));
+    sendStackingOrderUuidsChanged();
+    stackingOrderDeltas->sendStackingOrderChanged(previous);
+}
+
+void PlasmaWindowManagementInterfacePrivate::scheduleCommit(PlasmaWindowInterface *window)
+{
+    pendingWindows << window;
+    if (commitScheduled) {
+        return;
     }
-    send_stacking_order_uuid_changed(r, uuids);
+    commitScheduled = true;
+    QMetaObject::invokeMethod(
+        q,
+        [this] {
+            commitScheduled = false;
+            q->commit();
+        },
+        Qt::QueuedConnection);
 }
 
 void PlasmaWindowManagementInterfacePrivate::org_kde_plasma_window_management_bind_resource(Resource *resource)
@@ -193,8 +671,10 @@ void PlasmaWindowManagementInterfacePrivate::org_kde_plasma_window_management_bi
             send_window(resource->handle, window->d->windowId);
         }
     }
-    sendStackingOrderChanged(resource->handle);
-    sendStackingOrderUuidsChanged(resource->handle);
+    sendStackingOrderChanged(resource->handle, encodeStackingOrder(stackingOrder));
+    if (!stackingOrderDeltas->isBound(resource->client())) {
+        sendStackingOrderUuidsChanged(resource->handle);
+    }
 }
 
 void PlasmaWindowManagementInterfacePrivate::org_kde_plasma_window_management_show_desktop(Resource *resource, uint32_t state)
@@ -278,6 +758,7 @@ PlasmaWindowInterface *PlasmaWindowManagementInterface::createWindow(QObject *pa
     d->windows << window;
     connect(window, &QObject::destroyed, this, [this, window] {
         d->windows.removeAll(window);
+        d->pendingWindows.removeAll(window);
     });
     return window;
 }
@@ -301,8 +782,17 @@ void PlasmaWindowManagementInterface::setStackingOrderUuids(const QVector<QStrin
     if (d->stackingOrderUuids == stackingOrderUuids) {
         return;
     }
-    d->stackingOrderUuids = stackingOrderUuids;
-    d->sendStackingOrderUuidsChanged();
+    d->setStackingOrderUuids(stackingOrderUuids);
+}
+
+void PlasmaWindowManagementInterface::setIconSizes(const QList<QSize> &sizes)
+{
+    d->iconSizes = sizes;
+}
+
+QList<QSize> PlasmaWindowManagementInterface::iconSizes() const
+{
+    return d->iconSizes;
 }
 
 void PlasmaWindowManagementInterface::setPlasmaVirtualDesktopManagementInterface(PlasmaVirtualDesktopManagementInterface *manager)
@@ -318,6 +808,41 @@ PlasmaVirtualDesktopManagementInterface *PlasmaWindowManagementInterface::plasma
     return d->plasmaVirtualDesktopManagementInterface;
 }
 
+void PlasmaWindowManagementInterface::setPlasmaVirtualDesktops(const QHash<PlasmaWindowInterface *, QStringList> &desktops)
+{
+    if (!d->plasmaVirtualDesktopManagementInterface) {
+        return;
+    }
+    for (auto it = desktops.constBegin(); it != desktops.constEnd(); ++it) {
+        it.key()->setPlasmaVirtualDesktops(it.value());
+    }
+    d->plasmaVirtualDesktopManagementInterface->sendDone();
+}
+
+void PlasmaWindowManagementInterface::setBatchingEnabled(bool enabled)
+{
+    if (d->batchingEnabled == enabled) {
+        return;
+    }
+    d->batchingEnabled = enabled;
+    if (!enabled) {
+        commit();
+    }
+}
+
+bool PlasmaWindowManagementInterface::isBatchingEnabled() const
+{
+    return d->batchingEnabled;
+}
+
+void PlasmaWindowManagementInterface::commit()
+{
+    const QVector<PlasmaWindowInterface *> windows = std::exchange(d->pendingWindows, {});
+    for (PlasmaWindowInterface *window : windows) {
+        window->d->sendPendingChanges();
+    }
+}
+
 //////PlasmaWindow
 PlasmaWindowInterfacePrivate::PlasmaWindowInterfacePrivate(PlasmaWindowManagementInterface *wm, PlasmaWindowInterface *q)
     : QtWaylandServer::org_kde_plasma_window()
@@ -362,7 +887,8 @@ void PlasmaWindowInterfacePrivate::org_kde_plasma_window_bind_resource(Resource
     if (!m_themedIconName.isEmpty()) {
         send_themed_icon_name_changed(resource->handle, m_themedIconName);
     } else if (!m_icon.isNull()) {
-        if (resource->version() >= ORG_KDE_PLASMA_WINDOW_ICON_CHANGED_SINCE_VERSION) {
+        // such clients get the icon by its hash
+        if (resource->version() >= ORG_KDE_PLASMA_WINDOW_ICON_CHANGED_SINCE_VERSION && !wm->d->windowIcons->isBound(resource->client())) {
             send_icon_changed(resource->handle);
         }
     }
@@ -385,11 +911,7 @@ void PlasmaWindowInterfacePrivate::setAppId(const QString &appId)
     }
 
     m_appId = appId;
-    const auto clientResources = resourceMap();
-
-    for (auto resource : clientResources) {
-        send_app_id_changed(resource->handle, m_appId);
-    }
+    propertyChanged(AppIdProperty);
 }
 
 void PlasmaWindowInterfacePrivate::setPid(quint32 pid)
@@ -398,11 +920,7 @@ void PlasmaWindowInterfacePrivate::setPid(quint32 pid)
         return;
     }
     m_pid = pid;
-    const auto clientResources = resourceMap();
-
-    for (auto resource : clientResources) {
-        send_pid_changed(resource->handle, pid);
-    }
+    propertyChanged(PidProperty);
 }
 
 void PlasmaWindowInterfacePrivate::setWindowId(quint32 winid)
@@ -414,44 +932,54 @@ void PlasmaWindowInterfacePrivate::setWindowId(quint32 winid)
     }
 }
 
+void PlasmaWindowInterfacePrivate::enterPlasmaVirtualDesktop(PlasmaVirtualDesktopInterface *desktop)
+{
+    const QString id = desktop->id();
+    plasmaVirtualDesktops << id;
+    // if the desktop dies, remove it from our list
+    plasmaVirtualDesktopConnections.insert(id, QObject::connect(desktop, &QObject::destroyed, q, [this, id] {
+        q->removePlasmaVirtualDesktop(id);
+    }));
+    broadcast_virtual_desktop_entered(id);
+}
+
+void PlasmaWindowInterfacePrivate::leavePlasmaVirtualDesktop(const QString &id)
+{
+    plasmaVirtualDesktops.removeAll(id);
+    QObject::disconnect(plasmaVirtualDesktopConnections.take(id));
+    broadcast_virtual_desktop_left(id);
+}
+
 void PlasmaWindowInterfacePrivate::setThemedIconName(const QString &iconName)
 {
     if (m_themedIconName == iconName) {
         return;
     }
     m_themedIconName = iconName;
-    const auto clientResources = resourceMap();
-
-    for (auto resource : clientResources) {
-        send_themed_icon_name_changed(resource->handle, m_themedIconName);
-    }
+    propertyChanged(ThemedIconNameProperty);
 }
 
 void PlasmaWindowInterfacePrivate::setIcon(const QIcon &icon)
 {
+    if (icon.cacheKey() == m_icon.cacheKey()) {
+        return;
+    }
     m_icon = icon;
     setThemedIconName(m_icon.name());
 
-    const auto clientResources = resourceMap();
-    for (auto resource : clientResources) {
-        if (resource->version() >= ORG_KDE_PLASMA_WINDOW_ICON_CHANGED_SINCE_VERSION) {
-            send_icon_changed(resource->handle);
-        }
-    }
+    propertyChanged(IconProperty);
 }
 
 void PlasmaWindowInterfacePrivate::org_kde_plasma_window_get_icon(Resource *resource, int32_t fd)
 {
     Q_UNUSED(resource)
-    QtConcurrent::run(
-        [fd](const QIcon &icon) {
-            QFile file;
-            file.open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle);
-            QDataStream ds(&file);
-            ds << icon;
-            file.close();
-        },
-        m_icon);
+    QtConcurrent::run(s_iconCache->threadPool(), [fd, icon = m_icon, sizes = wm->iconSizes()] {
+        const QByteArray data = s_iconCache->serialize(icon, sizes);
+        QFile file;
+        file.open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle);
+        file.write(data);
+        file.close();
+    });
 }
 
 void PlasmaWindowInterfacePrivate::org_kde_plasma_window_request_enter_virtual_desktop(Resource *resource, const QString &id)
@@ -496,11 +1024,7 @@ void PlasmaWindowInterfacePrivate::setTitle(const QString &title)
         return;
     }
     m_title = title;
-    const auto clientResources = resourceMap();
-
-    for (auto resource : clientResources) {
-        send_title_changed(resource->handle, m_title);
-    }
+    propertyChanged(TitleProperty);
 }
 
 void PlasmaWindowInterfacePrivate::unmap()
@@ -509,6 +1033,7 @@ void PlasmaWindowInterfacePrivate::unmap()
         return;
     }
     unmapped = true;
+    sendPendingChanges();
     const auto clientResources = resourceMap();
 
     for (auto resource : clientResources) {
@@ -528,11 +1053,7 @@ void PlasmaWindowInterfacePrivate::setState(org_kde_plasma_window_management_sta
         return;
     }
     m_state = newState;
-    const auto clientResources = resourceMap();
-
-    for (auto resource : clientResources) {
-        send_state_changed(resource->handle, m_state);
-    }
+    propertyChanged(StateProperty);
 }
 
 wl_resource *PlasmaWindowInterfacePrivate::resourceForParent(PlasmaWindowInterface *parent, Resource *child) const
@@ -563,16 +1084,10 @@ void PlasmaWindowInterfacePrivate::setParentWindow(PlasmaWindowInterface *window
         parentWindowDestroyConnection = QObject::connect(window, &QObject::destroyed, q, [this] {
             parentWindow = nullptr;
             parentWindowDestroyConnection = QMetaObject::Connection();
-            const auto clientResources = resourceMap();
-            for (auto resource : clientResources) {
-                send_parent_window(resource->handle, nullptr);
-            }
+            broadcast_parent_window(nullptr);
         });
     }
-    const auto clientResources = resourceMap();
-    for (auto resource : clientResources) {
-        send_parent_window(resource->handle, resourceForParent(window, resource));
-    }
+    propertyChanged(ParentWindowProperty);
 }
 
 void PlasmaWindowInterfacePrivate::setGeometry(const QRect &geo)
@@ -584,14 +1099,7 @@ void PlasmaWindowInterfacePrivate::setGeometry(const QRect &geo)
     if (!geometry.isValid()) {
         return;
     }
-
-    const auto clientResources = resourceMap();
-    for (auto resource : clientResources) {
-        if (resource->version() < ORG_KDE_PLASMA_WINDOW_GEOMETRY_SINCE_VERSION) {
-            continue;
-        }
-        send_geometry(resource->handle, geometry.x(), geometry.y(), geometry.width(), geometry.height());
-    }
+    propertyChanged(GeometryProperty);
 }
 
 void PlasmaWindowInterfacePrivate::setApplicationMenuPaths(const QString &service, const QString &object)
@@ -601,12 +1109,71 @@ void PlasmaWindowInterfacePrivate::setApplicationMenuPaths(const QString &servic
     }
     m_appServiceName = service;
     m_appObjectPath = object;
+    propertyChanged(ApplicationMenuProperty);
+}
+
+void PlasmaWindowInterfacePrivate::propertyChanged(Property property)
+{
+    const bool wasPending = pendingProperties;
+    pendingProperties |= property;
+    if (!wm->isBatchingEnabled()) {
+        sendPendingChanges();
+    } else if (!wasPending) {
+        wm->d->scheduleCommit(q);
+    }
+}
+
+void PlasmaWindowInterfacePrivate::sendPendingChanges()
+{
+    quint32 properties = std::exchange(pendingProperties, 0);
+    // a batch can end where it started
+    if (m_state == sentState) {
+        properties &= ~StateProperty;
+    }
+    if (geometry == sentGeometry || !geometry.isValid()) {
+        properties &= ~GeometryProperty;
+    }
+    if (!properties) {
+        return;
+    }
+    sentState = m_state;
+    if (properties & GeometryProperty) {
+        sentGeometry = geometry;
+    }
+
     const auto clientResources = resourceMap();
     for (auto resource : clientResources) {
-        if (resource->version() < ORG_KDE_PLASMA_WINDOW_APPLICATION_MENU_SINCE_VERSION) {
-            continue;
+        if (properties & AppIdProperty) {
+            send_app_id_changed(resource->handle, m_appId);
+        }
+        if (properties & PidProperty) {
+            send_pid_changed(resource->handle, m_pid);
+        }
+        if (properties & TitleProperty) {
+            send_title_changed(resource->handle, m_title);
+        }
+        if (properties & ApplicationMenuProperty) {
+            send_application_menu(resource->handle, m_appServiceName, m_appObjectPath);
+        }
+        if (properties & StateProperty) {
+            send_state_changed(resource->handle, m_state);
+        }
+        if (properties & ThemedIconNameProperty) {
+            send_themed_icon_name_changed(resource->handle, m_themedIconName);
+        }
+        if ((properties & IconProperty) && resource->version() >= ORG_KDE_PLASMA_WINDOW_ICON_CHANGED_SINCE_VERSION
+            && !wm->d->windowIcons->isBound(resource->client())) {
+            send_icon_changed(resource->handle);
+        }
+        if (properties & ParentWindowProperty) {
+            send_parent_window(resource->handle, resourceForParent(parentWindow, resource));
+        }
+        if ((properties & GeometryProperty) && resource->version() >= ORG_KDE_PLASMA_WINDOW_GEOMETRY_SINCE_VERSION) {
+            send_geometry(resource->handle, geometry.x(), geometry.y(), geometry.width(), geometry.height());
         }
-        send_application_menu(resource->handle, service, object);
+    }
+    if (properties & IconProperty) {
+        wm->d->windowIcons->sendIconChanged(q);
     }
 }
 
@@ -808,7 +1375,6 @@ void PlasmaWindowInterface::setOnAllDesktops(bool set)
     if (!d->wm->plasmaVirtualDesktopManagementInterface()) {
         return;
     }
-    const auto clientResources = d->resourceMap();
     // the current vd management
     if (set) {
         if (d->plasmaVirtualDesktops.isEmpty()) {
@@ -816,11 +1382,8 @@ void PlasmaWindowInterface::setOnAllDesktops(bool set)
         }
         // leaving everything means on all desktops
         for (auto desk : plasmaVirtualDesktops()) {
-            for (auto resource : clientResources) {
-                d->send_virtual_desktop_left(resource->handle, desk);
-            }
+            d->leavePlasmaVirtualDesktop(desk);
         }
-        d->plasmaVirtualDesktops.clear();
     } else {
         if (!d->plasmaVirtualDesktops.isEmpty()) {
             return;
@@ -828,10 +1391,7 @@ void PlasmaWindowInterface::setOnAllDesktops(bool set)
         // enters the desktops which are active (usually only one  but not a given)
         for (auto desk : d->wm->plasmaVirtualDesktopManagementInterface()->desktops()) {
             if (desk->isActive() && !d->plasmaVirtualDesktops.contains(desk->id())) {
-                d->plasmaVirtualDesktops << desk->id();
-                for (auto resource : clientResources) {
-                    d->send_virtual_desktop_entered(resource->handle, desk->id());
-                }
+                d->enterPlasmaVirtualDesktop(desk);
             }
         }
     }
@@ -890,17 +1450,7 @@ void PlasmaWindowInterface::addPlasmaVirtualDesktop(const QString &id)
         return;
     }
 
-    d->plasmaVirtualDesktops << id;
-
-    // if the desktop dies, remove it from or list
-    connect(desktop, &QObject::destroyed, this, [this, id]() {
-        removePlasmaVirtualDesktop(id);
-    });
-
-    const auto clientResources = d->resourceMap();
-    for (auto resource : clientResources) {
-        d->send_virtual_desktop_entered(resource->handle, id);
-    }
+    d->enterPlasmaVirtualDesktop(desktop);
 }
 
 void PlasmaWindowInterface::removePlasmaVirtualDesktop(const QString &id)
@@ -909,11 +1459,7 @@ void PlasmaWindowInterface::removePlasmaVirtualDesktop(const QString &id)
         return;
     }
 
-    d->plasmaVirtualDesktops.removeAll(id);
-    const auto clientResources = d->resourceMap();
-    for (auto resource : clientResources) {
-        d->send_virtual_desktop_left(resource->handle, id);
-    }
+    d->leavePlasmaVirtualDesktop(id);
 
     // we went on all desktops
     if (d->plasmaVirtualDesktops.isEmpty()) {
@@ -921,6 +1467,39 @@ void PlasmaWindowInterface::removePlasmaVirtualDesktop(const QString &id)
     }
 }
 
+void PlasmaWindowInterface::setPlasmaVirtualDesktops(const QStringList &ids)
+{
+    PlasmaVirtualDesktopManagementInterface *desktopManagement = d->wm->plasmaVirtualDesktopManagementInterface();
+    if (!desktopManagement) {
+        return;
+    }
+
+    QVector<PlasmaVirtualDesktopInterface *> desktops;
+    QSet<QString> desktopIds;
+    for (const QString &id : ids) {
+        PlasmaVirtualDesktopInterface *desktop = desktopManagement->desktop(id);
+        if (desktop && !desktopIds.contains(id)) {
+            desktops << desktop;
+            desktopIds.insert(id);
+        }
+    }
+
+    const QStringList current = d->plasmaVirtualDesktops;
+    for (const QString &id : current) {
+        if (!desktopIds.contains(id)) {
+            d->leavePlasmaVirtualDesktop(id);
+        }
+    }
+    for (PlasmaVirtualDesktopInterface *desktop : qAsConst(desktops)) {
+        if (!d->plasmaVirtualDesktops.contains(desktop->id())) {
+            d->enterPlasmaVirtualDesktop(desktop);
+        }
+    }
+
+    // the deprecated vd management
+    d->setState(ORG_KDE_PLASMA_WINDOW_MANAGEMENT_STATE_ON_ALL_DESKTOPS, desktops.isEmpty());
+}
+
 QStringList PlasmaWindowInterface::plasmaVirtualDesktops() const
 {
     return d->plasmaVirtualDesktops;
@@ -934,12 +1513,7 @@ void PlasmaWindowInterface::addPlasmaActivity(const QString &id)
 
     d->plasmaActivities << id;
 
-    const auto clientResources = d->resourceMap();
-    for (auto resource : clientResources) {
-        if (resource->version() >= ORG_KDE_PLASMA_WINDOW_ACTIVITY_ENTERED_SINCE_VERSION) {
-            d->send_activity_entered(resource->handle, id);
-        }
-    }
+    d->broadcast_activity_entered(id);
 }
 
 void PlasmaWindowInterface::removePlasmaActivity(const QString &id)
@@ -948,12 +1522,7 @@ void PlasmaWindowInterface::removePlasmaActivity(const QString &id)
         return;
     }
 
-    const auto clientResources = d->resourceMap();
-    for (auto resource : clientResources) {
-        if (resource->version() >= ORG_KDE_PLASMA_WINDOW_ACTIVITY_LEFT_SINCE_VERSION) {
-            d->send_activity_left(resource->handle, id);
-        }
-    }
+    d->broadcast_activity_left(id);
 }
 
 QStringList PlasmaWindowInterface::plasmaActivities() const
@@ -1016,6 +1585,11 @@ QString PlasmaWindowInterface::uuid() const
     return d->uuid;
 }
 
+void PlasmaWindowInterface::commit()
+{
+    d->sendPendingChanges();
+}
+
 class PlasmaWindowActivationFeedbackInterfacePrivate : public QtWaylandServer::org_kde_plasma_activation_feedback
 {
 public:
@@ -1076,18 +1650,12 @@ PlasmaWindowActivationInterface::PlasmaWindowActivationInterface()
 
 PlasmaWindowActivationInterface::~PlasmaWindowActivationInterface()
 {
-    const auto clientResources = d->resourceMap();
-    for (auto resource : clientResources) {
-        d->send_finished(resource->handle);
-    }
+    d->broadcast_finished();
 }
 
 void PlasmaWindowActivationInterface::sendAppId(const QString &appid)
 {
-    const auto clientResources = d->resourceMap();
-    for (auto resource : clientResources) {
-        d->send_app_id(resource->handle, appid);
-    }
+    d->broadcast_app_id(appid);
 }
 
 }
@@ -85,17 +85,63 @@ public:
      */
     PlasmaVirtualDesktopManagementInterface *plasmaVirtualDesktopManagementInterface() const;
 
+    /**
+     * Moves many windows across virtual desktops at once, e.g. when a group of windows is sent
+     * to another desktop. Every window in @p desktops is put on the desktops with the given ids
+     * as with PlasmaWindowInterface::setPlasmaVirtualDesktops. Afterwards the associated
+     * PlasmaVirtualDesktopManagementInterface sends a single done to every client.
+     */
+    void setPlasmaVirtualDesktops(const QHash<PlasmaWindowInterface *, QStringList> &desktops);
+
     /**
      * Associate stacking order to this window management
      */
     void setStackingOrder(const QVector<quint32> &stackingOrder);
 
+    /**
+     * Sets the stacking order from bottom to top. Clients which bound com_deepin_stacking_order
+     * get a change which only moves one window as that move instead of the full order.
+     */
     void setStackingOrderUuids(const QVector<QString> &stackingOrderUuids);
 
+    /**
+     * Restricts the icons transferred to clients to the given @p sizes, e.g. the ones the task
+     * managers render, instead of every size the icons provide. An empty list, the default,
+     * transfers all sizes.
+     */
+    void setIconSizes(const QList<QSize> &sizes);
+    QList<QSize> iconSizes() const;
+
+    /**
+     * Enables batching the property changes of the windows. Instead of sending an event for
+     * every change right away, each PlasmaWindowInterface remembers which of its properties
+     * changed, and sends their latest values once the event loop gets back to the
+     * PlasmaWindowManagementInterface, or on commit(). For example the geometry updates of an
+     * interactive move or resize are collapsed into one event per event loop iteration.
+     *
+     * Batching covers the title, app id, pid, icon, state flags, parent window, geometry and
+     * application menu. Virtual desktops, activities and unmapping are still sent right away,
+     * unmapping sends the pending changes of the window first.
+     *
+     * Disabling batching sends the pending changes. It is disabled by default.
+     *
+     * @see commit
+     * @see PlasmaWindowInterface::commit
+     */
+    void setBatchingEnabled(bool enabled);
+    bool isBatchingEnabled() const;
+    /**
+     * Sends the pending property changes of all windows now.
+     *
+     * @see setBatchingEnabled
+     */
+    void commit();
+
 Q_SIGNALS:
     void requestChangeShowingDesktop(ShowingDesktopState requestedState);
 
 private:
+    friend class PlasmaWindowInterfacePrivate;
     QScopedPointer<PlasmaWindowManagementInterfacePrivate> d;
 };
 
@@ -187,6 +233,15 @@ public:
      */
     void removePlasmaVirtualDesktop(const QString &id);
 
+    /**
+     * Puts this window on exactly the desktops with the given @p ids, sending only the
+     * desktops it enters and leaves. Unknown ids are ignored, none puts the window on all
+     * desktops.
+     *
+     * @see PlasmaWindowManagementInterface::setPlasmaVirtualDesktops
+     */
+    void setPlasmaVirtualDesktops(const QStringList &ids);
+
     /**
      * The ids of all the desktops currently associated with this window.
      * When a desktop is deleted it will be automatically removed from this list
@@ -226,6 +281,13 @@ public:
      */
     QString uuid() const;
 
+    /**
+     * Sends the pending property changes of this window now, e.g. at the end of a move.
+     *
+     * @see PlasmaWindowManagementInterface::setBatchingEnabled
+     */
+    void commit();
+
 Q_SIGNALS:
     void closeRequested();
     void moveRequested();
@@ -293,6 +355,7 @@ private:
     friend class PlasmaWindowManagementInterface;
     friend class PlasmaWindowInterfacePrivate;
     friend class PlasmaWindowManagementInterfacePrivate;
+    friend class PlasmaWindowIconsInterfacePrivate;
     explicit PlasmaWindowInterface(PlasmaWindowManagementInterface *wm, QObject *parent);
 
     QScopedPointer<PlasmaWindowInterfacePrivate> d;
@@ -53,9 +53,9 @@ PointerInterfacePrivate::~PointerInterfacePrivate()
 {
 }
 
-QList<PointerInterfacePrivate::Resource *> PointerInterfacePrivate::pointersForClient(ClientConnection *client) const
+PointerInterfacePrivate::ResourceRange PointerInterfacePrivate::pointersForClient(ClientConnection *client) const
 {
-    return resourceMap().values(client->client());
+    return resourceMap().resources(client->client());
 }
 
 void PointerInterfacePrivate::pointer_set_cursor(Resource *resource, uint32_t serial, ::wl_resource *surface_resource, int32_t hotspot_x, int32_t hotspot_y)
@@ -114,27 +114,36 @@ void PointerInterfacePrivate::pointer_bind_resource(Resource *resource)
 
 void PointerInterfacePrivate::sendLeave(quint32 serial)
 {
-    const QList<Resource *> pointerResources = pointersForClient(focusedSurface->client());
-    for (Resource *resource : pointerResources) {
-        send_leave(resource->handle, serial, focusedSurface->resource());
-    }
+    broadcast_leave(pointersForClient(focusedSurface->client()), serial, focusedSurface->resource());
 }
 
 void PointerInterfacePrivate::sendEnter(const QPointF &position, quint32 serial)
 {
-    const QList<Resource *> pointerResources = pointersForClient(focusedSurface->client());
-    for (Resource *resource : pointerResources) {
-        send_enter(resource->handle, serial, focusedSurface->resource(), wl_fixed_from_double(position.x()), wl_fixed_from_double(position.y()));
-    }
+    broadcast_enter(pointersForClient(focusedSurface->client()), serial, focusedSurface->resource(), wl_fixed_from_double(position.x()), wl_fixed_from_double(position.y()));
 }
 
 void PointerInterfacePrivate::sendFrame()
 {
-    const QList<Resource *> pointerResources = pointersForClient(focusedSurface->client());
-    for (Resource *resource : pointerResources) {
-        if (resource->version() >= WL_POINTER_FRAME_SINCE_VERSION) {
-            send_frame(resource->handle);
-        }
+    broadcast_frame(pointersForClient(focusedSurface->client()));
+    framePending = false;
+    frameRequired = false;
+}
+
+void PointerInterfacePrivate::sendMotion()
+{
+    broadcast_motion(pointersForClient(focusedSurface->client()), pendingMotionTime, wl_fixed_from_double(lastPosition.x()), wl_fixed_from_double(lastPosition.y()));
+    ++sentMotionCount;
+    framePending = true;
+}
+
+void PointerInterfacePrivate::flushPendingMotion()
+{
+    if (!hasPendingMotion) {
+        return;
+    }
+    hasPendingMotion = false;
+    if (focusedSurface) {
+        sendMotion();
     }
 }
 
@@ -158,6 +167,9 @@ void PointerInterface::setFocusedSurface(SurfaceInterface *surface, const QPoint
         return;
     }
 
+    // the enter event carries the position, merged motion is of no use to either surface
+    d->hasPendingMotion = false;
+
     if (d->focusedSurface) {
         d->sendLeave(serial);
         if (!surface || d->focusedSurface->client() != surface->client()) {
@@ -189,10 +201,10 @@ void PointerInterface::sendButton(quint32 button, PointerButtonState state, quin
         return;
     }
 
-    const auto pointerResources = d->pointersForClient(d->focusedSurface->client());
-    for (PointerInterfacePrivate::Resource *resource : pointerResources) {
-        d->send_button(resource->handle, serial, d->seat->timestamp(), button, quint32(state));
-    }
+    d->flushPendingMotion();
+    d->broadcast_button(d->pointersForClient(d->focusedSurface->client()), serial, d->seat->timestamp(), button, quint32(state));
+    d->framePending = true;
+    d->frameRequired = true;
 }
 
 void PointerInterface::sendAxis(Qt::Orientation orientation, qreal delta, qint32 discreteDelta, PointerAxisSource source)
@@ -201,6 +213,7 @@ void PointerInterface::sendAxis(Qt::Orientation orientation, qreal delta, qint32
         return;
     }
 
+    d->flushPendingMotion();
     const auto pointerResources = d->pointersForClient(d->focusedSurface->client());
     for (PointerInterfacePrivate::Resource *resource : pointerResources) {
         const quint32 version = resource->version();
@@ -239,29 +252,88 @@ void PointerInterface::sendAxis(Qt::Orientation orientation, qreal delta, qint32
             d->send_axis_stop(resource->handle, d->seat->timestamp(), wlOrientation);
         }
     }
+    d->framePending = true;
+    d->frameRequired = true;
 }
 
 void PointerInterface::sendMotion(const QPointF &position)
 {
     d->lastPosition = position;
+    ++d->receivedMotionCount;
 
     if (!d->focusedSurface) {
         return;
     }
 
-    const auto pointerResources = d->pointersForClient(d->focusedSurface->client());
-    for (PointerInterfacePrivate::Resource *resource : pointerResources) {
-        d->send_motion(resource->handle, d->seat->timestamp(), wl_fixed_from_double(position.x()), wl_fixed_from_double(position.y()));
+    d->pendingMotionTime = d->seat->timestamp();
+    if (d->motionCoalescing == PointerMotionCoalescing::Disabled) {
+        d->sendMotion();
+    } else {
+        d->hasPendingMotion = true;
     }
 }
 
 void PointerInterface::sendFrame()
 {
-    if (d->focusedSurface) {
+    if (!d->focusedSurface) {
+        return;
+    }
+
+    switch (d->motionCoalescing) {
+    case PointerMotionCoalescing::Disabled:
+        break;
+    case PointerMotionCoalescing::Frame:
+        d->flushPendingMotion();
+        break;
+    case PointerMotionCoalescing::Vblank:
+        if (!d->frameRequired) {
+            // nothing but motion in this frame, keep merging until the next vblank
+            return;
+        }
+        d->flushPendingMotion();
+        break;
+    }
+    d->sendFrame();
+}
+
+void PointerInterface::setMotionCoalescing(PointerMotionCoalescing coalescing)
+{
+    if (d->motionCoalescing == coalescing) {
+        return;
+    }
+    d->motionCoalescing = coalescing;
+    if (d->focusedSurface && (d->hasPendingMotion || d->framePending)) {
+        flushMotion();
+    }
+}
+
+PointerMotionCoalescing PointerInterface::motionCoalescing() const
+{
+    return d->motionCoalescing;
+}
+
+void PointerInterface::flushMotion()
+{
+    if (!d->focusedSurface) {
+        d->hasPendingMotion = false;
+        return;
+    }
+    d->flushPendingMotion();
+    if (d->framePending) {
         d->sendFrame();
     }
 }
 
+quint64 PointerInterface::receivedMotionCount() const
+{
+    return d->receivedMotionCount;
+}
+
+quint64 PointerInterface::sentMotionCount() const
+{
+    return d->sentMotionCount;
+}
+
 Cursor *PointerInterface::cursor() const
 {
     return d->cursor;
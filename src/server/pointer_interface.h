@@ -23,6 +23,7 @@ class SurfaceInterface;
 
 enum class PointerAxisSource;
 enum class PointerButtonState : quint32;
+enum class PointerMotionCoalescing;
 
 /**
  * The PointerInterface class represents one or more input devices such as mice, which control
@@ -64,6 +65,27 @@ public:
     void sendMotion(const QPointF &position);
     void sendFrame();
 
+    /**
+     * Sets how motion is delivered to the focused client.
+     *
+     * @see SeatInterface::setPointerMotionCoalescing
+     */
+    void setMotionCoalescing(PointerMotionCoalescing coalescing);
+    PointerMotionCoalescing motionCoalescing() const;
+    /**
+     * Sends the merged motion, if any, followed by a frame event.
+     */
+    void flushMotion();
+    /**
+     * Returns the number of motion events passed to sendMotion.
+     */
+    quint64 receivedMotionCount() const;
+    /**
+     * Returns the number of motion events sent to the focused client. It is lower than
+     * receivedMotionCount if motion events got merged or had no focused surface to go to.
+     */
+    quint64 sentMotionCount() const;
+
 Q_SIGNALS:
     /**
      * This signal is emitted whenever the cursor surface changes. As long as there is no
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "pointer_interface.h"
+#include "seat_interface.h"
 
 #include <QPointF>
 #include <QPointer>
@@ -31,7 +32,7 @@ public:
     PointerInterfacePrivate(PointerInterface *q, SeatInterface *seat);
     ~PointerInterfacePrivate() override;
 
-    QList<Resource *> pointersForClient(ClientConnection *client) const;
+    ResourceRange pointersForClient(ClientConnection *client) const;
 
     PointerInterface *q;
     SeatInterface *seat;
@@ -44,9 +45,22 @@ public:
     QScopedPointer<PointerHoldGestureV1Interface> holdGesturesV1;
     QPointF lastPosition;
 
+    PointerMotionCoalescing motionCoalescing = PointerMotionCoalescing::Disabled;
+    // the merged motion which has not been sent to the focused client yet
+    bool hasPendingMotion = false;
+    quint32 pendingMotionTime = 0;
+    // events were sent which are not terminated by a frame event yet
+    bool framePending = false;
+    // a frame event has to be sent on the next sendFrame(), even if motion is merged across frames
+    bool frameRequired = false;
+    quint64 receivedMotionCount = 0;
+    quint64 sentMotionCount = 0;
+
     void sendLeave(quint32 serial);
     void sendEnter(const QPointF &parentSurfacePosition, quint32 serial);
     void sendFrame();
+    void sendMotion();
+    void flushPendingMotion();
 
 protected:
     void pointer_set_cursor(Resource *resource, uint32_t serial, ::wl_resource *surface_resource, int32_t hotspot_x, int32_t hotspot_y) override;
@@ -106,10 +106,7 @@ void PointerSwipeGestureV1Interface::sendBegin(quint32 serial, quint32 fingerCou
     focusedClient = focusedSurface->client();
     SeatInterface *seat = pointer->seat();
 
-    const QList<Resource *> swipeResources = resourceMap().values(focusedClient->client());
-    for (Resource *swipeResource : swipeResources) {
-        send_begin(swipeResource->handle, serial, seat->timestamp(), focusedSurface->resource(), fingerCount);
-    }
+    broadcast_begin(resourceMap().resources(focusedClient->client()), serial, seat->timestamp(), focusedSurface->resource(), fingerCount);
 }
 
 void PointerSwipeGestureV1Interface::sendUpdate(const QSizeF &delta)
@@ -120,10 +117,7 @@ void PointerSwipeGestureV1Interface::sendUpdate(const QSizeF &delta)
 
     SeatInterface *seat = pointer->seat();
 
-    const QList<Resource *> swipeResources = resourceMap().values(focusedClient->client());
-    for (Resource *swipeResource : swipeResources) {
-        send_update(swipeResource->handle, seat->timestamp(), wl_fixed_from_double(delta.width()), wl_fixed_from_double(delta.height()));
-    }
+    broadcast_update(resourceMap().resources(focusedClient->client()), seat->timestamp(), wl_fixed_from_double(delta.width()), wl_fixed_from_double(delta.height()));
 }
 
 void PointerSwipeGestureV1Interface::sendEnd(quint32 serial)
@@ -134,10 +128,7 @@ void PointerSwipeGestureV1Interface::sendEnd(quint32 serial)
 
     SeatInterface *seat = pointer->seat();
 
-    const QList<Resource *> swipeResources = resourceMap().values(focusedClient->client());
-    for (Resource *swipeResource : swipeResources) {
-        send_end(swipeResource->handle, serial, seat->timestamp(), false);
-    }
+    broadcast_end(resourceMap().resources(focusedClient->client()), serial, seat->timestamp(), false);
 
     // The gesture session has been just finished, reset the cached focused client.
     focusedClient = nullptr;
@@ -151,10 +142,7 @@ void PointerSwipeGestureV1Interface::sendCancel(quint32 serial)
 
     SeatInterface *seat = pointer->seat();
 
-    const QList<Resource *> swipeResources = resourceMap().values(focusedClient->client());
-    for (Resource *swipeResource : swipeResources) {
-        send_end(swipeResource->handle, serial, seat->timestamp(), true);
-    }
+    broadcast_end(resourceMap().resources(focusedClient->client()), serial, seat->timestamp(), true);
 
     // The gesture session has been just finished, reset the cached focused client.
     focusedClient = nullptr;
@@ -192,10 +180,7 @@ void PointerPinchGestureV1Interface::sendBegin(quint32 serial, quint32 fingerCou
     focusedClient = focusedSurface->client();
     SeatInterface *seat = pointer->seat();
 
-    const QList<Resource *> pinchResources = resourceMap().values(*focusedClient);
-    for (Resource *pinchResource : pinchResources) {
-        send_begin(pinchResource->handle, serial, seat->timestamp(), focusedSurface->resource(), fingerCount);
-    }
+    broadcast_begin(resourceMap().resources(*focusedClient), serial, seat->timestamp(), focusedSurface->resource(), fingerCount);
 }
 
 void PointerPinchGestureV1Interface::sendUpdate(const QSizeF &delta, qreal scale, qreal rotation)
@@ -206,7 +191,7 @@ void PointerPinchGestureV1Interface::sendUpdate(const QSizeF &delta, qreal scale
 
     SeatInterface *seat = pointer->seat();
 
-    const QList<Resource *> pinchResources = resourceMap().values(*focusedClient);
+    const auto pinchResources = resourceMap().resources(*focusedClient);
     for (Resource *pinchResource : pinchResources) {
         send_update(pinchResource->handle,
                     seat->timestamp(),
@@ -225,10 +210,7 @@ void PointerPinchGestureV1Interface::sendEnd(quint32 serial)
 
     SeatInterface *seat = pointer->seat();
 
-    const QList<Resource *> pinchResources = resourceMap().values(*focusedClient);
-    for (Resource *pinchResource : pinchResources) {
-        send_end(pinchResource->handle, serial, seat->timestamp(), false);
-    }
+    broadcast_end(resourceMap().resources(*focusedClient), serial, seat->timestamp(), false);
 
     // The gesture session has been just finished, reset the cached focused client.
     focusedClient = nullptr;
@@ -242,10 +224,7 @@ void PointerPinchGestureV1Interface::sendCancel(quint32 serial)
 
     SeatInterface *seat = pointer->seat();
 
-    const QList<Resource *> pinchResources = resourceMap().values(*focusedClient);
-    for (Resource *pinchResource : pinchResources) {
-        send_end(pinchResource->handle, serial, seat->timestamp(), true);
-    }
+    broadcast_end(resourceMap().resources(*focusedClient), serial, seat->timestamp(), true);
 
     // The gesture session has been just finished, reset the cached focused client.
     focusedClient = nullptr;
@@ -283,10 +262,7 @@ void PointerHoldGestureV1Interface::sendBegin(quint32 serial, quint32 fingerCoun
     focusedClient = focusedSurface->client();
     SeatInterface *seat = pointer->seat();
 
-    const QList<Resource *> holdResources = resourceMap().values(*focusedClient);
-    for (Resource *holdResource : holdResources) {
-        send_begin(holdResource->handle, serial, seat->timestamp(), focusedSurface->resource(), fingerCount);
-    }
+    broadcast_begin(resourceMap().resources(*focusedClient), serial, seat->timestamp(), focusedSurface->resource(), fingerCount);
 }
 
 void PointerHoldGestureV1Interface::sendEnd(quint32 serial)
@@ -297,10 +273,7 @@ void PointerHoldGestureV1Interface::sendEnd(quint32 serial)
 
     SeatInterface *seat = pointer->seat();
 
-    const QList<Resource *> holdResources = resourceMap().values(*focusedClient);
-    for (Resource *holdResource : holdResources) {
-        send_end(holdResource->handle, serial, seat->timestamp(), false);
-    }
+    broadcast_end(resourceMap().resources(*focusedClient), serial, seat->timestamp(), false);
 
     // The gesture session has been just finished, reset the cached focused client.
     focusedClient = nullptr;
@@ -314,10 +287,7 @@ void PointerHoldGestureV1Interface::sendCancel(quint32 serial)
 
     SeatInterface *seat = pointer->seat();
 
-    const QList<Resource *> holdResources = resourceMap().values(*focusedClient);
-    for (Resource *holdResource : holdResources) {
-        send_end(holdResource->handle, serial, seat->timestamp(), true);
-    }
+    broadcast_end(resourceMap().resources(*focusedClient), serial, seat->timestamp(), true);
 
     // The gesture session has been just finished, reset the cached focused client.
     focusedClient = nullptr;
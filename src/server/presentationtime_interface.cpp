@@ -0,0 +1,77 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "presentationtime_interface.h"
+#include "display.h"
+#include "surface_interface.h"
+#include "surface_interface_p.h"
+
+#include "qwayland-server-presentation-time.h"
+
+namespace KWaylandServer
+{
+static const quint32 s_version = 1;
+
+class PresentationInterfacePrivate : public QtWaylandServer::wp_presentation
+{
+public:
+    clockid_t clockId = CLOCK_MONOTONIC;
+
+protected:
+    void wp_presentation_bind_resource(Resource *resource) override;
+    void wp_presentation_destroy(Resource *resource) override;
+    void wp_presentation_feedback(Resource *resource, struct ::wl_resource *surface, uint32_t callback) override;
+};
+
+void PresentationInterfacePrivate::wp_presentation_bind_resource(Resource *resource)
+{
+    send_clock_id(resource->handle, clockId);
+}
+
+void PresentationInterfacePrivate::wp_presentation_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void PresentationInterfacePrivate::wp_presentation_feedback(Resource *resource, struct ::wl_resource *surface_resource, uint32_t callback)
+{
+    SurfaceInterface *surface = SurfaceInterface::get(surface_resource);
+    wl_resource *feedbackResource = wl_resource_create(resource->client(), &wp_presentation_feedback_interface, resource->version(), callback);
+    if (!feedbackResource) {
+        wl_resource_post_no_memory(resource->handle);
+        return;
+    }
+
+    wl_resource_set_implementation(feedbackResource, nullptr, nullptr, [](wl_resource *resource) {
+        wl_list_remove(wl_resource_get_link(resource));
+    });
+
+    SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+    wl_list_insert(surfacePrivate->pending.presentationFeedbacks.prev, wl_resource_get_link(feedbackResource));
+}
+
+PresentationInterface::PresentationInterface(Display *display, QObject *parent)
+    : QObject(parent)
+    , d(new PresentationInterfacePrivate)
+{
+    d->init(*display, s_version);
+}
+
+PresentationInterface::~PresentationInterface()
+{
+}
+
+void PresentationInterface::setClockId(clockid_t clockId)
+{
+    d->clockId = clockId;
+}
+
+clockid_t PresentationInterface::clockId() const
+{
+    return d->clockId;
+}
+
+} // namespace KWaylandServer
@@ -0,0 +1,78 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#pragma once
+
+#include <DWayland/Server/kwaylandserver_export.h>
+
+#include <QObject>
+
+#include <time.h>
+
+namespace KWaylandServer
+{
+class Display;
+class PresentationInterfacePrivate;
+
+/**
+ * The PresentationInterface is an extension that lets clients know when their content updates
+ * were shown on an output.
+ *
+ * A client asks for feedback on the next content update of a surface. The feedback is queued
+ * with the surface on commit. The compositor reports it with SurfaceInterface::sendPresented()
+ * once the frame showing the update was presented, or with SurfaceInterface::sendDiscarded()
+ * if the update never made it to the screen. A content update superseded by a later commit of
+ * the same surface is discarded automatically.
+ *
+ * The timestamps passed to SurfaceInterface::sendPresented() must come from clockId().
+ *
+ * PresentationInterface corresponds to the Wayland interface @c wp_presentation.
+ */
+class KWAYLANDSERVER_EXPORT PresentationInterface : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * How the content update was presented, see @c wp_presentation_feedback.kind.
+     */
+    enum class Kind {
+        /**
+         * The presentation was synchronized to the vertical retrace of the output.
+         */
+        Vsync = 0x1,
+        /**
+         * The timestamp comes from a hardware clock, e.g. the vblank event of the display.
+         */
+        HardwareClock = 0x2,
+        /**
+         * The hardware signalled the start of the presentation.
+         */
+        HardwareCompletion = 0x4,
+        /**
+         * The buffer of the client was scanned out directly, without a copy.
+         */
+        ZeroCopy = 0x8,
+    };
+    Q_DECLARE_FLAGS(Kinds, Kind)
+
+    explicit PresentationInterface(Display *display, QObject *parent = nullptr);
+    ~PresentationInterface() override;
+
+    /**
+     * Sets the clock the presentation timestamps are taken from. Clients bound later are told
+     * about it. The default is @c CLOCK_MONOTONIC.
+     */
+    void setClockId(clockid_t clockId);
+    clockid_t clockId() const;
+
+private:
+    QScopedPointer<PresentationInterfacePrivate> d;
+};
+
+} // namespace KWaylandServer
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(KWaylandServer::PresentationInterface::Kinds)
@@ -52,10 +52,7 @@ void PrimaryOutputV1Interface::setPrimaryOutput(const QString &outputName)
     }
     d->m_outputName = outputName;
 
-    const auto resources = d->resourceMap();
-    for (auto *resource : resources) {
-        d->send_primary_output(resource->handle, outputName);
-    }
+    d->broadcast_primary_output(outputName);
 }
 
 }
@@ -77,7 +77,7 @@ void RelativePointerV1Interface::sendRelativeMotion(const QSizeF &delta, const Q
     }
 
     ClientConnection *focusedClient = pointer->focusedSurface()->client();
-    const QList<Resource *> pointerResources = resourceMap().values(focusedClient->client());
+    const auto pointerResources = resourceMap().resources(focusedClient->client());
     for (Resource *pointerResource : pointerResources) {
         if (pointerResource->client() == focusedClient->client()) {
             send_relative_motion(pointerResource->handle,
@@ -89,6 +89,10 @@ void RelativePointerV1Interface::sendRelativeMotion(const QSizeF &delta, const Q
                                  wl_fixed_from_double(deltaNonAccelerated.height()));
         }
     }
+    if (!pointerResources.isEmpty()) {
+        // relative motion is grouped by wl_pointer.frame as well
+        PointerInterfacePrivate::get(pointer)->framePending = true;
+    }
 }
 
 } // namespace KWaylandServer
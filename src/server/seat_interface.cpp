@@ -14,6 +14,7 @@
 #include "datasource_interface.h"
 #include "display.h"
 #include "display_p.h"
+#include "inputeventring.h"
 #include "keyboard_interface.h"
 #include "keyboard_interface_p.h"
 #include "logging.h"
@@ -25,6 +26,7 @@
 #include "primaryselectionsource_v1_interface.h"
 #include "relativepointer_v1_interface_p.h"
 #include "seat_interface_p.h"
+#include "selection_cache.h"
 #include "surface_interface.h"
 #include "textinput_v2_interface_p.h"
 #include "textinput_v3_interface_p.h"
@@ -32,6 +34,7 @@
 #include "utils.h"
 
 #include <linux/input.h>
+#include <time.h>
 
 #include <functional>
 
@@ -180,7 +183,7 @@ void SeatInterfacePrivate::registerDataDevice(DataDeviceInterface *dataDevice)
         if (*globalKeyboard.focus.surface->client() == dataDevice->client()) {
             globalKeyboard.focus.selections.append(dataDevice);
             if (currentSelection) {
-                dataDevice->sendSelection(currentSelection);
+                dataDevice->sendSelection(offeredSelection());
             }
         }
     }
@@ -237,7 +240,7 @@ void SeatInterfacePrivate::registerDataControlDevice(DataControlDeviceV1Interfac
     });
 
     if (currentSelection) {
-        dataDevice->sendSelection(currentSelection);
+        dataDevice->sendSelection(offeredSelection());
     }
     if (currentPrimarySelection) {
         dataDevice->sendPrimarySelection(currentPrimarySelection);
@@ -307,6 +310,14 @@ void SeatInterfacePrivate::endDrag(quint32 serial)
     Q_EMIT q->dragEnded();
 }
 
+AbstractDataSource *SeatInterfacePrivate::offeredSelection() const
+{
+    if (selectionCache && currentSelection && selectionCache->capturedSource() == currentSelection) {
+        return selectionCache->cachedSource();
+    }
+    return currentSelection;
+}
+
 void SeatInterfacePrivate::updateSelection(DataDeviceInterface *dataDevice)
 {
     // if the update is from the focussed window we should inform the active client
@@ -327,10 +338,7 @@ void SeatInterfacePrivate::updatePrimarySelection(PrimarySelectionDeviceV1Interf
 
 void SeatInterfacePrivate::sendCapabilities()
 {
-    const auto seatResources = resourceMap();
-    for (SeatInterfacePrivate::Resource *resource : seatResources) {
-        send_capabilities(resource->handle, capabilities);
-    }
+    broadcast_capabilities(capabilities);
 }
 
 void SeatInterface::setHasKeyboard(bool has)
@@ -359,6 +367,7 @@ void SeatInterface::setHasPointer(bool has)
     if (has) {
         d->capabilities |= SeatInterfacePrivate::capability_pointer;
         d->pointer.reset(new PointerInterface(this));
+        d->pointer->setMotionCoalescing(d->pointerMotionCoalescing);
     } else {
         d->capabilities &= ~SeatInterfacePrivate::capability_pointer;
         d->pointer.reset();
@@ -394,12 +403,7 @@ void SeatInterface::setName(const QString &name)
     }
     d->name = name;
 
-    const auto seatResources = d->resourceMap();
-    for (SeatInterfacePrivate::Resource *resource : seatResources) {
-        if (resource->version() >= WL_SEAT_NAME_SINCE_VERSION) {
-            d->send_name(resource->handle, d->name);
-        }
-    }
+    d->broadcast_name(d->name);
 
     Q_EMIT nameChanged(d->name);
 }
@@ -497,6 +501,118 @@ void SeatInterface::setTimestamp(quint32 time)
     Q_EMIT timestampChanged(time);
 }
 
+void SeatInterfacePrivate::deliverInputEvent(const InputEvent &event)
+{
+    q->setTimestamp(std::chrono::duration_cast<std::chrono::milliseconds>(event.time).count());
+    switch (event.type) {
+    case InputEvent::Type::PointerMotion:
+        q->notifyPointerMotion(event.position());
+        break;
+    case InputEvent::Type::PointerButton:
+        q->notifyPointerButton(event.button.button, event.button.state);
+        break;
+    case InputEvent::Type::PointerAxis:
+        q->notifyPointerAxis(event.axis.orientation, event.axis.delta, event.axis.discreteDelta, event.axis.source);
+        break;
+    case InputEvent::Type::PointerFrame:
+        q->notifyPointerFrame();
+        break;
+    case InputEvent::Type::KeyboardKey:
+        q->notifyKeyboardKey(event.key.keyCode, event.key.state);
+        break;
+    case InputEvent::Type::KeyboardModifiers:
+        q->notifyKeyboardModifiers(event.modifiers.depressed, event.modifiers.latched, event.modifiers.locked, event.modifiers.group);
+        break;
+    case InputEvent::Type::TouchDown:
+        q->notifyTouchDown(event.touch.id, event.position());
+        break;
+    case InputEvent::Type::TouchUp:
+        q->notifyTouchUp(event.touch.id);
+        break;
+    case InputEvent::Type::TouchMotion:
+        q->notifyTouchMotion(event.touch.id, event.position());
+        break;
+    case InputEvent::Type::TouchFrame:
+        q->notifyTouchFrame();
+        break;
+    case InputEvent::Type::TouchCancel:
+        q->notifyTouchCancel();
+        break;
+    }
+
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const std::chrono::nanoseconds latency = std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec) - event.time;
+    switch (event.category()) {
+    case InputEvent::Category::Pointer:
+        pointerLatency.record(latency);
+        break;
+    case InputEvent::Category::Keyboard:
+        keyboardLatency.record(latency);
+        break;
+    case InputEvent::Category::Touch:
+        touchLatency.record(latency);
+        break;
+    }
+}
+
+void SeatInterface::setInputEventRing(InputEventRing *ring)
+{
+    if (d->inputEventRing == ring) {
+        return;
+    }
+    d->inputEventNotifier.reset();
+    d->inputEventRing = ring;
+    if (!ring) {
+        return;
+    }
+    if (ring->fileDescriptor() != -1) {
+        d->inputEventNotifier.reset(new QSocketNotifier(ring->fileDescriptor(), QSocketNotifier::Read));
+        connect(d->inputEventNotifier.data(), &QSocketNotifier::activated, this, [this] {
+            d->inputEventRing->acknowledgeWakeUp();
+            dispatchInputEvents();
+        });
+    }
+    dispatchInputEvents();
+}
+
+InputEventRing *SeatInterface::inputEventRing() const
+{
+    return d->inputEventRing;
+}
+
+int SeatInterface::dispatchInputEvents()
+{
+    if (!d->inputEventRing || d->inputEventRing->isEmpty()) {
+        return 0;
+    }
+    return d->inputEventRing->drain([this](const InputEvent &event) {
+        d->deliverInputEvent(event);
+    });
+}
+
+const InputLatencyHistogram &SeatInterface::pointerInputLatency() const
+{
+    return d->pointerLatency;
+}
+
+const InputLatencyHistogram &SeatInterface::keyboardInputLatency() const
+{
+    return d->keyboardLatency;
+}
+
+const InputLatencyHistogram &SeatInterface::touchInputLatency() const
+{
+    return d->touchLatency;
+}
+
+void SeatInterface::resetInputLatency()
+{
+    d->pointerLatency.reset();
+    d->keyboardLatency.reset();
+    d->touchLatency.reset();
+}
+
 void SeatInterface::setDragTarget(AbstractDropHandler *dropTarget,
                                   SurfaceInterface *surface,
                                   const QPointF &globalPosition,
@@ -748,6 +864,29 @@ void SeatInterface::notifyPointerFrame()
     d->pointer->sendFrame();
 }
 
+void SeatInterface::notifyPointerVblank()
+{
+    if (!d->pointer) {
+        return;
+    }
+    if (d->pointerMotionCoalescing == PointerMotionCoalescing::Vblank) {
+        d->pointer->flushMotion();
+    }
+}
+
+void SeatInterface::setPointerMotionCoalescing(PointerMotionCoalescing coalescing)
+{
+    d->pointerMotionCoalescing = coalescing;
+    if (d->pointer) {
+        d->pointer->setMotionCoalescing(coalescing);
+    }
+}
+
+PointerMotionCoalescing SeatInterface::pointerMotionCoalescing() const
+{
+    return d->pointerMotionCoalescing;
+}
+
 quint32 SeatInterface::pointerButtonSerial(Qt::MouseButton button) const
 {
     return pointerButtonSerial(qtToWaylandButton(button));
@@ -937,7 +1076,7 @@ void SeatInterface::setFocusedKeyboardSurface(SurfaceInterface *surface)
         d->globalKeyboard.focus.selections = dataDevices;
         for (auto dataDevice : dataDevices) {
             if (d->currentSelection) {
-                dataDevice->sendSelection(d->currentSelection);
+                dataDevice->sendSelection(d->offeredSelection());
             } else {
                 dataDevice->sendClearSelection();
             }
@@ -1292,21 +1431,27 @@ void SeatInterface::setSelection(AbstractDataSource *selection)
     }
 
     if (selection) {
-        auto cleanup = [this]() {
-            setSelection(nullptr);
+        auto cleanup = [this, selection]() {
+            // keep the content of a selection whose owner goes away
+            setSelection(d->selectionCache ? d->selectionCache->persist(selection) : nullptr);
         };
         connect(selection, &AbstractDataSource::aboutToBeDestroyed, this, cleanup);
     }
 
+    if (d->selectionCache && (!selection || selection != d->selectionCache->cachedSource())) {
+        d->selectionCache->capture(selection);
+    }
+
     d->currentSelection = selection;
 
     if (!d->currentSelection && d->currentCachedSelection) {
         d->currentSelection = d->currentCachedSelection;
     }
 
+    AbstractDataSource *offered = d->offeredSelection();
     for (auto focussedSelection : qAsConst(d->globalKeyboard.focus.selections)) {
-        if (d->currentSelection) {
-            focussedSelection->sendSelection(d->currentSelection);
+        if (offered) {
+            focussedSelection->sendSelection(offered);
         } else {
             focussedSelection->sendClearSelection();
         }
@@ -1314,7 +1459,7 @@ void SeatInterface::setSelection(AbstractDataSource *selection)
 
     for (auto control : qAsConst(d->dataControlDevices)) {
         if (selection) {
-            control->sendSelection(selection);
+            control->sendSelection(offered);
         } else {
             control->sendClearSelection();
         }
@@ -1323,6 +1468,25 @@ void SeatInterface::setSelection(AbstractDataSource *selection)
     Q_EMIT selectionChanged(selection);
 }
 
+void SeatInterface::setSelectionCache(SelectionCache *cache)
+{
+    if (d->selectionCache == cache) {
+        return;
+    }
+    if (d->selectionCache) {
+        d->selectionCache->clear();
+    }
+    d->selectionCache = cache;
+    if (cache && d->currentSelection) {
+        cache->capture(d->currentSelection);
+    }
+}
+
+SelectionCache *SeatInterface::selectionCache() const
+{
+    return d->selectionCache;
+}
+
 AbstractDataSource *SeatInterface::primarySelection() const
 {
     return d->currentPrimarySelection;
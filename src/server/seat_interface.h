@@ -22,9 +22,12 @@ class AbstractDropHandler;
 class DragAndDropIcon;
 class DataDeviceInterface;
 class Display;
+class InputEventRing;
+class InputLatencyHistogram;
 class KeyboardInterface;
 class PointerInterface;
 class SeatInterfacePrivate;
+class SelectionCache;
 class SurfaceInterface;
 class TextInputV2Interface;
 class TextInputV3Interface;
@@ -65,6 +68,30 @@ enum class PointerButtonState : quint32 {
     Pressed = 1,
 };
 
+/**
+ * This enum type is used to describe how pointer motion is delivered to the focused client.
+ *
+ * With coalescing the motion events between two deliveries are merged into a single
+ * @c wl_pointer.motion event with the latest position and timestamp. Button and axis events
+ * flush the merged motion first, so they are always delivered at the right position. Relative
+ * motion is never merged.
+ */
+enum class PointerMotionCoalescing {
+    /**
+     * Every motion event is sent right away.
+     */
+    Disabled,
+    /**
+     * Motion is merged until SeatInterface::notifyPointerFrame is called.
+     */
+    Frame,
+    /**
+     * Motion is merged until SeatInterface::notifyPointerVblank is called, pointer frames which
+     * carry nothing but motion are merged as well.
+     */
+    Vblank,
+};
+
 /**
  * This enum type is used to describe the state of a keyboard key. It is
  * equivalent to the @c wl_keyboard.key_state enum.
@@ -171,6 +198,47 @@ public:
     void setTimestamp(quint32 time);
     quint32 timestamp() const;
 
+    /**
+     * Installs @p ring to receive the input events of an input thread. Each event is delivered
+     * as if passed to setTimestamp() and the matching notify method. The ring is drained at the
+     * start of each Display::dispatchEvents() and whenever it wakes up the event loop.
+     *
+     * The input focus is still up to the compositor, e.g. it can update the focused pointer
+     * surface in reaction to pointerPosChanged.
+     *
+     * The SeatInterface does not take the ownership of @p ring. Pass @c null to uninstall it,
+     * which has to happen before the ring is destroyed.
+     *
+     * @see InputEventRing
+     */
+    void setInputEventRing(InputEventRing *ring);
+    /**
+     * @returns the installed InputEventRing, @c null by default
+     */
+    InputEventRing *inputEventRing() const;
+    /**
+     * Delivers the events queued in the installed InputEventRing right away.
+     *
+     * @returns the number of delivered events
+     */
+    int dispatchInputEvents();
+    /**
+     * @returns the latencies from the time of the pointer events passed through the
+     * InputEventRing to their delivery to clients
+     */
+    const InputLatencyHistogram &pointerInputLatency() const;
+    /**
+     * @returns the latencies from the time of the keyboard events passed through the
+     * InputEventRing to their delivery to clients
+     */
+    const InputLatencyHistogram &keyboardInputLatency() const;
+    /**
+     * @returns the latencies from the time of the touch events passed through the
+     * InputEventRing to their delivery to clients
+     */
+    const InputLatencyHistogram &touchInputLatency() const;
+    void resetInputLatency();
+
     /**
      * @name Drag'n'Drop related methods
      */
@@ -347,6 +415,27 @@ public:
      */
     void notifyPointerButton(Qt::MouseButton button, PointerButtonState state);
     void notifyPointerFrame();
+    /**
+     * Hints that the output showing the focused pointer surface is about to start a new frame.
+     * Delivers the merged pointer motion if the motion coalescing is PointerMotionCoalescing::Vblank,
+     * otherwise does nothing.
+     *
+     * @see setPointerMotionCoalescing
+     */
+    void notifyPointerVblank();
+    /**
+     * Sets how pointer motion is delivered to the focused client. The default is
+     * PointerMotionCoalescing::Disabled.
+     *
+     * Coalescing reduces the number of events sent to clients for high frequency pointing
+     * devices. PointerInterface::receivedMotionCount and PointerInterface::sentMotionCount
+     * tell how many motion events got merged.
+     */
+    void setPointerMotionCoalescing(PointerMotionCoalescing coalescing);
+    /**
+     * @returns how pointer motion is delivered to the focused client.
+     */
+    PointerMotionCoalescing pointerMotionCoalescing() const;
     /**
      * @returns whether the @p button is pressed
      */
@@ -408,6 +497,9 @@ public:
      * Sending relative pointer events only makes sense if the RelativePointerManagerInterface
      * is created on the Display.
      *
+     * Relative motion is sent right away regardless of the pointer motion coalescing, so no
+     * delta is ever lost.
+     *
      * @param delta Motion vector
      * @param deltaNonAccelerated non-accelerated motion vector
      * @param microseconds timestamp with microseconds granularity
@@ -660,6 +752,19 @@ public:
 
     void updateCachedSelection(AbstractDataSource *selection);
 
+    /**
+     * Installs @p cache to keep a copy of the clipboard selection. Clients are offered the
+     * cached copy, and the selection stays available after its source client went away.
+     * The SeatInterface does not take the ownership of @p cache. Pass @c null to stop caching.
+     *
+     * @see SelectionCache
+     */
+    void setSelectionCache(SelectionCache *cache);
+    /**
+     * @returns the installed SelectionCache, @c null by default
+     */
+    SelectionCache *selectionCache() const;
+
     KWaylandServer::AbstractDataSource *primarySelection() const;
     void setPrimarySelection(AbstractDataSource *selection);
 
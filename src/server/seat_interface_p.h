@@ -7,11 +7,13 @@
 #pragma once
 
 // KWayland
+#include "inputeventring.h"
 #include "seat_interface.h"
 // Qt
 #include <QHash>
 #include <QMap>
 #include <QPointer>
+#include <QSocketNotifier>
 #include <QVector>
 
 #include "qwayland-server-wayland.h"
@@ -26,6 +28,7 @@ class TextInputV2Interface;
 class TextInputV3Interface;
 class PrimarySelectionDeviceV1Interface;
 class DragAndDropIcon;
+class SelectionCache;
 
 class SeatInterfacePrivate : public QtWaylandServer::wl_seat
 {
@@ -41,6 +44,11 @@ public:
     void registerDataControlDevice(DataControlDeviceV1Interface *dataDevice);
     void endDrag(quint32 serial);
     void cancelDrag(quint32 serial);
+    /**
+     * The source offered to clients for the current selection, its cached copy if there is one.
+     */
+    AbstractDataSource *offeredSelection() const;
+    void deliverInputEvent(const InputEvent &event);
 
     SeatInterface *q;
     QPointer<Display> display;
@@ -50,6 +58,7 @@ public:
     quint32 capabilities = 0;
     QScopedPointer<KeyboardInterface> keyboard;
     QScopedPointer<PointerInterface> pointer;
+    PointerMotionCoalescing pointerMotionCoalescing = PointerMotionCoalescing::Disabled;
     QScopedPointer<TouchInterface> touch;
     QVector<DataDeviceInterface *> dataDevices;
     QVector<PrimarySelectionDeviceV1Interface *> primarySelectionDevices;
@@ -66,6 +75,14 @@ public:
     AbstractDataSource *currentSelection = nullptr;
     AbstractDataSource *currentPrimarySelection = nullptr;
     AbstractDataSource *currentCachedSelection = nullptr;
+    QPointer<SelectionCache> selectionCache;
+
+    // events pushed by an input thread
+    InputEventRing *inputEventRing = nullptr;
+    QScopedPointer<QSocketNotifier> inputEventNotifier;
+    InputLatencyHistogram pointerLatency;
+    InputLatencyHistogram keyboardLatency;
+    InputLatencyHistogram touchLatency;
 
     // Pointer related members
     struct Pointer {
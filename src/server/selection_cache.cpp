@@ -0,0 +1,415 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#include "selection_cache.h"
+#include "abstract_data_source.h"
+#include "blob_data_source.h"
+#include "logging.h"
+
+#include <QDeadlineTimer>
+#include <QHash>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace KWaylandServer
+{
+/**
+ * Offers the mime types of the captured source, serving the cached ones from memory.
+ */
+class CachedSelectionSource : public AbstractDataSource
+{
+public:
+    CachedSelectionSource(AbstractDataSource *source, QObject *parent)
+        : AbstractDataSource(parent)
+        , origin(source)
+        , source(source)
+    {
+        connect(source, &AbstractDataSource::mimeTypeOffered, this, &AbstractDataSource::mimeTypeOffered);
+    }
+    ~CachedSelectionSource() override
+    {
+        Q_EMIT aboutToBeDestroyed();
+    }
+
+    void requestData(const QString &mimeType, qint32 fd) override
+    {
+        if (blobs.mimeTypes().contains(mimeType)) {
+            blobs.requestData(mimeType, fd);
+        } else if (source) {
+            source->requestData(mimeType, fd);
+        } else {
+            close(fd);
+        }
+    }
+    void cancel() override
+    {
+        // the SeatInterface cancels the captured source itself
+    }
+    QStringList mimeTypes() const override
+    {
+        return source ? source->mimeTypes() : blobs.mimeTypes();
+    }
+
+    void orphan()
+    {
+        if (source) {
+            disconnect(source, nullptr, this, nullptr);
+            source = nullptr;
+        }
+    }
+
+    // only compared against, it may be gone
+    AbstractDataSource *origin;
+    AbstractDataSource *source;
+    BlobDataSource blobs;
+};
+
+/**
+ * The reads of one captured selection. Writing to the cancel pipe wakes up all of them.
+ */
+struct CaptureState {
+    CaptureState()
+    {
+        if (pipe2(cancelFds, O_CLOEXEC) == -1) {
+            cancelFds[0] = cancelFds[1] = -1;
+        }
+    }
+    ~CaptureState()
+    {
+        for (int fd : cancelFds) {
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+    }
+
+    void cancel()
+    {
+        if (cancelFds[1] != -1) {
+            const char c = 0;
+            while (write(cancelFds[1], &c, 1) == -1 && errno == EINTR) { }
+        }
+    }
+
+    int cancelFds[2];
+};
+
+/**
+ * Reads @p fd until end of file. Gives up if more than @p maximumSize bytes arrive, the writer
+ * stalls for @p timeout milliseconds or @p state gets cancelled.
+ */
+static bool readSelection(int fd, qint64 maximumSize, int timeout, const CaptureState &state, QByteArray *data)
+{
+    QDeadlineTimer deadline(timeout);
+    char buffer[64 * 1024];
+    while (true) {
+        pollfd fds[2] = {{fd, POLLIN, 0}, {state.cancelFds[0], POLLIN, 0}};
+        const int ready = poll(fds, 2, deadline.remainingTime());
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (ready == 0 || fds[1].revents) {
+            return false;
+        }
+        const ssize_t bytes = read(fd, buffer, sizeof(buffer));
+        if (bytes == 0) {
+            return true;
+        }
+        if (bytes < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return false;
+        }
+        if (data->size() + bytes > maximumSize) {
+            return false;
+        }
+        data->append(buffer, bytes);
+        deadline.setRemainingTime(timeout);
+    }
+}
+
+struct MimeTypePolicy {
+    SelectionCache::Policy policy;
+    qint64 maximumSize;
+};
+
+class SelectionCachePrivate
+{
+public:
+    SelectionCachePrivate(SelectionCache *q);
+
+    const MimeTypePolicy *policy(const QString &mimeType) const;
+    void startRead(const QString &mimeType, qint64 maximumSize);
+    void readFinished(quint32 serial, const QString &mimeType, bool success, const QByteArray &data);
+    void abortReads();
+
+    QHash<QString, MimeTypePolicy> policies;
+    qint64 maximumSize = 16 << 20;
+    int maximumMimeTypeCount = 8;
+    int readTimeout = 5000;
+
+    QPointer<AbstractDataSource> captured;
+    QScopedPointer<CachedSelectionSource> cachedSource;
+    QSharedPointer<CaptureState> capture;
+    quint32 serial = 0;
+    int pendingReads = 0;
+    qint64 cachedSize = 0;
+    QThreadPool threadPool;
+
+private:
+    SelectionCache *q;
+};
+
+SelectionCachePrivate::SelectionCachePrivate(SelectionCache *q)
+    : q(q)
+{
+    policies.insert(QStringLiteral("*"), {SelectionCache::Policy::Cache, 4 << 20});
+    threadPool.setMaxThreadCount(4);
+}
+
+const MimeTypePolicy *SelectionCachePrivate::policy(const QString &mimeType) const
+{
+    auto it = policies.constFind(mimeType);
+    if (it != policies.constEnd()) {
+        return &it.value();
+    }
+    // the longest matching prefix wins
+    const MimeTypePolicy *best = nullptr;
+    int bestLength = -1;
+    for (it = policies.constBegin(); it != policies.constEnd(); ++it) {
+        const QString &pattern = it.key();
+        if (!pattern.endsWith(QLatin1Char('*'))) {
+            continue;
+        }
+        const int length = pattern.size() - 1;
+        if (length > bestLength && mimeType.startsWith(QStringView(pattern).left(length))) {
+            best = &it.value();
+            bestLength = length;
+        }
+    }
+    return best;
+}
+
+void SelectionCachePrivate::startRead(const QString &mimeType, qint64 limit)
+{
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC | O_NONBLOCK) == -1) {
+        qCWarning(KWAYLAND_SERVER) << "Failed to create a pipe to cache the selection:" << strerror(errno);
+        return;
+    }
+    // the source takes the ownership of the write end
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) & ~O_NONBLOCK);
+    captured->requestData(mimeType, fds[1]);
+
+    ++pendingReads;
+    QtConcurrent::run(&threadPool, [this, fd = fds[0], serial = serial, state = capture, mimeType, limit, timeout = readTimeout] {
+        QByteArray data;
+        const bool success = readSelection(fd, limit, timeout, *state, &data);
+        close(fd);
+        // the SelectionCache waits for the reads before it goes away
+        QMetaObject::invokeMethod(
+            q,
+            [this, serial, mimeType, success, data] {
+                readFinished(serial, mimeType, success, data);
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+void SelectionCachePrivate::readFinished(quint32 readSerial, const QString &mimeType, bool success, const QByteArray &data)
+{
+    if (readSerial != serial || !cachedSource) {
+        return;
+    }
+    if (success && captured) {
+        if (cachedSize + data.size() > maximumSize) {
+            qCDebug(KWAYLAND_SERVER) << "Not caching" << mimeType << "of the selection, the cache is full";
+        } else if (cachedSource->blobs.setData(mimeType, data)) {
+            cachedSize += data.size();
+        }
+    }
+    if (--pendingReads == 0) {
+        Q_EMIT q->captureFinished(cachedSource->blobs.mimeTypes());
+    }
+}
+
+void SelectionCachePrivate::abortReads()
+{
+    if (capture) {
+        capture->cancel();
+        capture.reset();
+    }
+    ++serial;
+    if (pendingReads) {
+        pendingReads = 0;
+        if (cachedSource) {
+            Q_EMIT q->captureFinished(cachedSource->blobs.mimeTypes());
+        }
+    }
+}
+
+SelectionCache::SelectionCache(QObject *parent)
+    : QObject(parent)
+    , d(new SelectionCachePrivate(this))
+{
+}
+
+SelectionCache::~SelectionCache()
+{
+    clear();
+    d->threadPool.waitForDone();
+}
+
+void SelectionCache::setMimeTypePolicy(const QString &mimeType, Policy policy, qint64 maximumSize)
+{
+    d->policies.insert(mimeType, {policy, maximumSize});
+}
+
+SelectionCache::Policy SelectionCache::mimeTypePolicy(const QString &mimeType) const
+{
+    const MimeTypePolicy *policy = d->policy(mimeType);
+    return policy ? policy->policy : Policy::Skip;
+}
+
+qint64 SelectionCache::maximumMimeTypeSize(const QString &mimeType) const
+{
+    const MimeTypePolicy *policy = d->policy(mimeType);
+    if (!policy || policy->maximumSize < 0) {
+        return d->maximumSize;
+    }
+    return qMin(policy->maximumSize, d->maximumSize);
+}
+
+void SelectionCache::setMaximumSize(qint64 bytes)
+{
+    d->maximumSize = bytes;
+}
+
+qint64 SelectionCache::maximumSize() const
+{
+    return d->maximumSize;
+}
+
+void SelectionCache::setMaximumMimeTypeCount(int count)
+{
+    d->maximumMimeTypeCount = count;
+}
+
+int SelectionCache::maximumMimeTypeCount() const
+{
+    return d->maximumMimeTypeCount;
+}
+
+void SelectionCache::setReadTimeout(int msec)
+{
+    d->readTimeout = msec;
+}
+
+int SelectionCache::readTimeout() const
+{
+    return d->readTimeout;
+}
+
+void SelectionCache::capture(AbstractDataSource *source)
+{
+    if (d->captured == source && source) {
+        return;
+    }
+    clear();
+    if (!source) {
+        return;
+    }
+
+    d->captured = source;
+    d->cachedSource.reset(new CachedSelectionSource(source, this));
+    d->capture = QSharedPointer<CaptureState>::create();
+    connect(source, &AbstractDataSource::aboutToBeDestroyed, this, [this, source] {
+        persist(source);
+    });
+
+    int count = 0;
+    const QStringList mimeTypes = source->mimeTypes();
+    for (const QString &mimeType : mimeTypes) {
+        if (count == d->maximumMimeTypeCount) {
+            break;
+        }
+        if (mimeTypePolicy(mimeType) == Policy::Skip) {
+            continue;
+        }
+        d->startRead(mimeType, maximumMimeTypeSize(mimeType));
+        ++count;
+    }
+    if (!d->pendingReads) {
+        Q_EMIT captureFinished(QStringList());
+    }
+}
+
+void SelectionCache::clear()
+{
+    if (d->captured) {
+        disconnect(d->captured, nullptr, this, nullptr);
+    }
+    d->abortReads();
+    d->captured.clear();
+    d->cachedSource.reset();
+    d->cachedSize = 0;
+}
+
+AbstractDataSource *SelectionCache::persist(AbstractDataSource *source)
+{
+    if (!d->cachedSource || d->cachedSource->origin != source) {
+        return nullptr;
+    }
+    if (d->cachedSource->source) {
+        // whatever is still arriving may be cut off by the source client going away
+        d->abortReads();
+        disconnect(source, nullptr, this, nullptr);
+        d->captured.clear();
+        d->cachedSource->orphan();
+    }
+    if (d->cachedSource->blobs.mimeTypes().isEmpty()) {
+        return nullptr;
+    }
+    return d->cachedSource.data();
+}
+
+AbstractDataSource *SelectionCache::capturedSource() const
+{
+    return d->captured;
+}
+
+AbstractDataSource *SelectionCache::cachedSource() const
+{
+    return d->cachedSource.data();
+}
+
+QStringList SelectionCache::cachedMimeTypes() const
+{
+    return d->cachedSource ? d->cachedSource->blobs.mimeTypes() : QStringList();
+}
+
+qint64 SelectionCache::cachedSize() const
+{
+    return d->cachedSize;
+}
+
+bool SelectionCache::isCapturing() const
+{
+    return d->pendingReads > 0;
+}
+
+}
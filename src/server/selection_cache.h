@@ -0,0 +1,140 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#pragma once
+
+#include <QObject>
+
+#include <DWayland/Server/kwaylandserver_export.h>
+
+namespace KWaylandServer
+{
+class AbstractDataSource;
+class SelectionCachePrivate;
+
+/**
+ * @brief The SelectionCache class keeps a copy of the clipboard selection in the compositor.
+ *
+ * When a SelectionCache is installed on a SeatInterface, each new selection is read right
+ * away for a bounded set of its mime types. The reads happen on worker threads, the event
+ * loop never waits for the source client. Clients are offered the cachedSource() instead of
+ * the selection itself, which serves the captured mime types from memory and forwards the
+ * others to the source client as long as it exists. When the source client goes away, the
+ * cachedSource() becomes the selection, so the clipboard content survives its owner.
+ *
+ * @code
+ * auto cache = new SelectionCache(seat);
+ * cache->setMimeTypePolicy(QStringLiteral("image/*"), SelectionCache::Policy::Cache, 32 << 20);
+ * cache->setMimeTypePolicy(QStringLiteral("application/x-kde-*"), SelectionCache::Policy::Skip);
+ * seat->setSelectionCache(cache);
+ * @endcode
+ *
+ * @see SeatInterface::setSelectionCache
+ */
+class KWAYLANDSERVER_EXPORT SelectionCache : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Policy {
+        /**
+         * The mime type is read when the selection is set, up to its size limit.
+         */
+        Cache,
+        /**
+         * The mime type is never read, it is only available while the source client exists.
+         */
+        Skip,
+    };
+    Q_ENUM(Policy)
+
+    explicit SelectionCache(QObject *parent = nullptr);
+    ~SelectionCache() override;
+
+    /**
+     * Sets the @p policy and the @p maximumSize in bytes for @p mimeType. The mime type can be
+     * a full name, a prefix followed by a @c * like @c "image/*", or just @c "*" for all the mime
+     * types without a more specific policy. A negative @p maximumSize means maximumSize().
+     *
+     * By default all mime types are cached with a limit of 4 MiB each.
+     */
+    void setMimeTypePolicy(const QString &mimeType, Policy policy, qint64 maximumSize = -1);
+    /**
+     * @returns the policy which applies to @p mimeType
+     */
+    Policy mimeTypePolicy(const QString &mimeType) const;
+    /**
+     * @returns the size limit which applies to @p mimeType
+     */
+    qint64 maximumMimeTypeSize(const QString &mimeType) const;
+
+    /**
+     * Sets the maximum number of bytes cached for one selection, over all its mime types.
+     * The default is 16 MiB.
+     */
+    void setMaximumSize(qint64 bytes);
+    qint64 maximumSize() const;
+    /**
+     * Sets the maximum number of mime types read from one selection. The mime types are read
+     * in the order the source offered them. The default is 8.
+     */
+    void setMaximumMimeTypeCount(int count);
+    int maximumMimeTypeCount() const;
+    /**
+     * Sets how long in milliseconds the source client may stall before reading a mime type is
+     * given up. The default is 5 seconds.
+     */
+    void setReadTimeout(int msec);
+    int readTimeout() const;
+
+    /**
+     * Starts caching @p source, dropping what was cached before. This is done by the
+     * SeatInterface for every new selection.
+     */
+    void capture(AbstractDataSource *source);
+    /**
+     * Drops the cached selection.
+     */
+    void clear();
+    /**
+     * Tells the cache that @p source is about to go away. Reads still in progress are aborted.
+     *
+     * @returns the cachedSource() if it holds any data of @p source, otherwise @c null
+     */
+    AbstractDataSource *persist(AbstractDataSource *source);
+
+    /**
+     * @returns the selection being cached, @c null once it is gone
+     */
+    AbstractDataSource *capturedSource() const;
+    /**
+     * @returns the source offered to clients in place of capturedSource(), @c null if
+     * nothing is cached
+     */
+    AbstractDataSource *cachedSource() const;
+    /**
+     * @returns the mime types whose data is held in memory
+     */
+    QStringList cachedMimeTypes() const;
+    /**
+     * @returns the number of bytes held in memory
+     */
+    qint64 cachedSize() const;
+    /**
+     * @returns whether reads of the captured selection are still in progress
+     */
+    bool isCapturing() const;
+
+Q_SIGNALS:
+    /**
+     * Emitted when all reads of the captured selection ended, with the @p mimeTypes now held
+     * in memory.
+     */
+    void captureFinished(const QStringList &mimeTypes);
+
+private:
+    QScopedPointer<SelectionCachePrivate> d;
+};
+
+}
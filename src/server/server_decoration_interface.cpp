@@ -69,10 +69,7 @@ void ServerSideDecorationManagerInterfacePrivate::setDefaultMode(ServerSideDecor
     defaultMode = mode;
     const uint32_t wlMode = modeWayland(mode);
 
-    const auto clientResources = resourceMap();
-    for (Resource *resource : clientResources) {
-        send_default_mode(resource->handle, wlMode);
-    }
+    broadcast_default_mode(wlMode);
 }
 
 ServerSideDecorationManagerInterfacePrivate::ServerSideDecorationManagerInterfacePrivate(ServerSideDecorationManagerInterface *_q, Display *display)
@@ -6,20 +6,204 @@
 
 #include "shmclientbuffer.h"
 #include "clientbuffer_p.h"
+#include "shmclientbuffer_p.h"
 #include "display.h"
+#include "logging.h"
+
+#include <QAbstractEventDispatcher>
+#include <QMutex>
+#include <QPointer>
+#include <QThread>
+
+#include <atomic>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include <wayland-server-core.h>
 #include <wayland-server-protocol.h>
 
 namespace KWaylandServer
 {
-static const ShmClientBuffer *s_accessedBuffer = nullptr;
-static int s_accessCounter = 0;
+class ShmClientBufferPrivate;
+
+/**
+ * A wl_shm_buffer mapping shared by all QImages returned by ShmClientBuffer::data().
+ *
+ * The mapping keeps a reference on the shm pool, which defers pool resizes and keeps the
+ * data pointer stable, and registers the buffer range with the SIGBUS guard.
+ */
+struct ShmAccess {
+    ShmClientBufferPrivate *owner = nullptr;
+    QThread *displayThread = nullptr;
+    wl_shm_pool *pool = nullptr;
+    const uchar *data = nullptr;
+    int refCount = 0;
+    int guardSlot = -1;
+};
+
+/**
+ * SIGBUS protection for concurrently accessed shm buffers.
+ *
+ * libwayland's wl_shm_buffer_begin_access() tracks a single pool per thread, so it can't be
+ * used to access several buffers at once. Instead every accessed buffer range is registered
+ * in a fixed table which the signal handler scans without locking. When a client truncates
+ * the file behind a pool, the faulting page is replaced with zeroes and the client gets
+ * disconnected once the access ends.
+ */
+struct ShmGuardSlot {
+    std::atomic<uintptr_t> begin{0};
+    std::atomic<uintptr_t> end{0};
+    std::atomic<bool> faulted{false};
+};
+
+static const int s_guardSlotCount = 512;
+static ShmGuardSlot s_guardSlots[s_guardSlotCount];
+static struct sigaction s_oldSigbusAction;
+static uintptr_t s_pageSize = 0;
+// set while a fault is passed on to the previous handler
+static thread_local bool s_chainingSigbus = false;
+
+// guards ShmAccess bookkeeping, never taken in the signal handler
+static QMutex s_accessLock;
+// guards (re)installing the signal handler
+static QMutex s_sigbusLock;
+
+static void reraiseSigbus(int signum, siginfo_t *info, void *context)
+{
+    if (s_chainingSigbus) {
+        // The previous handler put ours back and raised again, e.g. libwayland's handler
+        // for a fault outside of its pool. The fault belongs to nobody.
+        struct sigaction defaultAction;
+        sigemptyset(&defaultAction.sa_mask);
+        defaultAction.sa_flags = 0;
+        defaultAction.sa_handler = SIG_DFL;
+        sigaction(SIGBUS, &defaultAction, nullptr);
+        raise(SIGBUS);
+        return;
+    }
+    if (s_oldSigbusAction.sa_flags & SA_SIGINFO) {
+        if (s_oldSigbusAction.sa_sigaction) {
+            s_chainingSigbus = true;
+            s_oldSigbusAction.sa_sigaction(signum, info, context);
+            s_chainingSigbus = false;
+            return;
+        }
+    } else if (s_oldSigbusAction.sa_handler != SIG_DFL && s_oldSigbusAction.sa_handler != SIG_IGN) {
+        s_chainingSigbus = true;
+        s_oldSigbusAction.sa_handler(signum);
+        s_chainingSigbus = false;
+        return;
+    }
+    sigaction(SIGBUS, &s_oldSigbusAction, nullptr);
+    raise(SIGBUS);
+}
+
+static void sigbusHandler(int signum, siginfo_t *info, void *context)
+{
+    const uintptr_t address = reinterpret_cast<uintptr_t>(info->si_addr);
+    for (ShmGuardSlot &slot : s_guardSlots) {
+        const uintptr_t begin = slot.begin.load(std::memory_order_acquire);
+        if (!begin || address < begin || address >= slot.end.load(std::memory_order_acquire)) {
+            continue;
+        }
+        slot.faulted.store(true, std::memory_order_release);
+        // Only pages entirely beyond the end of the file fault, replace the page with
+        // zeroes and let the access be retried.
+        void *page = reinterpret_cast<void *>(address & ~(s_pageSize - 1));
+        if (mmap(page, s_pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0) == MAP_FAILED) {
+            break;
+        }
+        return;
+    }
+    reraiseSigbus(signum, info, context);
+}
+
+static bool isSigbusHandlerInstalled(const struct sigaction &current)
+{
+    return (current.sa_flags & SA_SIGINFO) && current.sa_sigaction == sigbusHandler;
+}
+
+/**
+ * Installs the SIGBUS handler, or installs it again in front of a handler that was installed
+ * after it, e.g. by wl_shm_buffer_begin_access() in the compositor. Faults outside of the
+ * guarded ranges are passed on to the replaced handler.
+ */
+static void installSigbusHandler()
+{
+    struct sigaction current;
+    if (sigaction(SIGBUS, nullptr, &current) == 0 && isSigbusHandlerInstalled(current)) {
+        return;
+    }
+    QMutexLocker locker(&s_sigbusLock);
+    if (sigaction(SIGBUS, nullptr, &current) != 0 || isSigbusHandlerInstalled(current)) {
+        return;
+    }
+    if (!s_pageSize) {
+        s_pageSize = sysconf(_SC_PAGESIZE);
+    }
+    // ours isn't installed while the previous handler is replaced
+    s_oldSigbusAction = current;
+
+    struct sigaction action;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    action.sa_sigaction = sigbusHandler;
+    sigaction(SIGBUS, &action, nullptr);
+}
+
+int registerShmGuardRange(const void *data, size_t size)
+{
+    installSigbusHandler();
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(data);
+    for (int i = 0; i < s_guardSlotCount; ++i) {
+        ShmGuardSlot &slot = s_guardSlots[i];
+        uintptr_t expected = 0;
+        if (!slot.begin.compare_exchange_strong(expected, begin, std::memory_order_acq_rel)) {
+            continue;
+        }
+        // the range stays empty for the handler until the end is published
+        slot.faulted.store(false, std::memory_order_relaxed);
+        slot.end.store(begin + size, std::memory_order_release);
+        return i;
+    }
+    return -1;
+}
+
+bool unregisterShmGuardRange(int slot)
+{
+    ShmGuardSlot &guardSlot = s_guardSlots[slot];
+    guardSlot.end.store(0, std::memory_order_release);
+    const bool faulted = guardSlot.faulted.load(std::memory_order_acquire);
+    guardSlot.begin.store(0, std::memory_order_release);
+    return faulted;
+}
+
+/**
+ * Runs @p function on @p thread, which must be the thread the Display dispatches on.
+ * The shm pool reference counts are not atomic, so they may only be touched there.
+ */
+template<typename Function>
+static void runOnDisplayThread(QThread *thread, Function function)
+{
+    if (!thread || QThread::currentThread() == thread) {
+        function();
+        return;
+    }
+    if (QAbstractEventDispatcher *dispatcher = QAbstractEventDispatcher::instance(thread)) {
+        QMetaObject::invokeMethod(dispatcher, function, Qt::QueuedConnection);
+        return;
+    }
+    // without an event loop on the display thread the function would never run and leak the pool
+    function();
+}
 
 class ShmClientBufferPrivate : public ClientBufferPrivate
 {
 public:
     ShmClientBufferPrivate(ShmClientBuffer *q);
+    ~ShmClientBufferPrivate() override;
 
     static void buffer_destroy_callback(wl_listener *listener, void *data);
 
@@ -27,8 +211,10 @@ public:
     QImage::Format format = QImage::Format_Invalid;
     uint32_t width = 0;
     uint32_t height = 0;
+    uint32_t stride = 0;
     bool hasAlphaChannel = false;
     QImage savedData;
+    ShmAccess *access = nullptr;
 
     struct DestroyListener {
         wl_listener listener;
@@ -42,9 +228,28 @@ ShmClientBufferPrivate::ShmClientBufferPrivate(ShmClientBuffer *q)
 {
 }
 
-static void cleanupShmPool(void *poolHandle)
+ShmClientBufferPrivate::~ShmClientBufferPrivate()
 {
-    wl_shm_pool_unref(static_cast<wl_shm_pool *>(poolHandle));
+    // images handed out by data() may outlive the buffer
+    QMutexLocker locker(&s_accessLock);
+    if (access) {
+        access->owner = nullptr;
+    }
+}
+
+struct SavedPool {
+    wl_shm_pool *pool;
+    QThread *displayThread;
+};
+
+static void cleanupShmPool(void *savedPoolHandle)
+{
+    auto savedPool = static_cast<SavedPool *>(savedPoolHandle);
+    wl_shm_pool *pool = savedPool->pool;
+    runOnDisplayThread(savedPool->displayThread, [pool]() {
+        wl_shm_pool_unref(pool);
+    });
+    delete savedPool;
 }
 
 void ShmClientBufferPrivate::buffer_destroy_callback(wl_listener *listener, void *data)
@@ -64,7 +269,7 @@ void ShmClientBufferPrivate::buffer_destroy_callback(wl_listener *listener, void
                                       wl_shm_buffer_get_stride(buffer),
                                       bufferPrivate->format,
                                       cleanupShmPool,
-                                      pool);
+                                      new SavedPool{pool, bufferPrivate->q->thread()});
 }
 
 static bool alphaChannelFromFormat(uint32_t format)
@@ -112,6 +317,7 @@ ShmClientBuffer::ShmClientBuffer(wl_resource *resource)
     wl_shm_buffer *buffer = wl_shm_buffer_get(resource);
     d->width = wl_shm_buffer_get_width(buffer);
     d->height = wl_shm_buffer_get_height(buffer);
+    d->stride = wl_shm_buffer_get_stride(buffer);
     d->hasAlphaChannel = alphaChannelFromFormat(wl_shm_buffer_get_format(buffer));
     d->format = imageFormatForShmFormat(wl_shm_buffer_get_format(buffer));
 
@@ -139,30 +345,62 @@ ClientBuffer::Origin ShmClientBuffer::origin() const
     return Origin::TopLeft;
 }
 
-static void cleanupShmData(void *bufferHandle)
+static void cleanupShmAccess(void *accessHandle)
 {
-    Q_ASSERT_X(s_accessCounter > 0, "cleanup", "access counter must be positive");
-    s_accessCounter--;
-    if (s_accessCounter == 0) {
-        s_accessedBuffer = nullptr;
+    auto access = static_cast<ShmAccess *>(accessHandle);
+
+    QMutexLocker locker(&s_accessLock);
+    Q_ASSERT_X(access->refCount > 0, "cleanup", "access counter must be positive");
+    if (--access->refCount > 0) {
+        return;
+    }
+    if (access->owner) {
+        access->owner->access = nullptr;
     }
-    wl_shm_buffer_end_access(static_cast<wl_shm_buffer *>(bufferHandle));
+    const bool faulted = access->guardSlot != -1 && unregisterShmGuardRange(access->guardSlot);
+    QPointer<ShmClientBuffer> buffer = access->owner ? access->owner->q : nullptr;
+    locker.unlock();
+
+    wl_shm_pool *pool = access->pool;
+    runOnDisplayThread(access->displayThread, [pool, faulted, buffer]() {
+        if (faulted && buffer && buffer->resource()) {
+            wl_resource_post_error(buffer->resource(), WL_SHM_ERROR_INVALID_FD, "error accessing SHM buffer");
+        }
+        wl_shm_pool_unref(pool);
+    });
+    delete access;
 }
 
 QImage ShmClientBuffer::data() const
 {
-    if (s_accessedBuffer && s_accessedBuffer != this) {
+    Q_D(const ShmClientBuffer);
+    auto dd = const_cast<ShmClientBufferPrivate *>(d);
+
+    QMutexLocker locker(&s_accessLock);
+    if (ShmAccess *access = dd->access) {
+        access->refCount++;
+        return QImage(access->data, d->width, d->height, d->stride, d->format, cleanupShmAccess, access);
+    }
+
+    if (QThread::currentThread() != thread()) {
+        // only the display thread may take a reference on the shm pool
+        qCWarning(KWAYLAND_SERVER) << "ShmClientBuffer::data() called off the display thread for a buffer not mapped on it";
         return QImage();
     }
 
-    Q_D(const ShmClientBuffer);
     if (wl_shm_buffer *buffer = wl_shm_buffer_get(resource())) {
-        s_accessedBuffer = this;
-        s_accessCounter++;
-        wl_shm_buffer_begin_access(buffer);
-        const uchar *data = static_cast<const uchar *>(wl_shm_buffer_get_data(buffer));
-        const uint32_t stride = wl_shm_buffer_get_stride(buffer);
-        return QImage(data, d->width, d->height, stride, d->format, cleanupShmData, buffer);
+        auto access = new ShmAccess;
+        access->owner = dd;
+        access->displayThread = thread();
+        access->pool = wl_shm_buffer_ref_pool(buffer);
+        access->data = static_cast<const uchar *>(wl_shm_buffer_get_data(buffer));
+        access->refCount = 1;
+        access->guardSlot = registerShmGuardRange(access->data, size_t(d->stride) * d->height);
+        if (access->guardSlot == -1) {
+            qCWarning(KWAYLAND_SERVER) << "Too many shm buffers accessed at once, accessing" << this << "without SIGBUS protection";
+        }
+        dd->access = access;
+        return QImage(access->data, d->width, d->height, d->stride, d->format, cleanupShmAccess, access);
     }
     return d->savedData;
 }
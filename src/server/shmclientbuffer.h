@@ -16,8 +16,9 @@ class ShmClientBufferPrivate;
 /**
  * The ShmClientBuffer class represents a wl_shm_buffer client buffer.
  *
- * The buffer's data can be accessed using the data() function. Note that it is not allowed
- * to access data of several shared memory buffers simultaneously.
+ * The buffer's data can be accessed using the data() function. Any number of shared memory
+ * buffers can be accessed simultaneously, each access is protected against the client
+ * truncating the file backing the buffer.
  */
 class KWAYLANDSERVER_EXPORT ShmClientBuffer : public ClientBuffer
 {
@@ -27,6 +28,15 @@ class KWAYLANDSERVER_EXPORT ShmClientBuffer : public ClientBuffer
 public:
     explicit ShmClientBuffer(wl_resource *resource);
 
+    /**
+     * Returns an image referencing the buffer's data, the buffer stays mapped as long as
+     * any image returned by this function, or a copy of it, is alive.
+     *
+     * The returned images can be read and released on any thread. Mapping the buffer takes
+     * a reference on the client's shm pool though, which is only possible on the thread the
+     * Display dispatches on. Calling this function on another thread returns a null image
+     * unless the buffer is currently mapped.
+     */
     QImage data() const;
 
     QSize size() const override;
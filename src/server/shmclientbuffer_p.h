@@ -0,0 +1,28 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+namespace KWaylandServer
+{
+/**
+ * Protects [@p data, @p data + @p size) of a mapped shm buffer against SIGBUS, for code
+ * accessing wl_shm_buffer data directly instead of going through ShmClientBuffer::data().
+ *
+ * Returns the guard slot to pass to unregisterShmGuardRange(), or @c -1 if too many
+ * ranges are guarded already.
+ */
+int registerShmGuardRange(const void *data, size_t size);
+
+/**
+ * Removes the guard @p slot. Returns @c true if a SIGBUS was caught in its range, in
+ * which case the client owning the buffer should be sent an error.
+ */
+bool unregisterShmGuardRange(int slot);
+
+} // namespace KWaylandServer
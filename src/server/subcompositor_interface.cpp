@@ -177,7 +177,10 @@ void SubSurfaceInterfacePrivate::parentCommit()
 {
     if (hasPendingPosition) {
         hasPendingPosition = false;
-        position = pendingPosition;
+        if (position != pendingPosition) {
+            position = pendingPosition;
+            SurfaceInterfacePrivate::get(parent)->invalidateHitTest();
+        }
         Q_EMIT q->positionChanged(position);
     }
 
@@ -9,26 +9,45 @@
 #include "clientconnection.h"
 #include "compositor_interface.h"
 #include "display.h"
+#include "framecallbackscheduler.h"
 #include "idleinhibit_v1_interface_p.h"
 #include "linuxdmabufv1clientbuffer.h"
 #include "pointerconstraints_v1_interface_p.h"
+#include "presentationtime_interface.h"
 #include "region_interface_p.h"
 #include "subcompositor_interface.h"
 #include "subsurface_interface_p.h"
 #include "surface_interface_p.h"
 #include "surfacerole_p.h"
 #include "utils.h"
+
+#include "qwayland-server-presentation-time.h"
 // std
 #include <algorithm>
 
 namespace KWaylandServer
 {
+static void discardPresentationFeedbacks(wl_list *feedbacks)
+{
+    wl_resource *resource;
+    wl_resource *tmp;
+
+    wl_resource_for_each_safe(resource, tmp, feedbacks)
+    {
+        wp_presentation_feedback_send_discarded(resource);
+        wl_resource_destroy(resource);
+    }
+}
+
 SurfaceInterfacePrivate::SurfaceInterfacePrivate(SurfaceInterface *q)
     : q(q)
 {
     wl_list_init(&current.frameCallbacks);
     wl_list_init(&pending.frameCallbacks);
     wl_list_init(&cached.frameCallbacks);
+    wl_list_init(&current.presentationFeedbacks);
+    wl_list_init(&pending.presentationFeedbacks);
+    wl_list_init(&cached.presentationFeedbacks);
 }
 
 SurfaceInterfacePrivate::~SurfaceInterfacePrivate()
@@ -48,6 +67,9 @@ SurfaceInterfacePrivate::~SurfaceInterfacePrivate()
     {
         wl_resource_destroy(resource);
     }
+    discardPresentationFeedbacks(&current.presentationFeedbacks);
+    discardPresentationFeedbacks(&pending.presentationFeedbacks);
+    discardPresentationFeedbacks(&cached.presentationFeedbacks);
 
     if (current.buffer) {
         current.buffer->unref();
@@ -61,6 +83,7 @@ void SurfaceInterfacePrivate::addChild(SubSurfaceInterface *child)
     cached.above.append(child);
     current.above.append(child);
     child->surface()->setOutputs(outputs);
+    invalidateHitTest();
     Q_EMIT q->childSubSurfaceAdded(child);
     Q_EMIT q->childSubSurfacesChanged();
 }
@@ -74,6 +97,7 @@ void SurfaceInterfacePrivate::removeChild(SubSurfaceInterface *child)
     cached.above.removeAll(child);
     current.below.removeAll(child);
     current.above.removeAll(child);
+    invalidateHitTest();
     Q_EMIT q->childSubSurfaceRemoved(child);
     Q_EMIT q->childSubSurfacesChanged();
 }
@@ -245,20 +269,21 @@ void SurfaceInterfacePrivate::surface_attach(Resource *resource, struct ::wl_res
     if (!buffer) {
         // got a null buffer, deletes content in next frame
         pending.buffer = nullptr;
-        pending.damage = QRegion();
-        pending.bufferDamage = QRegion();
+        pending.damage.clear();
+        pending.bufferDamage.clear();
         return;
     }
     pending.buffer = compositor->display()->clientBufferForResource(buffer);
 
     // set default damage to force initial rendering
     auto bufferSize = pending.buffer->size();
-    pending.damage = QRegion(0, 0, bufferSize.width(), bufferSize.height());
+    pending.damage.clear();
+    pending.damage.add(QRect(0, 0, bufferSize.width(), bufferSize.height()));
 }
 
 void SurfaceInterfacePrivate::surface_damage(Resource *, int32_t x, int32_t y, int32_t width, int32_t height)
 {
-    pending.damage |= QRect(x, y, width, height);
+    pending.damage.add(QRect(x, y, width, height), compositor->damageRectThreshold());
 }
 
 void SurfaceInterfacePrivate::surface_frame(Resource *resource, uint32_t callback)
@@ -328,7 +353,7 @@ void SurfaceInterfacePrivate::surface_set_buffer_scale(Resource *resource, int32
 void SurfaceInterfacePrivate::surface_damage_buffer(Resource *resource, int32_t x, int32_t y, int32_t width, int32_t height)
 {
     Q_UNUSED(resource)
-    pending.bufferDamage |= QRect(x, y, width, height);
+    pending.bufferDamage.add(QRect(x, y, width, height), compositor->damageRectThreshold());
 }
 
 SurfaceInterface::SurfaceInterface(CompositorInterface *compositor, wl_resource *resource)
@@ -364,17 +389,34 @@ CompositorInterface *SurfaceInterface::compositor() const
     return d->compositor;
 }
 
-void SurfaceInterface::frameRendered(quint32 msec)
+void SurfaceInterfacePrivate::sendFrameCallbacks(quint32 msec)
 {
-    // notify all callbacks
     wl_resource *resource;
     wl_resource *tmp;
 
-    wl_resource_for_each_safe(resource, tmp, &d->current.frameCallbacks)
+    wl_resource_for_each_safe(resource, tmp, &current.frameCallbacks)
     {
         wl_callback_send_done(resource, msec);
         wl_resource_destroy(resource);
     }
+}
+
+void SurfaceInterfacePrivate::scheduleFrameCallbacks(const QVector<OutputInterface *> &outputs)
+{
+    if (wl_list_empty(&current.frameCallbacks)) {
+        return;
+    }
+    for (OutputInterface *output : outputs) {
+        if (FrameCallbackScheduler *scheduler = FrameCallbackScheduler::get(output)) {
+            scheduler->schedule(q);
+        }
+    }
+}
+
+void SurfaceInterface::frameRendered(quint32 msec)
+{
+    // notify all callbacks
+    d->sendFrameCallbacks(msec);
 
     for (SubSurfaceInterface *subsurface : qAsConst(d->current.below)) {
         subsurface->surface()->frameRendered(msec);
@@ -389,70 +431,66 @@ bool SurfaceInterface::hasFrameCallbacks() const
     return !wl_list_empty(&d->current.frameCallbacks);
 }
 
-QMatrix4x4 SurfaceInterfacePrivate::buildSurfaceToBufferMatrix()
+void SurfaceInterface::sendPresented(OutputInterface *output, std::chrono::nanoseconds timestamp, quint64 sequence, PresentationInterface::Kinds kinds)
 {
-    // The order of transforms is reversed, i.e. the viewport transform is the first one.
+    wl_resource *resource;
+    wl_resource *tmp;
 
-    QMatrix4x4 surfaceToBufferMatrix;
+    const quint64 seconds = timestamp.count() / 1000000000;
+    const quint32 nanoseconds = timestamp.count() % 1000000000;
+    // the refresh rate is in mHz
+    const quint32 refresh = output && output->refreshRate() > 0 ? 1000000000000ll / output->refreshRate() : 0;
 
-    if (!current.buffer) {
-        return surfaceToBufferMatrix;
-    }
-
-    surfaceToBufferMatrix.scale(current.bufferScale, current.bufferScale);
-
-    switch (current.bufferTransform) {
-    case OutputInterface::Transform::Normal:
-    case OutputInterface::Transform::Flipped:
-        break;
-    case OutputInterface::Transform::Rotated90:
-    case OutputInterface::Transform::Flipped90:
-        surfaceToBufferMatrix.translate(0, bufferSize.height() / current.bufferScale);
-        surfaceToBufferMatrix.rotate(-90, 0, 0, 1);
-        break;
-    case OutputInterface::Transform::Rotated180:
-    case OutputInterface::Transform::Flipped180:
-        surfaceToBufferMatrix.translate(bufferSize.width() / current.bufferScale, bufferSize.height() / current.bufferScale);
-        surfaceToBufferMatrix.rotate(-180, 0, 0, 1);
-        break;
-    case OutputInterface::Transform::Rotated270:
-    case OutputInterface::Transform::Flipped270:
-        surfaceToBufferMatrix.translate(bufferSize.width() / current.bufferScale, 0);
-        surfaceToBufferMatrix.rotate(-270, 0, 0, 1);
-        break;
-    }
-
-    switch (current.bufferTransform) {
-    case OutputInterface::Transform::Flipped:
-    case OutputInterface::Transform::Flipped180:
-        surfaceToBufferMatrix.translate(bufferSize.width() / current.bufferScale, 0);
-        surfaceToBufferMatrix.scale(-1, 1);
-        break;
-    case OutputInterface::Transform::Flipped90:
-    case OutputInterface::Transform::Flipped270:
-        surfaceToBufferMatrix.translate(bufferSize.height() / current.bufferScale, 0);
-        surfaceToBufferMatrix.scale(-1, 1);
-        break;
-    default:
-        break;
-    }
-
-    if (current.viewport.sourceGeometry.isValid()) {
-        surfaceToBufferMatrix.translate(current.viewport.sourceGeometry.x(), current.viewport.sourceGeometry.y());
-    }
-
-    QSizeF sourceSize;
-    if (current.viewport.sourceGeometry.isValid()) {
-        sourceSize = current.viewport.sourceGeometry.size();
-    } else {
-        sourceSize = implicitSurfaceSize;
+    wl_resource_for_each_safe(resource, tmp, &d->current.presentationFeedbacks)
+    {
+        if (output) {
+            const QVector<wl_resource *> outputResources = output->clientResources(client());
+            for (wl_resource *outputResource : outputResources) {
+                wp_presentation_feedback_send_sync_output(resource, outputResource);
+            }
+        }
+        wp_presentation_feedback_send_presented(resource,
+                                                seconds >> 32,
+                                                seconds & 0xffffffff,
+                                                nanoseconds,
+                                                refresh,
+                                                sequence >> 32,
+                                                sequence & 0xffffffff,
+                                                uint32_t(kinds));
+        wl_resource_destroy(resource);
     }
 
-    if (sourceSize != surfaceSize) {
-        surfaceToBufferMatrix.scale(sourceSize.width() / surfaceSize.width(), sourceSize.height() / surfaceSize.height());
+    for (SubSurfaceInterface *subsurface : qAsConst(d->current.below)) {
+        subsurface->surface()->sendPresented(output, timestamp, sequence, kinds);
     }
+    for (SubSurfaceInterface *subsurface : qAsConst(d->current.above)) {
+        subsurface->surface()->sendPresented(output, timestamp, sequence, kinds);
+    }
+}
 
-    return surfaceToBufferMatrix;
+void SurfaceInterface::sendDiscarded()
+{
+    discardPresentationFeedbacks(&d->current.presentationFeedbacks);
+
+    for (SubSurfaceInterface *subsurface : qAsConst(d->current.below)) {
+        subsurface->surface()->sendDiscarded();
+    }
+    for (SubSurfaceInterface *subsurface : qAsConst(d->current.above)) {
+        subsurface->surface()->sendDiscarded();
+    }
+}
+
+bool SurfaceInterface::hasPresentationFeedback() const
+{
+    return !wl_list_empty(&d->current.presentationFeedbacks);
+}
+
+SurfaceTransform SurfaceInterfacePrivate::buildSurfaceToBufferTransform() const
+{
+    if (!current.buffer) {
+        return SurfaceTransform();
+    }
+    return SurfaceTransform(current.bufferTransform, current.bufferScale, bufferSize, current.viewport.sourceGeometry, surfaceSize);
 }
 
 void SurfaceState::mergeInto(SurfaceState *target)
@@ -478,6 +516,9 @@ void SurfaceState::mergeInto(SurfaceState *target)
         target->childrenChanged = true;
     }
     wl_list_insert_list(&target->frameCallbacks, &frameCallbacks);
+    // the content update the target had feedback for is superseded
+    discardPresentationFeedbacks(&target->presentationFeedbacks);
+    wl_list_insert_list(&target->presentationFeedbacks, &presentationFeedbacks);
 
     if (shadowIsSet) {
         target->shadow = shadow;
@@ -516,6 +557,7 @@ void SurfaceState::mergeInto(SurfaceState *target)
     below = target->below;
     above = target->above;
     wl_list_init(&frameCallbacks);
+    wl_list_init(&presentationFeedbacks);
 }
 
 void SurfaceInterfacePrivate::applyState(SurfaceState *next)
@@ -533,10 +575,11 @@ void SurfaceInterfacePrivate::applyState(SurfaceState *next)
 
     const QSize oldSurfaceSize = surfaceSize;
     const QSize oldBufferSize = bufferSize;
-    const QMatrix4x4 oldSurfaceToBufferMatrix = surfaceToBufferMatrix;
+    const SurfaceTransform oldSurfaceToBuffer = surfaceToBuffer;
     const QRegion oldInputRegion = inputRegion;
 
     next->mergeInto(&current);
+    scheduleFrameCallbacks(outputs);
 
     if (lockedPointer) {
         auto lockedPointerPrivate = LockedPointerV1InterfacePrivate::get(lockedPointer);
@@ -589,8 +632,7 @@ void SurfaceInterfacePrivate::applyState(SurfaceState *next)
         bufferSize = QSize();
     }
 
-    surfaceToBufferMatrix = buildSurfaceToBufferMatrix();
-    bufferToSurfaceMatrix = surfaceToBufferMatrix.inverted();
+    surfaceToBuffer = buildSurfaceToBufferTransform();
     inputRegion = current.input & QRect(QPoint(0, 0), surfaceSize);
     if (opaqueRegionChanged) {
         Q_EMIT q->opaqueChanged(current.opaque);
@@ -608,19 +650,25 @@ void SurfaceInterfacePrivate::applyState(SurfaceState *next)
         updateEffectiveMapped();
     }
     if (bufferChanged) {
+        damage = QRegion();
         if (current.buffer && (!current.damage.isEmpty() || !current.bufferDamage.isEmpty())) {
-            const QRegion windowRegion = QRegion(0, 0, q->size().width(), q->size().height());
-            const QRegion bufferDamage = q->mapFromBuffer(current.bufferDamage);
-            current.damage = windowRegion.intersected(current.damage.united(bufferDamage));
-            Q_EMIT q->damaged(current.damage);
+            const QRect windowRect = QRect(QPoint(0, 0), q->size());
+            damage = current.damage.region() & windowRect;
+            if (!current.bufferDamage.isEmpty()) {
+                damage += q->mapFromBuffer(current.bufferDamage.region()) & windowRect;
+            }
+            Q_EMIT q->damaged(damage);
         }
     }
-    if (surfaceToBufferMatrix != oldSurfaceToBufferMatrix) {
+    if (surfaceToBuffer != oldSurfaceToBuffer) {
         Q_EMIT q->surfaceToBufferMatrixChanged();
     }
     if (bufferSize != oldBufferSize) {
         Q_EMIT q->bufferSizeChanged();
     }
+    if (surfaceSize != oldSurfaceSize || inputRegion != oldInputRegion || childrenChanged) {
+        invalidateHitTest();
+    }
     if (surfaceSize != oldSurfaceSize) {
         Q_EMIT q->sizeChanged();
     }
@@ -693,6 +741,7 @@ void SurfaceInterfacePrivate::updateEffectiveMapped()
     }
 
     mapped = effectiveMapped;
+    invalidateHitTest();
 
     if (mapped) {
         Q_EMIT q->mapped();
@@ -712,7 +761,7 @@ void SurfaceInterfacePrivate::updateEffectiveMapped()
 
 QRegion SurfaceInterface::damage() const
 {
-    return d->current.damage;
+    return d->damage;
 }
 
 QRegion SurfaceInterface::opaque() const
@@ -868,6 +917,7 @@ void SurfaceInterface::setOutputs(const QVector<OutputInterface *> &outputs)
             d->send_enter(outputResource);
         });
     }
+    d->scheduleFrameCallbacks(addedOutputsOutputs);
 
     d->outputs = outputs;
     for (auto child : qAsConst(d->current.below)) {
@@ -878,64 +928,83 @@ void SurfaceInterface::setOutputs(const QVector<OutputInterface *> &outputs)
     }
 }
 
-SurfaceInterface *SurfaceInterface::surfaceAt(const QPointF &position)
+void SurfaceInterfacePrivate::invalidateHitTest()
 {
-    if (!isMapped()) {
-        return nullptr;
+    // the hit test of every surface up to the root of the tree includes this one
+    SurfaceInterfacePrivate *surfacePrivate = this;
+    while (surfacePrivate) {
+        surfacePrivate->hitTestValid = false;
+        SurfaceInterface *parent = surfacePrivate->subSurface ? surfacePrivate->subSurface->parentSurface() : nullptr;
+        surfacePrivate = parent ? SurfaceInterfacePrivate::get(parent) : nullptr;
     }
+}
 
-    for (auto it = d->current.above.crbegin(); it != d->current.above.crend(); ++it) {
-        const SubSurfaceInterface *current = *it;
-        SurfaceInterface *surface = current->surface();
-        if (auto s = surface->surfaceAt(position - current->position())) {
-            return s;
-        }
+void SurfaceInterfacePrivate::buildHitTest(QVector<HitTestEntry> *entries, const QPoint &offset) const
+{
+    if (!mapped) {
+        return;
     }
-
-    // check whether the geometry contains the pos
-    if (!size().isEmpty() && QRectF(QPoint(0, 0), size()).contains(position)) {
-        return this;
+    for (auto it = current.above.crbegin(); it != current.above.crend(); ++it) {
+        const SubSurfaceInterface *child = *it;
+        SurfaceInterfacePrivate::get(child->surface())->buildHitTest(entries, offset + child->position());
+    }
+    if (!surfaceSize.isEmpty()) {
+        entries->append(HitTestEntry{q, offset, QRectF(offset, surfaceSize), inputRegion});
+    }
+    for (auto it = current.below.crbegin(); it != current.below.crend(); ++it) {
+        const SubSurfaceInterface *child = *it;
+        SurfaceInterfacePrivate::get(child->surface())->buildHitTest(entries, offset + child->position());
     }
+}
 
-    for (auto it = d->current.below.crbegin(); it != d->current.below.crend(); ++it) {
-        const SubSurfaceInterface *current = *it;
-        SurfaceInterface *surface = current->surface();
-        if (auto s = surface->surfaceAt(position - current->position())) {
-            return s;
+const QVector<SurfaceInterfacePrivate::HitTestEntry> &SurfaceInterfacePrivate::hitTestEntries()
+{
+    if (!hitTestValid) {
+        hitTest.clear();
+        buildHitTest(&hitTest, QPoint(0, 0));
+        hitTestBounds = QRectF();
+        for (const HitTestEntry &entry : qAsConst(hitTest)) {
+            hitTestBounds |= entry.geometry;
         }
+        hitTestValid = true;
     }
-    return nullptr;
+    return hitTest;
 }
 
-SurfaceInterface *SurfaceInterface::inputSurfaceAt(const QPointF &position)
+SurfaceInterface *SurfaceInterface::surfaceAt(const QPointF &position)
 {
-    // TODO: Most of this is very similar to SurfaceInterface::surfaceAt
-    //       Is there a way to reduce the code duplication?
     if (!isMapped()) {
         return nullptr;
     }
 
-    for (auto it = d->current.above.crbegin(); it != d->current.above.crend(); ++it) {
-        const SubSurfaceInterface *current = *it;
-        auto surface = current->surface();
-        if (auto s = surface->inputSurfaceAt(position - current->position())) {
-            return s;
+    const auto &entries = d->hitTestEntries();
+    if (!d->hitTestBounds.contains(position)) {
+        return nullptr;
+    }
+    for (const SurfaceInterfacePrivate::HitTestEntry &entry : entries) {
+        if (entry.geometry.contains(position)) {
+            return entry.surface;
         }
     }
+    return nullptr;
+}
 
-    // check whether the geometry and input region contain the pos
-    if (!size().isEmpty() && QRectF(QPoint(0, 0), size()).contains(position) && input().contains(position.toPoint())) {
-        return this;
+SurfaceInterface *SurfaceInterface::inputSurfaceAt(const QPointF &position)
+{
+    if (!isMapped()) {
+        return nullptr;
     }
 
-    for (auto it = d->current.below.crbegin(); it != d->current.below.crend(); ++it) {
-        const SubSurfaceInterface *current = *it;
-        auto surface = current->surface();
-        if (auto s = surface->inputSurfaceAt(position - current->position())) {
-            return s;
+    const auto &entries = d->hitTestEntries();
+    if (!d->hitTestBounds.contains(position)) {
+        return nullptr;
+    }
+    for (const SurfaceInterfacePrivate::HitTestEntry &entry : entries) {
+        // the input region is clipped to the surface, but the geometry check keeps the edges inclusive
+        if (entry.geometry.contains(position) && entry.input.contains((position - entry.offset).toPoint())) {
+            return entry.surface;
         }
     }
-
     return nullptr;
 }
 
@@ -961,36 +1030,27 @@ LinuxDmaBufV1Feedback *SurfaceInterface::dmabufFeedbackV1() const
 
 QPointF SurfaceInterface::mapToBuffer(const QPointF &point) const
 {
-    return d->surfaceToBufferMatrix.map(point);
+    return d->surfaceToBuffer.map(point);
 }
 
 QPointF SurfaceInterface::mapFromBuffer(const QPointF &point) const
 {
-    return d->bufferToSurfaceMatrix.map(point);
-}
-
-static QRegion map_helper(const QMatrix4x4 &matrix, const QRegion &region)
-{
-    QRegion result;
-    for (const QRect &rect : region) {
-        result += matrix.mapRect(rect);
-    }
-    return result;
+    return d->surfaceToBuffer.inverseMap(point);
 }
 
 QRegion SurfaceInterface::mapToBuffer(const QRegion &region) const
 {
-    return map_helper(d->surfaceToBufferMatrix, region);
+    return d->surfaceToBuffer.map(region);
 }
 
 QRegion SurfaceInterface::mapFromBuffer(const QRegion &region) const
 {
-    return map_helper(d->bufferToSurfaceMatrix, region);
+    return d->surfaceToBuffer.inverseMap(region);
 }
 
 QMatrix4x4 SurfaceInterface::surfaceToBufferMatrix() const
 {
-    return d->surfaceToBufferMatrix;
+    return d->surfaceToBuffer.toMatrix();
 }
 
 QPointF SurfaceInterface::mapToChild(SurfaceInterface *child, const QPointF &point) const
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "output_interface.h"
+#include "presentationtime_interface.h"
 
 #include <QMatrix4x4>
 #include <QObject>
@@ -15,6 +16,8 @@
 
 #include <DWayland/Server/kwaylandserver_export.h>
 
+#include <chrono>
+
 namespace KWaylandServer
 {
 class BlurInterface;
@@ -137,6 +140,9 @@ public:
      * and regions in the buffer pixel coordinates. In order to map regions between the two spaces,
      * one has to use mapToBuffer() and mapFromBuffer().
      *
+     * Rectangles that don't cover whole surface-local units, e.g. an odd number of pixels of a
+     * buffer with scale 2, are rounded outwards.
+     *
      * The returned value will become invalid when the surfaceToBufferMatrixChanged() signal is emitted.
      *
      * @see surfaceToBufferMatrix(), surfaceToBufferMatrixChanged()
@@ -157,9 +163,33 @@ public:
      */
     QPointF mapToChild(SurfaceInterface *child, const QPointF &point) const;
 
+    /**
+     * Sends the frame callbacks of this surface and all its subsurfaces with the timestamp @p msec.
+     *
+     * @see FrameCallbackScheduler
+     */
     void frameRendered(quint32 msec);
     bool hasFrameCallbacks() const;
 
+    /**
+     * Tells the clients which asked for feedback on the current content update of this surface
+     * and its subsurfaces that it was presented on @p output at @p timestamp. The @p timestamp
+     * is taken from PresentationInterface::clockId() and @p sequence is the vblank counter of
+     * the output, if it has one.
+     *
+     * @see sendDiscarded
+     */
+    void sendPresented(OutputInterface *output, std::chrono::nanoseconds timestamp, quint64 sequence, PresentationInterface::Kinds kinds);
+    /**
+     * Tells the clients which asked for feedback on the current content update of this surface
+     * and its subsurfaces that it will never be presented, e.g. because the surface got hidden.
+     */
+    void sendDiscarded();
+    /**
+     * @returns whether a client waits for feedback on the current content update
+     */
+    bool hasPresentationFeedback() const;
+
     QRegion damage() const;
     QRegion opaque() const;
     QRegion input() const;
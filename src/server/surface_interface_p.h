@@ -6,7 +6,9 @@
 */
 #pragma once
 
+#include "damageaccumulator_p.h"
 #include "surface_interface.h"
+#include "surfacetransform_p.h"
 #include "utils.h"
 // Qt
 #include <QHash>
@@ -23,8 +25,8 @@ class ViewportInterface;
 struct SurfaceState {
     void mergeInto(SurfaceState *target);
 
-    QRegion damage = QRegion();
-    QRegion bufferDamage = QRegion();
+    DamageAccumulator damage;
+    DamageAccumulator bufferDamage;
     QRegion opaque = QRegion();
     QRegion input = infiniteRegion();
     bool inputIsSet = false;
@@ -40,6 +42,7 @@ struct SurfaceState {
     qint32 bufferScale = 1;
     OutputInterface::Transform bufferTransform = OutputInterface::Transform::Normal;
     wl_list frameCallbacks;
+    wl_list presentationFeedbacks;
     QPoint offset = QPoint();
     QPointer<ClientBuffer> buffer;
     QPointer<ShadowInterface> shadow;
@@ -88,12 +91,28 @@ public:
     void commitFromCache();
 
     void commitSubSurface();
-    QMatrix4x4 buildSurfaceToBufferMatrix();
+    SurfaceTransform buildSurfaceToBufferTransform() const;
     void applyState(SurfaceState *next);
+    void sendFrameCallbacks(quint32 msec);
+    void scheduleFrameCallbacks(const QVector<OutputInterface *> &outputs);
 
     bool computeEffectiveMapped() const;
     void updateEffectiveMapped();
 
+    /**
+     * A mapped surface of the sub-surface tree rooted at this surface, in the tree's
+     * surface-local coordinates.
+     */
+    struct HitTestEntry {
+        SurfaceInterface *surface;
+        QPointF offset;
+        QRectF geometry;
+        QRegion input;
+    };
+    void invalidateHitTest();
+    void buildHitTest(QVector<HitTestEntry> *entries, const QPoint &offset) const;
+    const QVector<HitTestEntry> &hitTestEntries();
+
     CompositorInterface *compositor;
     SurfaceInterface *q;
     SurfaceRole *role = nullptr;
@@ -101,12 +120,16 @@ public:
     SurfaceState pending;
     SurfaceState cached;
     SubSurfaceInterface *subSurface = nullptr;
-    QMatrix4x4 surfaceToBufferMatrix;
-    QMatrix4x4 bufferToSurfaceMatrix;
+    SurfaceTransform surfaceToBuffer;
     QSize bufferSize;
     QSize implicitSurfaceSize;
     QSize surfaceSize;
     QRegion inputRegion;
+    QRegion damage;
+    // the surfaces of the tree from topmost to bottommost, rebuilt lazily after it changes
+    QVector<HitTestEntry> hitTest;
+    QRectF hitTestBounds;
+    bool hitTestValid = false;
     ClientBuffer *bufferRef = nullptr;
     bool mapped = false;
     bool hasCacheState = false;
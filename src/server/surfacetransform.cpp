@@ -0,0 +1,258 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#include "surfacetransform_p.h"
+
+#include <QVarLengthArray>
+
+#include <cmath>
+#include <limits>
+
+namespace KWaylandServer
+{
+
+static bool isIntegral(qreal value)
+{
+    return std::floor(value) == value && std::abs(value) <= std::numeric_limits<int>::max();
+}
+
+static int floorDivide(int numerator, int denominator)
+{
+    const int quotient = numerator / denominator;
+    return (numerator % denominator != 0 && numerator < 0) ? quotient - 1 : quotient;
+}
+
+static int ceilDivide(int numerator, int denominator)
+{
+    const int quotient = numerator / denominator;
+    return (numerator % denominator != 0 && numerator > 0) ? quotient + 1 : quotient;
+}
+
+/**
+ * Divides the range [@p first, @p last] by @p divisor, rounding outwards.
+ */
+static void divideRange(int first, int last, int divisor, int *low, int *high)
+{
+    if (divisor < 0) {
+        first = -first;
+        last = -last;
+        divisor = -divisor;
+    }
+    *low = floorDivide(std::min(first, last), divisor);
+    *high = ceilDivide(std::max(first, last), divisor);
+}
+
+SurfaceTransform::Affine SurfaceTransform::Affine::then(const Affine &next) const
+{
+    Affine result;
+    result.m11 = next.m11 * m11 + next.m12 * m21;
+    result.m12 = next.m11 * m12 + next.m12 * m22;
+    result.m21 = next.m21 * m11 + next.m22 * m21;
+    result.m22 = next.m21 * m12 + next.m22 * m22;
+    result.dx = next.m11 * dx + next.m12 * dy + next.dx;
+    result.dy = next.m21 * dx + next.m22 * dy + next.dy;
+    return result;
+}
+
+SurfaceTransform::Affine SurfaceTransform::Affine::inverted() const
+{
+    const qreal determinant = m11 * m22 - m12 * m21;
+    Affine result;
+    result.m11 = m22 / determinant;
+    result.m12 = -m12 / determinant;
+    result.m21 = -m21 / determinant;
+    result.m22 = m11 / determinant;
+    result.dx = -(result.m11 * dx + result.m12 * dy);
+    result.dy = -(result.m21 * dx + result.m22 * dy);
+    return result;
+}
+
+QPointF SurfaceTransform::Affine::map(const QPointF &point) const
+{
+    return QPointF(m11 * point.x() + m12 * point.y() + dx, m21 * point.x() + m22 * point.y() + dy);
+}
+
+SurfaceTransform::SurfaceTransform(OutputInterface::Transform bufferTransform,
+                                   int bufferScale,
+                                   const QSize &bufferSize,
+                                   const QRectF &sourceGeometry,
+                                   const QSize &surfaceSize)
+{
+    // The transforms are listed in the order they are applied to a surface-local point.
+    const qreal width = bufferSize.width() / bufferScale;
+    const qreal height = bufferSize.height() / bufferScale;
+
+    QSize implicitSurfaceSize = bufferSize / bufferScale;
+    switch (bufferTransform) {
+    case OutputInterface::Transform::Rotated90:
+    case OutputInterface::Transform::Rotated270:
+    case OutputInterface::Transform::Flipped90:
+    case OutputInterface::Transform::Flipped270:
+        implicitSurfaceSize.transpose();
+        break;
+    default:
+        break;
+    }
+
+    Affine transform;
+    const QSizeF sourceSize = sourceGeometry.isValid() ? sourceGeometry.size() : QSizeF(implicitSurfaceSize);
+    if (sourceSize != surfaceSize && !surfaceSize.isEmpty()) {
+        transform.m11 = sourceSize.width() / surfaceSize.width();
+        transform.m22 = sourceSize.height() / surfaceSize.height();
+    }
+    if (sourceGeometry.isValid()) {
+        transform.dx = sourceGeometry.x();
+        transform.dy = sourceGeometry.y();
+    }
+
+    switch (bufferTransform) {
+    case OutputInterface::Transform::Flipped:
+    case OutputInterface::Transform::Flipped180:
+        transform = transform.then({-1, 0, 0, 1, width, 0});
+        break;
+    case OutputInterface::Transform::Flipped90:
+    case OutputInterface::Transform::Flipped270:
+        transform = transform.then({-1, 0, 0, 1, height, 0});
+        break;
+    default:
+        break;
+    }
+
+    switch (bufferTransform) {
+    case OutputInterface::Transform::Normal:
+    case OutputInterface::Transform::Flipped:
+        break;
+    case OutputInterface::Transform::Rotated90:
+    case OutputInterface::Transform::Flipped90:
+        transform = transform.then({0, 1, -1, 0, 0, height});
+        break;
+    case OutputInterface::Transform::Rotated180:
+    case OutputInterface::Transform::Flipped180:
+        transform = transform.then({-1, 0, 0, -1, width, height});
+        break;
+    case OutputInterface::Transform::Rotated270:
+    case OutputInterface::Transform::Flipped270:
+        transform = transform.then({0, -1, 1, 0, width, 0});
+        break;
+    }
+
+    m_forward = transform.then({qreal(bufferScale), 0, 0, qreal(bufferScale), 0, 0});
+    m_inverse = m_forward.inverted();
+
+    m_integral = isIntegral(m_forward.m11) && isIntegral(m_forward.m12) && isIntegral(m_forward.m21) && isIntegral(m_forward.m22)
+        && isIntegral(m_forward.dx) && isIntegral(m_forward.dy);
+    if (m_integral) {
+        m_a = m_forward.m11;
+        m_b = m_forward.m12;
+        m_c = m_forward.m21;
+        m_d = m_forward.m22;
+        m_tx = m_forward.dx;
+        m_ty = m_forward.dy;
+    } else {
+        m_matrix = toMatrix();
+        m_inverseMatrix = m_matrix.inverted();
+    }
+}
+
+QPointF SurfaceTransform::map(const QPointF &point) const
+{
+    return m_forward.map(point);
+}
+
+QPointF SurfaceTransform::inverseMap(const QPointF &point) const
+{
+    return m_inverse.map(point);
+}
+
+QRect SurfaceTransform::mapRect(const QRect &rect) const
+{
+    if (!m_integral) {
+        return m_matrix.mapRect(rect);
+    }
+    const int x1 = rect.x();
+    const int y1 = rect.y();
+    const int x2 = x1 + rect.width();
+    const int y2 = y1 + rect.height();
+    const int mappedX1 = m_a * x1 + m_b * y1 + m_tx;
+    const int mappedX2 = m_a * x2 + m_b * y2 + m_tx;
+    const int mappedY1 = m_c * x1 + m_d * y1 + m_ty;
+    const int mappedY2 = m_c * x2 + m_d * y2 + m_ty;
+    return QRect(std::min(mappedX1, mappedX2), std::min(mappedY1, mappedY2), std::abs(mappedX2 - mappedX1), std::abs(mappedY2 - mappedY1));
+}
+
+QRect SurfaceTransform::inverseMapRect(const QRect &rect) const
+{
+    if (!m_integral) {
+        return m_inverseMatrix.mapRect(rect);
+    }
+    const int x1 = rect.x() - m_tx;
+    const int y1 = rect.y() - m_ty;
+    const int x2 = x1 + rect.width();
+    const int y2 = y1 + rect.height();
+
+    int left, right, top, bottom;
+    if (m_b == 0) {
+        divideRange(x1, x2, m_a, &left, &right);
+        divideRange(y1, y2, m_d, &top, &bottom);
+    } else {
+        // the buffer x axis runs along the surface y axis
+        divideRange(y1, y2, m_c, &left, &right);
+        divideRange(x1, x2, m_b, &top, &bottom);
+    }
+    return QRect(left, top, right - left, bottom - top);
+}
+
+QRegion SurfaceTransform::map(const QRegion &region) const
+{
+    if (region.rectCount() == 1) {
+        return mapRect(region.boundingRect());
+    }
+    if (m_integral && m_a > 0 && m_d > 0) {
+        // translating and scaling up by an integer keeps the rects sorted, banded and apart
+        QVarLengthArray<QRect, 32> rects;
+        rects.reserve(region.rectCount());
+        for (const QRect &rect : region) {
+            rects.append(mapRect(rect));
+        }
+        QRegion result;
+        result.setRects(rects.constData(), rects.count());
+        return result;
+    }
+    QRegion result;
+    for (const QRect &rect : region) {
+        result += mapRect(rect);
+    }
+    return result;
+}
+
+QRegion SurfaceTransform::inverseMap(const QRegion &region) const
+{
+    if (region.rectCount() == 1) {
+        return inverseMapRect(region.boundingRect());
+    }
+    QRegion result;
+    for (const QRect &rect : region) {
+        result += inverseMapRect(rect);
+    }
+    return result;
+}
+
+QMatrix4x4 SurfaceTransform::toMatrix() const
+{
+    QMatrix4x4 matrix(m_forward.m11, m_forward.m12, 0, m_forward.dx,
+                      m_forward.m21, m_forward.m22, 0, m_forward.dy,
+                      0, 0, 1, 0,
+                      0, 0, 0, 1);
+    matrix.optimize();
+    return matrix;
+}
+
+bool SurfaceTransform::operator==(const SurfaceTransform &other) const
+{
+    return m_forward.m11 == other.m_forward.m11 && m_forward.m12 == other.m_forward.m12 && m_forward.m21 == other.m_forward.m21
+        && m_forward.m22 == other.m_forward.m22 && m_forward.dx == other.m_forward.dx && m_forward.dy == other.m_forward.dy;
+}
+
+} // namespace KWaylandServer
@@ -0,0 +1,95 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#pragma once
+
+#include "output_interface.h"
+
+#include <DWayland/Server/kwaylandserver_export.h>
+
+#include <QMatrix4x4>
+#include <QRegion>
+
+namespace KWaylandServer
+{
+/**
+ * The mapping from the surface-local coordinates of a surface to its buffer pixel coordinates.
+ *
+ * A buffer scale, a buffer transform and a viewport crop only ever move, mirror, rotate by a
+ * multiple of 90 degrees and scale by an integer, so integer coordinates are mapped to integer
+ * coordinates. Such transforms map rectangles with integer arithmetic. Only a viewport which
+ * scales by a non-integral factor falls back to QMatrix4x4.
+ *
+ * Rectangles mapped from buffer to surface coordinates are rounded outwards, so mapped damage
+ * always covers the pixels it came from.
+ */
+class KWAYLANDSERVER_EXPORT SurfaceTransform
+{
+public:
+    /**
+     * Constructs the identity transform, used for surfaces without a buffer.
+     */
+    SurfaceTransform() = default;
+    SurfaceTransform(OutputInterface::Transform bufferTransform,
+                     int bufferScale,
+                     const QSize &bufferSize,
+                     const QRectF &sourceGeometry,
+                     const QSize &surfaceSize);
+
+    /**
+     * Returns @c true if the transform maps integer coordinates to integer coordinates.
+     */
+    bool isIntegral() const
+    {
+        return m_integral;
+    }
+
+    QPointF map(const QPointF &point) const;
+    QPointF inverseMap(const QPointF &point) const;
+    QRect mapRect(const QRect &rect) const;
+    QRect inverseMapRect(const QRect &rect) const;
+    QRegion map(const QRegion &region) const;
+    QRegion inverseMap(const QRegion &region) const;
+
+    QMatrix4x4 toMatrix() const;
+
+    bool operator==(const SurfaceTransform &other) const;
+    bool operator!=(const SurfaceTransform &other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    // x' = m11 * x + m12 * y + dx, y' = m21 * x + m22 * y + dy, where either m12 and m21 or
+    // m11 and m22 are zero
+    struct Affine {
+        qreal m11 = 1;
+        qreal m12 = 0;
+        qreal m21 = 0;
+        qreal m22 = 1;
+        qreal dx = 0;
+        qreal dy = 0;
+
+        Affine then(const Affine &next) const;
+        Affine inverted() const;
+        QPointF map(const QPointF &point) const;
+    };
+
+    Affine m_forward;
+    Affine m_inverse;
+    // integer copies of m_forward, valid if m_integral is set
+    int m_a = 1;
+    int m_b = 0;
+    int m_c = 0;
+    int m_d = 1;
+    int m_tx = 0;
+    int m_ty = 0;
+    bool m_integral = true;
+    // the fallback for transforms which aren't integral
+    QMatrix4x4 m_matrix;
+    QMatrix4x4 m_inverseMatrix;
+};
+
+} // namespace KWaylandServer
@@ -52,10 +52,7 @@ TabletV2Interface::TabletV2Interface(uint32_t vendorId, uint32_t productId, cons
 
 TabletV2Interface::~TabletV2Interface()
 {
-    const auto tabletResources = d->resourceMap();
-    for (TabletV2InterfacePrivate::Resource *resource : tabletResources) {
-        d->send_removed(resource->handle);
-    }
+    d->broadcast_removed();
 }
 
 bool TabletV2Interface::isSurfaceSupported(SurfaceInterface *surface) const
@@ -216,10 +213,7 @@ TabletToolV2Interface::TabletToolV2Interface(Display *display,
 
 TabletToolV2Interface::~TabletToolV2Interface()
 {
-    const auto toolResources = d->resourceMap();
-    for (TabletToolV2InterfacePrivate::Resource *resource : toolResources) {
-        d->send_removed(resource->handle);
-    }
+    d->broadcast_removed();
 }
 
 void TabletToolV2Interface::setCurrentSurface(SurfaceInterface *surface)
@@ -561,10 +555,7 @@ TabletPadV2Interface::TabletPadV2Interface(const QString &path,
 
 TabletPadV2Interface::~TabletPadV2Interface()
 {
-    const auto tabletPadResources = d->resourceMap();
-    for (TabletPadV2InterfacePrivate::Resource *resource : tabletPadResources) {
-        d->send_removed(resource->handle);
-    }
+    d->broadcast_removed();
 }
 
 void TabletPadV2Interface::sendButton(quint32 time, quint32 button, bool pressed)
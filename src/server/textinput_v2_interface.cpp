@@ -154,10 +154,7 @@ void TextInputV2InterfacePrivate::sendEnter(SurfaceInterface *newSurface, quint3
     // It should be always synchronized with SeatInterface::focusedTextInputSurface.
     Q_ASSERT(!surface && newSurface);
     surface = newSurface;
-    const auto clientResources = textInputsForClient(newSurface->client());
-    for (auto resource : clientResources) {
-        send_enter(resource->handle, serial, newSurface->resource());
-    }
+    broadcast_enter(textInputsForClient(newSurface->client()), serial, newSurface->resource());
 }
 
 void TextInputV2InterfacePrivate::sendLeave(quint32 serial, SurfaceInterface *leavingSurface)
@@ -166,10 +163,7 @@ void TextInputV2InterfacePrivate::sendLeave(quint32 serial, SurfaceInterface *le
     Q_ASSERT(leavingSurface && surface == leavingSurface);
     EnabledEmitter emitter(q);
     surface.clear();
-    const auto clientResources = textInputsForClient(leavingSurface->client());
-    for (auto resource : clientResources) {
-        send_leave(resource->handle, serial, leavingSurface->resource());
-    }
+    broadcast_leave(textInputsForClient(leavingSurface->client()), serial, leavingSurface->resource());
 }
 
 void TextInputV2InterfacePrivate::preEdit(const QString &text, const QString &commit)
@@ -178,10 +172,7 @@ void TextInputV2InterfacePrivate::preEdit(const QString &text, const QString &co
         return;
     }
 
-    const auto clientResources = textInputsForClient(surface->client());
-    for (auto resource : clientResources) {
-        send_preedit_string(resource->handle, text, commit);
-    }
+    broadcast_preedit_string(textInputsForClient(surface->client()), text, commit);
 }
 
 void TextInputV2InterfacePrivate::preEditStyling(uint32_t index, uint32_t length, uint32_t style)
@@ -190,10 +181,7 @@ void TextInputV2InterfacePrivate::preEditStyling(uint32_t index, uint32_t length
         return;
     }
 
-    const auto clientResources = textInputsForClient(surface->client());
-    for (auto resource : clientResources) {
-        send_preedit_styling(resource->handle, index, length, style);
-    }
+    broadcast_preedit_styling(textInputsForClient(surface->client()), index, length, style);
 }
 
 void TextInputV2InterfacePrivate::commitString(const QString &text)
@@ -201,10 +189,7 @@ void TextInputV2InterfacePrivate::commitString(const QString &text)
     if (!surface) {
         return;
     }
-    const QList<Resource *> textInputs = textInputsForClient(surface->client());
-    for (auto resource : textInputs) {
-        send_commit_string(resource->handle, text);
-    }
+    broadcast_commit_string(textInputsForClient(surface->client()), text);
 }
 
 void TextInputV2InterfacePrivate::keysymPressed(quint32 keysym, quint32 modifiers)
@@ -213,10 +198,7 @@ void TextInputV2InterfacePrivate::keysymPressed(quint32 keysym, quint32 modifier
         return;
     }
 
-    const QList<Resource *> textInputs = textInputsForClient(surface->client());
-    for (auto resource : textInputs) {
-        send_keysym(resource->handle, seat ? seat->timestamp() : 0, keysym, WL_KEYBOARD_KEY_STATE_PRESSED, modifiers);
-    }
+    broadcast_keysym(textInputsForClient(surface->client()), seat ? seat->timestamp() : 0, keysym, WL_KEYBOARD_KEY_STATE_PRESSED, modifiers);
 }
 
 void TextInputV2InterfacePrivate::keysymReleased(quint32 keysym, quint32 modifiers)
@@ -225,10 +207,7 @@ void TextInputV2InterfacePrivate::keysymReleased(quint32 keysym, quint32 modifie
         return;
     }
 
-    const QList<Resource *> textInputs = textInputsForClient(surface->client());
-    for (auto resource : textInputs) {
-        send_keysym(resource->handle, seat ? seat->timestamp() : 0, keysym, WL_KEYBOARD_KEY_STATE_RELEASED, modifiers);
-    }
+    broadcast_keysym(textInputsForClient(surface->client()), seat ? seat->timestamp() : 0, keysym, WL_KEYBOARD_KEY_STATE_RELEASED, modifiers);
 }
 
 void TextInputV2InterfacePrivate::deleteSurroundingText(quint32 beforeLength, quint32 afterLength)
@@ -236,10 +215,7 @@ void TextInputV2InterfacePrivate::deleteSurroundingText(quint32 beforeLength, qu
     if (!surface) {
         return;
     }
-    const QList<Resource *> textInputs = textInputsForClient(surface->client());
-    for (auto resource : textInputs) {
-        send_delete_surrounding_text(resource->handle, beforeLength, afterLength);
-    }
+    broadcast_delete_surrounding_text(textInputsForClient(surface->client()), beforeLength, afterLength);
 }
 
 void TextInputV2InterfacePrivate::setCursorPosition(qint32 index, qint32 anchor)
@@ -247,10 +223,7 @@ void TextInputV2InterfacePrivate::setCursorPosition(qint32 index, qint32 anchor)
     if (!surface) {
         return;
     }
-    const QList<Resource *> textInputs = textInputsForClient(surface->client());
-    for (auto resource : textInputs) {
-        send_cursor_position(resource->handle, index, anchor);
-    }
+    broadcast_cursor_position(textInputsForClient(surface->client()), index, anchor);
 }
 
 void TextInputV2InterfacePrivate::setTextDirection(Qt::LayoutDirection direction)
@@ -273,10 +246,7 @@ void TextInputV2InterfacePrivate::setTextDirection(Qt::LayoutDirection direction
         Q_UNREACHABLE();
         break;
     }
-    const QList<Resource *> textInputs = textInputsForClient(surface->client());
-    for (auto resource : textInputs) {
-        send_text_direction(resource->handle, wlDirection);
-    }
+    broadcast_text_direction(textInputsForClient(surface->client()), wlDirection);
 }
 
 void TextInputV2InterfacePrivate::setPreEditCursor(qint32 index)
@@ -284,10 +254,7 @@ void TextInputV2InterfacePrivate::setPreEditCursor(qint32 index)
     if (!surface) {
         return;
     }
-    const QList<Resource *> textInputs = textInputsForClient(surface->client());
-    for (auto resource : textInputs) {
-        send_preedit_cursor(resource->handle, index);
-    }
+    broadcast_preedit_cursor(textInputsForClient(surface->client()), index);
 }
 
 void TextInputV2InterfacePrivate::sendInputPanelState()
@@ -295,7 +262,7 @@ void TextInputV2InterfacePrivate::sendInputPanelState()
     if (!surface) {
         return;
     }
-    const QList<Resource *> textInputs = textInputsForClient(surface->client());
+    const auto textInputs = textInputsForClient(surface->client());
     for (auto resource : textInputs) {
         send_input_panel_state(resource->handle,
                                inputPanelVisible ? ZWP_TEXT_INPUT_V2_INPUT_PANEL_VISIBILITY_VISIBLE : ZWP_TEXT_INPUT_V2_INPUT_PANEL_VISIBILITY_HIDDEN,
@@ -311,10 +278,7 @@ void TextInputV2InterfacePrivate::sendLanguage()
     if (!surface) {
         return;
     }
-    const QList<Resource *> textInputs = textInputsForClient(surface->client());
-    for (auto resource : textInputs) {
-        send_language(resource->handle, language);
-    }
+    broadcast_language(textInputsForClient(surface->client()), language);
 }
 
 void TextInputV2InterfacePrivate::sendModifiersMap()
@@ -322,10 +286,7 @@ void TextInputV2InterfacePrivate::sendModifiersMap()
     if (!surface) {
         return;
     }
-    const QList<Resource *> textInputs = textInputsForClient(surface->client());
-    for (auto resource : textInputs) {
-        send_modifiers_map(resource->handle, modifiersMap);
-    }
+    broadcast_modifiers_map(textInputsForClient(surface->client()), modifiersMap);
 }
 
 TextInputV2InterfacePrivate::TextInputV2InterfacePrivate(SeatInterface *seat, TextInputV2Interface *_q)
@@ -373,10 +334,14 @@ void TextInputV2InterfacePrivate::zwp_text_input_v2_hide_input_panel(Resource *r
     Q_EMIT q->requestHideInputPanel();
 }
 
-void TextInputV2InterfacePrivate::zwp_text_input_v2_set_surrounding_text(Resource *resource, const QString &text, int32_t cursor, int32_t anchor)
+void TextInputV2InterfacePrivate::zwp_text_input_v2_set_surrounding_text(Resource *resource, QtWaylandServer::Utf8View text, int32_t cursor, int32_t anchor)
 {
     Q_UNUSED(resource)
-    surroundingText = text;
+    // clients resend the whole text when only the cursor moved
+    if (text != surroundingTextUtf8) {
+        surroundingTextUtf8 = text.toByteArray();
+        surroundingText = text.toString();
+    }
     surroundingTextCursorPosition = cursor;
     surroundingTextSelectionAnchor = anchor;
     Q_EMIT q->surroundingTextChanged();
@@ -419,9 +384,9 @@ void TextInputV2InterfacePrivate::zwp_text_input_v2_show_input_panel(Resource *r
     Q_EMIT q->requestShowInputPanel();
 }
 
-QList<TextInputV2InterfacePrivate::Resource *> TextInputV2InterfacePrivate::textInputsForClient(ClientConnection *client) const
+TextInputV2InterfacePrivate::ResourceRange TextInputV2InterfacePrivate::textInputsForClient(ClientConnection *client) const
 {
-    return resourceMap().values(client->client());
+    return resourceMap().resources(client->client());
 }
 
 TextInputV2Interface::TextInputV2Interface(SeatInterface *seat)
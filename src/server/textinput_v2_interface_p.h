@@ -49,7 +49,7 @@ public:
     void sendLanguage();
     void sendModifiersMap();
 
-    QList<Resource *> textInputsForClient(ClientConnection *client) const;
+    ResourceRange textInputsForClient(ClientConnection *client) const;
     static TextInputV2InterfacePrivate *get(TextInputV2Interface *inputInterface)
     {
         return inputInterface->d.data();
@@ -62,6 +62,7 @@ public:
     SeatInterface *seat = nullptr;
     QPointer<SurfaceInterface> surface;
     QString surroundingText;
+    QByteArray surroundingTextUtf8;
     qint32 surroundingTextCursorPosition = 0;
     qint32 surroundingTextSelectionAnchor = 0;
     bool inputPanelVisible = false;
@@ -76,7 +77,7 @@ protected:
     void zwp_text_input_v2_disable(Resource *resource, wl_resource *surface) override;
     void zwp_text_input_v2_show_input_panel(Resource *resource) override;
     void zwp_text_input_v2_hide_input_panel(Resource *resource) override;
-    void zwp_text_input_v2_set_surrounding_text(Resource *resource, const QString &text, int32_t cursor, int32_t anchor) override;
+    void zwp_text_input_v2_set_surrounding_text(Resource *resource, QtWaylandServer::Utf8View text, int32_t cursor, int32_t anchor) override;
     void zwp_text_input_v2_set_content_type(Resource *resource, uint32_t hint, uint32_t purpose) override;
     void zwp_text_input_v2_set_cursor_rectangle(Resource *resource, int32_t x, int32_t y, int32_t width, int32_t height) override;
     void zwp_text_input_v2_set_preferred_language(Resource *resource, const QString &language) override;
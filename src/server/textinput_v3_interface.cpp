@@ -186,10 +186,7 @@ void TextInputV3InterfacePrivate::sendEnter(SurfaceInterface *newSurface)
     // It should be always synchronized with SeatInterface::focusedTextInputSurface.
     Q_ASSERT(!surface && newSurface);
     surface = newSurface;
-    const auto clientResources = textInputsForClient(newSurface->client());
-    for (auto resource : clientResources) {
-        send_enter(resource->handle, newSurface->resource());
-    }
+    broadcast_enter(textInputsForClient(newSurface->client()), newSurface->resource());
 }
 
 void TextInputV3InterfacePrivate::sendLeave(SurfaceInterface *leavingSurface)
@@ -198,10 +195,7 @@ void TextInputV3InterfacePrivate::sendLeave(SurfaceInterface *leavingSurface)
     // It should be always synchronized with SeatInterface::focusedTextInputSurface.
     Q_ASSERT(leavingSurface && surface == leavingSurface);
     surface.clear();
-    const auto clientResources = textInputsForClient(leavingSurface->client());
-    for (auto resource : clientResources) {
-        send_leave(resource->handle, leavingSurface->resource());
-    }
+    broadcast_leave(textInputsForClient(leavingSurface->client()), leavingSurface->resource());
 }
 
 void TextInputV3InterfacePrivate::sendPreEdit(const QString &text, const quint32 cursorBegin, const quint32 cursorEnd)
@@ -250,18 +244,18 @@ void TextInputV3InterfacePrivate::done()
     }
 }
 
-QList<TextInputV3InterfacePrivate::Resource *> TextInputV3InterfacePrivate::textInputsForClient(ClientConnection *client) const
+TextInputV3InterfacePrivate::ResourceRange TextInputV3InterfacePrivate::textInputsForClient(ClientConnection *client) const
 {
-    return resourceMap().values(client->client());
+    return resourceMap().resources(client->client());
 }
 
 QList<TextInputV3InterfacePrivate::Resource *> TextInputV3InterfacePrivate::enabledTextInputsForClient(ClientConnection *client) const
 {
     QList<TextInputV3InterfacePrivate::Resource *> result;
-    const auto [start, end] = resourceMap().equal_range(client->client());
-    for (auto it = start; it != end; ++it) {
-        if (enabled[*it]) {
-            result.append(*it);
+    const auto clientResources = textInputsForClient(client);
+    for (Resource *resource : clientResources) {
+        if (enabled[resource]) {
+            result.append(resource);
         }
     }
     return result;
@@ -293,14 +287,18 @@ void TextInputV3InterfacePrivate::zwp_text_input_v3_disable(Resource *resource)
     defaultPending();
 }
 
-void TextInputV3InterfacePrivate::zwp_text_input_v3_set_surrounding_text(Resource *resource, const QString &text, int32_t cursor, int32_t anchor)
+void TextInputV3InterfacePrivate::zwp_text_input_v3_set_surrounding_text(Resource *resource, QtWaylandServer::Utf8View text, int32_t cursor, int32_t anchor)
 {
     Q_UNUSED(resource)
     // zwp_text_input_v3_set_surrounding_text is no-op if enabled request is not pending
     if (!pending.enabled) {
         return;
     }
-    pending.surroundingText = text;
+    // clients resend the whole text when only the cursor moved
+    if (text != pending.surroundingTextUtf8) {
+        pending.surroundingTextUtf8 = text.toByteArray();
+        pending.surroundingText = text.toString();
+    }
     pending.surroundingTextCursorPosition = cursor;
     pending.surroundingTextSelectionAnchor = anchor;
 }
@@ -387,6 +385,7 @@ void TextInputV3InterfacePrivate::defaultPending()
     pending.contentPurpose = TextInputContentPurpose::Normal;
     pending.enabled = false;
     pending.surroundingText = QString();
+    pending.surroundingTextUtf8 = QByteArray();
     pending.surroundingTextCursorPosition = 0;
     pending.surroundingTextSelectionAnchor = 0;
 }
@@ -43,7 +43,7 @@ public:
     void done();
 
     bool isEnabled() const;
-    QList<TextInputV3InterfacePrivate::Resource *> textInputsForClient(ClientConnection *client) const;
+    ResourceRange textInputsForClient(ClientConnection *client) const;
     QList<TextInputV3InterfacePrivate::Resource *> enabledTextInputsForClient(ClientConnection *client) const;
 
     static TextInputV3InterfacePrivate *get(TextInputV3Interface *inputInterface)
@@ -70,6 +70,7 @@ public:
         TextInputContentPurpose contentPurpose = TextInputContentPurpose::Normal;
         bool enabled = false;
         QString surroundingText;
+        QByteArray surroundingTextUtf8;
         qint32 surroundingTextCursorPosition = 0;
         qint32 surroundingTextSelectionAnchor = 0;
     } pending;
@@ -87,7 +88,7 @@ protected:
     // requests
     void zwp_text_input_v3_enable(Resource *resource) override;
     void zwp_text_input_v3_disable(Resource *resource) override;
-    void zwp_text_input_v3_set_surrounding_text(Resource *resource, const QString &text, int32_t cursor, int32_t anchor) override;
+    void zwp_text_input_v3_set_surrounding_text(Resource *resource, QtWaylandServer::Utf8View text, int32_t cursor, int32_t anchor) override;
     void zwp_text_input_v3_set_content_type(Resource *resource, uint32_t hint, uint32_t purpose) override;
     void zwp_text_input_v3_set_text_change_cause(Resource *resource, uint32_t cause) override;
     void zwp_text_input_v3_set_cursor_rectangle(Resource *resource, int32_t x, int32_t y, int32_t width, int32_t height) override;
@@ -30,9 +30,9 @@ void TouchInterfacePrivate::touch_release(Resource *resource)
     wl_resource_destroy(resource->handle);
 }
 
-QList<TouchInterfacePrivate::Resource *> TouchInterfacePrivate::touchesForClient(ClientConnection *client) const
+TouchInterfacePrivate::ResourceRange TouchInterfacePrivate::touchesForClient(ClientConnection *client) const
 {
-    return resourceMap().values(client->client());
+    return resourceMap().resources(client->client());
 }
 
 TouchInterface::TouchInterface(SeatInterface *seat)
@@ -60,10 +60,7 @@ void TouchInterface::sendCancel()
         return;
     }
 
-    const auto touchResources = d->touchesForClient(d->focusedSurface->client());
-    for (TouchInterfacePrivate::Resource *resource : touchResources) {
-        d->send_cancel(resource->handle);
-    }
+    d->broadcast_cancel(d->touchesForClient(d->focusedSurface->client()));
 }
 
 void TouchInterface::sendFrame()
@@ -72,10 +69,7 @@ void TouchInterface::sendFrame()
         return;
     }
 
-    const auto touchResources = d->touchesForClient(d->focusedSurface->client());
-    for (TouchInterfacePrivate::Resource *resource : touchResources) {
-        d->send_frame(resource->handle);
-    }
+    d->broadcast_frame(d->touchesForClient(d->focusedSurface->client()));
 }
 
 void TouchInterface::sendMotion(qint32 id, const QPointF &localPos)
@@ -84,10 +78,7 @@ void TouchInterface::sendMotion(qint32 id, const QPointF &localPos)
         return;
     }
 
-    const auto touchResources = d->touchesForClient(d->focusedSurface->client());
-    for (TouchInterfacePrivate::Resource *resource : touchResources) {
-        d->send_motion(resource->handle, d->seat->timestamp(), id, wl_fixed_from_double(localPos.x()), wl_fixed_from_double(localPos.y()));
-    }
+    d->broadcast_motion(d->touchesForClient(d->focusedSurface->client()), d->seat->timestamp(), id, wl_fixed_from_double(localPos.x()), wl_fixed_from_double(localPos.y()));
 }
 
 void TouchInterface::sendUp(qint32 id, quint32 serial)
@@ -96,10 +87,7 @@ void TouchInterface::sendUp(qint32 id, quint32 serial)
         return;
     }
 
-    const auto touchResources = d->touchesForClient(d->focusedSurface->client());
-    for (TouchInterfacePrivate::Resource *resource : touchResources) {
-        d->send_up(resource->handle, serial, d->seat->timestamp(), id);
-    }
+    d->broadcast_up(d->touchesForClient(d->focusedSurface->client()), serial, d->seat->timestamp(), id);
 }
 
 void TouchInterface::sendDown(qint32 id, quint32 serial, const QPointF &localPos)
@@ -20,7 +20,7 @@ public:
     static TouchInterfacePrivate *get(TouchInterface *touch);
     TouchInterfacePrivate(TouchInterface *q, SeatInterface *seat);
 
-    QList<Resource *> touchesForClient(ClientConnection *client) const;
+    ResourceRange touchesForClient(ClientConnection *client) const;
 
     TouchInterface *q;
     QPointer<SurfaceInterface> focusedSurface;
@@ -0,0 +1,321 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#include "windowcapture_p.h"
+#include "logging.h"
+#include "shmclientbuffer.h"
+#include "shmclientbuffer_p.h"
+#include "surface_interface.h"
+
+#include <wayland-server-protocol.h>
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace KWaylandServer
+{
+
+static QImage::Format imageFormatForShmFormat(uint32_t format)
+{
+    switch (format) {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    case WL_SHM_FORMAT_ARGB2101010:
+        return QImage::Format_A2RGB30_Premultiplied;
+    case WL_SHM_FORMAT_XRGB2101010:
+        return QImage::Format_RGB30;
+    case WL_SHM_FORMAT_ABGR2101010:
+        return QImage::Format_A2BGR30_Premultiplied;
+    case WL_SHM_FORMAT_XBGR2101010:
+        return QImage::Format_BGR30;
+    case WL_SHM_FORMAT_ABGR8888:
+        return QImage::Format_RGBA8888_Premultiplied;
+    case WL_SHM_FORMAT_XBGR8888:
+        return QImage::Format_RGBX8888;
+#endif
+    case WL_SHM_FORMAT_ARGB8888:
+        return QImage::Format_ARGB32_Premultiplied;
+    case WL_SHM_FORMAT_XRGB8888:
+        return QImage::Format_RGB32;
+    default:
+        return QImage::Format_Invalid;
+    }
+}
+
+/**
+ * How a row of @c from pixels turns into a row of @c to pixels.
+ */
+enum class RowKernel {
+    Copy,
+    SetAlpha,
+    SwapRedBlue,
+    SwapRedBlueSetAlpha,
+    Convert, // anything else goes through QImage
+};
+
+static bool isArgbLayout(QImage::Format format)
+{
+    return format == QImage::Format_ARGB32_Premultiplied || format == QImage::Format_RGB32;
+}
+
+static bool isRgbaLayout(QImage::Format format)
+{
+    return format == QImage::Format_RGBA8888_Premultiplied || format == QImage::Format_RGBX8888;
+}
+
+static RowKernel rowKernel(QImage::Format from, QImage::Format to)
+{
+    if (from == to) {
+        return RowKernel::Copy;
+    }
+    // the X channel of an opaque destination is ignored, the A channel of an opaque source
+    // is whatever the client left there
+    const bool setAlpha = (from == QImage::Format_RGB32 || from == QImage::Format_RGBX8888) && to != QImage::Format_RGB32 && to != QImage::Format_RGBX8888;
+    if ((isArgbLayout(from) && isArgbLayout(to)) || (isRgbaLayout(from) && isRgbaLayout(to))) {
+        return setAlpha ? RowKernel::SetAlpha : RowKernel::Copy;
+    }
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if ((isArgbLayout(from) && isRgbaLayout(to)) || (isRgbaLayout(from) && isArgbLayout(to))) {
+        return setAlpha ? RowKernel::SwapRedBlueSetAlpha : RowKernel::SwapRedBlue;
+    }
+#endif
+    return RowKernel::Convert;
+}
+
+template<bool SwapRedBlue, bool SetAlpha>
+static void convertRow(quint32 *dst, const quint32 *src, int count)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    const __m128i alphaGreen = _mm_set1_epi32(0xff00ff00);
+    const __m128i redBlue = _mm_set1_epi32(0x00ff00ff);
+    for (; i + 4 <= count; i += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        if (SwapRedBlue) {
+            const __m128i rb = _mm_and_si128(pixels, redBlue);
+            pixels = _mm_or_si128(_mm_and_si128(pixels, alphaGreen), _mm_or_si128(_mm_srli_epi32(rb, 16), _mm_slli_epi32(rb, 16)));
+        }
+        if (SetAlpha) {
+            pixels = _mm_or_si128(pixels, alpha);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), pixels);
+    }
+#endif
+    for (; i < count; ++i) {
+        quint32 pixel = src[i];
+        if (SwapRedBlue) {
+            pixel = (pixel & 0xff00ff00) | ((pixel >> 16) & 0xff) | ((pixel & 0xff) << 16);
+        }
+        if (SetAlpha) {
+            pixel |= 0xff000000;
+        }
+        dst[i] = pixel;
+    }
+}
+
+static void copyRows(uchar *dst, int dstStride, const QImage &source, QImage::Format to, RowKernel kernel, const QRect &rows)
+{
+    const int width = rows.width();
+    const int bytes = width * source.depth() / 8;
+    if (kernel == RowKernel::Convert) {
+        const QImage converted = source.copy(rows).convertToFormat(to);
+        const int convertedBytes = width * converted.depth() / 8;
+        for (int y = 0; y < rows.height(); ++y) {
+            std::memcpy(dst + (rows.top() + y) * dstStride, converted.constScanLine(y), convertedBytes);
+        }
+        return;
+    }
+    for (int y = rows.top(); y <= rows.bottom(); ++y) {
+        uchar *dstLine = dst + y * dstStride;
+        const uchar *srcLine = source.constScanLine(y);
+        auto dstPixels = reinterpret_cast<quint32 *>(dstLine);
+        auto srcPixels = reinterpret_cast<const quint32 *>(srcLine);
+        switch (kernel) {
+        case RowKernel::Copy:
+            std::memcpy(dstLine, srcLine, bytes);
+            break;
+        case RowKernel::SetAlpha:
+            convertRow<false, true>(dstPixels, srcPixels, width);
+            break;
+        case RowKernel::SwapRedBlue:
+            convertRow<true, false>(dstPixels, srcPixels, width);
+            break;
+        case RowKernel::SwapRedBlueSetAlpha:
+            convertRow<true, true>(dstPixels, srcPixels, width);
+            break;
+        case RowKernel::Convert:
+            Q_UNREACHABLE();
+        }
+    }
+}
+
+WindowCapture::WindowCapture() = default;
+
+WindowCapture::~WindowCapture()
+{
+    for (Target *target : qAsConst(m_targets)) {
+        wl_list_remove(&target->destroyListener.listener.link);
+        QObject::disconnect(target->damageConnection);
+        QObject::disconnect(target->matrixConnection);
+        delete target;
+    }
+}
+
+void WindowCapture::setReadbackFunction(const ClientManagementInterface::ReadbackFunction &function)
+{
+    m_readback = function;
+}
+
+void WindowCapture::destination_destroy_callback(wl_listener *listener, void *data)
+{
+    Q_UNUSED(data)
+    auto destroyListener = reinterpret_cast<DestroyListener *>(listener);
+    Target *target = destroyListener->target;
+    target->capture->removeTarget(target);
+}
+
+WindowCapture::Target *WindowCapture::target(wl_resource *destination)
+{
+    Target *&target = m_targets[destination];
+    if (!target) {
+        target = new Target;
+        target->capture = this;
+        target->destination = destination;
+        target->destroyListener.target = target;
+        target->destroyListener.listener.notify = destination_destroy_callback;
+        wl_resource_add_destroy_listener(destination, &target->destroyListener.listener);
+    }
+    return target;
+}
+
+void WindowCapture::removeTarget(Target *target)
+{
+    wl_list_remove(&target->destroyListener.listener.link);
+    QObject::disconnect(target->damageConnection);
+    QObject::disconnect(target->matrixConnection);
+    m_targets.remove(target->destination);
+    delete target;
+}
+
+bool WindowCapture::capture(SurfaceInterface *surface, wl_resource *destination)
+{
+    if (!surface || !surface->buffer() || !wl_shm_buffer_get(destination)) {
+        return false;
+    }
+    Target *target = this->target(destination);
+
+    if (target->surface != surface) {
+        QObject::disconnect(target->damageConnection);
+        QObject::disconnect(target->matrixConnection);
+        target->surface = surface;
+        target->valid = false;
+        target->damageConnection = QObject::connect(surface, &SurfaceInterface::damaged, [target](const QRegion &damage) {
+            target->damage += damage;
+        });
+        target->matrixConnection = QObject::connect(surface, &SurfaceInterface::surfaceToBufferMatrixChanged, [target]() {
+            target->valid = false;
+        });
+    }
+
+    auto shmBuffer = qobject_cast<ShmClientBuffer *>(surface->buffer());
+    if (!shmBuffer) {
+        // there is no damage tracking for buffers read back by the compositor
+        target->valid = false;
+        target->damage = QRegion();
+        if (!m_readback) {
+            return false;
+        }
+        return access(destination, [this, surface](uchar *data, int width, int height, int stride, QImage::Format format) {
+            QImage image(data, width, height, stride, format);
+            return m_readback(surface->buffer(), image);
+        });
+    }
+
+    const QImage image = shmBuffer->data();
+    if (image.isNull()) {
+        target->valid = false;
+        return false;
+    }
+
+    QRegion rows;
+    if (target->valid && target->sourceSize == image.size() && target->sourceFormat == image.format()) {
+        rows = surface->mapToBuffer(target->damage);
+    } else {
+        rows = QRect(QPoint(0, 0), image.size());
+    }
+    target->damage = QRegion();
+    target->sourceSize = image.size();
+    target->sourceFormat = image.format();
+    target->valid = copy(image, rows, destination);
+    return target->valid;
+}
+
+bool WindowCapture::capture(const QImage &image, wl_resource *destination)
+{
+    if (image.isNull() || !wl_shm_buffer_get(destination)) {
+        return false;
+    }
+    if (Target *target = m_targets.value(destination)) {
+        target->valid = false;
+    }
+    return copy(image, QRect(QPoint(0, 0), image.size()), destination);
+}
+
+bool WindowCapture::copy(const QImage &source, const QRegion &rows, wl_resource *destination)
+{
+    return access(destination, [this, &source, &rows](uchar *data, int width, int height, int stride, QImage::Format format) {
+        const RowKernel kernel = rowKernel(source.format(), format);
+        const QRect bounds = QRect(0, 0, width, height) & source.rect();
+        QRegion bands;
+        for (const QRect &rect : rows) {
+            bands += QRect(bounds.left(), rect.top(), bounds.width(), rect.height());
+        }
+        for (const QRect &rect : bands & bounds) {
+            copyRows(data, stride, source, format, kernel, rect);
+            m_copiedRows += rect.height();
+        }
+        return true;
+    });
+}
+
+bool WindowCapture::access(wl_resource *destination, const std::function<bool(uchar *, int, int, int, QImage::Format)> &write)
+{
+    wl_shm_buffer *buffer = wl_shm_buffer_get(destination);
+    const QImage::Format format = imageFormatForShmFormat(wl_shm_buffer_get_format(buffer));
+    if (format == QImage::Format_Invalid) {
+        qCWarning(KWAYLAND_SERVER) << "Unsupported capture buffer format" << wl_shm_buffer_get_format(buffer);
+        return false;
+    }
+    const int width = wl_shm_buffer_get_width(buffer);
+    const int height = wl_shm_buffer_get_height(buffer);
+    const int stride = wl_shm_buffer_get_stride(buffer);
+
+    uchar *data = static_cast<uchar *>(wl_shm_buffer_get_data(buffer));
+    if (!data) {
+        return false;
+    }
+
+    // The client can truncate the pool under our feet. Use the guarded ranges instead of
+    // wl_shm_buffer_begin_access(), which can only protect a single pool per thread and
+    // installs a SIGBUS handler in front of the guard.
+    const int slot = registerShmGuardRange(data, size_t(stride) * height);
+    if (slot < 0) {
+        qCWarning(KWAYLAND_SERVER) << "Too many shm buffers accessed at once, skipping capture into" << destination;
+        return false;
+    }
+
+    bool succeeded = write(data, width, height, stride, format);
+
+    if (unregisterShmGuardRange(slot)) {
+        wl_resource_post_error(destination, WL_SHM_ERROR_INVALID_FD, "error accessing SHM buffer");
+        succeeded = false;
+    }
+    return succeeded;
+}
+
+}
@@ -0,0 +1,87 @@
+/*
+    SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#pragma once
+
+#include "clientmanagement_interface.h"
+
+#include <QHash>
+#include <QImage>
+#include <QPointer>
+#include <QRegion>
+
+#include <wayland-server-core.h>
+
+#include <functional>
+
+namespace KWaylandServer
+{
+class SurfaceInterface;
+
+/**
+ * Copies window content into client provided wl_shm_buffers.
+ *
+ * A destination buffer remembers which surface it was last filled from. As long as the
+ * same destination is reused for the same surface and nothing about the geometry or the
+ * formats changed, only the rows damaged since the previous capture are copied.
+ */
+class WindowCapture
+{
+public:
+    WindowCapture();
+    ~WindowCapture();
+
+    /**
+     * Copies the current buffer of @p surface into the shm buffer @p destination.
+     * Non shm buffers are read back using the readback function, if any.
+     */
+    bool capture(SurfaceInterface *surface, wl_resource *destination);
+    /**
+     * Copies @p image into the shm buffer @p destination.
+     */
+    bool capture(const QImage &image, wl_resource *destination);
+
+    void setReadbackFunction(const ClientManagementInterface::ReadbackFunction &function);
+
+    /**
+     * The number of rows copied by the captures so far, for testing.
+     */
+    quint64 copiedRows() const
+    {
+        return m_copiedRows;
+    }
+
+private:
+    struct Target;
+    struct DestroyListener {
+        wl_listener listener;
+        Target *target;
+    };
+    struct Target {
+        WindowCapture *capture = nullptr;
+        wl_resource *destination = nullptr;
+        DestroyListener destroyListener;
+
+        QPointer<SurfaceInterface> surface;
+        QMetaObject::Connection damageConnection;
+        QMetaObject::Connection matrixConnection;
+        QRegion damage;
+        QSize sourceSize;
+        QImage::Format sourceFormat = QImage::Format_Invalid;
+        bool valid = false;
+    };
+
+    static void destination_destroy_callback(wl_listener *listener, void *data);
+    Target *target(wl_resource *destination);
+    void removeTarget(Target *target);
+    bool copy(const QImage &source, const QRegion &rows, wl_resource *destination);
+    bool access(wl_resource *destination, const std::function<bool(uchar *, int, int, int, QImage::Format)> &write);
+
+    QHash<wl_resource *, Target *> m_targets;
+    ClientManagementInterface::ReadbackFunction m_readback;
+    quint64 m_copiedRows = 0;
+};
+
+}
@@ -123,10 +123,7 @@ void XdgOutputV1Interface::setLogicalSize(const QSize &size)
     d->size = size;
     d->dirty = true;
 
-    const auto outputResources = d->resourceMap();
-    for (auto resource : outputResources) {
-        d->send_logical_size(resource->handle, size.width(), size.height());
-    }
+    d->broadcast_logical_size(size.width(), size.height());
 }
 
 QSize XdgOutputV1Interface::logicalSize() const
@@ -142,10 +139,7 @@ void XdgOutputV1Interface::setLogicalPosition(const QPoint &pos)
     d->pos = pos;
     d->dirty = true;
 
-    const auto outputResources = d->resourceMap();
-    for (auto resource : outputResources) {
-        d->send_logical_position(resource->handle, pos.x(), pos.y());
-    }
+    d->broadcast_logical_position(pos.x(), pos.y());
 }
 
 QPoint XdgOutputV1Interface::logicalPosition() const
@@ -346,6 +346,8 @@ void XdgToplevelInterfacePrivate::reset()
 
     windowTitle = QString();
     windowClass = QString();
+    windowTitleUtf8 = QByteArray();
+    windowClassUtf8 = QByteArray();
     current = next = State();
 
     Q_EMIT q->resetOccurred();
@@ -374,24 +376,26 @@ void XdgToplevelInterfacePrivate::xdg_toplevel_set_parent(Resource *resource, ::
     Q_EMIT q->parentXdgToplevelChanged();
 }
 
-void XdgToplevelInterfacePrivate::xdg_toplevel_set_title(Resource *resource, const QString &title)
+void XdgToplevelInterfacePrivate::xdg_toplevel_set_title(Resource *resource, QtWaylandServer::Utf8View title)
 {
     Q_UNUSED(resource)
-    if (windowTitle == title) {
+    if (title == windowTitleUtf8) {
         return;
     }
-    windowTitle = title;
-    Q_EMIT q->windowTitleChanged(title);
+    windowTitleUtf8 = title.toByteArray();
+    windowTitle = title.toString();
+    Q_EMIT q->windowTitleChanged(windowTitle);
 }
 
-void XdgToplevelInterfacePrivate::xdg_toplevel_set_app_id(Resource *resource, const QString &app_id)
+void XdgToplevelInterfacePrivate::xdg_toplevel_set_app_id(Resource *resource, QtWaylandServer::Utf8View app_id)
 {
     Q_UNUSED(resource)
-    if (windowClass == app_id) {
+    if (app_id == windowClassUtf8) {
         return;
     }
-    windowClass = app_id;
-    Q_EMIT q->windowClassChanged(app_id);
+    windowClassUtf8 = app_id.toByteArray();
+    windowClass = app_id.toString();
+    Q_EMIT q->windowClassChanged(windowClass);
 }
 
 void XdgToplevelInterfacePrivate::xdg_toplevel_show_window_menu(Resource *resource, ::wl_resource *seatResource, uint32_t serial, int32_t x, int32_t y)
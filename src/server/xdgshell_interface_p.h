@@ -12,6 +12,8 @@
 #include "surface_interface.h"
 #include "surfacerole_p.h"
 
+#include <QMultiMap>
+
 namespace KWaylandServer
 {
 class XdgToplevelDecorationV1Interface;
@@ -138,6 +140,9 @@ public:
 
     QString windowTitle;
     QString windowClass;
+    // the bytes last sent by the client, to skip the conversion of repeated titles
+    QByteArray windowTitleUtf8;
+    QByteArray windowClassUtf8;
 
     struct State {
         QSize minimumSize;
@@ -151,8 +156,8 @@ protected:
     void xdg_toplevel_destroy_resource(Resource *resource) override;
     void xdg_toplevel_destroy(Resource *resource) override;
     void xdg_toplevel_set_parent(Resource *resource, ::wl_resource *parent) override;
-    void xdg_toplevel_set_title(Resource *resource, const QString &title) override;
-    void xdg_toplevel_set_app_id(Resource *resource, const QString &app_id) override;
+    void xdg_toplevel_set_title(Resource *resource, QtWaylandServer::Utf8View title) override;
+    void xdg_toplevel_set_app_id(Resource *resource, QtWaylandServer::Utf8View app_id) override;
     void xdg_toplevel_show_window_menu(Resource *resource, ::wl_resource *seat, uint32_t serial, int32_t x, int32_t y) override;
     void xdg_toplevel_move(Resource *resource, ::wl_resource *seat, uint32_t serial) override;
     void xdg_toplevel_resize(Resource *resource, ::wl_resource *seat, uint32_t serial, uint32_t edges) override;
@@ -79,6 +79,8 @@ private:
         bool request;
         QByteArray name;
         QByteArray type;
+        int since;
+        bool utf8Strings;
         std::vector<WaylandArgument> arguments;
     };
 
@@ -104,9 +106,11 @@ private:
     QByteArray waylandToQtType(const QByteArray &waylandType, const QByteArray &interface, bool cStyleArray);
     const Scanner::WaylandArgument *newIdArgument(const std::vector<WaylandArgument> &arguments);
 
-    void printEvent(const WaylandEvent &e, bool omitNames = false, bool withResource = false);
+    void printEvent(const WaylandEvent &e, bool omitNames = false, bool withResource = false, bool withResources = false);
     void printEventHandlerSignature(const WaylandEvent &e, const char *interfaceName, bool deepIndent = true);
     void printEnums(const std::vector<WaylandEnum> &enums);
+    void printResourceMap();
+    void printUtf8View();
 
     QByteArray stripInterfaceName(const QByteArray &name);
     bool ignoreInterface(const QByteArray &name);
@@ -124,6 +128,7 @@ private:
     QByteArray m_headerPath;
     QByteArray m_prefix;
     QVector <QByteArray> m_includes;
+    QVector <QByteArray> m_utf8Strings;
     QXmlStreamReader *m_xml = nullptr;
 };
 
@@ -150,16 +155,23 @@ bool Scanner::parseArguments(int argc, char **argv)
         // --header-path=<path> (14 characters)
         // --prefix=<prefix> (9 characters)
         // --add-include=<include> (14 characters)
+        // --utf8-strings=<interface[.request]>,... (15 characters)
         for (int pos = 3; pos < argc; pos++) {
             const QByteArray &option = args[pos];
             if (option.startsWith("--header-path=")) {
                 m_headerPath = option.mid(14);
             } else if (option.startsWith("--prefix=")) {
-                m_prefix = option.mid(10);
+                m_prefix = option.mid(9);
             } else if (option.startsWith("--add-include=")) {
                 auto include = option.mid(14);
                 if (!include.isEmpty())
                     m_includes << include;
+            } else if (option.startsWith("--utf8-strings=")) {
+                const QList<QByteArray> names = option.mid(15).split(',');
+                for (const QByteArray &name : names) {
+                    if (!name.isEmpty())
+                        m_utf8Strings << name;
+                }
             } else {
                 return false;
             }
@@ -171,7 +183,7 @@ bool Scanner::parseArguments(int argc, char **argv)
 
 void Scanner::printUsage()
 {
-    fprintf(stderr, "Usage: %s [client-header|server-header|client-code|server-code] specfile [--header-path=<path>] [--prefix=<prefix>] [--add-include=<include>]\n", m_scannerName.constData());
+    fprintf(stderr, "Usage: %s [client-header|server-header|client-code|server-code] specfile [--header-path=<path>] [--prefix=<prefix>] [--add-include=<include>] [--utf8-strings=<interface[.request]>,...]\n", m_scannerName.constData());
 }
 
 bool Scanner::isServerSide()
@@ -220,6 +232,8 @@ Scanner::WaylandEvent Scanner::readEvent(QXmlStreamReader &xml, bool request)
         .request = request,
         .name = byteArrayValue(xml, "name"),
         .type = byteArrayValue(xml, "type"),
+        .since = intValue(xml, "since", 1),
+        .utf8Strings = false,
         .arguments = {},
     };
     while (xml.readNextStartElement()) {
@@ -283,6 +297,12 @@ Scanner::WaylandInterface Scanner::readInterface(QXmlStreamReader &xml)
             xml.skipCurrentElement();
     }
 
+    // Requests opted in with --utf8-strings get their string arguments as Utf8View
+    for (WaylandEvent &request : interface.requests) {
+        request.utf8Strings = m_utf8Strings.contains(interface.name)
+                || m_utf8Strings.contains(interface.name + '.' + request.name);
+    }
+
     return interface;
 }
 
@@ -329,7 +349,7 @@ const Scanner::WaylandArgument *Scanner::newIdArgument(const std::vector<Wayland
     return nullptr;
 }
 
-void Scanner::printEvent(const WaylandEvent &e, bool omitNames, bool withResource)
+void Scanner::printEvent(const WaylandEvent &e, bool omitNames, bool withResource, bool withResources)
 {
     printf("%s(", e.name.constData());
     bool needsComma = false;
@@ -340,6 +360,9 @@ void Scanner::printEvent(const WaylandEvent &e, bool omitNames, bool withResourc
         } else if (withResource) {
             printf("struct ::wl_resource *%s", omitNames ? "" : "resource");
             needsComma = true;
+        } else if (withResources) {
+            printf("const ResourceRange &%s", omitNames ? "" : "resources");
+            needsComma = true;
         }
     }
     for (const WaylandArgument &a : e.arguments) {
@@ -366,6 +389,8 @@ void Scanner::printEvent(const WaylandEvent &e, bool omitNames, bool withResourc
         }
 
         QByteArray qtType = waylandToQtType(a.type, a.interface, e.request == isServerSide());
+        if (isServerSide() && e.utf8Strings && a.type == "string")
+            qtType = "Utf8View";
         printf("%s%s%s", qtType.constData(), qtType.endsWith("&") || qtType.endsWith("*") ? "" : " ", omitNames ? "" : a.name.constData());
     }
     printf(")");
@@ -426,6 +451,163 @@ bool Scanner::ignoreInterface(const QByteArray &name)
            || (isServerSide() && name == "wl_registry");
 }
 
+void Scanner::printResourceMap()
+{
+    // Shared by all generated server headers, so it is guarded separately from the protocol.
+    printf("%s", R"(#ifndef QT_WAYLAND_SERVER_RESOURCE_MAP
+#define QT_WAYLAND_SERVER_RESOURCE_MAP
+    /*
+     * The resources bound to an object, grouped by client. The resources are kept in a flat
+     * array sorted by client, the most recently added resource of a client comes first.
+     *
+     * Copies are implicitly shared, so taking a copy is a cheap way to snapshot the resources
+     * before running code which may destroy some of them. A Range is a view into the map and
+     * must not outlive a modification of it.
+     */
+    template<typename Resource>
+    class ResourceMap
+    {
+    public:
+        typedef typename QVector<Resource *>::const_iterator const_iterator;
+        typedef const_iterator iterator;
+
+        class Range
+        {
+        public:
+            Range() : m_begin(nullptr), m_end(nullptr) {}
+            Range(const_iterator begin, const_iterator end) : m_begin(begin), m_end(end) {}
+
+            const_iterator begin() const { return m_begin; }
+            const_iterator end() const { return m_end; }
+            bool isEmpty() const { return m_begin == m_end; }
+            int count() const { return int(m_end - m_begin); }
+            int size() const { return count(); }
+            Resource *first() const { return *m_begin; }
+            bool contains(Resource *resource) const { return std::find(m_begin, m_end, resource) != m_end; }
+            QList<Resource *> toList() const
+            {
+                QList<Resource *> list;
+                list.reserve(count());
+                for (Resource *resource : *this)
+                    list.append(resource);
+                return list;
+            }
+
+        private:
+            const_iterator m_begin;
+            const_iterator m_end;
+        };
+
+        void insert(struct ::wl_client *client, Resource *resource)
+        {
+            const int index = lowerBound(client);
+            m_clients.insert(index, client);
+            m_resources.insert(index, resource);
+        }
+        bool remove(struct ::wl_client *client, Resource *resource)
+        {
+            for (int index = lowerBound(client); index < m_clients.count() && m_clients.at(index) == client; ++index) {
+                if (m_resources.at(index) == resource) {
+                    m_clients.remove(index);
+                    m_resources.remove(index);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        Range resources() const { return Range(m_resources.constBegin(), m_resources.constEnd()); }
+        Range resources(struct ::wl_client *client) const
+        {
+            const int first = lowerBound(client);
+            int last = first;
+            while (last < m_clients.count() && m_clients.at(last) == client)
+                ++last;
+            return Range(m_resources.constBegin() + first, m_resources.constBegin() + last);
+        }
+        std::pair<const_iterator, const_iterator> equal_range(struct ::wl_client *client) const
+        {
+            const Range range = resources(client);
+            return std::make_pair(range.begin(), range.end());
+        }
+
+        Resource *value(struct ::wl_client *client, Resource *defaultValue = nullptr) const
+        {
+            const Range range = resources(client);
+            return range.isEmpty() ? defaultValue : range.first();
+        }
+        QList<Resource *> values(struct ::wl_client *client) const { return resources(client).toList(); }
+        QList<Resource *> values() const { return resources().toList(); }
+        bool contains(struct ::wl_client *client) const
+        {
+            const int index = lowerBound(client);
+            return index < m_clients.count() && m_clients.at(index) == client;
+        }
+
+        bool isEmpty() const { return m_resources.isEmpty(); }
+        int count() const { return m_resources.count(); }
+        int count(struct ::wl_client *client) const { return resources(client).count(); }
+        int size() const { return count(); }
+
+        const_iterator begin() const { return m_resources.constBegin(); }
+        const_iterator end() const { return m_resources.constEnd(); }
+        const_iterator constBegin() const { return m_resources.constBegin(); }
+        const_iterator constEnd() const { return m_resources.constEnd(); }
+
+    private:
+        int lowerBound(struct ::wl_client *client) const
+        {
+            return int(std::lower_bound(m_clients.constBegin(), m_clients.constEnd(), client, std::less<struct ::wl_client *>()) - m_clients.constBegin());
+        }
+
+        QVector<struct ::wl_client *> m_clients;
+        QVector<Resource *> m_resources;
+    };
+#endif
+)");
+}
+
+void Scanner::printUtf8View()
+{
+    printf("%s", R"(#ifndef QT_WAYLAND_SERVER_UTF8_VIEW
+#define QT_WAYLAND_SERVER_UTF8_VIEW
+    /*
+     * A string argument of a request, viewed as the UTF-8 bytes sent by the client. Requests
+     * opted in with --utf8-strings receive these instead of a QString, so handlers can compare
+     * the bytes with what they already have and only convert a string which actually changed.
+     *
+     * The view is only valid while the request is being handled.
+     */
+    class Utf8View
+    {
+    public:
+        Utf8View() : m_data(nullptr), m_size(0) {}
+        explicit Utf8View(const char *data) : m_data(data), m_size(data ? int(qstrlen(data)) : 0) {}
+
+        const char *data() const { return m_data; }
+        int size() const { return m_size; }
+        bool isNull() const { return !m_data; }
+        bool isEmpty() const { return m_size == 0; }
+
+        QString toString() const { return QString::fromUtf8(m_data, m_size); }
+        QByteArray toByteArray() const { return m_data ? QByteArray(m_data, m_size) : QByteArray(); }
+        // Only valid as long as the view, doesn't copy the bytes
+        QByteArray toRawByteArray() const { return QByteArray::fromRawData(m_data, m_size); }
+
+        bool operator==(const QByteArray &other) const
+        {
+            return m_size == other.size() && (m_size == 0 || std::memcmp(m_data, other.constData(), m_size) == 0);
+        }
+        bool operator!=(const QByteArray &other) const { return !(*this == other); }
+
+    private:
+        const char *m_data;
+        int m_size;
+    };
+#endif
+)");
+}
+
 bool Scanner::process()
 {
     QFile file(m_protocolFilePath);
@@ -484,9 +666,15 @@ bool Scanner::process()
         else
             printf("#include <%s/wayland-%s-server-protocol.h>\n", m_headerPath.constData(), QByteArray(m_protocolName).replace('_', '-').constData());
         printf("#include <QByteArray>\n");
-        printf("#include <QMultiMap>\n");
+        printf("#include <QList>\n");
         printf("#include <QString>\n");
+        printf("#include <QVector>\n");
 
+        printf("\n");
+        printf("#include <algorithm>\n");
+        printf("#include <cstring>\n");
+        printf("#include <functional>\n");
+        printf("#include <utility>\n");
         printf("\n");
         printf("#include <unistd.h>\n");
 
@@ -517,8 +705,10 @@ bool Scanner::process()
         }
         printf("\n");
         printf("namespace QtWaylandServer {\n");
+        printResourceMap();
+        printUtf8View();
 
-        bool needsNewLine = false;
+        bool needsNewLine = true;
         for (const WaylandInterface &interface : interfaces) {
 
             if (ignoreInterface(interface.name))
@@ -569,8 +759,8 @@ bool Scanner::process()
             printf("        Resource *resource() { return m_resource; }\n");
             printf("        const Resource *resource() const { return m_resource; }\n");
             printf("\n");
-            printf("        QMultiMap<struct ::wl_client*, Resource*> resourceMap() { return m_resource_map; }\n");
-            printf("        const QMultiMap<struct ::wl_client*, Resource*> resourceMap() const { return m_resource_map; }\n");
+            printf("        typedef ResourceMap<Resource>::Range ResourceRange;\n");
+            printf("        const ResourceMap<Resource> &resourceMap() const { return m_resource_map; }\n");
             printf("\n");
             printf("        bool isGlobalRemoved() const { return m_globalRemovedEvent; }\n");
             printf("        void globalRemove();\n");
@@ -596,6 +786,14 @@ bool Scanner::process()
                     printf("        void send_");
                     printEvent(e, false, true);
                     printf(";\n");
+                    if (!newIdArgument(e.arguments)) {
+                        printf("        void broadcast_");
+                        printEvent(e);
+                        printf(";\n");
+                        printf("        void broadcast_");
+                        printEvent(e, false, false, true);
+                        printf(";\n");
+                    }
                 }
             }
 
@@ -643,7 +841,7 @@ bool Scanner::process()
             }
 
             printf("\n");
-            printf("        QMultiMap<struct ::wl_client*, Resource*> m_resource_map;\n");
+            printf("        ResourceMap<Resource> m_resource_map;\n");
             printf("        Resource *m_resource;\n");
             printf("        struct ::wl_global *m_global;\n");
             printf("        struct ::wl_display *m_display;\n");
@@ -966,6 +1164,8 @@ bool Scanner::process()
                         const char *argumentName = a.name.constData();
                         if (cType == qtType)
                             printf("            %s", argumentName);
+                        else if (a.type == "string" && e.utf8Strings)
+                            printf("            Utf8View(%s)", argumentName);
                         else if (a.type == "string")
                             printf("            QString::fromUtf8(%s)", argumentName);
                     }
@@ -1031,6 +1231,73 @@ bool Scanner::process()
                 printf(");\n");
                 printf("    }\n");
                 printf("\n");
+
+                // Events which create objects need a new resource per client, they can't be broadcast
+                if (newIdArgument(e.arguments))
+                    continue;
+
+                printf("    void %s::broadcast_", interfaceName);
+                printEvent(e);
+                printf("\n");
+                printf("    {\n");
+                printf("        broadcast_%s(\n", e.name.constData());
+                printf("            m_resource_map.resources()");
+                for (const WaylandArgument &a : e.arguments) {
+                    printf(",\n");
+                    printf("            %s", a.name.constData());
+                }
+                printf(");\n");
+                printf("    }\n");
+                printf("\n");
+
+                printf("    void %s::broadcast_", interfaceName);
+                printEvent(e, false, false, true);
+                printf("\n");
+                printf("    {\n");
+
+                // Convert the arguments once, not once per resource
+                for (const WaylandArgument &a : e.arguments) {
+                    if (a.type == "string") {
+                        printf("        const QByteArray %s_utf8 = %s.toUtf8();\n", a.name.constData(), a.name.constData());
+                        printf("\n");
+                        continue;
+                    }
+                    if (a.type != "array")
+                        continue;
+                    QByteArray array = a.name + "_data";
+                    const char *arrayName = array.constData();
+                    const char *variableName = a.name.constData();
+                    printf("        struct wl_array %s;\n", arrayName);
+                    printf("        %s.size = %s.size();\n", arrayName, variableName);
+                    printf("        %s.data = static_cast<void *>(const_cast<char *>(%s.constData()));\n", arrayName, variableName);
+                    printf("        %s.alloc = 0;\n", arrayName);
+                    printf("\n");
+                }
+
+                printf("        for (Resource *resource : resources) {\n");
+                if (e.since > 1) {
+                    printf("            if (resource->version() < %d)\n", e.since);
+                    printf("                continue;\n");
+                }
+                printf("            %s_send_%s(\n", interfaceName, e.name.constData());
+                printf("                resource->handle");
+
+                for (const WaylandArgument &a : e.arguments) {
+                    printf(",\n");
+                    QByteArray cType = waylandToCType(a.type, a.interface);
+                    QByteArray qtType = waylandToQtType(a.type, a.interface, e.request);
+                    if (a.type == "string")
+                        printf("                %s_utf8.constData()", a.name.constData());
+                    else if (a.type == "array")
+                        printf("                &%s_data", a.name.constData());
+                    else if (cType == qtType)
+                        printf("                %s", a.name.constData());
+                }
+
+                printf(");\n");
+                printf("        }\n");
+                printf("    }\n");
+                printf("\n");
             }
         }
         printf("}\n");